@@ -54,17 +54,31 @@
  * g_buffered_input_stream_set_buffer_size(). Note that the buffer's size 
  * cannot be reduced below the size of the data within the buffer.
  *
+ * A stream that uses the default buffer size grows its buffer while the
+ * data is read sequentially, up to 64 kilobytes, so that large reads 
+ * need fewer calls into the base stream. Setting the buffer size
+ * explicitly turns this off.
+ *
  **/
 
 
 
 #define DEFAULT_BUFFER_SIZE 4096
 
+/* A stream left at the default buffer size grows its buffer after this
+ * many fills in a row were satisfied in full, up to READAHEAD_MAX_SIZE.
+ */
+#define READAHEAD_FILLS 2
+#define READAHEAD_MAX_SIZE (64 * 1024)
+
 struct _GBufferedInputStreamPrivate {
   guint8 *buffer;
   gsize   len;
   gsize   pos;
   gsize   end;
+  gsize   fill_count;
+  guint   n_full_fills;
+  guint   size_set : 1;
   GAsyncReadyCallback outstanding_callback;
 };
 
@@ -127,7 +141,11 @@ static gssize g_buffered_input_stream_real_fill_finish (GBufferedInputStream  *s
 							GAsyncResult          *result,
 							GError               **error);
 
-static void compact_buffer (GBufferedInputStream *stream);
+static void  compact_buffer (GBufferedInputStream *stream);
+static gsize prepare_fill   (GBufferedInputStream *stream,
+                             gssize                count);
+static void  finish_fill    (GBufferedInputStream *stream,
+                             gssize                nread);
 
 G_DEFINE_TYPE (GBufferedInputStream,
                g_buffered_input_stream,
@@ -169,7 +187,7 @@ g_buffered_input_stream_class_init (GBufferedInputStreamClass *klass)
                                                       1,
                                                       G_MAXUINT,
                                                       DEFAULT_BUFFER_SIZE,
-                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
+                                                      G_PARAM_READWRITE |
                                                       G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
 
 
@@ -191,24 +209,13 @@ g_buffered_input_stream_get_buffer_size (GBufferedInputStream  *stream)
   return stream->priv->len;
 }
 
-/**
- * g_buffered_input_stream_set_buffer_size:
- * @stream: #GBufferedInputStream.
- * @size: a #gsize.
- *
- * Sets the size of the internal buffer of @stream to @size, or to the 
- * size of the contents of the buffer. The buffer can never be resized 
- * smaller than its current contents.
- **/
-void
-g_buffered_input_stream_set_buffer_size (GBufferedInputStream  *stream,
-                                         gsize                  size)
+static void
+resize_buffer (GBufferedInputStream *stream,
+               gsize                 size)
 {
   GBufferedInputStreamPrivate *priv;
   gsize in_buffer;
   guint8 *buffer;
-  
-  g_return_if_fail (G_IS_BUFFERED_INPUT_STREAM (stream));
 
   priv = stream->priv;
 
@@ -241,6 +248,27 @@ g_buffered_input_stream_set_buffer_size (GBufferedInputStream  *stream,
   g_object_notify (G_OBJECT (stream), "buffer-size");
 }
 
+/**
+ * g_buffered_input_stream_set_buffer_size:
+ * @stream: #GBufferedInputStream.
+ * @size: a #gsize.
+ *
+ * Sets the size of the internal buffer of @stream to @size, or to the 
+ * size of the contents of the buffer. The buffer can never be resized 
+ * smaller than its current contents.
+ **/
+void
+g_buffered_input_stream_set_buffer_size (GBufferedInputStream  *stream,
+                                         gsize                  size)
+{
+  g_return_if_fail (G_IS_BUFFERED_INPUT_STREAM (stream));
+
+  /* The caller picked a size, don't second-guess it */
+  stream->priv->size_set = TRUE;
+
+  resize_buffer (stream, size);
+}
+
 static void
 g_buffered_input_stream_set_property (GObject      *object,
                                       guint         prop_id,
@@ -310,6 +338,12 @@ g_buffered_input_stream_init (GBufferedInputStream *stream)
   stream->priv = G_TYPE_INSTANCE_GET_PRIVATE (stream,
                                               G_TYPE_BUFFERED_INPUT_STREAM,
                                               GBufferedInputStreamPrivate);
+
+  /* The buffer-size property is only set when the caller asks for a
+   * size, which is what keeps readahead off for explicit sizes.
+   */
+  stream->priv->len = DEFAULT_BUFFER_SIZE;
+  stream->priv->buffer = g_malloc (DEFAULT_BUFFER_SIZE);
 }
 
 
@@ -649,30 +683,91 @@ compact_buffer (GBufferedInputStream *stream)
   priv->end = current_size;
 }
 
-static gssize
-g_buffered_input_stream_real_fill (GBufferedInputStream  *stream,
-                                   gssize                 count,
-                                   GCancellable          *cancellable,
-                                   GError               **error)
+/* Works out how much the next fill should read, and makes room for it.
+ * Data that is already in the buffer is only moved when the space
+ * after it has become too small to be worth reading into; until then
+ * the fill is just shorter than asked for, which callers have to cope
+ * with anyway.
+ */
+static gsize
+prepare_fill (GBufferedInputStream *stream,
+              gssize                count)
 {
   GBufferedInputStreamPrivate *priv;
-  GInputStream *base_stream;
-  gssize nread;
   gsize in_buffer;
 
   priv = stream->priv;
 
-  if (count == -1)
-    count = priv->len;
-  
   in_buffer = priv->end - priv->pos;
 
+  if (in_buffer == 0)
+    {
+      priv->pos = 0;
+      priv->end = 0;
+    }
+
+  if (count == -1 || count >= priv->len)
+    {
+      /* The reader keeps draining the buffer, read ahead more */
+      if (!priv->size_set &&
+          priv->n_full_fills >= READAHEAD_FILLS &&
+          priv->len < READAHEAD_MAX_SIZE &&
+          in_buffer <= priv->len / 4)
+        {
+          resize_buffer (stream, MIN (2 * priv->len, READAHEAD_MAX_SIZE));
+          priv->n_full_fills = 0;
+        }
+
+      count = priv->len;
+    }
+
   /* Never fill more than can fit in the buffer */
   count = MIN (count, priv->len - in_buffer);
 
-  /* If requested length does not fit at end, compact */
   if (priv->len - priv->end < count)
-    compact_buffer (stream);
+    {
+      if (priv->len - priv->end > 0 &&
+          priv->len - priv->end >= priv->len / 4)
+        count = priv->len - priv->end;
+      else
+        compact_buffer (stream);
+    }
+
+  priv->fill_count = count;
+
+  return count;
+}
+
+static void
+finish_fill (GBufferedInputStream *stream,
+             gssize                nread)
+{
+  GBufferedInputStreamPrivate *priv;
+
+  priv = stream->priv;
+
+  if (nread > 0)
+    priv->end += nread;
+
+  if (nread > 0 && nread == priv->fill_count)
+    priv->n_full_fills++;
+  else
+    priv->n_full_fills = 0;
+}
+
+static gssize
+g_buffered_input_stream_real_fill (GBufferedInputStream  *stream,
+                                   gssize                 count,
+                                   GCancellable          *cancellable,
+                                   GError               **error)
+{
+  GBufferedInputStreamPrivate *priv;
+  GInputStream *base_stream;
+  gssize nread;
+
+  priv = stream->priv;
+
+  count = prepare_fill (stream, count);
 
   base_stream = G_FILTER_INPUT_STREAM (stream)->base_stream;
   nread = g_input_stream_read (base_stream,
@@ -681,8 +776,7 @@ g_buffered_input_stream_real_fill (GBufferedInputStream  *stream,
                                cancellable,
                                error);
 
-  if (nread > 0)
-    priv->end += nread;
+  finish_fill (stream, nread);
   
   return nread;
 }
@@ -953,7 +1047,7 @@ fill_async_callback (GObject      *source_object,
       priv = G_BUFFERED_INPUT_STREAM (object)->priv;
 
       g_assert_cmpint (priv->end + res, <=, priv->len);
-      priv->end += res;
+      finish_fill (G_BUFFERED_INPUT_STREAM (object), res);
 
       g_object_unref (object);
     }
@@ -974,21 +1068,10 @@ g_buffered_input_stream_real_fill_async (GBufferedInputStream *stream,
   GBufferedInputStreamPrivate *priv;
   GInputStream *base_stream;
   GSimpleAsyncResult *simple;
-  gsize in_buffer;
 
   priv = stream->priv;
 
-  if (count == -1)
-    count = priv->len;
-  
-  in_buffer = priv->end - priv->pos;
-
-  /* Never fill more than can fit in the buffer */
-  count = MIN (count, priv->len - in_buffer);
-
-  /* If requested length does not fit at end, compact */
-  if (priv->len - priv->end < count)
-    compact_buffer (stream);
+  count = prepare_fill (stream, count);
 
   simple = g_simple_async_result_new (G_OBJECT (stream),
 				      callback, user_data,
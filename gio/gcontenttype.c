@@ -391,21 +391,139 @@ g_content_type_guess_for_tree (GFile *root)
 #else /* !G_OS_WIN32 - Unix specific version */
 
 #include <dirent.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 
 #define XDG_PREFIX _gio_xdg
 #include "xdgmime/xdgmime.h"
 
-/* We lock this mutex whenever we modify global state in this module.  */
+/* Lookups in the xdgmime database don't take a lock. A thread doing
+ * a lookup is counted in xdgmime_readers, and the database is only
+ * reloaded, with gio_xdgmime held, once that count has dropped to
+ * zero. While a reload is pending, new lookups wait for it on
+ * gio_xdgmime instead of entering.
+ *
+ * As xdgmime used to do, the files are stat()ed at most every 5
+ * seconds to find out whether a reload is needed. That check runs
+ * under gio_xdgmime but alongside lookups, so they only have to wait
+ * when something actually changed.
+ */
 G_LOCK_DEFINE_STATIC (gio_xdgmime);
+static volatile gint xdgmime_readers = 0;
+static volatile gint xdgmime_valid = FALSE;
+static volatile gint xdgmime_next_check = 0;
+
+#define XDGMIME_CHECK_INTERVAL 5
+
+#ifdef G_ENABLE_DEBUG
+/* The lookup depth of the current thread. A nested lookup would
+ * wait forever for a pending reload, which waits for it in turn.
+ */
+static GStaticPrivate xdgmime_depth = G_STATIC_PRIVATE_INIT;
+#endif
+
+static gboolean
+xdgmime_check_due (void)
+{
+  GTimeVal now;
+
+  g_get_current_time (&now);
+
+  return now.tv_sec >= g_atomic_int_get (&xdgmime_next_check);
+}
+
+static void
+xdgmime_update (void)
+{
+  GTimeVal now;
+  gboolean reload, changed;
+
+  G_LOCK (gio_xdgmime);
+
+  reload = !g_atomic_int_get (&xdgmime_valid);
+  changed = FALSE;
+
+  if (!reload && xdgmime_check_due ())
+    {
+      g_get_current_time (&now);
+      g_atomic_int_set (&xdgmime_next_check, now.tv_sec + XDGMIME_CHECK_INTERVAL);
+
+      if (xdg_mime_needs_update ())
+	{
+	  /* Keep new lookups out until the reload is done. This
+	   * must be a full barrier, or the readers could be counted
+	   * before a lookup that still sees the database as valid.
+	   */
+	  g_atomic_int_compare_and_exchange (&xdgmime_valid, TRUE, FALSE);
+	  reload = changed = TRUE;
+	}
+    }
+
+  if (reload)
+    {
+      while (g_atomic_int_get (&xdgmime_readers) > 0)
+	g_thread_yield ();
+
+      xdg_mime_set_auto_reload (FALSE);
+      xdg_mime_update (changed);
+
+      g_get_current_time (&now);
+      g_atomic_int_set (&xdgmime_next_check, now.tv_sec + XDGMIME_CHECK_INTERVAL);
+      g_atomic_int_compare_and_exchange (&xdgmime_valid, FALSE, TRUE);
+    }
+
+  G_UNLOCK (gio_xdgmime);
+}
+
+static void
+xdgmime_lookup_begin (void)
+{
+#ifdef G_ENABLE_DEBUG
+  gint depth;
+
+  depth = GPOINTER_TO_INT (g_static_private_get (&xdgmime_depth));
+  if (depth != 0)
+    g_error ("Nested lookups in the xdgmime database are not allowed");
+  g_static_private_set (&xdgmime_depth, GINT_TO_POINTER (depth + 1), NULL);
+#endif
+
+  while (TRUE)
+    {
+      g_atomic_int_inc (&xdgmime_readers);
+
+      /* The other half of the barrier in xdgmime_update() */
+      if (G_LIKELY (g_atomic_int_compare_and_exchange (&xdgmime_valid, TRUE, TRUE) &&
+		    !xdgmime_check_due ()))
+	return;
+
+      g_atomic_int_add (&xdgmime_readers, -1);
+      xdgmime_update ();
+    }
+}
+
+static void
+xdgmime_lookup_end (void)
+{
+  g_atomic_int_add (&xdgmime_readers, -1);
+
+#ifdef G_ENABLE_DEBUG
+  g_static_private_set (&xdgmime_depth, GINT_TO_POINTER (0), NULL);
+#endif
+}
+
+static char    *mime_info_get_description (const char  *type);
+static gboolean mime_info_get_icons       (const char  *type,
+					   char       **icon,
+					   char       **generic_icon);
 
 gsize
 _g_unix_content_type_get_sniff_len (void)
 {
   gsize size;
 
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   size = xdg_mime_get_max_buffer_extents ();
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
 
   return size;
 }
@@ -415,9 +533,9 @@ _g_unix_content_type_unalias (const char *type)
 {
   char *res;
   
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   res = g_strdup (xdg_mime_unalias_mime_type (type));
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
   
   return res;
 }
@@ -432,7 +550,7 @@ _g_unix_content_type_get_parents (const char *type)
 
   array = g_ptr_array_new ();
   
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   
   umime = xdg_mime_unalias_mime_type (type);
   
@@ -444,7 +562,7 @@ _g_unix_content_type_get_parents (const char *type)
   
   free (parents);
   
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
   
   g_ptr_array_add (array, NULL);
   
@@ -470,9 +588,9 @@ g_content_type_equals (const char *type1,
   g_return_val_if_fail (type1 != NULL, FALSE);
   g_return_val_if_fail (type2 != NULL, FALSE);
   
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   res = xdg_mime_mime_type_equal (type1, type2);
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
 	
   return res;
 }
@@ -496,9 +614,9 @@ g_content_type_is_a (const char *type,
   g_return_val_if_fail (type != NULL, FALSE);
   g_return_val_if_fail (supertype != NULL, FALSE);
   
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   res = xdg_mime_mime_type_subclass (type, supertype);
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
 	
   return res;
 }
@@ -675,7 +793,7 @@ load_comment_for_mime (const char *mimetype)
     }
   g_free (basename);
   
-  return g_strdup_printf (_("%s type"), mimetype);
+  return NULL;
 }
 
 /**
@@ -689,31 +807,18 @@ load_comment_for_mime (const char *mimetype)
 char *
 g_content_type_get_description (const char *type)
 {
-  static GHashTable *type_comment_cache = NULL;
-  char *comment;
+  char *umime, *comment;
 
   g_return_val_if_fail (type != NULL, NULL);
   
-  G_LOCK (gio_xdgmime);
-  type = xdg_mime_unalias_mime_type (type);
+  xdgmime_lookup_begin ();
+  umime = g_strdup (xdg_mime_unalias_mime_type (type));
+  xdgmime_lookup_end ();
 
-  if (type_comment_cache == NULL)
-    type_comment_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-
-  comment = g_hash_table_lookup (type_comment_cache, type);
-  comment = g_strdup (comment);
-  G_UNLOCK (gio_xdgmime);
-  
-  if (comment != NULL)
-    return comment;
-
-  comment = load_comment_for_mime (type);
-  
-  G_LOCK (gio_xdgmime);
-  g_hash_table_insert (type_comment_cache,
-		       g_strdup (type),
-		       g_strdup (comment));
-  G_UNLOCK (gio_xdgmime);
+  comment = mime_info_get_description (umime);
+  if (comment == NULL)
+    comment = g_strdup_printf (_("%s type"), umime);
+  g_free (umime);
 
   return comment;
 }
@@ -755,10 +860,13 @@ g_content_type_get_icon (const char *type)
   
   g_return_val_if_fail (type != NULL, NULL);
   
-  G_LOCK (gio_xdgmime);
-  xdg_mimetype_icon = g_strdup (xdg_mime_get_icon (type));
-  xdg_mimetype_generic_icon = g_strdup (xdg_mime_get_generic_icon (type));
-  G_UNLOCK (gio_xdgmime);
+  if (!mime_info_get_icons (type, &xdg_mimetype_icon, &xdg_mimetype_generic_icon))
+    {
+      xdgmime_lookup_begin ();
+      xdg_mimetype_icon = g_strdup (xdg_mime_get_icon (type));
+      xdg_mimetype_generic_icon = g_strdup (xdg_mime_get_generic_icon (type));
+      xdgmime_lookup_end ();
+    }
 
   mimetype_icon = g_strdup (type);
   
@@ -855,10 +963,10 @@ g_content_type_from_mime_type (const char *mime_type)
 
   g_return_val_if_fail (mime_type != NULL, NULL);
 
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   /* mime type and content type are same on unixes */
   umime = g_strdup (xdg_mime_unalias_mime_type (mime_type));
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
 
   return umime;
 }
@@ -898,7 +1006,7 @@ g_content_type_guess (const char   *filename,
   if (result_uncertain)
     *result_uncertain = FALSE;
   
-  G_LOCK (gio_xdgmime);
+  xdgmime_lookup_begin ();
   
   if (filename)
     {
@@ -922,7 +1030,7 @@ g_content_type_guess (const char   *filename,
   /* Got an extension match, and no conflicts. This is it. */
   if (n_name_mimetypes == 1)
     {
-      G_UNLOCK (gio_xdgmime);
+      xdgmime_lookup_end ();
       return g_strdup (name_mimetypes[0]);
     }
   
@@ -987,7 +1095,7 @@ g_content_type_guess (const char   *filename,
 	}
     }
   
-  G_UNLOCK (gio_xdgmime);
+  xdgmime_lookup_end ();
 
   return mimetype;
 }
@@ -1086,11 +1194,7 @@ g_content_types_get_registered (void)
 }
 
 
-/* tree magic data */
-static GList *tree_matches = NULL;
-static gboolean need_reload = FALSE;
-
-G_LOCK_DEFINE_STATIC (gio_treemagic);
+/* tree magic data, only used while building the mime info cache */
 
 typedef struct 
 {
@@ -1218,9 +1322,10 @@ cmp_match (gconstpointer a, gconstpointer b)
 }
 
 static void
-insert_match (TreeMatch *match)
+insert_match (GList     **tree_matches,
+	      TreeMatch  *match)
 {
-  tree_matches = g_list_insert_sorted (tree_matches, match, cmp_match);
+  *tree_matches = g_list_insert_sorted (*tree_matches, match, cmp_match);
 }
 
 static void
@@ -1261,7 +1366,8 @@ insert_matchlet (TreeMatch    *match,
 }
 
 static void
-read_tree_magic_from_directory (const gchar *prefix)
+read_tree_magic_from_directory (const gchar  *prefix,
+				GList       **tree_matches)
 {
   gchar *filename;
   gchar *text;
@@ -1285,7 +1391,7 @@ read_tree_magic_from_directory (const gchar *prefix)
               if (lines[i][0] == '[') 
                 {
                   match = parse_header (lines[i]);
-                  insert_match (match);
+                  insert_match (tree_matches, match);
                 }
               else 
                 {
@@ -1306,48 +1412,769 @@ read_tree_magic_from_directory (const gchar *prefix)
 }
 
 
+/* The mime info cache
+ *
+ * Descriptions, icons and tree magic rules are kept in a binary file
+ * in the user cache directory. The first process that needs them builds
+ * it from the mime database, which means parsing an XML file for every
+ * type, and all later processes just map it. There is one file for
+ * each set of data directories and languages.
+ *
+ * The file records the mtimes of the mime directories it was built from,
+ * and is rebuilt when any of them changed, as happens whenever
+ * update-mime-database runs. If it can't be written, the data is used
+ * from memory.
+ *
+ * All integers are 32 bit in host byte order, and all offsets are from
+ * the start of the file. Strings are nul-terminated, 0 means no string.
+ * Types are sorted by name, tree matches by priority, and the children
+ * of a tree matchlet are stored next to each other.
+ */
+
+#define MIME_INFO_MAGIC "GIOMINFO"
+#define MIME_INFO_VERSION 1
+
+typedef struct
+{
+  gchar magic[8];
+  guint32 version;
+  guint32 size;
+  guint32 languages;
+  guint32 dirs;
+  guint32 n_dirs;
+  guint32 types;
+  guint32 n_types;
+  guint32 tree_matches;
+  guint32 n_tree_matches;
+  guint32 tree_matchlets;
+  guint32 n_tree_matchlets;
+} MimeInfoHeader;
+
+typedef struct
+{
+  guint32 path;
+  guint32 mtime;
+  guint32 mtime_nsec;
+} MimeInfoDir;
+
+typedef struct
+{
+  guint32 name;
+  guint32 comment;
+  guint32 icon;
+  guint32 generic_icon;
+} MimeInfoType;
+
+typedef struct
+{
+  guint32 contenttype;
+  gint32 priority;
+  guint32 first_matchlet;
+  guint32 n_matchlets;
+} MimeInfoTreeMatch;
+
+typedef struct
+{
+  guint32 path;
+  guint32 mimetype;
+  guint32 type;
+  guint32 flags;
+  guint32 first_child;
+  guint32 n_children;
+} MimeInfoTreeMatchlet;
+
+typedef enum
+{
+  TREE_MATCHLET_MATCH_CASE = 1 << 0,
+  TREE_MATCHLET_EXECUTABLE = 1 << 1,
+  TREE_MATCHLET_NON_EMPTY  = 1 << 2,
+  TREE_MATCHLET_ON_DISC    = 1 << 3
+} TreeMatchletFlags;
+
+typedef struct
+{
+  volatile gint ref_count;
+  GMappedFile *file;
+  const gchar *data;
+  gsize size;
+  gboolean complete;
+} MimeInfo;
+
+typedef struct
+{
+  GArray *dirs;
+  GArray *types;
+  GArray *tree_matches;
+  GArray *tree_matchlets;
+  GString *strings;
+  GHashTable *string_offsets;
+} MimeInfoBuilder;
+
+G_LOCK_DEFINE_STATIC (mime_info);
+static MimeInfo *mime_info = NULL;
+static volatile gint mime_info_changed = TRUE;
+static gboolean mime_info_building = FALSE;
+static gboolean mime_info_unwritable = FALSE;
+
+static const char * const *
+mime_info_get_data_dirs (void)
+{
+  static const char **dirs = NULL;
+  const char * const *system_dirs;
+  int i, j, n;
+
+  /* Only called with mime_info held */
+  if (dirs == NULL)
+    {
+      system_dirs = g_get_system_data_dirs ();
+      dirs = g_new (const char *, g_strv_length ((char **) system_dirs) + 2);
+      dirs[0] = g_get_user_data_dir ();
+      n = 1;
+      for (i = 0; system_dirs[i] != NULL; i++)
+	{
+	  /* Don't read the same tree magic twice */
+	  for (j = 0; j < n; j++)
+	    if (strcmp (dirs[j], system_dirs[i]) == 0)
+	      break;
+	  if (j == n)
+	    dirs[n++] = system_dirs[i];
+	}
+      dirs[n] = NULL;
+    }
+
+  return dirs;
+}
+
+static char *
+mime_info_get_languages (void)
+{
+  return g_strjoinv (":", (char **) g_get_language_names ());
+}
+
+static void
+mime_info_stat_dir (const char  *dir,
+		    MimeInfoDir *entry)
+{
+  struct stat st;
+  char *path;
+
+  path = g_build_filename (dir, "mime", NULL);
+  entry->mtime = 0;
+  entry->mtime_nsec = 0;
+  if (g_stat (path, &st) == 0)
+    {
+      entry->mtime = st.st_mtime;
+#if defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+      entry->mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+    }
+  g_free (path);
+}
+
+static const char *
+mime_info_string (MimeInfo *info,
+		  guint32   offset)
+{
+  /* The file ends with a nul, so every offset inside it is a string */
+  if (offset == 0 || offset >= info->size)
+    return NULL;
+
+  return info->data + offset;
+}
+
+static gboolean
+mime_info_table_is_valid (gsize   size,
+			  guint32 offset,
+			  guint32 n_entries,
+			  gsize   entry_size)
+{
+  return offset % 4 == 0 &&
+	 offset <= size &&
+	 n_entries <= (size - offset) / entry_size;
+}
+
+static gboolean
+mime_info_is_valid (MimeInfo *info)
+{
+  const MimeInfoHeader *header;
+  const MimeInfoDir *dirs;
+  const char * const *data_dirs;
+  MimeInfoDir current;
+  const char *path;
+  char *languages;
+  gboolean valid;
+  guint32 i;
+
+  header = (const MimeInfoHeader *) info->data;
+
+  if (info->size < sizeof (MimeInfoHeader) ||
+      memcmp (header->magic, MIME_INFO_MAGIC, sizeof (header->magic)) != 0 ||
+      header->version != MIME_INFO_VERSION ||
+      header->size != info->size ||
+      info->data[info->size - 1] != 0 ||
+      !mime_info_table_is_valid (info->size, header->dirs, header->n_dirs, sizeof (MimeInfoDir)) ||
+      !mime_info_table_is_valid (info->size, header->types, header->n_types, sizeof (MimeInfoType)) ||
+      !mime_info_table_is_valid (info->size, header->tree_matches, header->n_tree_matches, sizeof (MimeInfoTreeMatch)) ||
+      !mime_info_table_is_valid (info->size, header->tree_matchlets, header->n_tree_matchlets, sizeof (MimeInfoTreeMatchlet)))
+    return FALSE;
+
+  languages = mime_info_get_languages ();
+  valid = g_strcmp0 (mime_info_string (info, header->languages), languages) == 0;
+  g_free (languages);
+  if (!valid)
+    return FALSE;
+
+  data_dirs = mime_info_get_data_dirs ();
+  dirs = (const MimeInfoDir *) (info->data + header->dirs);
+  for (i = 0; i < header->n_dirs; i++)
+    {
+      path = mime_info_string (info, dirs[i].path);
+      if (data_dirs[i] == NULL || g_strcmp0 (path, data_dirs[i]) != 0)
+	return FALSE;
+
+      mime_info_stat_dir (data_dirs[i], &current);
+      if (current.mtime != dirs[i].mtime || current.mtime_nsec != dirs[i].mtime_nsec)
+	return FALSE;
+    }
+
+  return data_dirs[i] == NULL;
+}
+
+static guint32
+mime_info_builder_add_string (MimeInfoBuilder *builder,
+			      const char      *str)
+{
+  gpointer offset;
+
+  if (str == NULL)
+    return 0;
+
+  offset = g_hash_table_lookup (builder->string_offsets, str);
+  if (offset == NULL)
+    {
+      offset = GUINT_TO_POINTER (builder->strings->len);
+      g_string_append_len (builder->strings, str, strlen (str) + 1);
+      g_hash_table_insert (builder->string_offsets, g_strdup (str), offset);
+    }
+
+  return GPOINTER_TO_UINT (offset);
+}
+
+static guint32
+mime_info_builder_add_tree_matchlets (MimeInfoBuilder *builder,
+				      GList           *matchlets)
+{
+  MimeInfoTreeMatchlet *entry;
+  TreeMatchlet *matchlet;
+  guint32 first, first_child;
+  GList *l;
+  int i;
+
+  first = builder->tree_matchlets->len;
+  g_array_set_size (builder->tree_matchlets, first + g_list_length (matchlets));
+
+  for (l = matchlets, i = 0; l != NULL; l = l->next, i++)
+    {
+      matchlet = l->data;
+      first_child = mime_info_builder_add_tree_matchlets (builder, matchlet->matches);
+
+      entry = &g_array_index (builder->tree_matchlets, MimeInfoTreeMatchlet, first + i);
+      entry->path = mime_info_builder_add_string (builder, matchlet->path);
+      entry->mimetype = mime_info_builder_add_string (builder, matchlet->mimetype);
+      entry->type = matchlet->type;
+      entry->flags = (matchlet->match_case ? TREE_MATCHLET_MATCH_CASE : 0) |
+		     (matchlet->executable ? TREE_MATCHLET_EXECUTABLE : 0) |
+		     (matchlet->non_empty ? TREE_MATCHLET_NON_EMPTY : 0) |
+		     (matchlet->on_disc ? TREE_MATCHLET_ON_DISC : 0);
+      entry->first_child = first_child;
+      entry->n_children = g_list_length (matchlet->matches);
+    }
+
+  return first;
+}
+
+static gint
+compare_strings (gconstpointer a,
+		 gconstpointer b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
 static void
-xdg_mime_reload (void *user_data)
+mime_info_builder_fix_string (guint32 *offset,
+			      guint32  base)
 {
-  need_reload = TRUE;
+  if (*offset != 0)
+    *offset += base;
 }
 
-static void 
-tree_magic_shutdown (void)
+/* Only the tree magic is cheap to read, the types need one XML
+ * file each for their description. Without @complete the types
+ * are left out.
+ */
+static gchar *
+mime_info_build (gboolean  complete,
+		 gsize    *size)
 {
+  MimeInfoBuilder builder;
+  MimeInfoHeader header = { MIME_INFO_MAGIC };
+  const char * const *data_dirs;
+  GHashTable *mimetypes;
+  GHashTableIter iter;
+  GPtrArray *names;
+  GList *tree_matches, *l;
+  GString *data;
+  char *languages;
+  gpointer key;
+  guint32 base, i;
+
+  builder.dirs = g_array_new (FALSE, TRUE, sizeof (MimeInfoDir));
+  builder.types = g_array_new (FALSE, TRUE, sizeof (MimeInfoType));
+  builder.tree_matches = g_array_new (FALSE, TRUE, sizeof (MimeInfoTreeMatch));
+  builder.tree_matchlets = g_array_new (FALSE, TRUE, sizeof (MimeInfoTreeMatchlet));
+  builder.strings = g_string_new (NULL);
+  builder.string_offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* Offset 0 in the strings is taken, it means no string */
+  g_string_append_c (builder.strings, 0);
+
+  /* Take the mtimes first, so changes made while
+   * building cause a rebuild the next time around.
+   */
+  data_dirs = mime_info_get_data_dirs ();
+  mimetypes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (i = 0; data_dirs[i] != NULL; i++)
+    {
+      MimeInfoDir dir;
+
+      mime_info_stat_dir (data_dirs[i], &dir);
+      dir.path = mime_info_builder_add_string (&builder, data_dirs[i]);
+      g_array_append_val (builder.dirs, dir);
+
+      if (complete)
+	enumerate_mimetypes_dir (data_dirs[i], mimetypes);
+    }
+
+  languages = mime_info_get_languages ();
+  header.languages = mime_info_builder_add_string (&builder, languages);
+  g_free (languages);
+
+  names = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, mimetypes);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    g_ptr_array_add (names, key);
+  g_ptr_array_sort (names, compare_strings);
+
+  for (i = 0; i < names->len; i++)
+    {
+      MimeInfoType type;
+      const char *name;
+      char *comment;
+
+      name = g_ptr_array_index (names, i);
+      type.name = mime_info_builder_add_string (&builder, name);
+      comment = load_comment_for_mime (name);
+      type.comment = mime_info_builder_add_string (&builder, comment);
+      g_free (comment);
+
+      xdgmime_lookup_begin ();
+      type.icon = mime_info_builder_add_string (&builder, xdg_mime_get_icon (name));
+      type.generic_icon = mime_info_builder_add_string (&builder, xdg_mime_get_generic_icon (name));
+      xdgmime_lookup_end ();
+
+      g_array_append_val (builder.types, type);
+    }
+
+  g_ptr_array_free (names, TRUE);
+  g_hash_table_destroy (mimetypes);
+
+  tree_matches = NULL;
+  for (i = 0; data_dirs[i] != NULL; i++)
+    read_tree_magic_from_directory (data_dirs[i], &tree_matches);
+
+  for (l = tree_matches; l != NULL; l = l->next)
+    {
+      TreeMatch *match = l->data;
+      MimeInfoTreeMatch entry;
+
+      entry.contenttype = mime_info_builder_add_string (&builder, match->contenttype);
+      entry.priority = match->priority;
+      entry.first_matchlet = mime_info_builder_add_tree_matchlets (&builder, match->matches);
+      entry.n_matchlets = g_list_length (match->matches);
+      g_array_append_val (builder.tree_matches, entry);
+    }
+
   g_list_foreach (tree_matches, (GFunc)tree_match_free, NULL);
   g_list_free (tree_matches);
-  tree_matches = NULL;
+
+  /* Lay out the file, and point the strings into it */
+  header.version = MIME_INFO_VERSION;
+  header.dirs = sizeof (MimeInfoHeader);
+  header.n_dirs = builder.dirs->len;
+  header.types = header.dirs + header.n_dirs * sizeof (MimeInfoDir);
+  header.n_types = builder.types->len;
+  header.tree_matches = header.types + header.n_types * sizeof (MimeInfoType);
+  header.n_tree_matches = builder.tree_matches->len;
+  header.tree_matchlets = header.tree_matches + header.n_tree_matches * sizeof (MimeInfoTreeMatch);
+  header.n_tree_matchlets = builder.tree_matchlets->len;
+  base = header.tree_matchlets + header.n_tree_matchlets * sizeof (MimeInfoTreeMatchlet);
+  header.size = base + builder.strings->len;
+
+  mime_info_builder_fix_string (&header.languages, base);
+  for (i = 0; i < builder.dirs->len; i++)
+    mime_info_builder_fix_string (&g_array_index (builder.dirs, MimeInfoDir, i).path, base);
+  for (i = 0; i < builder.types->len; i++)
+    {
+      MimeInfoType *type = &g_array_index (builder.types, MimeInfoType, i);
+
+      mime_info_builder_fix_string (&type->name, base);
+      mime_info_builder_fix_string (&type->comment, base);
+      mime_info_builder_fix_string (&type->icon, base);
+      mime_info_builder_fix_string (&type->generic_icon, base);
+    }
+  for (i = 0; i < builder.tree_matches->len; i++)
+    mime_info_builder_fix_string (&g_array_index (builder.tree_matches, MimeInfoTreeMatch, i).contenttype, base);
+  for (i = 0; i < builder.tree_matchlets->len; i++)
+    {
+      MimeInfoTreeMatchlet *matchlet = &g_array_index (builder.tree_matchlets, MimeInfoTreeMatchlet, i);
+
+      mime_info_builder_fix_string (&matchlet->path, base);
+      mime_info_builder_fix_string (&matchlet->mimetype, base);
+    }
+
+  data = g_string_sized_new (header.size);
+  g_string_append_len (data, (gchar *) &header, sizeof (MimeInfoHeader));
+  g_string_append_len (data, builder.dirs->data, builder.dirs->len * sizeof (MimeInfoDir));
+  g_string_append_len (data, builder.types->data, builder.types->len * sizeof (MimeInfoType));
+  g_string_append_len (data, builder.tree_matches->data, builder.tree_matches->len * sizeof (MimeInfoTreeMatch));
+  g_string_append_len (data, builder.tree_matchlets->data, builder.tree_matchlets->len * sizeof (MimeInfoTreeMatchlet));
+  g_string_append_len (data, builder.strings->str, builder.strings->len);
+
+  g_array_free (builder.dirs, TRUE);
+  g_array_free (builder.types, TRUE);
+  g_array_free (builder.tree_matches, TRUE);
+  g_array_free (builder.tree_matchlets, TRUE);
+  g_string_free (builder.strings, TRUE);
+  g_hash_table_destroy (builder.string_offsets);
+
+  *size = data->len;
+  return g_string_free (data, FALSE);
+}
+
+static MimeInfo *
+mime_info_new_from_file (const char *filename)
+{
+  GMappedFile *file;
+  MimeInfo *info;
+
+  file = g_mapped_file_new (filename, FALSE, NULL);
+  if (file == NULL)
+    return NULL;
+
+  info = g_slice_new (MimeInfo);
+  info->ref_count = 1;
+  info->file = file;
+  info->data = g_mapped_file_get_contents (file);
+  info->size = g_mapped_file_get_length (file);
+  info->complete = TRUE;
+
+  return info;
+}
+
+static MimeInfo *
+mime_info_new_from_data (gchar *data,
+			 gsize  size)
+{
+  MimeInfo *info;
+
+  info = g_slice_new (MimeInfo);
+  info->ref_count = 1;
+  info->file = NULL;
+  info->data = data;
+  info->size = size;
+  info->complete = FALSE;
+
+  return info;
+}
+
+static MimeInfo *
+mime_info_ref (MimeInfo *info)
+{
+  g_atomic_int_inc (&info->ref_count);
+  return info;
 }
 
 static void
-tree_magic_init (void)
+mime_info_unref (MimeInfo *info)
 {
-  static gboolean initialized = FALSE;
-  const gchar *dir;
-  const gchar * const * dirs;
+  if (g_atomic_int_dec_and_test (&info->ref_count))
+    {
+      if (info->file)
+	g_mapped_file_free (info->file);
+      else
+	g_free ((gchar *) info->data);
+      g_slice_free (MimeInfo, info);
+    }
+}
+
+static char *
+mime_info_get_filename (void)
+{
+  const char * const *data_dirs;
+  GString *key;
+  char *languages, *basename, *filename;
   int i;
 
-  if (!initialized) 
+  /* The file is only valid for one set of languages, directories
+   * and byte order, so these are all part of its name.
+   */
+  languages = mime_info_get_languages ();
+  key = g_string_new (languages);
+  g_free (languages);
+  data_dirs = mime_info_get_data_dirs ();
+  for (i = 0; data_dirs[i] != NULL; i++)
+    g_string_append_printf (key, ":%s", data_dirs[i]);
+
+  basename = g_strdup_printf ("mime-info-%s-%08x.cache",
+			      G_BYTE_ORDER == G_LITTLE_ENDIAN ? "le" : "be",
+			      g_str_hash (key->str));
+  filename = g_build_filename (g_get_user_cache_dir (), "glib-2.0", basename, NULL);
+  g_string_free (key, TRUE);
+  g_free (basename);
+
+  return filename;
+}
+
+static MimeInfo *
+mime_info_load (void)
+{
+  MimeInfo *info;
+  char *filename;
+
+  filename = mime_info_get_filename ();
+  info = mime_info_new_from_file (filename);
+  g_free (filename);
+
+  if (info != NULL && !mime_info_is_valid (info))
+    {
+      mime_info_unref (info);
+      info = NULL;
+    }
+
+  return info;
+}
+
+static MimeInfo *
+mime_info_write (void)
+{
+  MimeInfo *info;
+  char *filename, *dirname;
+  gchar *data;
+  gsize size;
+
+  data = mime_info_build (TRUE, &size);
+
+  filename = mime_info_get_filename ();
+  dirname = g_path_get_dirname (filename);
+  info = NULL;
+  if (g_mkdir_with_parents (dirname, 0700) == 0 &&
+      g_file_set_contents (filename, data, size, NULL))
+    info = mime_info_new_from_file (filename);
+  g_free (dirname);
+  g_free (filename);
+
+  g_free (data);
+
+  if (info != NULL && info->size != size)
+    {
+      mime_info_unref (info);
+      info = NULL;
+    }
+
+  return info;
+}
+
+static gpointer
+mime_info_write_thread (gpointer data)
+{
+  MimeInfo *info;
+
+  info = mime_info_write ();
+
+  G_LOCK (mime_info);
+
+  mime_info_building = FALSE;
+  if (info == NULL)
+    {
+      /* Keeping every type in memory in each process would cost
+       * more than it saves, so stay with the lookups by type.
+       */
+      mime_info_unwritable = TRUE;
+    }
+  else if (mime_info_is_valid (info))
+    {
+      if (mime_info != NULL)
+	mime_info_unref (mime_info);
+      mime_info = info;
+    }
+  else
     {
-      initialized = TRUE;
+      /* The database changed while it was read, try again */
+      mime_info_unref (info);
+      g_atomic_int_set (&mime_info_changed, TRUE);
+    }
 
-      xdg_mime_register_reload_callback (xdg_mime_reload, NULL, NULL);
-      need_reload = TRUE;
+  G_UNLOCK (mime_info);
+
+  return NULL;
+}
+
+static void
+mime_info_xdgmime_reloaded (void *user_data)
+{
+  g_atomic_int_set (&mime_info_changed, TRUE);
+}
+
+static MimeInfo *
+mime_info_get (void)
+{
+  static gboolean registered = FALSE;
+  MimeInfo *info;
+  gchar *data;
+  gsize size;
+
+  G_LOCK (mime_info);
+
+  if (!registered)
+    {
+      G_LOCK (gio_xdgmime);
+      xdg_mime_register_reload_callback (mime_info_xdgmime_reloaded, NULL, NULL);
+      G_UNLOCK (gio_xdgmime);
+      registered = TRUE;
     }
 
-  if (need_reload) 
+  /* Only check the cache when the mime database was reloaded */
+  if (g_atomic_int_compare_and_exchange (&mime_info_changed, TRUE, FALSE) &&
+      (mime_info == NULL || !mime_info->complete || !mime_info_is_valid (mime_info)))
     {
-      need_reload = FALSE;
+      if (mime_info != NULL)
+	mime_info_unref (mime_info);
+      mime_info = mime_info_load ();
 
-      tree_magic_shutdown ();
+      /* Reading the description of every type takes a while, so
+       * the file is written by a thread. Until it is done, only the
+       * tree magic is kept, and the types are looked up one by one.
+       */
+      if (mime_info == NULL)
+	{
+	  data = mime_info_build (FALSE, &size);
+	  mime_info = mime_info_new_from_data (data, size);
 
-      dir = g_get_user_data_dir ();
-      read_tree_magic_from_directory (dir);
-      dirs = g_get_system_data_dirs ();
-      for (i = 0; dirs[i]; i++)
-        read_tree_magic_from_directory (dirs[i]);
+	  if (!mime_info_building && !mime_info_unwritable &&
+	      g_thread_supported ())
+	    mime_info_building =
+	      g_thread_create (mime_info_write_thread, NULL, FALSE, NULL) != NULL;
+	}
     }
+
+  info = mime_info_ref (mime_info);
+
+  G_UNLOCK (mime_info);
+
+  return info;
+}
+
+static const MimeInfoType *
+mime_info_lookup_type (MimeInfo   *info,
+		       const char *name)
+{
+  const MimeInfoHeader *header;
+  const MimeInfoType *types;
+  const char *type_name;
+  guint32 lo, hi, mid;
+  int cmp;
+
+  header = (const MimeInfoHeader *) info->data;
+  types = (const MimeInfoType *) (info->data + header->types);
+
+  lo = 0;
+  hi = header->n_types;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      type_name = mime_info_string (info, types[mid].name);
+      cmp = strcmp (type_name ? type_name : "", name);
+      if (cmp == 0)
+	return &types[mid];
+      else if (cmp < 0)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  return NULL;
+}
+
+G_LOCK_DEFINE_STATIC (type_comment_cache);
+
+static char *
+mime_info_get_description (const char *type)
+{
+  static GHashTable *type_comment_cache = NULL;
+  const MimeInfoType *entry;
+  MimeInfo *info;
+  char *comment;
+  gboolean complete;
+
+  info = mime_info_get ();
+  complete = info->complete;
+  entry = complete ? mime_info_lookup_type (info, type) : NULL;
+  comment = entry ? g_strdup (mime_info_string (info, entry->comment)) : NULL;
+  mime_info_unref (info);
+
+  if (complete)
+    return comment;
+
+  G_LOCK (type_comment_cache);
+  if (type_comment_cache == NULL)
+    type_comment_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  comment = g_hash_table_lookup (type_comment_cache, type);
+  comment = g_strdup (comment);
+  G_UNLOCK (type_comment_cache);
+
+  if (comment != NULL)
+    return comment;
+
+  comment = load_comment_for_mime (type);
+
+  G_LOCK (type_comment_cache);
+  g_hash_table_insert (type_comment_cache,
+		       g_strdup (type),
+		       g_strdup (comment));
+  G_UNLOCK (type_comment_cache);
+
+  return comment;
+}
+
+static gboolean
+mime_info_get_icons (const char  *type,
+		     char       **icon,
+		     char       **generic_icon)
+{
+  const MimeInfoType *entry;
+  MimeInfo *info;
+
+  info = mime_info_get ();
+  entry = mime_info_lookup_type (info, type);
+  if (entry != NULL)
+    {
+      *icon = g_strdup (mime_info_string (info, entry->icon));
+      *generic_icon = g_strdup (mime_info_string (info, entry->generic_icon));
+    }
+  mime_info_unref (info);
+
+  return entry != NULL;
 }
 
 /* a filtering enumerator */
@@ -1502,18 +2329,44 @@ enumerator_free (Enumerator *e)
   g_free (e);
 }
 
+static const MimeInfoTreeMatchlet *
+tree_matchlets_get (MimeInfo *mime_info,
+		    guint32   first,
+		    guint32   n,
+		    guint32   min_first)
+{
+  const MimeInfoHeader *header;
+
+  header = (const MimeInfoHeader *) mime_info->data;
+
+  /* Children come after their parent, which rules out loops */
+  if (first < min_first ||
+      first > header->n_tree_matchlets ||
+      n > header->n_tree_matchlets - first)
+    return NULL;
+
+  return (const MimeInfoTreeMatchlet *) (mime_info->data + header->tree_matchlets) + first;
+}
+
 static gboolean
-matchlet_match (TreeMatchlet *matchlet,
-                GFile        *root)
+matchlet_match (MimeInfo                   *mime_info,
+                const MimeInfoTreeMatchlet *matchlet,
+                GFile                      *root)
 {
+  const MimeInfoTreeMatchlet *children;
+  const MimeInfoHeader *header;
+  const gchar *path, *mimetype;
   GFile *file;
   GFileInfo *info;
   gboolean result;
   const gchar *attrs;
   Enumerator *e;
-  GList *l;
+  guint32 i;
 
-  e = enumerator_new (root, matchlet->path, !matchlet->match_case);
+  path = mime_info_string (mime_info, matchlet->path);
+  mimetype = mime_info_string (mime_info, matchlet->mimetype);
+
+  e = enumerator_new (root, path ? path : "", !(matchlet->flags & TREE_MATCHLET_MATCH_CASE));
 	
   do 
     {
@@ -1524,7 +2377,7 @@ matchlet_match (TreeMatchlet *matchlet,
           return FALSE;
         }
 
-      if (matchlet->mimetype)
+      if (mimetype)
         attrs = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
                 G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE ","
                 G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE;
@@ -1544,14 +2397,14 @@ matchlet_match (TreeMatchlet *matchlet,
               g_file_info_get_file_type (info) != matchlet->type) 
             result = FALSE;
 
-          if (matchlet->executable &&
+          if ((matchlet->flags & TREE_MATCHLET_EXECUTABLE) &&
               !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE))
             result = FALSE;
         }	
       else 
         result = FALSE;
 
-      if (result && matchlet->non_empty) 
+      if (result && (matchlet->flags & TREE_MATCHLET_NON_EMPTY)) 
         {
           GFileEnumerator *child_enum;
           GFileInfo *child_info;
@@ -1575,9 +2428,9 @@ matchlet_match (TreeMatchlet *matchlet,
             result = FALSE;
         }
 	
-      if (result && matchlet->mimetype) 
+      if (result && mimetype) 
         {
-          if (strcmp (matchlet->mimetype, g_file_info_get_content_type (info)) != 0) 
+          if (strcmp (mimetype, g_file_info_get_content_type (info)) != 0) 
             result = FALSE;
         }
 	
@@ -1588,15 +2441,20 @@ matchlet_match (TreeMatchlet *matchlet,
 
   enumerator_free (e);
 	
-  if (!matchlet->matches) 
+  if (matchlet->n_children == 0) 
     return TRUE;
 
-  for (l = matchlet->matches; l; l = l->next) 
-    {
-      TreeMatchlet *submatchlet;
+  header = (const MimeInfoHeader *) mime_info->data;
+  children = tree_matchlets_get (mime_info,
+                                 matchlet->first_child,
+                                 matchlet->n_children,
+                                 matchlet - (const MimeInfoTreeMatchlet *) (mime_info->data + header->tree_matchlets) + 1);
+  if (children == NULL)
+    return FALSE;
 
-      submatchlet = l->data;
-      if (matchlet_match (submatchlet, root))
+  for (i = 0; i < matchlet->n_children; i++) 
+    {
+      if (matchlet_match (mime_info, &children[i], root))
         return TRUE;
     }
 
@@ -1604,18 +2462,25 @@ matchlet_match (TreeMatchlet *matchlet,
 }
 
 static void
-match_match (TreeMatch    *match,
-             GFile        *root,
-             GPtrArray    *types)
+match_match (MimeInfo                *mime_info,
+             const MimeInfoTreeMatch *match,
+             GFile                   *root,
+             GPtrArray               *types)
 {
-  GList *l;
+  const MimeInfoTreeMatchlet *matchlets;
+  const gchar *contenttype;
+  guint32 i;
+
+  contenttype = mime_info_string (mime_info, match->contenttype);
+  matchlets = tree_matchlets_get (mime_info, match->first_matchlet, match->n_matchlets, 0);
+  if (contenttype == NULL || matchlets == NULL)
+    return;
 	
-  for (l = match->matches; l; l = l->next) 
+  for (i = 0; i < match->n_matchlets; i++) 
     {
-      TreeMatchlet *matchlet = l->data;
-      if (matchlet_match (matchlet, root)) 
+      if (matchlet_match (mime_info, &matchlets[i], root)) 
         {
-          g_ptr_array_add (types, g_strdup (match->contenttype));
+          g_ptr_array_add (types, g_strdup (contenttype));
           break;
         }
     }
@@ -1644,21 +2509,20 @@ match_match (TreeMatch    *match,
 char **
 g_content_type_guess_for_tree (GFile *root)
 {
+  const MimeInfoHeader *header;
+  const MimeInfoTreeMatch *matches;
+  MimeInfo *mime_info;
   GPtrArray *types;
-  GList *l;
+  guint32 i;
 
   types = g_ptr_array_new ();
 
-  G_LOCK (gio_treemagic);
-
-  tree_magic_init ();
-  for (l = tree_matches; l; l = l->next) 
-    {
-      TreeMatch *match = l->data;
-      match_match (match, root, types);
-    }
-
-  G_UNLOCK (gio_treemagic);
+  mime_info = mime_info_get ();
+  header = (const MimeInfoHeader *) mime_info->data;
+  matches = (const MimeInfoTreeMatch *) (mime_info->data + header->tree_matches);
+  for (i = 0; i < header->n_tree_matches; i++) 
+    match_match (mime_info, &matches[i], root, types);
+  mime_info_unref (mime_info);
 
   g_ptr_array_add (types, NULL);
 
@@ -23,6 +23,7 @@
  */
 
 #include "config.h"
+#include <string.h>
 #include "gdatainputstream.h"
 #include "gsimpleasyncresult.h"
 #include "gcancellable.h"
@@ -630,6 +631,25 @@ g_data_input_stream_read_uint64 (GDataInputStream  *stream,
   return 0;
 }
 
+/* Finds the first byte in @buffer that is either @c1 or @c2. Both
+ * lookups go through memchr(), which the C library implements with
+ * wide loads, so this beats a byte-by-byte loop even though the second
+ * one rescans the bytes before the first hit.
+ */
+static const char *
+find_either_char (const char *buffer,
+                  gsize       len,
+                  char        c1,
+                  char        c2)
+{
+  const char *p1, *p2;
+
+  p1 = memchr (buffer, c1, len);
+  p2 = memchr (buffer, c2, p1 ? p1 - buffer : len);
+
+  return p2 ? p2 : p1;
+}
+
 static gssize
 scan_for_newline (GDataInputStream *stream,
 		  gsize            *checked_out,
@@ -638,120 +658,100 @@ scan_for_newline (GDataInputStream *stream,
 {
   GBufferedInputStream *bstream;
   GDataInputStreamPrivate *priv;
-  const char *buffer;
-  gsize start, end, peeked;
-  int i;
-  gssize found_pos;
-  int newline_len;
-  gsize available, checked;
-  gboolean last_saw_cr;
+  const char *buffer, *p;
+  gsize start, peeked, i;
+  gsize available;
 
   priv = stream->priv;
   
   bstream = G_BUFFERED_INPUT_STREAM (stream);
 
-  checked = *checked_out;
-  last_saw_cr = *last_saw_cr_out;
-  found_pos = -1;
-  newline_len = 0;
-  
-  start = checked;
+  start = *checked_out;
   buffer = (const char*)g_buffered_input_stream_peek_buffer (bstream, &available) + start;
-  end = available;
-  peeked = end - start;
+  if (start >= available)
+    return -1;
+  peeked = available - start;
 
-  for (i = 0; checked < available && i < peeked; i++)
+  switch (priv->newline_type)
     {
-      switch (priv->newline_type)
+    case G_DATA_STREAM_NEWLINE_TYPE_LF:
+      p = memchr (buffer, 10, peeked);
+      if (p)
 	{
-	case G_DATA_STREAM_NEWLINE_TYPE_LF:
-	  if (buffer[i] == 10)
-	    {
-	      found_pos = start + i;
-	      newline_len = 1;
-	    }
-	  break;
-	case G_DATA_STREAM_NEWLINE_TYPE_CR:
-	  if (buffer[i] == 13)
-	    {
-	      found_pos = start + i;
-	      newline_len = 1;
-	    }
-	  break;
-	case G_DATA_STREAM_NEWLINE_TYPE_CR_LF:
-	  if (last_saw_cr && buffer[i] == 10)
-	    {
-	      found_pos = start + i - 1;
-	      newline_len = 2;
-	    }
-	  break;
-	default:
-	case G_DATA_STREAM_NEWLINE_TYPE_ANY:
-	  if (buffer[i] == 10) /* LF */
-	    {
-	      if (last_saw_cr)
-		{
-		  /* CR LF */
-		  found_pos = start + i - 1;
-		  newline_len = 2;
-		}
-	      else
-		{
-		  /* LF */
-		  found_pos = start + i;
-		  newline_len = 1;
-		}
-	    }
-	  else if (last_saw_cr)
+	  *newline_len_out = 1;
+	  return start + (p - buffer);
+	}
+      break;
+
+    case G_DATA_STREAM_NEWLINE_TYPE_CR:
+      p = memchr (buffer, 13, peeked);
+      if (p)
+	{
+	  *newline_len_out = 1;
+	  return start + (p - buffer);
+	}
+      break;
+
+    case G_DATA_STREAM_NEWLINE_TYPE_CR_LF:
+      /* The CR may have been the last byte of the previous scan */
+      if (*last_saw_cr_out && buffer[0] == 10)
+	{
+	  *newline_len_out = 2;
+	  return start - 1;
+	}
+      for (i = 1; i < peeked; i = (p - buffer) + 1)
+	{
+	  p = memchr (buffer + i, 10, peeked - i);
+	  if (p == NULL)
+	    break;
+	  if (p[-1] == 13)
 	    {
-	      /* Last was cr, this is not LF, end is CR */
-	      found_pos = start + i - 1;
-	      newline_len = 1;
+	      *newline_len_out = 2;
+	      return start + (p - buffer) - 1;
 	    }
-	  /* Don't check for CR here, instead look at last_saw_cr on next byte */
-	  break;
 	}
-	
-      last_saw_cr = (buffer[i] == 13);
+      break;
 
-      if (found_pos != -1)
+    default:
+    case G_DATA_STREAM_NEWLINE_TYPE_ANY:
+      if (*last_saw_cr_out)
 	{
-	  *newline_len_out = newline_len;
-	  return found_pos;
+	  /* CR LF, or a lone CR */
+	  *newline_len_out = (buffer[0] == 10) ? 2 : 1;
+	  return start - 1;
 	}
+      p = find_either_char (buffer, peeked, 10, 13);
+      if (p && *p == 10)
+	{
+	  *newline_len_out = 1;
+	  return start + (p - buffer);
+	}
+      /* Whether a CR is followed by LF is only known once the next
+       * byte is there; if it isn't yet, look at last_saw_cr next time.
+       */
+      if (p && p + 1 < buffer + peeked)
+	{
+	  *newline_len_out = (p[1] == 10) ? 2 : 1;
+	  return start + (p - buffer);
+	}
+      break;
     }
 
-  checked = end;
-
-  *checked_out = checked;
-  *last_saw_cr_out = last_saw_cr;
+  *checked_out = available;
+  *last_saw_cr_out = (buffer[peeked - 1] == 13);
   return -1;
 }
 		  
 
-/**
- * g_data_input_stream_read_line:
- * @stream: a given #GDataInputStream.
- * @length: a #gsize to get the length of the data read in.
- * @cancellable: optional #GCancellable object, %NULL to ignore.
- * @error: #GError for error reporting.
- *
- * Reads a line from the data input stream.
- *
- * If @cancellable is not %NULL, then the operation can be cancelled by
- * triggering the cancellable object from another thread. If the operation
- * was cancelled, the error %G_IO_ERROR_CANCELLED will be returned.
- *
- * Returns: a string with the line that was read in (without the newlines).
- *     Set @length to a #gsize to get the length of the read line.
- *     On an error, it will return %NULL and @error will be set. If there's no
- *     content to read, it will still return %NULL, but @error won't be set.
- **/
-char *
-g_data_input_stream_read_line (GDataInputStream  *stream,
-			       gsize             *length,
-			       GCancellable      *cancellable,
-			       GError           **error)
+/* Makes sure that a complete line is in the buffer, filling it as
+ * needed. Returns the length of the line, without the line end, or -1
+ * at the end of the stream or on error.
+ */
+static gssize
+buffer_line (GDataInputStream  *stream,
+	     int               *newline_len_out,
+	     GCancellable      *cancellable,
+	     GError           **error)
 {
   GBufferedInputStream *bstream;
   gsize checked;
@@ -759,10 +759,7 @@ g_data_input_stream_read_line (GDataInputStream  *stream,
   gssize found_pos;
   gssize res;
   int newline_len;
-  char *line;
   
-  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);  
-
   bstream = G_BUFFERED_INPUT_STREAM (stream);
 
   newline_len = 0;
@@ -778,16 +775,12 @@ g_data_input_stream_read_line (GDataInputStream  *stream,
 
       res = g_buffered_input_stream_fill (bstream, -1, cancellable, error);
       if (res < 0)
-	return NULL;
+	return -1;
       if (res == 0)
 	{
 	  /* End of stream */
 	  if (g_buffered_input_stream_get_available (bstream) == 0)
-	    {
-	      if (length)
-		*length = 0;
-	      return NULL;
-	    }
+	    return -1;
 	  else
 	    {
 	      found_pos = checked;
@@ -797,6 +790,49 @@ g_data_input_stream_read_line (GDataInputStream  *stream,
 	}
     }
 
+  *newline_len_out = newline_len;
+  return found_pos;
+}
+
+/**
+ * g_data_input_stream_read_line:
+ * @stream: a given #GDataInputStream.
+ * @length: a #gsize to get the length of the data read in.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads a line from the data input stream.
+ *
+ * If @cancellable is not %NULL, then the operation can be cancelled by
+ * triggering the cancellable object from another thread. If the operation
+ * was cancelled, the error %G_IO_ERROR_CANCELLED will be returned.
+ *
+ * Returns: a string with the line that was read in (without the newlines).
+ *     Set @length to a #gsize to get the length of the read line.
+ *     On an error, it will return %NULL and @error will be set. If there's no
+ *     content to read, it will still return %NULL, but @error won't be set.
+ **/
+char *
+g_data_input_stream_read_line (GDataInputStream  *stream,
+			       gsize             *length,
+			       GCancellable      *cancellable,
+			       GError           **error)
+{
+  gssize found_pos;
+  gssize res;
+  int newline_len;
+  char *line;
+  
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);  
+
+  found_pos = buffer_line (stream, &newline_len, cancellable, error);
+  if (found_pos == -1)
+    {
+      if (length)
+	*length = 0;
+      return NULL;
+    }
+
   line = g_malloc (found_pos + newline_len + 1);
 
   res = g_input_stream_read (G_INPUT_STREAM (stream),
@@ -811,44 +847,120 @@ g_data_input_stream_read_line (GDataInputStream  *stream,
   return line;
 }
 
+/**
+ * g_data_input_stream_read_line_borrowed:
+ * @stream: a given #GDataInputStream.
+ * @length: a #gsize to get the length of the line.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads a line from the data input stream, like
+ * g_data_input_stream_read_line(), but instead of copying the line
+ * into a newly allocated string, returns a pointer to it inside
+ * the buffer of @stream.
+ *
+ * The returned data is <emphasis>not</emphasis> nul-terminated and
+ * must not be modified. It stays valid until the next read from
+ * @stream, or until the buffer is filled or resized.
+ *
+ * The line is always read into the buffer of @stream, even for local
+ * files, and never points into a mapping of the file as returned by
+ * g_file_input_stream_peek_buffer(). This makes it safe to use on
+ * files that other processes may modify or truncate.
+ *
+ * If @cancellable is not %NULL, then the operation can be cancelled by
+ * triggering the cancellable object from another thread. If the operation
+ * was cancelled, the error %G_IO_ERROR_CANCELLED will be returned.
+ *
+ * Returns: the line that was read in (without the newlines), with its
+ *     length stored in @length. On an error, it will return %NULL and
+ *     @error will be set. If there's no content to read, it will still
+ *     return %NULL, but @error won't be set.
+ *
+ * Since: 2.22
+ **/
+const char *
+g_data_input_stream_read_line_borrowed (GDataInputStream  *stream,
+					gsize             *length,
+					GCancellable      *cancellable,
+					GError           **error)
+{
+  GBufferedInputStream *bstream;
+  const char *line;
+  gssize found_pos;
+  gssize res;
+  int newline_len;
+
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);
+  g_return_val_if_fail (length != NULL, NULL);
+
+  bstream = G_BUFFERED_INPUT_STREAM (stream);
+
+  found_pos = buffer_line (stream, &newline_len, cancellable, error);
+  if (found_pos == -1)
+    {
+      *length = 0;
+      return NULL;
+    }
+
+  /* Skipping only moves the read position, the line stays in place */
+  line = g_buffered_input_stream_peek_buffer (bstream, NULL);
+  res = g_input_stream_skip (G_INPUT_STREAM (stream),
+			     found_pos + newline_len,
+			     NULL, NULL);
+  g_warn_if_fail (res == found_pos + newline_len);
+
+  *length = (gsize)found_pos;
+  return line;
+}
+
 static gssize
 scan_for_chars (GDataInputStream *stream,
 		gsize            *checked_out,
 		const char       *stop_chars)
 {
   GBufferedInputStream *bstream;
-  GDataInputStreamPrivate *priv;
-  const char *buffer;
-  gsize start, end, peeked;
-  int i;
-  gssize found_pos;
-  gsize available, checked;
-  const char *stop_char;
-
-  priv = stream->priv;
+  const char *buffer, *p;
+  gsize start, peeked, i;
+  gsize available;
+  guint32 stop_set[8];
   
   bstream = G_BUFFERED_INPUT_STREAM (stream);
 
-  checked = *checked_out;
-  found_pos = -1;
-  
-  start = checked;
+  start = *checked_out;
   buffer = (const char *)g_buffered_input_stream_peek_buffer (bstream, &available) + start;
-  end = available;
-  peeked = end - start;
-
-  for (i = 0; checked < available && i < peeked; i++)
+  if (start >= available)
+    return -1;
+  peeked = available - start;
+
+  if (stop_chars[0] == '\0')
+    p = NULL;
+  else if (stop_chars[1] == '\0')
+    p = memchr (buffer, stop_chars[0], peeked);
+  else if (stop_chars[2] == '\0')
+    p = find_either_char (buffer, peeked, stop_chars[0], stop_chars[1]);
+  else
     {
-      for (stop_char = stop_chars; *stop_char != '\0'; stop_char++)
-	{
-	  if (buffer[i] == *stop_char)
-	    return (start + i);
-	}
+      /* Look each byte up in a bitmap of the stop characters, rather
+       * than comparing it against every one of them in turn.
+       */
+      memset (stop_set, 0, sizeof (stop_set));
+      for (p = stop_chars; *p != '\0'; p++)
+	stop_set[(guchar) *p >> 5] |= 1U << ((guchar) *p & 31);
+
+      p = NULL;
+      for (i = 0; i < peeked; i++)
+	if (stop_set[(guchar) buffer[i] >> 5] & (1U << ((guchar) buffer[i] & 31)))
+	  {
+	    p = buffer + i;
+	    break;
+	  }
     }
 
-  checked = end;
+  if (p)
+    return start + (p - buffer);
 
-  *checked_out = checked;
+  *checked_out = available;
   return -1;
 }
 
@@ -103,6 +103,10 @@ char *                 g_data_input_stream_read_line            (GDataInputStrea
 							         gsize                   *length,
 							         GCancellable            *cancellable,
 							         GError                 **error);
+const char *           g_data_input_stream_read_line_borrowed   (GDataInputStream        *stream,
+							         gsize                   *length,
+							         GCancellable            *cancellable,
+							         GError                 **error);
 void                   g_data_input_stream_read_line_async      (GDataInputStream        *stream,
                                                                  gint                     io_priority,
                                                                  GCancellable            *cancellable,
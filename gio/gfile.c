@@ -23,6 +23,7 @@
  */
 
 #include "config.h"
+#define _GNU_SOURCE /* for copy_file_range() */
 #include <string.h>
 #include <sys/types.h>
 #ifdef HAVE_PWD_H
@@ -36,6 +37,7 @@
 #include "gfileattribute-priv.h"
 #include "gpollfilemonitor.h"
 #include "gappinfo.h"
+#include "gfileenumerator.h"
 #include "gfileinputstream.h"
 #include "gfileoutputstream.h"
 #include "gcancellable.h"
@@ -43,6 +45,22 @@
 #include "gioerror.h"
 #include "glibintl.h"
 
+#if defined (G_OS_UNIX) && (defined (HAVE_COPY_FILE_RANGE) || defined (HAVE_SENDFILE))
+#define USE_KERNEL_COPY 1
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+#include "glocalfileinputstream.h"
+#include "glocalfileoutputstream.h"
+#endif
+
 #include "gioalias.h"
 
 /**
@@ -2192,6 +2210,117 @@ g_file_copy_attributes (GFile           *source,
   return res;
 }
 
+#ifdef USE_KERNEL_COPY
+
+/* the amount handed to the kernel at a time, which is also how often
+ * progress is reported and cancellation noticed
+ */
+#define KERNEL_COPY_CHUNK_SIZE (1024 * 1024)
+
+static gboolean
+kernel_copy_unsupported (int errsv)
+{
+  return errsv == ENOSYS || errsv == EINVAL || errsv == EXDEV ||
+         errsv == EOPNOTSUPP || errsv == ENOTTY;
+}
+
+/* Copies @in_fd to @out_fd without moving the data through userspace:
+ * by sharing the extents if the filesystem can clone files, otherwise
+ * with copy_file_range() or sendfile(). If none of that works for these
+ * files *fallback is set, and the caller continues from the current
+ * offsets with read() and write().
+ */
+static gboolean
+copy_fds_with_progress (int                     in_fd,
+                        int                     out_fd,
+                        goffset                 total_size,
+                        goffset                *current_size,
+                        gboolean               *fallback,
+                        GCancellable           *cancellable,
+                        GFileProgressCallback   progress_callback,
+                        gpointer                progress_callback_data,
+                        GError                **error)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+  gboolean try_copy_file_range = TRUE;
+#endif
+  gssize res;
+
+  *fallback = FALSE;
+
+#ifdef FICLONE
+  {
+    struct stat in_stat;
+
+    if (fstat (in_fd, &in_stat) == 0 &&
+        S_ISREG (in_stat.st_mode) &&
+        ioctl (out_fd, FICLONE, in_fd) == 0)
+      {
+        *current_size = in_stat.st_size;
+
+        if (progress_callback)
+          progress_callback (*current_size, total_size, progress_callback_data);
+
+        return TRUE;
+      }
+  }
+#endif
+
+  while (TRUE)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        return FALSE;
+
+      res = -1;
+      errno = ENOSYS;
+#ifdef HAVE_COPY_FILE_RANGE
+      if (try_copy_file_range)
+        {
+          res = copy_file_range (in_fd, NULL, out_fd, NULL, KERNEL_COPY_CHUNK_SIZE, 0);
+          if (res == -1 && kernel_copy_unsupported (errno))
+            try_copy_file_range = FALSE;
+        }
+      if (!try_copy_file_range)
+#endif
+        {
+#ifdef HAVE_SENDFILE
+          res = sendfile (out_fd, in_fd, NULL, KERNEL_COPY_CHUNK_SIZE);
+#endif
+          if (res == -1 && kernel_copy_unsupported (errno))
+            {
+              *fallback = TRUE;
+              return TRUE;
+            }
+        }
+
+      if (res == -1)
+        {
+          int errsv = errno;
+
+          if (errsv == EINTR)
+            continue;
+
+          g_set_error (error, G_IO_ERROR,
+                       g_io_error_from_errno (errsv),
+                       _("Error splicing file: %s"),
+                       g_strerror (errsv));
+          return FALSE;
+        }
+
+      if (res == 0)
+        break;
+
+      *current_size += res;
+
+      if (progress_callback)
+        progress_callback (*current_size, total_size, progress_callback_data);
+    }
+
+  return TRUE;
+}
+
+#endif /* USE_KERNEL_COPY */
+
 /* Closes the streams */
 static gboolean
 copy_stream_with_progress (GInputStream           *in,
@@ -2239,6 +2368,25 @@ copy_stream_with_progress (GInputStream           *in,
   
   current_size = 0;
   res = TRUE;
+
+#ifdef USE_KERNEL_COPY
+  /* local files can be copied by the kernel */
+  if (G_TYPE_FROM_INSTANCE (in) == G_TYPE_LOCAL_FILE_INPUT_STREAM &&
+      G_TYPE_FROM_INSTANCE (out) == G_TYPE_LOCAL_FILE_OUTPUT_STREAM)
+    {
+      gboolean fallback;
+
+      res = copy_fds_with_progress (_g_local_file_input_stream_get_fd (G_LOCAL_FILE_INPUT_STREAM (in)),
+                                    _g_local_file_output_stream_get_fd (G_LOCAL_FILE_OUTPUT_STREAM (out)),
+                                    total_size, &current_size, &fallback,
+                                    cancellable,
+                                    progress_callback, progress_callback_data,
+                                    error);
+      if (!res || !fallback)
+        goto out;
+    }
+#endif
+
   while (TRUE)
     {
       n_read = g_input_stream_read (in, buffer, sizeof (buffer), cancellable, error);
@@ -2274,6 +2422,9 @@ copy_stream_with_progress (GInputStream           *in,
 	progress_callback (current_size, total_size, progress_callback_data);
     }
 
+#ifdef USE_KERNEL_COPY
+ out:
+#endif
   if (!res)
     error = NULL; /* Ignore further errors */
 
@@ -5905,5 +6056,359 @@ g_file_replace_contents_finish (GFile         *file,
   return TRUE;
 }
 
+#define WALK_BATCH_SIZE 100
+#define WALK_DEFAULT_PARALLEL 4
+
+typedef struct {
+  GSimpleAsyncResult *res;
+  GFile *root;
+  char *attributes;
+  GFileQueryInfoFlags flags;
+  int io_priority;
+  GCancellable *cancellable;
+  GFileWalkPruneCallback prune_cb;
+  GFileWalkBatchCallback batch_cb;
+  gpointer cb_data;
+
+  /* Only touched from the main loop */
+  GQueue pending;
+  int max_parallel;
+  int n_running;
+  GError *error;
+} WalkData;
+
+typedef struct {
+  WalkData *walk;
+  GFile *directory;
+} WalkJob;
+
+typedef struct {
+  WalkData *walk;
+  GFile *directory;
+  GList *infos;
+  gboolean done;
+  GError *error;
+} WalkBatch;
+
+static void walk_schedule (WalkData *walk);
+
+static void
+walk_data_free (WalkData *walk)
+{
+  GFile *file;
+
+  while ((file = g_queue_pop_head (&walk->pending)) != NULL)
+    g_object_unref (file);
+  g_object_unref (walk->root);
+  if (walk->cancellable)
+    g_object_unref (walk->cancellable);
+  if (walk->error)
+    g_error_free (walk->error);
+  g_free (walk->attributes);
+  g_free (walk);
+}
+
+static void
+walk_job_free (WalkJob *job)
+{
+  g_object_unref (job->directory);
+  g_free (job);
+}
+
+static void
+walk_batch_free (WalkBatch *batch)
+{
+  g_list_foreach (batch->infos, (GFunc)g_object_unref, NULL);
+  g_list_free (batch->infos);
+  g_object_unref (batch->directory);
+  if (batch->error)
+    g_error_free (batch->error);
+  g_free (batch);
+}
+
+static gboolean
+walk_batch_in_main (gpointer user_data)
+{
+  WalkBatch *batch = user_data;
+  WalkData *walk = batch->walk;
+  GFileInfo *info;
+  GList *l;
+
+  if (batch->infos != NULL &&
+      walk->error == NULL &&
+      !g_cancellable_is_cancelled (walk->cancellable))
+    {
+      if (walk->batch_cb)
+	walk->batch_cb (batch->directory, batch->infos, walk->cb_data);
+
+      for (l = batch->infos; l != NULL; l = l->next)
+	{
+	  info = l->data;
+
+	  if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY ||
+	      g_file_info_get_is_symlink (info))
+	    continue;
+
+	  if (walk->prune_cb &&
+	      walk->prune_cb (batch->directory, info, walk->cb_data))
+	    continue;
+
+	  g_queue_push_tail (&walk->pending,
+			     g_file_get_child (batch->directory,
+					       g_file_info_get_name (info)));
+	}
+    }
+
+  if (batch->done)
+    {
+      walk->n_running--;
+
+      /* A subdirectory that can't be read is skipped, but the walk
+       * fails if the directory it was started on can't be read.
+       */
+      if (batch->error != NULL && walk->error == NULL &&
+	  (g_file_equal (batch->directory, walk->root) ||
+	   g_error_matches (batch->error, G_IO_ERROR, G_IO_ERROR_CANCELLED)))
+	{
+	  walk->error = batch->error;
+	  batch->error = NULL;
+	}
+
+      walk_schedule (walk);
+    }
+
+  return FALSE;
+}
+
+static void
+walk_send_batch (GIOSchedulerJob *io_job,
+		 WalkJob         *job,
+		 GList           *infos,
+		 gboolean         done,
+		 GError          *error)
+{
+  WalkBatch *batch;
+
+  batch = g_new0 (WalkBatch, 1);
+  batch->walk = job->walk;
+  batch->directory = g_object_ref (job->directory);
+  batch->infos = g_list_reverse (infos);
+  batch->done = done;
+  batch->error = error;
+
+  g_io_scheduler_job_send_to_mainloop_async (io_job,
+					     walk_batch_in_main,
+					     batch,
+					     (GDestroyNotify)walk_batch_free);
+}
+
+static gboolean
+walk_directory_thread (GIOSchedulerJob *io_job,
+		       GCancellable    *cancellable,
+		       gpointer         user_data)
+{
+  WalkJob *job = user_data;
+  GFileEnumerator *enumerator;
+  GFileInfo *info;
+  GError *error;
+  GList *infos;
+  int n_infos;
+
+  error = NULL;
+  infos = NULL;
+  n_infos = 0;
+
+  enumerator = g_file_enumerate_children (job->directory,
+					  job->walk->attributes,
+					  job->walk->flags,
+					  cancellable, &error);
+  if (enumerator != NULL)
+    {
+      while ((info = g_file_enumerator_next_file (enumerator, cancellable, &error)) != NULL)
+	{
+	  infos = g_list_prepend (infos, info);
+	  if (++n_infos == WALK_BATCH_SIZE)
+	    {
+	      walk_send_batch (io_job, job, infos, FALSE, NULL);
+	      infos = NULL;
+	      n_infos = 0;
+	    }
+	}
+
+      g_file_enumerator_close (enumerator, NULL, NULL);
+      g_object_unref (enumerator);
+    }
+
+  /* Batches are delivered in order, so this one tells the main loop
+   * that the directory is finished.
+   */
+  walk_send_batch (io_job, job, infos, TRUE, error);
+
+  return FALSE;
+}
+
+static void
+walk_schedule (WalkData *walk)
+{
+  WalkJob *job;
+  GFile *file;
+
+  if (walk->error != NULL || g_cancellable_is_cancelled (walk->cancellable))
+    {
+      while ((file = g_queue_pop_head (&walk->pending)) != NULL)
+	g_object_unref (file);
+    }
+
+  while (walk->n_running < walk->max_parallel &&
+	 !g_queue_is_empty (&walk->pending))
+    {
+      job = g_new0 (WalkJob, 1);
+      job->walk = walk;
+      job->directory = g_queue_pop_head (&walk->pending);
+
+      walk->n_running++;
+      g_io_scheduler_push_job (walk_directory_thread, job,
+			       (GDestroyNotify)walk_job_free,
+			       walk->io_priority, walk->cancellable);
+    }
+
+  if (walk->n_running == 0)
+    {
+      if (walk->error != NULL)
+	g_simple_async_result_set_from_error (walk->res, walk->error);
+      else if (g_cancellable_is_cancelled (walk->cancellable))
+	g_simple_async_result_set_error (walk->res, G_IO_ERROR,
+					 G_IO_ERROR_CANCELLED,
+					 "%s", _("Operation was cancelled"));
+
+      /* In an idle, since this runs from within g_file_walk_async()
+       * if the cancellable was triggered already.
+       */
+      g_simple_async_result_complete_in_idle (walk->res);
+      g_object_unref (walk->res);
+    }
+}
+
+/**
+ * g_file_walk_async:
+ * @file: input #GFile for a directory.
+ * @attributes: an attribute query string.
+ * @flags: a set of #GFileQueryInfoFlags.
+ * @max_parallel: the maximal number of directories to read at the
+ *     same time, or 0 for a default.
+ * @io_priority: the <link linkend="io-priority">I/O priority</link>
+ *     of the request.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @prune_callback: function deciding which subdirectories to skip,
+ *     or %NULL to walk into all of them.
+ * @batch_callback: function receiving the files that were found,
+ *     or %NULL.
+ * @walk_callback_data: user data to pass to @prune_callback and
+ *     @batch_callback.
+ * @callback: a #GAsyncReadyCallback to call when the walk is finished.
+ * @user_data: the data to pass to callback function
+ *
+ * Asynchronously enumerates @file and all of the directories below it,
+ * getting the information requested in @attributes for each file, like
+ * g_file_enumerate_children() does. Up to @max_parallel directories are
+ * read at a time, each in a separate job of the #GIOScheduler.
+ *
+ * The files are handed to @batch_callback in batches as they are found,
+ * along with the directory they are in. Each directory that is found is
+ * passed to @prune_callback, and is skipped if it returns %TRUE. Both
+ * callbacks run in the main loop. Symbolic links to directories are
+ * never followed. The order in which directories are visited is not
+ * specified.
+ *
+ * The standard::name and standard::type attributes are always included.
+ * Unless @flags contains %G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+ * standard::is-symlink is also included, which means that every file
+ * has to be stat()ed.
+ *
+ * Subdirectories that can't be read are skipped. If @file itself can't
+ * be read, the walk fails.
+ *
+ * When the walk is finished, @callback will be called. You can then call
+ * g_file_walk_finish() to get the result of the operation.
+ *
+ * Since: 2.22
+ **/
+void
+g_file_walk_async (GFile                  *file,
+		   const char             *attributes,
+		   GFileQueryInfoFlags     flags,
+		   int                     max_parallel,
+		   int                     io_priority,
+		   GCancellable           *cancellable,
+		   GFileWalkPruneCallback  prune_callback,
+		   GFileWalkBatchCallback  batch_callback,
+		   gpointer                walk_callback_data,
+		   GAsyncReadyCallback     callback,
+		   gpointer                user_data)
+{
+  WalkData *walk;
+
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (attributes != NULL);
+
+  walk = g_new0 (WalkData, 1);
+  walk->res = g_simple_async_result_new (G_OBJECT (file), callback, user_data,
+					 g_file_walk_async);
+  walk->root = g_object_ref (file);
+  walk->attributes = g_strconcat (attributes,
+				  "," G_FILE_ATTRIBUTE_STANDARD_NAME
+				  "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+				  (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) ?
+				  NULL : "," G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK,
+				  NULL);
+  walk->flags = flags;
+  walk->io_priority = io_priority;
+  if (cancellable)
+    walk->cancellable = g_object_ref (cancellable);
+  walk->prune_cb = prune_callback;
+  walk->batch_cb = batch_callback;
+  walk->cb_data = walk_callback_data;
+  walk->max_parallel = max_parallel > 0 ? max_parallel : WALK_DEFAULT_PARALLEL;
+  g_queue_init (&walk->pending);
+
+  g_simple_async_result_set_op_res_gpointer (walk->res, walk,
+					     (GDestroyNotify)walk_data_free);
+
+  g_queue_push_tail (&walk->pending, g_object_ref (file));
+  walk_schedule (walk);
+}
+
+/**
+ * g_file_walk_finish:
+ * @file: input #GFile.
+ * @res: a #GAsyncResult.
+ * @error: a #GError, or %NULL
+ *
+ * Finishes a walk started with g_file_walk_async().
+ *
+ * Returns: %TRUE if the walk completed, %FALSE on error.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_file_walk_finish (GFile         *file,
+		    GAsyncResult  *res,
+		    GError       **error)
+{
+  GSimpleAsyncResult *simple;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), FALSE);
+
+  simple = G_SIMPLE_ASYNC_RESULT (res);
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) == g_file_walk_async);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  return TRUE;
+}
+
 #define __G_FILE_C__
 #include "gioaliasdef.c"
@@ -806,6 +806,20 @@ gboolean g_file_replace_contents_finish      (GFile                  *file,
 					      GAsyncResult           *res,
 					      char                  **new_etag,
 					      GError                **error);
+void     g_file_walk_async                   (GFile                  *file,
+					      const char             *attributes,
+					      GFileQueryInfoFlags     flags,
+					      int                     max_parallel,
+					      int                     io_priority,
+					      GCancellable           *cancellable,
+					      GFileWalkPruneCallback  prune_callback,
+					      GFileWalkBatchCallback  batch_callback,
+					      gpointer                walk_callback_data,
+					      GAsyncReadyCallback     callback,
+					      gpointer                user_data);
+gboolean g_file_walk_finish                  (GFile                  *file,
+					      GAsyncResult           *res,
+					      GError                **error);
 
 G_END_DECLS
 
@@ -57,6 +57,7 @@
 #include <string.h>
 
 #include "gfileinfo.h"
+#include "gfileinfo-priv.h"
 #include "gfileattribute-priv.h"
 #include "gicon.h"
 #include "glibintl.h"
@@ -85,9 +86,6 @@ struct _GFileInfoClass
 };
 
 
-static gboolean g_file_attribute_matcher_matches_id (GFileAttributeMatcher *matcher,
-						     guint32 id);
-
 G_DEFINE_TYPE (GFileInfo, g_file_info, G_TYPE_OBJECT);
 
 typedef struct {
@@ -140,6 +138,94 @@ _lookup_namespace (const char *namespace)
   return ns_info;
 }
 
+static guint32 _lookup_attribute (const char *attribute);
+
+static void
+ensure_attribute_hash (void)
+{
+  if (attribute_hash != NULL)
+    return;
+
+  ns_hash = g_hash_table_new (g_str_hash, g_str_equal);
+  attribute_hash = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* Registering the standard attributes first, in a fixed order, gives
+   * them the ids defined in gfileinfo-priv.h.
+   */
+#define REGISTER_ATTRIBUTE(name) G_STMT_START{ \
+  guint32 _id = _lookup_attribute (G_FILE_ATTRIBUTE_ ## name); \
+  g_assert (_id == G_FILE_ATTRIBUTE_ID_ ## name); \
+}G_STMT_END
+
+  REGISTER_ATTRIBUTE (STANDARD_TYPE);
+  REGISTER_ATTRIBUTE (STANDARD_IS_HIDDEN);
+  REGISTER_ATTRIBUTE (STANDARD_IS_BACKUP);
+  REGISTER_ATTRIBUTE (STANDARD_IS_SYMLINK);
+  REGISTER_ATTRIBUTE (STANDARD_IS_VIRTUAL);
+  REGISTER_ATTRIBUTE (STANDARD_NAME);
+  REGISTER_ATTRIBUTE (STANDARD_DISPLAY_NAME);
+  REGISTER_ATTRIBUTE (STANDARD_EDIT_NAME);
+  REGISTER_ATTRIBUTE (STANDARD_COPY_NAME);
+  REGISTER_ATTRIBUTE (STANDARD_DESCRIPTION);
+  REGISTER_ATTRIBUTE (STANDARD_ICON);
+  REGISTER_ATTRIBUTE (STANDARD_CONTENT_TYPE);
+  REGISTER_ATTRIBUTE (STANDARD_FAST_CONTENT_TYPE);
+  REGISTER_ATTRIBUTE (STANDARD_SIZE);
+  REGISTER_ATTRIBUTE (STANDARD_ALLOCATED_SIZE);
+  REGISTER_ATTRIBUTE (STANDARD_SYMLINK_TARGET);
+  REGISTER_ATTRIBUTE (STANDARD_TARGET_URI);
+  REGISTER_ATTRIBUTE (STANDARD_SORT_ORDER);
+  REGISTER_ATTRIBUTE (ETAG_VALUE);
+  REGISTER_ATTRIBUTE (ID_FILE);
+  REGISTER_ATTRIBUTE (ID_FILESYSTEM);
+  REGISTER_ATTRIBUTE (ACCESS_CAN_READ);
+  REGISTER_ATTRIBUTE (ACCESS_CAN_WRITE);
+  REGISTER_ATTRIBUTE (ACCESS_CAN_EXECUTE);
+  REGISTER_ATTRIBUTE (ACCESS_CAN_DELETE);
+  REGISTER_ATTRIBUTE (ACCESS_CAN_TRASH);
+  REGISTER_ATTRIBUTE (ACCESS_CAN_RENAME);
+  REGISTER_ATTRIBUTE (MOUNTABLE_CAN_MOUNT);
+  REGISTER_ATTRIBUTE (MOUNTABLE_CAN_UNMOUNT);
+  REGISTER_ATTRIBUTE (MOUNTABLE_CAN_EJECT);
+  REGISTER_ATTRIBUTE (MOUNTABLE_UNIX_DEVICE);
+  REGISTER_ATTRIBUTE (MOUNTABLE_HAL_UDI);
+  REGISTER_ATTRIBUTE (TIME_MODIFIED);
+  REGISTER_ATTRIBUTE (TIME_MODIFIED_USEC);
+  REGISTER_ATTRIBUTE (TIME_ACCESS);
+  REGISTER_ATTRIBUTE (TIME_ACCESS_USEC);
+  REGISTER_ATTRIBUTE (TIME_CHANGED);
+  REGISTER_ATTRIBUTE (TIME_CHANGED_USEC);
+  REGISTER_ATTRIBUTE (TIME_CREATED);
+  REGISTER_ATTRIBUTE (TIME_CREATED_USEC);
+  REGISTER_ATTRIBUTE (UNIX_DEVICE);
+  REGISTER_ATTRIBUTE (UNIX_INODE);
+  REGISTER_ATTRIBUTE (UNIX_MODE);
+  REGISTER_ATTRIBUTE (UNIX_NLINK);
+  REGISTER_ATTRIBUTE (UNIX_UID);
+  REGISTER_ATTRIBUTE (UNIX_GID);
+  REGISTER_ATTRIBUTE (UNIX_RDEV);
+  REGISTER_ATTRIBUTE (UNIX_BLOCK_SIZE);
+  REGISTER_ATTRIBUTE (UNIX_BLOCKS);
+  REGISTER_ATTRIBUTE (UNIX_IS_MOUNTPOINT);
+  REGISTER_ATTRIBUTE (DOS_IS_ARCHIVE);
+  REGISTER_ATTRIBUTE (DOS_IS_SYSTEM);
+  REGISTER_ATTRIBUTE (OWNER_USER);
+  REGISTER_ATTRIBUTE (OWNER_USER_REAL);
+  REGISTER_ATTRIBUTE (OWNER_GROUP);
+  REGISTER_ATTRIBUTE (THUMBNAIL_PATH);
+  REGISTER_ATTRIBUTE (THUMBNAILING_FAILED);
+  REGISTER_ATTRIBUTE (PREVIEW_ICON);
+  REGISTER_ATTRIBUTE (FILESYSTEM_SIZE);
+  REGISTER_ATTRIBUTE (FILESYSTEM_FREE);
+  REGISTER_ATTRIBUTE (FILESYSTEM_TYPE);
+  REGISTER_ATTRIBUTE (FILESYSTEM_READONLY);
+  REGISTER_ATTRIBUTE (FILESYSTEM_USE_PREVIEW);
+  REGISTER_ATTRIBUTE (GVFS_BACKEND);
+  REGISTER_ATTRIBUTE (SELINUX_CONTEXT);
+  REGISTER_ATTRIBUTE (TRASH_ITEM_COUNT);
+#undef REGISTER_ATTRIBUTE
+}
+
 static guint32
 lookup_namespace (const char *namespace)
 {
@@ -148,11 +234,7 @@ lookup_namespace (const char *namespace)
   
   G_LOCK (attribute_hash);
   
-  if (attribute_hash == NULL)
-    {
-      ns_hash = g_hash_table_new (g_str_hash, g_str_equal);
-      attribute_hash = g_hash_table_new (g_str_hash, g_str_equal);
-    }
+  ensure_attribute_hash ();
 
   ns_info = _lookup_namespace (namespace);
   id = 0;
@@ -175,27 +257,17 @@ get_attribute_for_id (int attribute)
 }
 
 static guint32
-lookup_attribute (const char *attribute)
+_lookup_attribute (const char *attribute)
 {
   guint32 attr_id, id;
   char *ns;
   const char *colon;
   NSInfo *ns_info;
-  
-  G_LOCK (attribute_hash);
-  if (attribute_hash == NULL)
-    {
-      ns_hash = g_hash_table_new (g_str_hash, g_str_equal);
-      attribute_hash = g_hash_table_new (g_str_hash, g_str_equal);
-    }
 
   attr_id = GPOINTER_TO_UINT (g_hash_table_lookup (attribute_hash, attribute));
 
   if (attr_id != 0)
-    {
-      G_UNLOCK (attribute_hash);
-      return attr_id;
-    }
+    return attr_id;
 
   colon = strstr (attribute, "::");
   if (colon)
@@ -213,9 +285,20 @@ lookup_attribute (const char *attribute)
   attr_id = MAKE_ATTR_ID (ns_info->id, id);
 
   g_hash_table_insert (attribute_hash, attributes[ns_info->id][id], GUINT_TO_POINTER (attr_id));
-  
+
+  return attr_id;
+}
+
+static guint32
+lookup_attribute (const char *attribute)
+{
+  guint32 attr_id;
+
+  G_LOCK (attribute_hash);
+  ensure_attribute_hash ();
+  attr_id = _lookup_attribute (attribute);
   G_UNLOCK (attribute_hash);
-  
+
   return attr_id;
 }
 
@@ -245,6 +328,11 @@ g_file_info_class_init (GFileInfoClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   
   gobject_class->finalize = g_file_info_finalize;
+
+  /* Infos filled in by id still need the names for listing */
+  G_LOCK (attribute_hash);
+  ensure_attribute_hash ();
+  G_UNLOCK (attribute_hash);
 }
 
 static void
@@ -357,7 +445,7 @@ g_file_info_set_attribute_mask (GFileInfo             *info,
       for (i = 0; i < info->attributes->len; i++)
 	{
 	  attr = &g_array_index (info->attributes, GFileAttribute, i);
-	  if (!g_file_attribute_matcher_matches_id (mask,
+	  if (!_g_file_attribute_matcher_matches_id (mask,
 						    attr->attribute))
 	    {
 	      _g_file_attribute_value_clear (&attr->value);
@@ -878,12 +966,16 @@ g_file_info_create_value (GFileInfo *info,
   int i;
 
   if (info->mask != NO_ATTRIBUTE_MASK &&
-      !g_file_attribute_matcher_matches_id (info->mask, attr_id))
+      !_g_file_attribute_matcher_matches_id (info->mask, attr_id))
     return NULL;
-  
-  i = g_file_info_find_place (info, attr_id);
-  
+
   attrs = (GFileAttribute *)info->attributes->data;
+
+  /* Infos are mostly filled in in id order, which only appends */
+  i = info->attributes->len;
+  if (i > 0 && attrs[i - 1].attribute >= attr_id)
+    i = g_file_info_find_place (info, attr_id);
+  
   if (i < info->attributes->len &&
       attrs[i].attribute == attr_id)
     return &attrs[i].value;
@@ -1132,6 +1224,127 @@ g_file_info_set_attribute_int64  (GFileInfo  *info,
     _g_file_attribute_value_set_int64 (value, attr_value);
 }
 
+/* The _by_id variants skip the name lookup, which takes a lock and
+ * hashes the name, for the attributes in gfileinfo-priv.h. They are
+ * meant for backends that fill in many infos, like directory
+ * enumeration.
+ */
+gboolean
+_g_file_info_has_attribute_by_id (GFileInfo *info,
+				  guint32    attribute)
+{
+  return g_file_info_find_value (info, attribute) != NULL;
+}
+
+void
+_g_file_info_set_attribute_by_id (GFileInfo          *info,
+				  guint32             attribute,
+				  GFileAttributeType  type,
+				  gpointer            value_p)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_from_pointer (value, type, value_p, TRUE);
+}
+
+void
+_g_file_info_set_attribute_string_by_id (GFileInfo  *info,
+                                         guint32     attribute,
+                                         const char *attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_string (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_byte_string_by_id (GFileInfo  *info,
+                                              guint32     attribute,
+                                              const char *attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_byte_string (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_boolean_by_id (GFileInfo  *info,
+                                          guint32     attribute,
+                                          gboolean    attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_boolean (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_uint32_by_id (GFileInfo  *info,
+                                         guint32     attribute,
+                                         guint32     attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_uint32 (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_int32_by_id (GFileInfo  *info,
+                                        guint32     attribute,
+                                        gint32      attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_int32 (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_uint64_by_id (GFileInfo  *info,
+                                         guint32     attribute,
+                                         guint64     attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_uint64 (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_int64_by_id (GFileInfo  *info,
+                                        guint32     attribute,
+                                        gint64      attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_int64 (value, attr_value);
+}
+
+void
+_g_file_info_set_attribute_object_by_id (GFileInfo  *info,
+                                         guint32     attribute,
+                                         GObject    *attr_value)
+{
+  GFileAttributeValue *value;
+
+  value = g_file_info_create_value (info, attribute);
+  if (value)
+    _g_file_attribute_value_set_object (value, attr_value);
+}
+
 /* Helper getters */
 /**
  * g_file_info_get_file_type:
@@ -1145,15 +1358,11 @@ g_file_info_set_attribute_int64  (GFileInfo  *info,
 GFileType
 g_file_info_get_file_type (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
 
   g_return_val_if_fail (G_IS_FILE_INFO (info), G_FILE_TYPE_UNKNOWN);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_TYPE);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_TYPE);
   return (GFileType)_g_file_attribute_value_get_uint32 (value);
 }
 
@@ -1168,15 +1377,11 @@ g_file_info_get_file_type (GFileInfo *info)
 gboolean
 g_file_info_get_is_hidden (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), FALSE);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_IS_HIDDEN);
   return (GFileType)_g_file_attribute_value_get_boolean (value);
 }
 
@@ -1191,15 +1396,11 @@ g_file_info_get_is_hidden (GFileInfo *info)
 gboolean
 g_file_info_get_is_backup (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), FALSE);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_IS_BACKUP);
   return (GFileType)_g_file_attribute_value_get_boolean (value);
 }
 
@@ -1214,15 +1415,11 @@ g_file_info_get_is_backup (GFileInfo *info)
 gboolean
 g_file_info_get_is_symlink (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), FALSE);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_IS_SYMLINK);
   return (GFileType)_g_file_attribute_value_get_boolean (value);
 }
 
@@ -1237,15 +1434,11 @@ g_file_info_get_is_symlink (GFileInfo *info)
 const char *
 g_file_info_get_name (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_NAME);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_NAME);
   return _g_file_attribute_value_get_byte_string (value);
 }
 
@@ -1260,15 +1453,11 @@ g_file_info_get_name (GFileInfo *info)
 const char *
 g_file_info_get_display_name (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_DISPLAY_NAME);
   return _g_file_attribute_value_get_string (value);
 }
 
@@ -1283,15 +1472,11 @@ g_file_info_get_display_name (GFileInfo *info)
 const char *
 g_file_info_get_edit_name (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_EDIT_NAME);
   return _g_file_attribute_value_get_string (value);
 }
 
@@ -1306,16 +1491,12 @@ g_file_info_get_edit_name (GFileInfo *info)
 GIcon *
 g_file_info_get_icon (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   GObject *obj;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_ICON);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_ICON);
   obj = _g_file_attribute_value_get_object (value);
   if (G_IS_ICON (obj))
     return G_ICON (obj);
@@ -1333,15 +1514,11 @@ g_file_info_get_icon (GFileInfo *info)
 const char *
 g_file_info_get_content_type (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_CONTENT_TYPE);
   return _g_file_attribute_value_get_string (value);
 }
 
@@ -1356,15 +1533,11 @@ g_file_info_get_content_type (GFileInfo *info)
 goffset
 g_file_info_get_size (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
  
   g_return_val_if_fail (G_IS_FILE_INFO (info), (goffset) 0);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_SIZE);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_SIZE);
   return (goffset) _g_file_attribute_value_get_uint64 (value);
 }
 
@@ -1380,21 +1553,14 @@ void
 g_file_info_get_modification_time (GFileInfo *info,
 				   GTimeVal  *result)
 {
-  static guint32 attr_mtime = 0, attr_mtime_usec;
   GFileAttributeValue *value;
 
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (result != NULL);
   
-  if (attr_mtime == 0)
-    {
-      attr_mtime = lookup_attribute (G_FILE_ATTRIBUTE_TIME_MODIFIED);
-      attr_mtime_usec = lookup_attribute (G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
-    }
-  
-  value = g_file_info_find_value (info, attr_mtime);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED);
   result->tv_sec = _g_file_attribute_value_get_uint64 (value);
-  value = g_file_info_find_value (info, attr_mtime_usec);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED_USEC);
   result->tv_usec = _g_file_attribute_value_get_uint32 (value);
 }
 
@@ -1409,15 +1575,11 @@ g_file_info_get_modification_time (GFileInfo *info,
 const char *
 g_file_info_get_symlink_target (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_SYMLINK_TARGET);
   return _g_file_attribute_value_get_byte_string (value);
 }
 
@@ -1433,15 +1595,11 @@ g_file_info_get_symlink_target (GFileInfo *info)
 const char *
 g_file_info_get_etag (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_ETAG_VALUE);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_ETAG_VALUE);
   return _g_file_attribute_value_get_string (value);
 }
 
@@ -1457,15 +1615,11 @@ g_file_info_get_etag (GFileInfo *info)
 gint32
 g_file_info_get_sort_order (GFileInfo *info)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_val_if_fail (G_IS_FILE_INFO (info), 0);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_SORT_ORDER);
-  
-  value = g_file_info_find_value (info, attr);
+  value = g_file_info_find_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_SORT_ORDER);
   return _g_file_attribute_value_get_int32 (value);
 }
 
@@ -1482,15 +1636,11 @@ void
 g_file_info_set_file_type (GFileInfo *info,
 			   GFileType  type)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_TYPE);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_TYPE);
   if (value)
     _g_file_attribute_value_set_uint32 (value, type);
 }
@@ -1507,15 +1657,11 @@ void
 g_file_info_set_is_hidden (GFileInfo *info,
 			   gboolean   is_hidden)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_IS_HIDDEN);
   if (value)
     _g_file_attribute_value_set_boolean (value, is_hidden);
 }
@@ -1532,15 +1678,11 @@ void
 g_file_info_set_is_symlink (GFileInfo *info,
 			    gboolean   is_symlink)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_IS_SYMLINK);
   if (value)
     _g_file_attribute_value_set_boolean (value, is_symlink);
 }
@@ -1557,16 +1699,12 @@ void
 g_file_info_set_name (GFileInfo  *info,
 		      const char *name)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (name != NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_NAME);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_NAME);
   if (value)
     _g_file_attribute_value_set_byte_string (value, name);
 }
@@ -1583,16 +1721,12 @@ void
 g_file_info_set_display_name (GFileInfo  *info,
 			      const char *display_name)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (display_name != NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_DISPLAY_NAME);
   if (value)
     _g_file_attribute_value_set_string (value, display_name);
 }
@@ -1609,16 +1743,12 @@ void
 g_file_info_set_edit_name (GFileInfo  *info,
 			   const char *edit_name)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (edit_name != NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_EDIT_NAME);
   if (value)
     _g_file_attribute_value_set_string (value, edit_name);
 }
@@ -1635,16 +1765,12 @@ void
 g_file_info_set_icon (GFileInfo *info,
 		      GIcon     *icon)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (G_IS_ICON (icon));
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_ICON);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_ICON);
   if (value)
     _g_file_attribute_value_set_object (value, G_OBJECT (icon));
 }
@@ -1661,16 +1787,12 @@ void
 g_file_info_set_content_type (GFileInfo  *info,
 			      const char *content_type)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (content_type != NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_CONTENT_TYPE);
   if (value)
     _g_file_attribute_value_set_string (value, content_type);
 }
@@ -1687,15 +1809,11 @@ void
 g_file_info_set_size (GFileInfo *info,
 		      goffset    size)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_SIZE);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_SIZE);
   if (value)
     _g_file_attribute_value_set_uint64 (value, size);
 }
@@ -1712,22 +1830,15 @@ void
 g_file_info_set_modification_time (GFileInfo *info,
 				   GTimeVal  *mtime)
 {
-  static guint32 attr_mtime = 0, attr_mtime_usec;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (mtime != NULL);
   
-  if (attr_mtime == 0)
-    {
-      attr_mtime = lookup_attribute (G_FILE_ATTRIBUTE_TIME_MODIFIED);
-      attr_mtime_usec = lookup_attribute (G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
-    }
-  
-  value = g_file_info_create_value (info, attr_mtime);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED);
   if (value)
     _g_file_attribute_value_set_uint64 (value, mtime->tv_sec);
-  value = g_file_info_create_value (info, attr_mtime_usec);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED_USEC);
   if (value)
     _g_file_attribute_value_set_uint32 (value, mtime->tv_usec);
 }
@@ -1744,16 +1855,12 @@ void
 g_file_info_set_symlink_target (GFileInfo  *info,
 				const char *symlink_target)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   g_return_if_fail (symlink_target != NULL);
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_SYMLINK_TARGET);
   if (value)
     _g_file_attribute_value_set_byte_string (value, symlink_target);
 }
@@ -1770,15 +1877,11 @@ void
 g_file_info_set_sort_order (GFileInfo *info,
 			    gint32     sort_order)
 {
-  static guint32 attr = 0;
   GFileAttributeValue *value;
   
   g_return_if_fail (G_IS_FILE_INFO (info));
   
-  if (attr == 0)
-    attr = lookup_attribute (G_FILE_ATTRIBUTE_STANDARD_SORT_ORDER);
-  
-  value = g_file_info_create_value (info, attr);
+  value = g_file_info_create_value (info, G_FILE_ATTRIBUTE_ID_STANDARD_SORT_ORDER);
   if (value)
     _g_file_attribute_value_set_int32 (value, sort_order);
 }
@@ -2033,9 +2136,9 @@ matcher_matches_id (GFileAttributeMatcher *matcher,
   return FALSE;
 }
 
-static gboolean
-g_file_attribute_matcher_matches_id (GFileAttributeMatcher *matcher,
-                                     guint32                id)
+gboolean
+_g_file_attribute_matcher_matches_id (GFileAttributeMatcher *matcher,
+                                      guint32                id)
 {
   /* We return a NULL matcher for an empty match string, so handle this */
   if (matcher == NULL)
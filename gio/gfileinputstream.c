@@ -50,6 +50,10 @@
  * use g_file_input_stream_tell(). To find out if a file input 
  * stream supports seeking, use g_file_input_stream_can_seek().
  * To position a file input stream, use g_file_input_stream_seek().
+ *
+ * Parsers that want to look at the whole file can get at its contents
+ * without copying them with g_file_input_stream_peek_buffer(), which
+ * local files implement by mapping the file into memory.
  **/
 
 static void       g_file_input_stream_seekable_iface_init    (GSeekableIface       *iface);
@@ -267,6 +271,58 @@ g_file_input_stream_query_info_finish (GFileInputStream  *stream,
   return class->query_info_finish (stream, result, error);
 }
 
+/**
+ * g_file_input_stream_peek_buffer:
+ * @stream: a #GFileInputStream.
+ * @count: a #gsize to get the number of bytes available.
+ *
+ * Gives direct access to the contents of the file from the current
+ * position of @stream up to its end, without copying them. This is
+ * meant for parsers that need to look at a whole file, and which would
+ * otherwise read it into memory piece by piece.
+ *
+ * The data is consumed by skipping or seeking past it; peeking does
+ * not move the stream position. The returned pointer stays valid until
+ * the next call to this function or until @stream is closed.
+ *
+ * For local files the data is mapped from the file, so changes made
+ * to it by others while the stream is open may be visible. If the file
+ * is truncated, accessing the part of the buffer past its new end
+ * raises <literal>SIGBUS</literal>, which kills the process unless it
+ * handles that signal. Only use this for files that no other process
+ * truncates while they are read, and use g_input_stream_read()
+ * otherwise.
+ *
+ * Not all streams support this, so callers must be prepared to fall
+ * back to g_input_stream_read().
+ *
+ * Returns: read-only buffer with the remaining contents of the file,
+ *     or %NULL, with @count set to 0, if the stream doesn't support
+ *     direct access or is at the end of the file.
+ *
+ * Since: 2.22
+ **/
+gconstpointer
+g_file_input_stream_peek_buffer (GFileInputStream *stream,
+				 gsize            *count)
+{
+  GFileInputStreamClass *class;
+
+  g_return_val_if_fail (count != NULL, NULL);
+  *count = 0;
+  g_return_val_if_fail (G_IS_FILE_INPUT_STREAM (stream), NULL);
+
+  if (g_input_stream_is_closed (G_INPUT_STREAM (stream)))
+    return NULL;
+
+  class = G_FILE_INPUT_STREAM_GET_CLASS (stream);
+
+  if (class->peek_buffer == NULL)
+    return NULL;
+
+  return class->peek_buffer (stream, count);
+}
+
 static goffset
 g_file_input_stream_tell (GFileInputStream *stream)
 {
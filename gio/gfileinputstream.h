@@ -81,10 +81,11 @@ struct _GFileInputStreamClass
   GFileInfo * (* query_info_finish) (GFileInputStream     *stream,
                                      GAsyncResult         *res,
                                      GError              **error);
+  gconstpointer (* peek_buffer)     (GFileInputStream     *stream,
+                                     gsize                *count);
 
   /*< private >*/
   /* Padding for future expansion */
-  void (*_g_reserved1) (void);
   void (*_g_reserved2) (void);
   void (*_g_reserved3) (void);
   void (*_g_reserved4) (void);
@@ -106,6 +107,8 @@ void       g_file_input_stream_query_info_async  (GFileInputStream     *stream,
 GFileInfo *g_file_input_stream_query_info_finish (GFileInputStream     *stream,
 						  GAsyncResult         *result,
 						  GError              **error);
+gconstpointer g_file_input_stream_peek_buffer    (GFileInputStream     *stream,
+						  gsize                *count);
 
 G_END_DECLS
 
@@ -32,10 +32,6 @@
 
 #include "gioalias.h"
 
-struct _FileChange;
-typedef struct _FileChange FileChange;
-static void file_change_free (FileChange *change);
-
 /**
  * SECTION:gfilemonitor
  * @short_description: File Monitor
@@ -49,12 +45,17 @@ static void file_change_free (FileChange *change);
  *
  * To get informed about changes to the file or directory you
  * are monitoring, connect to the #GFileMonitor::changed signal.
+ * If you expect many changes at once, for instance when watching
+ * a directory that files are copied into, connect to the
+ * #GFileMonitor::changes signal instead; it delivers all changes
+ * that came in during a main loop iteration in one emission.
  **/
 
 G_LOCK_DEFINE_STATIC(cancelled);
 
 enum {
   CHANGED,
+  CHANGES,
   LAST_SIGNAL
 };
 
@@ -63,11 +64,23 @@ enum {
 
 G_DEFINE_ABSTRACT_TYPE (GFileMonitor, g_file_monitor, G_TYPE_OBJECT);
 
+/* The rate limiters' deadlines are kept in a timer wheel: a ring of
+ * slots, each RATE_LIMITER_TICK_MSECS wide. A limiter sits in the
+ * slot of its next deadline, and a single timeout is armed for the
+ * earliest deadline, so the limiters are only looked at when they
+ * are due. Deadlines further away than one turn of the wheel are put
+ * back when their slot comes up too early.
+ */
+#define RATE_LIMITER_TICK_MSECS 32
+#define RATE_LIMITER_WHEEL_SIZE 64
+
 typedef struct {
   GFile *file;
   guint32 last_sent_change_time; /* 0 == not sent */
   guint32 send_delayed_change_at; /* 0 == never */
   guint32 send_virtual_changes_done_at; /* 0 == never */
+  guint32 deadline;
+  GList *wheel_link; /* NULL == not scheduled */
 } RateLimiter;
 
 struct _GFileMonitorPrivate {
@@ -76,12 +89,16 @@ struct _GFileMonitorPrivate {
 
   /* Rate limiting change events */
   GHashTable *rate_limiter;
+  GList **wheel; /* RateLimiter, RATE_LIMITER_WHEEL_SIZE slots */
+  guint wheel_count;
+  guint32 wheel_time; /* start of the last tick that was processed */
 
   guint pending_file_change_id;
-  GSList *pending_file_changes; /* FileChange */
+  GArray *pending_file_changes; /* GFileMonitorChange */
+  GHashTable *pending_file_index; /* GFile -> last index + 1 */
 
   GSource *timeout;
-  guint32 timeout_fires_at;
+  guint32 timeout_at;
 };
 
 enum {
@@ -158,6 +175,7 @@ static void
 g_file_monitor_finalize (GObject *object)
 {
   GFileMonitor *monitor;
+  int i;
 
   monitor = G_FILE_MONITOR (object);
 
@@ -167,11 +185,35 @@ g_file_monitor_finalize (GObject *object)
       g_source_unref (monitor->priv->timeout);
     }
 
+  if (monitor->priv->wheel)
+    {
+      for (i = 0; i < RATE_LIMITER_WHEEL_SIZE; i++)
+	g_list_free (monitor->priv->wheel[i]);
+      g_free (monitor->priv->wheel);
+    }
+
   g_hash_table_destroy (monitor->priv->rate_limiter);
 
   G_OBJECT_CLASS (g_file_monitor_parent_class)->finalize (object);
 }
 
+static void
+free_changes (GArray *changes)
+{
+  GFileMonitorChange *change;
+  guint i;
+
+  for (i = 0; i < changes->len; i++)
+    {
+      change = &g_array_index (changes, GFileMonitorChange, i);
+      g_object_unref (change->file);
+      if (change->other_file)
+	g_object_unref (change->other_file);
+    }
+
+  g_array_free (changes, TRUE);
+}
+
 static void
 g_file_monitor_dispose (GObject *object)
 {
@@ -186,9 +228,13 @@ g_file_monitor_dispose (GObject *object)
       g_source_remove (priv->pending_file_change_id);
       priv->pending_file_change_id = 0;
     }
-  g_slist_foreach (priv->pending_file_changes, (GFunc) file_change_free, NULL);
-  g_slist_free (priv->pending_file_changes);
-  priv->pending_file_changes = NULL;
+  if (priv->pending_file_changes)
+    {
+      g_hash_table_destroy (priv->pending_file_index);
+      priv->pending_file_index = NULL;
+      free_changes (priv->pending_file_changes);
+      priv->pending_file_changes = NULL;
+    }
 
   /* Make sure we cancel on last unref */
   g_file_monitor_cancel (monitor);
@@ -228,6 +274,34 @@ g_file_monitor_class_init (GFileMonitorClass *klass)
 		  G_TYPE_NONE, 3,
 		  G_TYPE_FILE, G_TYPE_FILE, G_TYPE_FILE_MONITOR_EVENT);
 
+  /**
+   * GFileMonitor::changes:
+   * @monitor: a #GFileMonitor.
+   * @changes: an array of #GFileMonitorChange.
+   * @n_changes: the number of elements in @changes.
+   *
+   * Emitted once per main loop iteration with all the changes
+   * that came in since the last emission, in order. Repeated
+   * %G_FILE_MONITOR_EVENT_CHANGED and
+   * %G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED events for the same
+   * file are merged. The array is only valid during the emission.
+   *
+   * #GFileMonitor::changed is emitted for each change after this,
+   * but only if it has handlers, so a monitor that is only used
+   * through this signal does not pay for it.
+   *
+   * Since: 2.22
+   **/
+  signals[CHANGES] =
+    g_signal_new (I_("changes"),
+		  G_TYPE_FILE_MONITOR,
+		  G_SIGNAL_RUN_LAST,
+		  G_STRUCT_OFFSET (GFileMonitorClass, changes),
+		  NULL, NULL,
+		  _gio_marshal_VOID__POINTER_UINT,
+		  G_TYPE_NONE, 2,
+		  G_TYPE_POINTER, G_TYPE_UINT);
+
   g_object_class_install_property (object_class,
                                    PROP_RATE_LIMIT,
                                    g_param_spec_int ("rate-limit",
@@ -338,41 +412,52 @@ g_file_monitor_set_rate_limit (GFileMonitor *monitor,
     }
 }
 
-struct _FileChange {
-  GFile             *child;
-  GFile             *other_file;
-  GFileMonitorEvent  event_type;
-};
-
-static void
-file_change_free (FileChange *change)
-{
-  g_object_unref (change->child);
-  if (change->other_file)
-    g_object_unref (change->other_file);
-  
-  g_slice_free (FileChange, change);
-}
+/**
+ * GFileMonitorChange:
+ * @file: the #GFile that changed.
+ * @other_file: a #GFile, or %NULL.
+ * @event_type: a #GFileMonitorEvent.
+ *
+ * One change, as delivered by the #GFileMonitor::changes signal.
+ * The members have the same meaning as the arguments of
+ * #GFileMonitor::changed.
+ *
+ * Since: 2.22
+ */
 
 static gboolean
 emit_cb (gpointer data)
 {
   GFileMonitor *monitor = G_FILE_MONITOR (data);
-  GSList *pending, *iter;
+  GFileMonitorClass *klass;
+  GFileMonitorChange *change;
+  GArray *changes;
+  guint i;
   
-  pending = g_slist_reverse (monitor->priv->pending_file_changes);
+  changes = monitor->priv->pending_file_changes;
   monitor->priv->pending_file_changes = NULL;
+  g_hash_table_destroy (monitor->priv->pending_file_index);
+  monitor->priv->pending_file_index = NULL;
   monitor->priv->pending_file_change_id = 0;
 
   g_object_ref (monitor);
-  for (iter = pending; iter; iter = iter->next)
+
+  g_signal_emit (monitor, signals[CHANGES], 0,
+		 changes->data, changes->len);
+
+  klass = G_FILE_MONITOR_GET_CLASS (monitor);
+  if (klass->changed ||
+      g_signal_has_handler_pending (monitor, signals[CHANGED], 0, FALSE))
     {
-       FileChange *change = iter->data;
-       g_signal_emit (monitor, signals[CHANGED], 0,
-	  	      change->child, change->other_file, change->event_type);
-       file_change_free (change);
+      for (i = 0; i < changes->len; i++)
+	{
+	  change = &g_array_index (changes, GFileMonitorChange, i);
+	  g_signal_emit (monitor, signals[CHANGED], 0,
+			 change->file, change->other_file, change->event_type);
+	}
     }
-  g_slist_free (pending);
+
+  free_changes (changes);
   g_object_unref (monitor);
 
   return FALSE;
@@ -385,20 +470,13 @@ emit_in_idle (GFileMonitor      *monitor,
 	      GFileMonitorEvent  event_type)
 {
   GSource *source;
-  FileChange *change;
+  GFileMonitorChange change;
+  GFileMonitorChange *last;
   GFileMonitorPrivate *priv;
+  guint index;
 
   priv = monitor->priv;
 
-  change = g_slice_new (FileChange);
-
-  change->child = g_object_ref (child);
-  if (other_file)
-    change->other_file = g_object_ref (other_file);
-  else
-    change->other_file = NULL;
-  change->event_type = event_type;
-
   if (!priv->pending_file_change_id)
     {
       source = g_idle_source_new ();
@@ -410,9 +488,34 @@ emit_in_idle (GFileMonitor      *monitor,
       g_source_set_callback (source, emit_cb, monitor, NULL);
       priv->pending_file_change_id = g_source_attach (source, NULL);
       g_source_unref (source);
+
+      priv->pending_file_changes = g_array_new (FALSE, FALSE, sizeof (GFileMonitorChange));
+      priv->pending_file_index = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
     }
-  /* We reverse this in the processor */
-  priv->pending_file_changes = g_slist_prepend (priv->pending_file_changes, change);
+
+  /* Another change or attribute change right after the same one
+   * doesn't tell the application anything new
+   */
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (priv->pending_file_index, child));
+  if (index != 0 && other_file == NULL &&
+      (event_type == G_FILE_MONITOR_EVENT_CHANGED ||
+       event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED))
+    {
+      last = &g_array_index (priv->pending_file_changes, GFileMonitorChange, index - 1);
+      if (last->event_type == event_type && last->other_file == NULL)
+	return;
+    }
+
+  change.file = g_object_ref (child);
+  if (other_file)
+    change.other_file = g_object_ref (other_file);
+  else
+    change.other_file = NULL;
+  change.event_type = event_type;
+
+  g_array_append_val (priv->pending_file_changes, change);
+  g_hash_table_insert (priv->pending_file_index, change.file,
+		       GUINT_TO_POINTER (priv->pending_file_changes->len));
 }
 
 static guint32
@@ -424,7 +527,8 @@ get_time_msecs (void)
 static guint32
 time_difference (guint32 from, guint32 to)
 {
-  if (from > to)
+  /* The times wrap around every 49 days, so go by their distance */
+  if ((gint32) (to - from) < 0)
     return 0;
   return to - from;
 }
@@ -471,157 +575,251 @@ rate_limiter_send_delayed_change_now (GFileMonitor *monitor,
     }
 }
 
-typedef struct {
-  guint32 min_time;
-  guint32 time_now;
-  GFileMonitor *monitor;
-} ForEachData;
+static void
+earliest_deadline (guint32   time_now,
+		   guint32   time,
+		   gboolean *pending,
+		   guint32  *deadline)
+{
+  if (!*pending ||
+      time_difference (time_now, time) < time_difference (time_now, *deadline))
+    *deadline = time;
+  *pending = TRUE;
+}
 
+/* Returns FALSE if the limiter has nothing left to do */
 static gboolean
-calc_min_time (GFileMonitor *monitor, 
+calc_deadline (GFileMonitor *monitor, 
                RateLimiter *limiter, 
                guint32 time_now, 
-               guint32 *min_time)
+               guint32 *deadline)
 {
-  gboolean delete_me;
+  gboolean pending;
   guint32 expire_at;
 
-  delete_me = TRUE;
+  pending = FALSE;
+  *deadline = 0;
 
   if (limiter->last_sent_change_time != 0)
     {
-      /* Set a timeout at 2*rate limit so that we can clear out the change from the hash eventualy */
+      /* Expire at 2*rate limit so that we can clear out the change from the hash eventualy */
       expire_at = limiter->last_sent_change_time + 2 * monitor->priv->rate_limit_msec;
 
       if (time_difference (time_now, expire_at) > 0)
-	{
-	  delete_me = FALSE;
-	  *min_time = MIN (*min_time,
-			   time_difference (time_now, expire_at));
-	}
+	earliest_deadline (time_now, expire_at, &pending, deadline);
     }
 
   if (limiter->send_delayed_change_at != 0)
-    {
-      delete_me = FALSE;
-      *min_time = MIN (*min_time,
-		       time_difference (time_now, limiter->send_delayed_change_at));
-    }
+    earliest_deadline (time_now, limiter->send_delayed_change_at, &pending, deadline);
 
   if (limiter->send_virtual_changes_done_at != 0)
+    earliest_deadline (time_now, limiter->send_virtual_changes_done_at, &pending, deadline);
+
+  return pending;
+}
+
+static gboolean rate_limiter_timeout (gpointer timeout_data);
+
+static guint
+rate_limiter_slot (guint32 time)
+{
+  return (time / RATE_LIMITER_TICK_MSECS) % RATE_LIMITER_WHEEL_SIZE;
+}
+
+/* Makes sure the timeout fires no later than @deadline */
+static void
+rate_limiter_arm (GFileMonitor *monitor,
+		  guint32       deadline,
+		  guint32       time_now)
+{
+  GFileMonitorPrivate *priv = monitor->priv;
+  GSource *source;
+
+  if (priv->timeout)
     {
-      delete_me = FALSE;
-      *min_time = MIN (*min_time,
-		       time_difference (time_now, limiter->send_virtual_changes_done_at));
+      if (time_difference (deadline, priv->timeout_at) == 0)
+	return;
+
+      g_source_destroy (priv->timeout);
+      g_source_unref (priv->timeout);
     }
 
-  return delete_me;
+  source = g_timeout_source_new (time_difference (time_now, deadline));
+  g_source_set_callback (source, rate_limiter_timeout, monitor, NULL);
+  g_source_attach (source, NULL);
+  priv->timeout = source;
+  priv->timeout_at = deadline;
 }
 
-static gboolean
-foreach_rate_limiter_fire (gpointer key,
-			   gpointer value,
-			   gpointer user_data)
+/* Returns the earliest deadline of the limiters in the wheel */
+static guint32
+rate_limiter_next_deadline (GFileMonitor *monitor)
 {
-  RateLimiter *limiter = value;
-  ForEachData *data = user_data;
+  GFileMonitorPrivate *priv = monitor->priv;
+  RateLimiter *limiter;
+  gboolean found;
+  guint32 best, distance;
+  GList *l;
+  guint i;
+
+  found = FALSE;
+  best = 0;
+  for (i = 1; i <= RATE_LIMITER_WHEEL_SIZE; i++)
+    {
+      l = priv->wheel[rate_limiter_slot (priv->wheel_time + i * RATE_LIMITER_TICK_MSECS)];
+      for (; l != NULL; l = l->next)
+	{
+	  limiter = l->data;
+	  distance = time_difference (priv->wheel_time, limiter->deadline);
+	  if (!found || distance < best)
+	    best = distance;
+	  found = TRUE;
+	}
 
-  if (limiter->send_delayed_change_at != 0 &&
-      time_difference (data->time_now, limiter->send_delayed_change_at) == 0)
-    rate_limiter_send_delayed_change_now (data->monitor, limiter, data->time_now);
-  
-  if (limiter->send_virtual_changes_done_at != 0 &&
-      time_difference (data->time_now, limiter->send_virtual_changes_done_at) == 0)
-    rate_limiter_send_virtual_changes_done_now (data->monitor, limiter);
-  
-  return calc_min_time (data->monitor, limiter, data->time_now, &data->min_time);
+      /* Nothing in a later slot can be due any earlier */
+      if (found && best < (i + 1) * RATE_LIMITER_TICK_MSECS)
+	break;
+    }
+
+  return priv->wheel_time + best;
 }
 
-static gboolean 
-rate_limiter_timeout (gpointer timeout_data)
+static void
+rate_limiter_unschedule (GFileMonitor *monitor,
+			 RateLimiter  *limiter)
 {
-  GFileMonitor *monitor = timeout_data;
-  ForEachData data;
-  GSource *source;
-  
-  data.min_time = G_MAXUINT32;
-  data.monitor = monitor;
-  data.time_now = get_time_msecs ();
-  g_hash_table_foreach_remove (monitor->priv->rate_limiter,
-			       foreach_rate_limiter_fire,
-			       &data);
-  
-  /* Remove old timeout */
-  if (monitor->priv->timeout)
+  GFileMonitorPrivate *priv = monitor->priv;
+  guint slot;
+
+  if (limiter->wheel_link)
     {
-      g_source_destroy (monitor->priv->timeout);
-      g_source_unref (monitor->priv->timeout);
-      monitor->priv->timeout = NULL;
-      monitor->priv->timeout_fires_at = 0;
+      slot = rate_limiter_slot (limiter->deadline);
+      priv->wheel[slot] = g_list_delete_link (priv->wheel[slot], limiter->wheel_link);
+      limiter->wheel_link = NULL;
+      priv->wheel_count--;
     }
-  
-  /* Set up new timeout */
-  if (data.min_time != G_MAXUINT32)
+}
+
+static void
+rate_limiter_insert (GFileMonitor *monitor,
+		     RateLimiter  *limiter,
+		     guint32       time_now)
+{
+  GFileMonitorPrivate *priv = monitor->priv;
+  guint slot;
+
+  if (priv->wheel == NULL)
+    priv->wheel = g_new0 (GList *, RATE_LIMITER_WHEEL_SIZE);
+
+  /* The wheel was idle, restart it from now */
+  if (priv->timeout == NULL)
+    priv->wheel_time = time_now - time_now % RATE_LIMITER_TICK_MSECS;
+
+  /* Anything that is already due goes into the next slot */
+  if (time_difference (priv->wheel_time, limiter->deadline) < RATE_LIMITER_TICK_MSECS)
+    limiter->deadline = priv->wheel_time + RATE_LIMITER_TICK_MSECS;
+
+  slot = rate_limiter_slot (limiter->deadline);
+  priv->wheel[slot] = g_list_prepend (priv->wheel[slot], limiter);
+  limiter->wheel_link = priv->wheel[slot];
+  priv->wheel_count++;
+
+  rate_limiter_arm (monitor, limiter->deadline, time_now);
+}
+
+/* Moves the limiter to the slot of its next deadline, or drops it
+ * if it has none. The limiter may be freed.
+ */
+static void
+rate_limiter_reschedule (GFileMonitor *monitor,
+			 RateLimiter  *limiter,
+			 guint32       time_now)
+{
+  guint32 deadline;
+
+  rate_limiter_unschedule (monitor, limiter);
+
+  if (calc_deadline (monitor, limiter, time_now, &deadline))
     {
-      source = g_timeout_source_new (data.min_time + 1); /* + 1 to make sure we've really passed the time */
-      g_source_set_callback (source, rate_limiter_timeout, monitor, NULL);
-      g_source_attach (source, NULL);
-      
-      monitor->priv->timeout = source;
-      monitor->priv->timeout_fires_at = data.time_now + data.min_time; 
+      limiter->deadline = deadline;
+      rate_limiter_insert (monitor, limiter, time_now);
     }
-  
-  return FALSE;
+  else
+    g_hash_table_remove (monitor->priv->rate_limiter, limiter->file);
 }
 
-static gboolean
-foreach_rate_limiter_update (gpointer key,
-			     gpointer value,
-			     gpointer user_data)
+static void
+rate_limiter_fire (GFileMonitor *monitor,
+		   RateLimiter  *limiter,
+		   guint32       time_now)
 {
-  RateLimiter *limiter = value;
-  ForEachData *data = user_data;
+  if (limiter->send_delayed_change_at != 0 &&
+      time_difference (time_now, limiter->send_delayed_change_at) == 0)
+    rate_limiter_send_delayed_change_now (monitor, limiter, time_now);
+  
+  if (limiter->send_virtual_changes_done_at != 0 &&
+      time_difference (time_now, limiter->send_virtual_changes_done_at) == 0)
+    rate_limiter_send_virtual_changes_done_now (monitor, limiter);
 
-  return calc_min_time (data->monitor, limiter, data->time_now, &data->min_time);
+  rate_limiter_reschedule (monitor, limiter, time_now);
 }
 
-static void
-update_rate_limiter_timeout (GFileMonitor *monitor, 
-                             guint new_time)
+static gboolean 
+rate_limiter_timeout (gpointer timeout_data)
 {
-  ForEachData data;
-  GSource *source;
+  GFileMonitor *monitor = timeout_data;
+  GFileMonitorPrivate *priv = monitor->priv;
+  RateLimiter *limiter;
+  GList *due;
+  guint32 time_now, n_ticks, i;
+  guint slot;
   
-  if (monitor->priv->timeout_fires_at != 0 && new_time != 0 &&
-      time_difference (new_time, monitor->priv->timeout_fires_at) == 0)
-    return; /* Nothing to do, we already fire earlier than that */
-
-  data.min_time = G_MAXUINT32;
-  data.monitor = monitor;
-  data.time_now = get_time_msecs ();
-  g_hash_table_foreach_remove (monitor->priv->rate_limiter,
-			       foreach_rate_limiter_update,
-			       &data);
-
-  /* Remove old timeout */
-  if (monitor->priv->timeout)
+  time_now = get_time_msecs ();
+  n_ticks = time_difference (priv->wheel_time, time_now) / RATE_LIMITER_TICK_MSECS;
+  if (n_ticks > RATE_LIMITER_WHEEL_SIZE)
     {
-      g_source_destroy (monitor->priv->timeout);
-      g_source_unref (monitor->priv->timeout);
-      monitor->priv->timeout_fires_at = 0;
-      monitor->priv->timeout = NULL;
+      /* Visit every slot once, ending with the current one */
+      priv->wheel_time += (n_ticks - RATE_LIMITER_WHEEL_SIZE) * RATE_LIMITER_TICK_MSECS;
+      n_ticks = RATE_LIMITER_WHEEL_SIZE;
     }
 
-  /* Set up new timeout */
-  if (data.min_time != G_MAXUINT32)
+  /* Everything put back below is due later than this, so
+   * nothing rearms the timeout until we are done
+   */
+  priv->timeout_at = priv->wheel_time;
+
+  for (i = 0; i < n_ticks; i++)
     {
-      source = g_timeout_source_new (data.min_time + 1);  /* + 1 to make sure we've really passed the time */
-      g_source_set_callback (source, rate_limiter_timeout, monitor, NULL);
-      g_source_attach (source, NULL);
-      
-      monitor->priv->timeout = source;
-      monitor->priv->timeout_fires_at = data.time_now + data.min_time; 
+      /* Limiters that are put back while we are at it go into
+       * a later slot
+       */
+      priv->wheel_time += RATE_LIMITER_TICK_MSECS;
+      slot = rate_limiter_slot (priv->wheel_time);
+      due = priv->wheel[slot];
+      priv->wheel[slot] = NULL;
+
+      while (due)
+	{
+	  limiter = due->data;
+	  due = g_list_delete_link (due, due);
+	  limiter->wheel_link = NULL;
+	  priv->wheel_count--;
+
+	  if (time_difference (time_now, limiter->deadline) == 0)
+	    rate_limiter_fire (monitor, limiter, time_now);
+	  else
+	    rate_limiter_insert (monitor, limiter, time_now);
+	}
     }
+
+  g_source_unref (priv->timeout);
+  priv->timeout = NULL;
+
+  /* Sleep until the next deadline, if there is one */
+  if (priv->wheel_count > 0)
+    rate_limiter_arm (monitor, rate_limiter_next_deadline (monitor), time_now);
+
+  return FALSE;
 }
 
 /**
@@ -651,24 +849,24 @@ g_file_monitor_emit_event (GFileMonitor      *monitor,
   g_return_if_fail (G_IS_FILE (child));
 
   limiter = g_hash_table_lookup (monitor->priv->rate_limiter, child);
+  time_now = get_time_msecs ();
 
   if (event_type != G_FILE_MONITOR_EVENT_CHANGED)
     {
       if (limiter)
 	{
-	  rate_limiter_send_delayed_change_now (monitor, limiter, get_time_msecs ());
+	  rate_limiter_send_delayed_change_now (monitor, limiter, time_now);
 	  if (event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
 	    limiter->send_virtual_changes_done_at = 0;
 	  else
 	    rate_limiter_send_virtual_changes_done_now (monitor, limiter);
-	  update_rate_limiter_timeout (monitor, 0);
+	  rate_limiter_reschedule (monitor, limiter, time_now);
 	}
       emit_in_idle (monitor, child, other_file, event_type);
     }
   else
     {
       /* Changed event, rate limit */
-      time_now = get_time_msecs ();
       emit_now = TRUE;
       
       if (limiter)
@@ -680,10 +878,7 @@ g_file_monitor_emit_event (GFileMonitor      *monitor,
 		 don't get any other events (that kill this timeout) */
 	      emit_now = FALSE;
 	      if (limiter->send_delayed_change_at == 0)
-		{
-		  limiter->send_delayed_change_at = time_now + monitor->priv->rate_limit_msec;
-		  update_rate_limiter_timeout (monitor, limiter->send_delayed_change_at);
-		}
+		limiter->send_delayed_change_at = time_now + monitor->priv->rate_limit_msec;
 	    }
 	}
       
@@ -696,15 +891,13 @@ g_file_monitor_emit_event (GFileMonitor      *monitor,
 	  
 	  limiter->last_sent_change_time = time_now;
 	  limiter->send_delayed_change_at = 0;
-	  /* Set a timeout of 2*rate limit so that we can clear out the change from the hash eventualy */
-	  update_rate_limiter_timeout (monitor, time_now + 2 * monitor->priv->rate_limit_msec);
 	}
       
       /* Schedule a virtual change done. This is removed if we get a real one, and
 	 postponed if we get more change events. */
       
       limiter->send_virtual_changes_done_at = time_now + DEFAULT_VIRTUAL_CHANGES_DONE_DELAY_SECS * 1000;
-      update_rate_limiter_timeout (monitor, limiter->send_virtual_changes_done_at);
+      rate_limiter_reschedule (monitor, limiter, time_now);
     }
 }
 
@@ -40,6 +40,14 @@ G_BEGIN_DECLS
 
 typedef struct _GFileMonitorClass       GFileMonitorClass;
 typedef struct _GFileMonitorPrivate	GFileMonitorPrivate;
+typedef struct _GFileMonitorChange      GFileMonitorChange;
+
+struct _GFileMonitorChange
+{
+  GFile             *file;
+  GFile             *other_file;
+  GFileMonitorEvent  event_type;
+};
 
 /**
  * GFileMonitor:
@@ -67,9 +75,13 @@ struct _GFileMonitorClass
   /* Virtual Table */
   gboolean (* cancel)  (GFileMonitor      *monitor);
 
+  /* Signals */
+  void     (* changes) (GFileMonitor             *monitor,
+                        const GFileMonitorChange *changes,
+                        guint                     n_changes);
+
   /*< private >*/
   /* Padding for future expansion */
-  void (*_g_reserved1) (void);
   void (*_g_reserved2) (void);
   void (*_g_reserved3) (void);
   void (*_g_reserved4) (void);
@@ -226,12 +226,16 @@ typedef enum {
  * GFileMonitorFlags:
  * @G_FILE_MONITOR_NONE: No flags set.
  * @G_FILE_MONITOR_WATCH_MOUNTS: Watch for mount events.
+ * @G_FILE_MONITOR_WATCH_RECURSIVE: Also watch all directories below
+ *   a monitored directory. Only supported by some backends; others
+ *   ignore it. Since 2.22
  *
  * Flags used to set what a #GFileMonitor will watch for.
  */
 typedef enum {
-  G_FILE_MONITOR_NONE         = 0,
-  G_FILE_MONITOR_WATCH_MOUNTS = (1 << 0)
+  G_FILE_MONITOR_NONE            = 0,
+  G_FILE_MONITOR_WATCH_MOUNTS    = (1 << 0),
+  G_FILE_MONITOR_WATCH_RECURSIVE = (1 << 1)
 } GFileMonitorFlags;
 
 
@@ -22,6 +22,11 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include "gioscheduler.h"
 #include "gcancellable.h"
 
@@ -44,10 +49,17 @@
  * It is recommended to choose priorities between %G_PRIORITY_LOW and 
  * %G_PRIORITY_HIGH, with %G_PRIORITY_DEFAULT as a default.
  * </para>
+ *
+ * When threads are available, jobs are run by a pool of worker threads.
+ * It has as many threads as there are processors, but at least 10,
+ * since most jobs spend their time blocked on I/O. The
+ * <envar>GIO_SCHEDULER_THREADS</envar> environment variable overrides
+ * this.
  **/
 
 struct _GIOSchedulerJob {
-  GSList *active_link;
+  volatile gint ref_count;
+  GList *active_link;
   GIOSchedulerJobFunc job_func;
   GSourceFunc cancel_func; /* Runs under job map lock */
   gpointer data;
@@ -55,12 +67,15 @@ struct _GIOSchedulerJob {
 
   gint io_priority;
   GCancellable *cancellable;
+  gulong cancelled_tag;
 
   guint idle_tag;
 };
 
+#define DEFAULT_MAX_THREADS 10
+
 G_LOCK_DEFINE_STATIC(active_jobs);
-static GSList *active_jobs = NULL;
+static GList *active_jobs = NULL;
 
 static GThreadPool *job_thread_pool = NULL;
 
@@ -68,11 +83,14 @@ static void io_job_thread (gpointer data,
 			   gpointer user_data);
 
 static void
-g_io_job_free (GIOSchedulerJob *job)
+g_io_job_unref (GIOSchedulerJob *job)
 {
+  if (!g_atomic_int_dec_and_test (&job->ref_count))
+    return;
+
   if (job->cancellable)
     g_object_unref (job->cancellable);
-  g_free (job);
+  g_slice_free (GIOSchedulerJob, job);
 }
 
 static gint
@@ -94,6 +112,28 @@ g_io_job_compare (gconstpointer a,
   return 1;
 }
 
+static gint
+get_max_threads (void)
+{
+  const char *env;
+  gint max_threads;
+
+  env = g_getenv ("GIO_SCHEDULER_THREADS");
+  if (env != NULL)
+    {
+      max_threads = atoi (env);
+      if (max_threads > 0)
+	return max_threads;
+    }
+
+  max_threads = DEFAULT_MAX_THREADS;
+#if defined (HAVE_UNISTD_H) && defined (_SC_NPROCESSORS_ONLN)
+  max_threads = MAX (max_threads, sysconf (_SC_NPROCESSORS_ONLN));
+#endif
+
+  return max_threads;
+}
+
 static gpointer
 init_scheduler (gpointer arg)
 {
@@ -102,7 +142,7 @@ init_scheduler (gpointer arg)
       /* TODO: thread_pool_new can fail */
       job_thread_pool = g_thread_pool_new (io_job_thread,
 					   NULL,
-					   10,
+					   get_max_threads (),
 					   FALSE,
 					   NULL);
       if (job_thread_pool != NULL)
@@ -121,35 +161,42 @@ init_scheduler (gpointer arg)
   return NULL;
 }
 
+/* Moves a cancelled job to the front of the queue, so that it can
+ * finish before anything else runs. The handler may still run after
+ * the job finished, but it holds a reference to the job.
+ */
 static void
-remove_active_job (GIOSchedulerJob *job)
+job_cancelled (GCancellable    *cancellable,
+	       GIOSchedulerJob *job)
 {
-  GIOSchedulerJob *other_job;
-  GSList *l;
   gboolean resort_jobs;
-  
+
   G_LOCK (active_jobs);
-  active_jobs = g_slist_delete_link (active_jobs, job->active_link);
-  
   resort_jobs = FALSE;
-  for (l = active_jobs; l != NULL; l = l->next)
+  if (job->active_link != NULL && job->io_priority >= 0)
     {
-      other_job = l->data;
-      if (other_job->io_priority >= 0 &&
-	  g_cancellable_is_cancelled (other_job->cancellable))
-	{
-	  other_job->io_priority = -1;
-	  resort_jobs = TRUE;
-	}
+      job->io_priority = -1;
+      resort_jobs = TRUE;
     }
   G_UNLOCK (active_jobs);
-  
+
   if (resort_jobs &&
       job_thread_pool != NULL)
     g_thread_pool_set_sort_function (job_thread_pool,
 				     g_io_job_compare,
 				     NULL);
+}
+
+static void
+remove_active_job (GIOSchedulerJob *job)
+{
+  if (job->cancelled_tag)
+    g_signal_handler_disconnect (job->cancellable, job->cancelled_tag);
 
+  G_LOCK (active_jobs);
+  active_jobs = g_list_delete_link (active_jobs, job->active_link);
+  job->active_link = NULL;
+  G_UNLOCK (active_jobs);
 }
 
 static void
@@ -161,7 +208,7 @@ job_destroy (gpointer data)
     job->destroy_notify (job->data);
 
   remove_active_job (job);
-  g_io_job_free (job);
+  g_io_job_unref (job);
 }
 
 static void
@@ -233,7 +280,8 @@ g_io_scheduler_push_job (GIOSchedulerJobFunc  job_func,
 
   g_return_if_fail (job_func != NULL);
 
-  job = g_new0 (GIOSchedulerJob, 1);
+  job = g_slice_new0 (GIOSchedulerJob);
+  job->ref_count = 1;
   job->job_func = job_func;
   job->data = user_data;
   job->destroy_notify = notify;
@@ -243,10 +291,22 @@ g_io_scheduler_push_job (GIOSchedulerJobFunc  job_func,
     job->cancellable = g_object_ref (cancellable);
 
   G_LOCK (active_jobs);
-  active_jobs = g_slist_prepend (active_jobs, job);
+  active_jobs = g_list_prepend (active_jobs, job);
   job->active_link = active_jobs;
   G_UNLOCK (active_jobs);
 
+  if (cancellable)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+	job->io_priority = -1;
+
+      g_atomic_int_inc (&job->ref_count);
+      job->cancelled_tag =
+	g_signal_connect_data (cancellable, "cancelled",
+			       G_CALLBACK (job_cancelled), job,
+			       (GClosureNotify) g_io_job_unref, 0);
+    }
+
   if (g_thread_supported())
     {
       g_once (&once_init, init_scheduler, NULL);
@@ -275,12 +335,13 @@ void
 g_io_scheduler_cancel_all_jobs (void)
 {
   GSList *cancellable_list, *l;
+  GList *jl;
   
   G_LOCK (active_jobs);
   cancellable_list = NULL;
-  for (l = active_jobs; l != NULL; l = l->next)
+  for (jl = active_jobs; jl != NULL; jl = jl->next)
     {
-      GIOSchedulerJob *job = l->data;
+      GIOSchedulerJob *job = jl->data;
       if (job->cancellable)
 	cancellable_list = g_slist_prepend (cancellable_list,
 					    g_object_ref (job->cancellable));
@@ -155,6 +155,39 @@ typedef gboolean (* GFileReadMoreCallback) (const char *file_contents,
                                             goffset file_size,
                                             gpointer callback_data);
 
+/**
+ * GFileWalkBatchCallback:
+ * @directory: the directory containing the files.
+ * @infos: a #GList of #GFileInfo<!-- -->s for files in @directory.
+ * @user_data: user data passed to g_file_walk_async().
+ *
+ * Receives the next batch of files found by g_file_walk_async().
+ * The list and the #GFileInfo<!-- -->s in it belong to the walk;
+ * take a reference on anything that needs to be kept.
+ *
+ * Since: 2.22
+ **/
+typedef void (* GFileWalkBatchCallback) (GFile    *directory,
+                                         GList    *infos,
+                                         gpointer  user_data);
+
+/**
+ * GFileWalkPruneCallback:
+ * @directory: the directory containing the subdirectory.
+ * @info: a #GFileInfo for the subdirectory.
+ * @user_data: user data passed to g_file_walk_async().
+ *
+ * Decides whether g_file_walk_async() should skip a subdirectory.
+ *
+ * Returns: %TRUE to skip the subdirectory and everything below it,
+ *     %FALSE to walk into it.
+ *
+ * Since: 2.22
+ **/
+typedef gboolean (* GFileWalkPruneCallback) (GFile     *directory,
+                                             GFileInfo *info,
+                                             gpointer   user_data);
+
 
 /**
  * GIOSchedulerJobFunc:
@@ -191,6 +224,24 @@ typedef void (*GSimpleAsyncThreadFunc) (GSimpleAsyncResult *res,
                                         GObject *object,
                                         GCancellable *cancellable);
 
+/**
+ * GOutputVector:
+ * @buffer: pointer to a buffer of data to write.
+ * @size: the size of @buffer.
+ *
+ * Structure used for gathered output. An array of #GOutputVector<!-- -->s
+ * is written as if all the buffers were one contiguous buffer, see
+ * g_output_stream_writev().
+ *
+ * Since: 2.22
+ **/
+typedef struct _GOutputVector GOutputVector;
+
+struct _GOutputVector {
+  gconstpointer buffer;
+  gsize size;
+};
+
 G_END_DECLS
 
 #endif /* __GIO_TYPES_H__ */
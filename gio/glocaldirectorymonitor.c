@@ -36,7 +36,8 @@
 enum
 {
   PROP_0,
-  PROP_DIRNAME
+  PROP_DIRNAME,
+  PROP_FLAGS
 };
 
 static gboolean g_local_directory_monitor_cancel (GFileMonitor      *monitor);
@@ -72,6 +73,7 @@ g_local_directory_monitor_set_property (GObject      *object,
   switch (property_id)
   {
     case PROP_DIRNAME:
+    case PROP_FLAGS:
       /* Do nothing */
       break;
     default:
@@ -90,6 +92,7 @@ g_local_directory_monitor_constructor (GType                  type,
   GObjectClass *parent_class;
   GLocalDirectoryMonitor *local_monitor;
   const gchar *dirname = NULL;
+  GFileMonitorFlags flags = 0;
   gint i;
   
   klass = G_LOCAL_DIRECTORY_MONITOR_CLASS (g_type_class_peek (G_TYPE_LOCAL_DIRECTORY_MONITOR));
@@ -106,11 +109,16 @@ g_local_directory_monitor_constructor (GType                  type,
         {
           g_warn_if_fail (G_VALUE_HOLDS_STRING (construct_properties[i].value));
           dirname = g_value_get_string (construct_properties[i].value);
-          break;
+        }
+      else if (strcmp ("flags", g_param_spec_get_name (construct_properties[i].pspec)) == 0)
+        {
+          g_warn_if_fail (G_VALUE_HOLDS_FLAGS (construct_properties[i].value));
+          flags = g_value_get_flags (construct_properties[i].value);
         }
     }
 
   local_monitor->dirname = g_strdup (dirname);
+  local_monitor->flags = flags;
 
   if (!klass->mount_notify)
     {
@@ -160,6 +168,17 @@ g_local_directory_monitor_class_init (GLocalDirectoryMonitorClass* klass)
                                                         G_PARAM_WRITABLE|
                                                         G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
 
+  g_object_class_install_property (gobject_class, 
+                                   PROP_FLAGS,
+                                   g_param_spec_flags ("flags", 
+                                                       P_("Monitor flags"), 
+                                                       P_("Flags the monitor was created with"),
+                                                       G_TYPE_FILE_MONITOR_FLAGS,
+                                                       G_FILE_MONITOR_NONE, 
+                                                       G_PARAM_CONSTRUCT_ONLY|
+                                                       G_PARAM_WRITABLE|
+                                                       G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
+
   klass->mount_notify = FALSE;
 }
 
@@ -268,7 +287,10 @@ _g_local_directory_monitor_new (const char         *dirname,
 
   monitor = NULL;
   if (type != G_TYPE_INVALID)
-    monitor = G_FILE_MONITOR (g_object_new (type, "dirname", dirname, NULL));
+    monitor = G_FILE_MONITOR (g_object_new (type,
+                                            "dirname", dirname,
+                                            "flags", flags,
+                                            NULL));
   else
     g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
                          _("Unable to find default local directory monitor type"));
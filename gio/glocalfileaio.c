@@ -0,0 +1,373 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <unistd.h>
+#if defined (__NR_io_uring_setup) && defined (IORING_FEAT_RW_CUR_POS) && \
+    defined (IORING_SETUP_CQSIZE)
+#define USE_IO_URING
+#endif
+#endif
+
+#include <glib.h>
+#include "glocalfileaio.h"
+
+#include "gioalias.h"
+
+/* Asynchronous reads and writes on local file streams are submitted to
+ * an io_uring instance shared by the whole process. The completions are
+ * reaped by a source polling the ring in the default main context, so
+ * outstanding operations don't tie up GIOScheduler threads. When the
+ * kernel lacks io_uring, or the ring is full, _g_local_file_aio_submit()
+ * returns %FALSE and the caller runs the blocking call in a thread as
+ * before.
+ */
+
+#ifdef USE_IO_URING
+
+/* Operations are submitted one at a time, so the submission queue can
+ * be small; the completion queue bounds how many can be in flight.
+ */
+#define AIO_RING_SQ_ENTRIES 32
+#define AIO_RING_CQ_ENTRIES 4096
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+typedef struct {
+  GLocalFileAioCallback callback;
+  gpointer user_data;
+} AioOp;
+
+typedef struct {
+  int fd;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  guint cq_entries;
+  guint n_in_flight;
+} AioRing;
+
+typedef struct {
+  GSource source;
+  GPollFD pollfd;
+} AioRingSource;
+
+G_LOCK_DEFINE_STATIC (aio_ring);
+static AioRing *aio_ring = NULL;
+static gboolean aio_ring_initialized = FALSE;
+
+static gboolean
+aio_ring_has_completions (AioRing *ring)
+{
+  unsigned tail;
+
+  tail = *(volatile unsigned *) ring->cq_tail;
+  __sync_synchronize ();
+
+  return *ring->cq_head != tail;
+}
+
+static gboolean
+aio_ring_source_prepare (GSource *source,
+			 gint    *timeout)
+{
+  *timeout = -1;
+  return aio_ring_has_completions (aio_ring);
+}
+
+static gboolean
+aio_ring_source_check (GSource *source)
+{
+  return aio_ring_has_completions (aio_ring);
+}
+
+static gboolean
+aio_ring_source_dispatch (GSource     *source,
+			  GSourceFunc  callback,
+			  gpointer     user_data)
+{
+  AioRing *ring = aio_ring;
+  struct io_uring_cqe *cqe;
+  AioOp op;
+  unsigned head;
+  int res;
+
+  /* Only the context owner consumes completions, so cq_head needs no
+   * lock. It is advanced before each callback runs, which lets the
+   * callback submit the next operation right away.
+   */
+  while (aio_ring_has_completions (ring))
+    {
+      head = *ring->cq_head;
+      cqe = &ring->cqes[head & *ring->cq_mask];
+      op = *(AioOp *) (guintptr) cqe->user_data;
+      g_slice_free (AioOp, (AioOp *) (guintptr) cqe->user_data);
+      res = cqe->res;
+
+      __sync_synchronize ();
+      *(volatile unsigned *) ring->cq_head = head + 1;
+
+      G_LOCK (aio_ring);
+      ring->n_in_flight--;
+      G_UNLOCK (aio_ring);
+
+      if (res < 0)
+	op.callback (-1, -res, op.user_data);
+      else
+	op.callback (res, 0, op.user_data);
+    }
+
+  return TRUE;
+}
+
+static GSourceFuncs aio_ring_source_funcs = {
+  aio_ring_source_prepare,
+  aio_ring_source_check,
+  aio_ring_source_dispatch,
+  NULL
+};
+
+static AioRing *
+aio_ring_new (void)
+{
+  struct io_uring_params params;
+  AioRingSource *source;
+  AioRing *ring;
+  gsize sq_size, cq_size, sqes_size;
+  char *sq, *cq;
+  gpointer sqes;
+  int fd;
+
+  memset (&params, 0, sizeof (params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = AIO_RING_CQ_ENTRIES;
+  fd = syscall (__NR_io_uring_setup, AIO_RING_SQ_ENTRIES, &params);
+  if (fd < 0)
+    return NULL;
+
+  /* Reads and writes have to use and advance the file position, like
+   * the synchronous read_fn and write_fn do.
+   */
+  if (!(params.features & IORING_FEAT_RW_CUR_POS))
+    {
+      close (fd);
+      return NULL;
+    }
+
+  sq_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+  cq_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+  sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+
+  sq = mmap (NULL, sq_size, PROT_READ | PROT_WRITE,
+	     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  cq = mmap (NULL, cq_size, PROT_READ | PROT_WRITE,
+	     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  sqes = mmap (NULL, sqes_size, PROT_READ | PROT_WRITE,
+	       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+  if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED)
+    {
+      if (sq != MAP_FAILED)
+	munmap (sq, sq_size);
+      if (cq != MAP_FAILED)
+	munmap (cq, cq_size);
+      if (sqes != MAP_FAILED)
+	munmap (sqes, sqes_size);
+      close (fd);
+      return NULL;
+    }
+
+  ring = g_new0 (AioRing, 1);
+  ring->fd = fd;
+  ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+  ring->sqes = sqes;
+  ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+  ring->cq_entries = params.cq_entries;
+
+  /* The ring is never torn down; the source lives as long as the
+   * default main context does.
+   */
+  source = (AioRingSource *) g_source_new (&aio_ring_source_funcs,
+					   sizeof (AioRingSource));
+  source->pollfd.fd = fd;
+  source->pollfd.events = G_IO_IN;
+  g_source_add_poll ((GSource *) source, &source->pollfd);
+  g_source_attach ((GSource *) source, NULL);
+  g_source_unref ((GSource *) source);
+
+  return ring;
+}
+
+static gboolean
+aio_ring_submit (int                   fd,
+		 guint8                opcode,
+		 gconstpointer         addr,
+		 guint32               len,
+		 GLocalFileAioCallback callback,
+		 gpointer              user_data)
+{
+  struct io_uring_sqe *sqe;
+  AioRing *ring;
+  AioOp *op;
+  unsigned tail, index;
+  int res;
+
+  G_LOCK (aio_ring);
+
+  if (!aio_ring_initialized)
+    {
+      aio_ring = aio_ring_new ();
+      aio_ring_initialized = TRUE;
+    }
+
+  /* Never have more operations in flight than there are completion
+   * slots, so the completion queue can't overflow.
+   */
+  ring = aio_ring;
+  if (ring == NULL || ring->n_in_flight >= ring->cq_entries)
+    {
+      G_UNLOCK (aio_ring);
+      return FALSE;
+    }
+
+  op = g_slice_new (AioOp);
+  op->callback = callback;
+  op->user_data = user_data;
+
+  tail = *ring->sq_tail;
+  index = tail & *ring->sq_mask;
+  sqe = &ring->sqes[index];
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->off = (__u64) -1;
+  sqe->addr = (guintptr) addr;
+  sqe->len = len;
+  sqe->user_data = (guintptr) op;
+  ring->sq_array[index] = index;
+
+  __sync_synchronize ();
+  *(volatile unsigned *) ring->sq_tail = tail + 1;
+
+  do
+    res = syscall (__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+  while (res == -1 && errno == EINTR);
+
+  if (res != 1)
+    {
+      /* Entries are only consumed inside io_uring_enter(), so one that
+       * wasn't taken can simply be withdrawn.
+       */
+      *(volatile unsigned *) ring->sq_tail = tail;
+      G_UNLOCK (aio_ring);
+      g_slice_free (AioOp, op);
+      return FALSE;
+    }
+
+  ring->n_in_flight++;
+
+  G_UNLOCK (aio_ring);
+
+  return TRUE;
+}
+
+#endif /* USE_IO_URING */
+
+/*
+ * _g_local_file_aio_submit:
+ * @fd: a file descriptor of a local file
+ * @write: %TRUE to write @count bytes from @buffer, %FALSE to read
+ * @buffer: the buffer, which must stay valid until @callback runs
+ * @count: the number of bytes to transfer
+ * @callback: called from the default main context when done
+ * @user_data: data for @callback
+ *
+ * Starts a read or write at the current file position of @fd, without
+ * blocking and without using a thread. The caller is expected to make
+ * sure that only one operation per @fd is outstanding at a time.
+ *
+ * Returns: %TRUE if the operation was started and @callback will be
+ * called, %FALSE if the kernel can't do it, in which case the caller
+ * should fall back to a blocking call in a thread.
+ */
+gboolean
+_g_local_file_aio_submit (int                   fd,
+			  gboolean              write,
+			  gpointer              buffer,
+			  gsize                 count,
+			  GLocalFileAioCallback callback,
+			  gpointer              user_data)
+{
+#ifdef USE_IO_URING
+  return aio_ring_submit (fd, write ? IORING_OP_WRITE : IORING_OP_READ,
+			  buffer, MIN (count, G_MAXINT), callback, user_data);
+#else
+  return FALSE;
+#endif
+}
+
+/*
+ * _g_local_file_aio_submit_writev:
+ * @fd: a file descriptor of a local file
+ * @vectors: the buffers to write, laid out like struct iovec
+ * @n_vectors: the number of elements in @vectors
+ * @callback: called from the default main context when done
+ * @user_data: data for @callback
+ *
+ * Like _g_local_file_aio_submit(), but gathers the data to write from
+ * @vectors, which must stay valid until @callback runs.
+ */
+gboolean
+_g_local_file_aio_submit_writev (int                   fd,
+				 const GOutputVector  *vectors,
+				 gsize                 n_vectors,
+				 GLocalFileAioCallback callback,
+				 gpointer              user_data)
+{
+#ifdef USE_IO_URING
+  return aio_ring_submit (fd, IORING_OP_WRITEV, vectors,
+			  MIN (n_vectors, IOV_MAX), callback, user_data);
+#else
+  return FALSE;
+#endif
+}
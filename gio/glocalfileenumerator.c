@@ -35,12 +35,6 @@
 
 #define CHUNK_SIZE 1000
 
-  /* TODO:
-   *  It would be nice to use the dirent->d_type to check file type without
-   *  needing to stat each files on linux and other systems that support it.
-   *  (question: does that following symlink or not?)
-   */
-
 #ifdef G_OS_WIN32
 #define USE_GDIR
 #endif
@@ -54,6 +48,7 @@
 typedef struct {
   char *name;
   long inode;
+  GFileType type;
 } DirEntry;
 
 #endif
@@ -77,9 +72,15 @@ struct _GLocalFileEnumerator
   DirEntry *entries;
   int entries_pos;
   gboolean at_end;
+  int dir_fd;
 #endif
   
   gboolean follow_symlinks;
+
+  /* Only standard::name and standard::type were asked for, so the
+   * type from the directory entry is enough when it is known.
+   */
+  gboolean only_name_and_type;
 };
 
 #define g_local_file_enumerator_get_type _g_local_file_enumerator_get_type
@@ -130,6 +131,9 @@ g_local_file_enumerator_finalize (GObject *object)
 
   free_entries (local);
 
+  if (local->got_parent_info)
+    _g_local_parent_file_info_clear (&local->parent_info);
+
   G_OBJECT_CLASS (g_local_file_enumerator_parent_class)->finalize (object);
 }
 
@@ -190,6 +194,32 @@ convert_file_to_io_error (GError **error,
 }
 #endif
 
+static gboolean
+only_name_and_type (const char *attributes)
+{
+  char **split;
+  gboolean res;
+  int i;
+
+  if (attributes == NULL)
+    return FALSE;
+
+  res = TRUE;
+  split = g_strsplit (attributes, ",", -1);
+  for (i = 0; split[i] != NULL; i++)
+    {
+      if (strcmp (split[i], G_FILE_ATTRIBUTE_STANDARD_NAME) != 0 &&
+	  strcmp (split[i], G_FILE_ATTRIBUTE_STANDARD_TYPE) != 0)
+	{
+	  res = FALSE;
+	  break;
+	}
+    }
+  g_strfreev (split);
+
+  return res;
+}
+
 GFileEnumerator *
 _g_local_file_enumerator_new (GLocalFile *file,
 			      const char           *attributes,
@@ -242,6 +272,15 @@ _g_local_file_enumerator_new (GLocalFile *file,
   local->filename = filename;
   local->matcher = g_file_attribute_matcher_new (attributes);
   local->flags = flags;
+  local->only_name_and_type = only_name_and_type (attributes);
+
+#ifndef USE_GDIR
+#if defined (HAVE_FSTATAT) && defined (HAVE_DIRFD)
+  local->dir_fd = dirfd (dir);
+#else
+  local->dir_fd = -1;
+#endif
+#endif
   
   return G_FILE_ENUMERATOR (local);
 }
@@ -257,8 +296,34 @@ sort_by_inode (const void *_a, const void *_b)
   return a->inode - b->inode;
 }
 
+static GFileType
+file_type_from_dirent (struct dirent *entry)
+{
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+  switch (entry->d_type)
+    {
+    case DT_REG:
+      return G_FILE_TYPE_REGULAR;
+    case DT_DIR:
+      return G_FILE_TYPE_DIRECTORY;
+    case DT_LNK:
+      return G_FILE_TYPE_SYMBOLIC_LINK;
+    case DT_CHR:
+    case DT_BLK:
+    case DT_FIFO:
+    case DT_SOCK:
+      return G_FILE_TYPE_SPECIAL;
+    default:
+      break;
+    }
+#endif
+
+  return G_FILE_TYPE_UNKNOWN;
+}
+
 static const char *
-next_file_helper (GLocalFileEnumerator *local)
+next_file_helper (GLocalFileEnumerator *local,
+		  GFileType            *file_type)
 {
   struct dirent *entry;
   const char *filename;
@@ -291,17 +356,21 @@ next_file_helper (GLocalFileEnumerator *local)
 	    {
 	      local->entries[i].name = g_strdup (entry->d_name);
 	      local->entries[i].inode = entry->d_ino;
+	      local->entries[i].type = file_type_from_dirent (entry);
 	    }
 	  else
 	    break;
 	}
       local->entries[i].name = NULL;
+      local->entries[i].type = G_FILE_TYPE_UNKNOWN;
       local->entries_pos = 0;
       
       qsort (local->entries, i, sizeof (DirEntry), sort_by_inode);
     }
 
-  filename = local->entries[local->entries_pos++].name;
+  filename = local->entries[local->entries_pos].name;
+  *file_type = local->entries[local->entries_pos].type;
+  local->entries_pos++;
   if (filename == NULL)
     local->at_end = TRUE;
     
@@ -317,6 +386,7 @@ g_local_file_enumerator_next_file (GFileEnumerator  *enumerator,
 {
   GLocalFileEnumerator *local = G_LOCAL_FILE_ENUMERATOR (enumerator);
   const char *filename;
+  GFileType file_type;
   char *path;
   GFileInfo *info;
   GError *my_error;
@@ -324,6 +394,7 @@ g_local_file_enumerator_next_file (GFileEnumerator  *enumerator,
   if (!local->got_parent_info)
     {
       _g_local_file_info_get_parent_info (local->filename, local->matcher, &local->parent_info);
+      _g_local_file_index_thumbnails (local->matcher, &local->parent_info);
       local->got_parent_info = TRUE;
     }
   
@@ -331,20 +402,47 @@ g_local_file_enumerator_next_file (GFileEnumerator  *enumerator,
 
 #ifdef USE_GDIR
   filename = g_dir_read_name (local->dir);
+  file_type = G_FILE_TYPE_UNKNOWN;
 #else
-  filename = next_file_helper (local);
+  filename = next_file_helper (local, &file_type);
 #endif
 
   if (filename == NULL)
     return NULL;
 
+  /* The type in the directory entry is that of the entry itself, so
+   * it can only stand in for stat() when it's not a symlink that has
+   * to be followed.
+   */
+  if (local->only_name_and_type &&
+      file_type != G_FILE_TYPE_UNKNOWN &&
+      (file_type != G_FILE_TYPE_SYMBOLIC_LINK ||
+       (local->flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS)))
+    {
+      info = g_file_info_new ();
+      g_file_info_set_attribute_mask (info, local->matcher);
+      g_file_info_set_name (info, filename);
+      g_file_info_set_file_type (info, file_type);
+      g_file_info_unset_attribute_mask (info);
+      return info;
+    }
+
   my_error = NULL;
   path = g_build_filename (local->filename, filename, NULL);
+#ifdef USE_GDIR
   info = _g_local_file_info_get (filename, path,
 				 local->matcher,
 				 local->flags,
 				 &local->parent_info,
-				 &my_error); 
+				 &my_error);
+#else
+  info = _g_local_file_info_get_at (local->dir_fd,
+				    filename, path,
+				    local->matcher,
+				    local->flags,
+				    &local->parent_info,
+				    &my_error);
+#endif
   g_free (path);
 
   if (info == NULL)
@@ -60,6 +60,7 @@
 
 #include <glib/gstdio.h>
 #include <gfileattribute-priv.h>
+#include <gfileinfo-priv.h>
 
 #include "glibintl.h"
 
@@ -115,6 +116,36 @@ static GHashTable *gid_cache = NULL;
 
 #endif  /* !G_OS_WIN32 */
 
+/* The names in the thumbnail directories, read at most once per
+ * change of the directory, so that enumerating a large directory
+ * with thumbnail attributes doesn't stat() two files per child.
+ * Reading them costs more than a few stat()s, so an enumeration only
+ * does that after THUMBNAIL_INDEX_MIN_CHILDREN children.
+ */
+#define THUMBNAIL_INDEX_MIN_CHILDREN 100
+
+typedef struct {
+  char *path;
+  GHashTable *names;
+  time_t mtime;
+  long mtime_nsec;
+} ThumbnailDir;
+
+enum {
+  THUMBNAIL_DIR_NORMAL,
+  THUMBNAIL_DIR_FAIL,
+  N_THUMBNAIL_DIRS
+};
+
+struct _GLocalThumbnailIndex
+{
+  GHashTable *names[N_THUMBNAIL_DIRS];
+  guint n_children;
+};
+
+G_LOCK_DEFINE_STATIC (thumbnail_dirs);
+static ThumbnailDir thumbnail_dirs[N_THUMBNAIL_DIRS];
+
 char *
 _g_local_file_info_create_etag (GLocalFileStat *statbuf)
 {
@@ -195,7 +226,7 @@ get_selinux_context (const char            *path,
 {
   char *context;
 
-  if (!g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_SELINUX_CONTEXT))
+  if (!_g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_SELINUX_CONTEXT))
     return;
   
   if (is_selinux_enabled ())
@@ -213,7 +244,7 @@ get_selinux_context (const char            *path,
 
       if (context)
 	{
-	  g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_SELINUX_CONTEXT, context);
+	  _g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_SELINUX_CONTEXT, context);
 	  freecon (context);
 	}
     }
@@ -796,11 +827,12 @@ _g_local_file_info_get_parent_info (const char            *dir,
   parent_info->is_sticky = FALSE;
   parent_info->has_trash_dir = FALSE;
   parent_info->device = 0;
+  parent_info->thumbnail_index = NULL;
 
-  if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME) ||
-      g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE) ||
-      g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH) ||
-      g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_RENAME) ||
+      _g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_DELETE) ||
+      _g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_TRASH) ||
+      _g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_UNIX_IS_MOUNTPOINT))
     {
       /* FIXME: Windows: The underlying _waccess() call in the C
        * library is mostly pointless as it only looks at the READONLY
@@ -827,12 +859,165 @@ _g_local_file_info_get_parent_info (const char            *dir,
 	  parent_info->device = statbuf.st_dev;
           /* No need to find trash dir if it's not writable anyway */
           if (parent_info->writable &&
-              g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH))
+              _g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_TRASH))
             parent_info->has_trash_dir = _g_local_file_has_trash_dir (dir, statbuf.st_dev);
 	}
     }
 }
 
+static const char *
+get_thumbnail_dir (int dir)
+{
+  ThumbnailDir *thumbnail_dir;
+  const char *root;
+  char *default_root;
+
+  thumbnail_dir = &thumbnail_dirs[dir];
+
+  G_LOCK (thumbnail_dirs);
+  if (thumbnail_dir->path == NULL)
+    {
+      /* Private, so the tests can stay out of the home directory */
+      root = g_getenv ("GIO_THUMBNAIL_DIR");
+      default_root = NULL;
+      if (root == NULL || *root == 0)
+	root = default_root = g_build_filename (g_get_home_dir (),
+						".thumbnails", NULL);
+
+      if (dir == THUMBNAIL_DIR_NORMAL)
+	thumbnail_dir->path = g_build_filename (root, "normal", NULL);
+      else
+	thumbnail_dir->path = g_build_filename (root, "fail",
+						"gnome-thumbnail-factory",
+						NULL);
+      g_free (default_root);
+    }
+  G_UNLOCK (thumbnail_dirs);
+
+  return thumbnail_dir->path;
+}
+
+/* Returns NULL if the names are not known, and @read is %FALSE
+ * or the directory is being written to.
+ */
+static GHashTable *
+get_thumbnail_dir_names (int      dir,
+			 gboolean read)
+{
+  ThumbnailDir *thumbnail_dir;
+  GHashTable *names;
+  struct stat statbuf;
+  GTimeVal now;
+  const char *name;
+  char *key;
+  GDir *gdir;
+  long nsec;
+
+  get_thumbnail_dir (dir);
+  thumbnail_dir = &thumbnail_dirs[dir];
+
+  G_LOCK (thumbnail_dirs);
+
+  if (g_stat (thumbnail_dir->path, &statbuf) != 0)
+    {
+      if (thumbnail_dir->names)
+	g_hash_table_unref (thumbnail_dir->names);
+      thumbnail_dir->names = NULL;
+      G_UNLOCK (thumbnail_dirs);
+
+      /* No directory, no thumbnails */
+      return g_hash_table_new (g_str_hash, g_str_equal);
+    }
+
+#if defined (HAVE_STRUCT_STAT_ST_MTIMENSEC)
+  nsec = statbuf.st_mtimensec;
+#elif defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+  nsec = statbuf.st_mtim.tv_nsec;
+#else
+  nsec = 0;
+#endif
+
+  /* A thumbnail written in the same second as the directory is read
+   * may not change the mtime on filesystems with coarse timestamps.
+   * So while a thumbnailer is at work, the names are not trusted, and
+   * not read over and over either.
+   */
+  g_get_current_time (&now);
+  if (statbuf.st_mtime >= now.tv_sec - 1)
+    names = NULL;
+  else if (thumbnail_dir->names != NULL &&
+	   thumbnail_dir->mtime == statbuf.st_mtime &&
+	   thumbnail_dir->mtime_nsec == nsec)
+    names = g_hash_table_ref (thumbnail_dir->names);
+  else if (read)
+    {
+      if (thumbnail_dir->names)
+	g_hash_table_unref (thumbnail_dir->names);
+      thumbnail_dir->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, NULL);
+
+      gdir = g_dir_open (thumbnail_dir->path, 0, NULL);
+      if (gdir)
+	{
+	  while ((name = g_dir_read_name (gdir)) != NULL)
+	    {
+	      key = g_strdup (name);
+	      g_hash_table_insert (thumbnail_dir->names, key, key);
+	    }
+	  g_dir_close (gdir);
+	}
+
+      thumbnail_dir->mtime = statbuf.st_mtime;
+      thumbnail_dir->mtime_nsec = nsec;
+
+      names = g_hash_table_ref (thumbnail_dir->names);
+    }
+  else
+    names = NULL;
+
+  G_UNLOCK (thumbnail_dirs);
+
+  return names;
+}
+
+void
+_g_local_file_index_thumbnails (GFileAttributeMatcher *attribute_matcher,
+				GLocalParentFileInfo  *parent_info)
+{
+  GLocalThumbnailIndex *index;
+  int i;
+
+  if (!_g_file_attribute_matcher_matches_id (attribute_matcher,
+					     G_FILE_ATTRIBUTE_ID_THUMBNAIL_PATH))
+    return;
+
+  /* Names that were read before are used right away */
+  index = g_slice_new (GLocalThumbnailIndex);
+  for (i = 0; i < N_THUMBNAIL_DIRS; i++)
+    index->names[i] = get_thumbnail_dir_names (i, FALSE);
+  index->n_children = 0;
+
+  parent_info->thumbnail_index = index;
+}
+
+void
+_g_local_parent_file_info_clear (GLocalParentFileInfo *parent_info)
+{
+  GLocalThumbnailIndex *index;
+  int i;
+
+  index = parent_info->thumbnail_index;
+  if (index == NULL)
+    return;
+
+  for (i = 0; i < N_THUMBNAIL_DIRS; i++)
+    if (index->names[i])
+      g_hash_table_unref (index->names[i]);
+  g_slice_free (GLocalThumbnailIndex, index);
+
+  parent_info->thumbnail_index = NULL;
+}
+
 static void
 get_access_rights (GFileAttributeMatcher *attribute_matcher,
 		   GFileInfo             *info,
@@ -841,20 +1026,20 @@ get_access_rights (GFileAttributeMatcher *attribute_matcher,
 		   GLocalParentFileInfo  *parent_info)
 {
   /* FIXME: Windows: The underlyin _waccess() is mostly pointless */
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ACCESS_CAN_READ))
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ,
-				       g_access (path, R_OK) == 0);
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_ACCESS_CAN_READ))
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_READ,
+					      g_access (path, R_OK) == 0);
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE))
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE,
-				       g_access (path, W_OK) == 0);
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_ACCESS_CAN_WRITE))
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_WRITE,
+					      g_access (path, W_OK) == 0);
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE))
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE,
-				       g_access (path, X_OK) == 0);
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_ACCESS_CAN_EXECUTE))
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_EXECUTE,
+					      g_access (path, X_OK) == 0);
 
 
   if (parent_info)
@@ -879,17 +1064,17 @@ get_access_rights (GFileAttributeMatcher *attribute_matcher,
 	    writable = TRUE;
 	}
 
-      if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME))
-	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME,
-					   writable);
+      if (_g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_RENAME))
+	_g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_RENAME,
+						  writable);
       
-      if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE))
-	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE,
-					   writable);
+      if (_g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_DELETE))
+	_g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_DELETE,
+						  writable);
 
-      if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH))
-        g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
-                                           writable && parent_info->has_trash_dir);
+      if (_g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_TRASH))
+        _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_ACCESS_CAN_TRASH,
+						  writable && parent_info->has_trash_dir);
     }
 }
 
@@ -921,73 +1106,80 @@ set_info_from_stat (GFileInfo             *info,
     file_type = G_FILE_TYPE_SYMBOLIC_LINK;
 #endif
 
-  g_file_info_set_file_type (info, file_type);
-  g_file_info_set_size (info, statbuf->st_size);
-
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE, statbuf->st_dev);
-#ifndef G_OS_WIN32
-  /* Pointless setting these on Windows even if they exist in the struct */
-  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE, statbuf->st_ino);
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK, statbuf->st_nlink);
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_UID, statbuf->st_uid);
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_GID, statbuf->st_gid);
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_RDEV, statbuf->st_rdev);
-#endif
-  /* FIXME: st_mode is mostly pointless on Windows, too. Set the attribute or not? */
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE, statbuf->st_mode);
-#if defined (HAVE_STRUCT_STAT_ST_BLKSIZE)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_BLOCK_SIZE, statbuf->st_blksize);
-#endif
+  /* The attributes are set in the order of their ids, so that each
+   * one is simply appended to the info.
+   */
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_STANDARD_TYPE, file_type);
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_STANDARD_SIZE, statbuf->st_size);
 #if defined (HAVE_STRUCT_STAT_ST_BLOCKS)
-  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_BLOCKS, statbuf->st_blocks);
-  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE,
-                                    statbuf->st_blocks * G_GUINT64_CONSTANT (512));
-#endif
-  
-  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, statbuf->st_mtime);
-#if defined (HAVE_STRUCT_STAT_ST_MTIMENSEC)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, statbuf->st_mtimensec / 1000);
-#elif defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, statbuf->st_mtim.tv_nsec / 1000);
-#endif
-  
-  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_ACCESS, statbuf->st_atime);
-#if defined (HAVE_STRUCT_STAT_ST_ATIMENSEC)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_ACCESS_USEC, statbuf->st_atimensec / 1000);
-#elif defined (HAVE_STRUCT_STAT_ST_ATIM_TV_NSEC)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_ACCESS_USEC, statbuf->st_atim.tv_nsec / 1000);
-#endif
-  
-  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CHANGED, statbuf->st_ctime);
-#if defined (HAVE_STRUCT_STAT_ST_CTIMENSEC)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC, statbuf->st_ctimensec / 1000);
-#elif defined (HAVE_STRUCT_STAT_ST_CTIM_TV_NSEC)
-  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC, statbuf->st_ctim.tv_nsec / 1000);
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_STANDARD_ALLOCATED_SIZE,
+                                           statbuf->st_blocks * G_GUINT64_CONSTANT (512));
 #endif
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ETAG_VALUE))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_ETAG_VALUE))
     {
       char *etag = _g_local_file_info_create_etag (statbuf);
-      g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ETAG_VALUE, etag);
+      _g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_ETAG_VALUE, etag);
       g_free (etag);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ID_FILE))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_ID_FILE))
     {
       char *id = _g_local_file_info_create_file_id (statbuf);
-      g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE, id);
+      _g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_ID_FILE, id);
       g_free (id);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ID_FILESYSTEM))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_ID_FILESYSTEM))
     {
       char *id = _g_local_file_info_create_fs_id (statbuf);
-      g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM, id);
+      _g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_ID_FILESYSTEM, id);
       g_free (id);
     }
+
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED, statbuf->st_mtime);
+#if defined (HAVE_STRUCT_STAT_ST_MTIMENSEC)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED_USEC, statbuf->st_mtimensec / 1000);
+#elif defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_MODIFIED_USEC, statbuf->st_mtim.tv_nsec / 1000);
+#endif
+  
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_ACCESS, statbuf->st_atime);
+#if defined (HAVE_STRUCT_STAT_ST_ATIMENSEC)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_ACCESS_USEC, statbuf->st_atimensec / 1000);
+#elif defined (HAVE_STRUCT_STAT_ST_ATIM_TV_NSEC)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_ACCESS_USEC, statbuf->st_atim.tv_nsec / 1000);
+#endif
+  
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_CHANGED, statbuf->st_ctime);
+#if defined (HAVE_STRUCT_STAT_ST_CTIMENSEC)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_CHANGED_USEC, statbuf->st_ctimensec / 1000);
+#elif defined (HAVE_STRUCT_STAT_ST_CTIM_TV_NSEC)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_TIME_CHANGED_USEC, statbuf->st_ctim.tv_nsec / 1000);
+#endif
+
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_DEVICE, statbuf->st_dev);
+#ifndef G_OS_WIN32
+  /* Pointless setting these on Windows even if they exist in the struct */
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_INODE, statbuf->st_ino);
+#endif
+  /* FIXME: st_mode is mostly pointless on Windows, too. Set the attribute or not? */
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_MODE, statbuf->st_mode);
+#ifndef G_OS_WIN32
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_NLINK, statbuf->st_nlink);
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_UID, statbuf->st_uid);
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_GID, statbuf->st_gid);
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_RDEV, statbuf->st_rdev);
+#endif
+#if defined (HAVE_STRUCT_STAT_ST_BLKSIZE)
+  _g_file_info_set_attribute_uint32_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_BLOCK_SIZE, statbuf->st_blksize);
+#endif
+#if defined (HAVE_STRUCT_STAT_ST_BLOCKS)
+  _g_file_info_set_attribute_uint64_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_BLOCKS, statbuf->st_blocks);
+#endif
 }
 
 #ifndef G_OS_WIN32
@@ -1266,9 +1458,37 @@ get_content_type (const char          *basename,
   
 }
 
+static gboolean
+has_thumbnail (GLocalParentFileInfo *parent_info,
+	       int                   dir,
+	       const char           *basename,
+	       const char           *filename)
+{
+  GLocalThumbnailIndex *index;
+  int i;
+
+  index = parent_info ? parent_info->thumbnail_index : NULL;
+
+  if (index != NULL && dir == THUMBNAIL_DIR_NORMAL &&
+      index->n_children++ == THUMBNAIL_INDEX_MIN_CHILDREN)
+    {
+      for (i = 0; i < N_THUMBNAIL_DIRS; i++)
+	if (index->names[i] == NULL)
+	  index->names[i] = get_thumbnail_dir_names (i, TRUE);
+    }
+
+  if (index != NULL && index->names[dir] != NULL &&
+      g_hash_table_lookup (index->names[dir], basename) == NULL)
+    return FALSE;
+
+  /* The names don't tell what the files are, so hits are checked */
+  return g_file_test (filename, G_FILE_TEST_IS_REGULAR);
+}
+
 static void
-get_thumbnail_attributes (const char *path,
-                          GFileInfo  *info)
+get_thumbnail_attributes (const char           *path,
+                          GFileInfo            *info,
+                          GLocalParentFileInfo *parent_info)
 {
   GChecksum *checksum;
   char *uri;
@@ -1285,23 +1505,19 @@ get_thumbnail_attributes (const char *path,
   basename = g_strconcat (g_checksum_get_string (checksum), ".png", NULL);
   g_checksum_free (checksum);
 
-  filename = g_build_filename (g_get_home_dir (),
-                               ".thumbnails", "normal", basename,
-                               NULL);
+  filename = g_build_filename (get_thumbnail_dir (THUMBNAIL_DIR_NORMAL),
+                               basename, NULL);
 
-  if (g_file_test (filename, G_FILE_TEST_IS_REGULAR))
-    g_file_info_set_attribute_byte_string (info, G_FILE_ATTRIBUTE_THUMBNAIL_PATH, filename);
+  if (has_thumbnail (parent_info, THUMBNAIL_DIR_NORMAL, basename, filename))
+    _g_file_info_set_attribute_byte_string_by_id (info, G_FILE_ATTRIBUTE_ID_THUMBNAIL_PATH, filename);
   else
     {
       g_free (filename);
-      filename = g_build_filename (g_get_home_dir (),
-                                   ".thumbnails", "fail",
-                                   "gnome-thumbnail-factory",
-                                   basename,
-                                   NULL);
+      filename = g_build_filename (get_thumbnail_dir (THUMBNAIL_DIR_FAIL),
+                                   basename, NULL);
 
-      if (g_file_test (filename, G_FILE_TEST_IS_REGULAR))
-	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_THUMBNAILING_FAILED, TRUE);
+      if (has_thumbnail (parent_info, THUMBNAIL_DIR_FAIL, basename, filename))
+	_g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_THUMBNAILING_FAILED, TRUE);
     }
   g_free (basename);
   g_free (filename);
@@ -1406,6 +1622,23 @@ _g_local_file_info_get (const char             *basename,
 			GFileQueryInfoFlags     flags,
 			GLocalParentFileInfo   *parent_info,
 			GError                **error)
+{
+  return _g_local_file_info_get_at (-1, basename, path, attribute_matcher,
+				    flags, parent_info, error);
+}
+
+/* Like _g_local_file_info_get(), but if @dir_fd is not -1 it must be
+ * an open descriptor for the directory containing @basename, and the
+ * file is stat()ed relative to it instead of by @path.
+ */
+GFileInfo *
+_g_local_file_info_get_at (int                     dir_fd,
+			   const char             *basename,
+			   const char             *path,
+			   GFileAttributeMatcher  *attribute_matcher,
+			   GFileQueryInfoFlags     flags,
+			   GLocalParentFileInfo   *parent_info,
+			   GError                **error)
 {
   GFileInfo *info;
   GLocalFileStat statbuf;
@@ -1430,7 +1663,12 @@ _g_local_file_info_get (const char             *basename,
     return info;
 
 #ifndef G_OS_WIN32
-  res = g_lstat (path, &statbuf);
+#ifdef HAVE_FSTATAT
+  if (dir_fd != -1)
+    res = fstatat (dir_fd, basename, &statbuf, AT_SYMLINK_NOFOLLOW);
+  else
+#endif
+    res = g_lstat (path, &statbuf);
 #else
   {
     wchar_t *wpath = g_utf8_to_utf16 (path, -1, NULL, NULL, error);
@@ -1483,7 +1721,12 @@ _g_local_file_info_get (const char             *basename,
       /* Unless NOFOLLOW was set we default to following symlinks */
       if (!(flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS))
 	{
-	  res = stat (path, &statbuf2);
+#ifdef HAVE_FSTATAT
+	  if (dir_fd != -1)
+	    res = fstatat (dir_fd, basename, &statbuf2, 0);
+	  else
+#endif
+	    res = stat (path, &statbuf2);
 
 	    /* Report broken links as symlinks */
 	  if (res != -1)
@@ -1502,22 +1745,22 @@ _g_local_file_info_get (const char             *basename,
 
   if (basename != NULL && basename[strlen (basename) -1] == '~' &&
       S_ISREG (statbuf.st_mode))
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP, TRUE);
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_STANDARD_IS_BACKUP, TRUE);
 #else
   if (dos_attributes & FILE_ATTRIBUTE_HIDDEN)
     g_file_info_set_is_hidden (info, TRUE);
 
   if (dos_attributes & FILE_ATTRIBUTE_ARCHIVE)
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_DOS_IS_ARCHIVE, TRUE);
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_DOS_IS_ARCHIVE, TRUE);
 
   if (dos_attributes & FILE_ATTRIBUTE_SYSTEM)
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_DOS_IS_SYSTEM, TRUE);
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_DOS_IS_SYSTEM, TRUE);
 #endif
 
 #ifdef S_ISLNK
   if (is_symlink &&
-      g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET))
+      _g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_SYMLINK_TARGET))
     {
       char *link = read_link (path);
       g_file_info_set_symlink_target (info, link);
@@ -1525,8 +1768,8 @@ _g_local_file_info_get (const char             *basename,
     }
 #endif
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_DISPLAY_NAME))
     {
       char *display_name = g_filename_display_basename (path);
      
@@ -1541,8 +1784,8 @@ _g_local_file_info_get (const char             *basename,
       g_free (display_name);
     }
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_EDIT_NAME))
     {
       char *edit_name = g_filename_display_basename (path);
       g_file_info_set_edit_name (info, edit_name);
@@ -1550,19 +1793,19 @@ _g_local_file_info_get (const char             *basename,
     }
 
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_COPY_NAME))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_COPY_NAME))
     {
       char *copy_name = g_filename_to_utf8 (basename, -1, NULL, NULL, NULL);
       if (copy_name)
-	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME, copy_name);
+	_g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_STANDARD_COPY_NAME, copy_name);
       g_free (copy_name);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE) ||
-      g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_ICON))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_CONTENT_TYPE) ||
+      _g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_ICON))
     {
       char *content_type = get_content_type (basename, path, &statbuf, is_symlink, symlink_broken, flags, FALSE);
 
@@ -1570,8 +1813,8 @@ _g_local_file_info_get (const char             *basename,
 	{
 	  g_file_info_set_content_type (info, content_type);
 
-	  if (g_file_attribute_matcher_matches (attribute_matcher,
-						G_FILE_ATTRIBUTE_STANDARD_ICON))
+	  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+						    G_FILE_ATTRIBUTE_ID_STANDARD_ICON))
 	    {
 	      GIcon *icon;
 
@@ -1604,20 +1847,20 @@ _g_local_file_info_get (const char             *basename,
 	}
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_STANDARD_FAST_CONTENT_TYPE))
     {
       char *content_type = get_content_type (basename, path, &statbuf, is_symlink, symlink_broken, flags, TRUE);
       
       if (content_type)
 	{
-	  g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE, content_type);
+	  _g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_STANDARD_FAST_CONTENT_TYPE, content_type);
 	  g_free (content_type);
 	}
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_OWNER_USER))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_OWNER_USER))
     {
       char *name = NULL;
       
@@ -1627,12 +1870,12 @@ _g_local_file_info_get (const char             *basename,
       name = get_username_from_uid (statbuf.st_uid);
 #endif
       if (name)
-	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_OWNER_USER, name);
+	_g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_OWNER_USER, name);
       g_free (name);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_OWNER_USER_REAL))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_OWNER_USER_REAL))
     {
       char *name = NULL;
 #ifdef G_OS_WIN32
@@ -1641,12 +1884,12 @@ _g_local_file_info_get (const char             *basename,
       name = get_realname_from_uid (statbuf.st_uid);
 #endif
       if (name)
-	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_OWNER_USER_REAL, name);
+	_g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_OWNER_USER_REAL, name);
       g_free (name);
     }
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_OWNER_GROUP))
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_OWNER_GROUP))
     {
       char *name = NULL;
 #ifdef G_OS_WIN32
@@ -1655,14 +1898,14 @@ _g_local_file_info_get (const char             *basename,
       name = get_groupname_from_gid (statbuf.st_gid);
 #endif
       if (name)
-	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_OWNER_GROUP, name);
+	_g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_OWNER_GROUP, name);
       g_free (name);
     }
 
   if (parent_info && parent_info->device != 0 &&
-      g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT) &&
+      _g_file_attribute_matcher_matches_id (attribute_matcher, G_FILE_ATTRIBUTE_ID_UNIX_IS_MOUNTPOINT) &&
       statbuf.st_dev != parent_info->device) 
-    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT, TRUE);
+    _g_file_info_set_attribute_boolean_by_id (info, G_FILE_ATTRIBUTE_ID_UNIX_IS_MOUNTPOINT, TRUE);
   
   get_access_rights (attribute_matcher, info, path, &statbuf, parent_info);
   
@@ -1672,9 +1915,9 @@ _g_local_file_info_get (const char             *basename,
   get_xattrs (path, TRUE, info, attribute_matcher, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
   get_xattrs (path, FALSE, info, attribute_matcher, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_THUMBNAIL_PATH))
-    get_thumbnail_attributes (path, info);
+  if (_g_file_attribute_matcher_matches_id (attribute_matcher,
+					    G_FILE_ATTRIBUTE_ID_THUMBNAIL_PATH))
+    get_thumbnail_attributes (path, info, parent_info);
   
   g_file_info_unset_attribute_mask (info);
 
@@ -1717,13 +1960,13 @@ _g_local_file_info_get_from_fd (int         fd,
   set_info_from_stat (info, &stat_buf, matcher);
   
 #ifdef HAVE_SELINUX
-  if (g_file_attribute_matcher_matches (matcher, G_FILE_ATTRIBUTE_SELINUX_CONTEXT) &&
+  if (_g_file_attribute_matcher_matches_id (matcher, G_FILE_ATTRIBUTE_ID_SELINUX_CONTEXT) &&
       is_selinux_enabled ())
     {
       char *context;
       if (fgetfilecon_raw (fd, &context) >= 0)
 	{
-	  g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_SELINUX_CONTEXT, context);
+	  _g_file_info_set_attribute_string_by_id (info, G_FILE_ATTRIBUTE_ID_SELINUX_CONTEXT, context);
 	  freecon (context);
 	}
     }
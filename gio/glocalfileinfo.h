@@ -32,6 +32,8 @@
 
 G_BEGIN_DECLS
 
+typedef struct _GLocalThumbnailIndex GLocalThumbnailIndex;
+
 typedef struct
 {
   gboolean writable;
@@ -39,6 +41,7 @@ typedef struct
   gboolean has_trash_dir;
   int      owner;
   dev_t    device;
+  GLocalThumbnailIndex *thumbnail_index;
 } GLocalParentFileInfo;
 
 #ifdef G_OS_WIN32
@@ -53,12 +56,22 @@ gboolean   _g_local_file_has_trash_dir        (const char             *dirname,
 void       _g_local_file_info_get_parent_info (const char             *dir,
                                                GFileAttributeMatcher  *attribute_matcher,
                                                GLocalParentFileInfo   *parent_info);
+void       _g_local_file_index_thumbnails     (GFileAttributeMatcher  *attribute_matcher,
+                                               GLocalParentFileInfo   *parent_info);
+void       _g_local_parent_file_info_clear    (GLocalParentFileInfo   *parent_info);
 GFileInfo *_g_local_file_info_get             (const char             *basename,
                                                const char             *path,
                                                GFileAttributeMatcher  *attribute_matcher,
                                                GFileQueryInfoFlags     flags,
                                                GLocalParentFileInfo   *parent_info,
                                                GError                **error);
+GFileInfo *_g_local_file_info_get_at          (int                     dir_fd,
+                                               const char             *basename,
+                                               const char             *path,
+                                               GFileAttributeMatcher  *attribute_matcher,
+                                               GFileQueryInfoFlags     flags,
+                                               GLocalParentFileInfo   *parent_info,
+                                               GError                **error);
 GFileInfo *_g_local_file_info_get_from_fd     (int                     fd,
                                                const char             *attributes,
                                                GError                **error);
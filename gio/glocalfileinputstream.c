@@ -29,13 +29,18 @@
 #include <unistd.h>
 #endif
 #include <errno.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "gcancellable.h"
+#include "gsimpleasyncresult.h"
 #include "gioerror.h"
 #include "glocalfileinputstream.h"
 #include "glocalfileinfo.h"
+#include "glocalfileaio.h"
 #include "glibintl.h"
 
 #ifdef G_OS_WIN32
@@ -49,6 +54,11 @@ G_DEFINE_TYPE (GLocalFileInputStream, g_local_file_input_stream, G_TYPE_FILE_INP
 
 struct _GLocalFileInputStreamPrivate {
   int fd;
+
+  /* mapping of the file for peek_buffer, made on first use */
+  gpointer map;
+  gsize map_size;
+  guint map_failed : 1;
 };
 
 static gssize     g_local_file_input_stream_read       (GInputStream      *stream,
@@ -56,6 +66,16 @@ static gssize     g_local_file_input_stream_read       (GInputStream      *strea
 							gsize              count,
 							GCancellable      *cancellable,
 							GError           **error);
+static void       g_local_file_input_stream_read_async (GInputStream      *stream,
+							void              *buffer,
+							gsize              count,
+							int                io_priority,
+							GCancellable      *cancellable,
+							GAsyncReadyCallback callback,
+							gpointer           user_data);
+static gssize     g_local_file_input_stream_read_finish (GInputStream     *stream,
+							GAsyncResult      *result,
+							GError           **error);
 static gssize     g_local_file_input_stream_skip       (GInputStream      *stream,
 							gsize              count,
 							GCancellable      *cancellable,
@@ -74,6 +94,8 @@ static GFileInfo *g_local_file_input_stream_query_info (GFileInputStream  *strea
 							const char        *attributes,
 							GCancellable      *cancellable,
 							GError           **error);
+static gconstpointer g_local_file_input_stream_peek_buffer (GFileInputStream *stream,
+							gsize             *count);
 
 static void
 g_local_file_input_stream_finalize (GObject *object)
@@ -97,12 +119,15 @@ g_local_file_input_stream_class_init (GLocalFileInputStreamClass *klass)
   gobject_class->finalize = g_local_file_input_stream_finalize;
 
   stream_class->read_fn = g_local_file_input_stream_read;
+  stream_class->read_async = g_local_file_input_stream_read_async;
+  stream_class->read_finish = g_local_file_input_stream_read_finish;
   stream_class->skip = g_local_file_input_stream_skip;
   stream_class->close_fn = g_local_file_input_stream_close;
   file_stream_class->tell = g_local_file_input_stream_tell;
   file_stream_class->can_seek = g_local_file_input_stream_can_seek;
   file_stream_class->seek = g_local_file_input_stream_seek;
   file_stream_class->query_info = g_local_file_input_stream_query_info;
+  file_stream_class->peek_buffer = g_local_file_input_stream_peek_buffer;
 }
 
 static void
@@ -130,6 +155,12 @@ _g_local_file_input_stream_new (int fd)
   return G_FILE_INPUT_STREAM (stream);
 }
 
+int
+_g_local_file_input_stream_get_fd (GLocalFileInputStream *stream)
+{
+  return stream->priv->fd;
+}
+
 static gssize
 g_local_file_input_stream_read (GInputStream  *stream,
 				void          *buffer,
@@ -167,6 +198,72 @@ g_local_file_input_stream_read (GInputStream  *stream,
   return res;
 }
 
+static void
+read_async_done (gssize   res,
+		 int      errsv,
+		 gpointer user_data)
+{
+  GSimpleAsyncResult *simple = user_data;
+
+  if (res == -1)
+    g_simple_async_result_set_error (simple, G_IO_ERROR,
+				     g_io_error_from_errno (errsv),
+				     _("Error reading from file: %s"),
+				     g_strerror (errsv));
+  else
+    g_simple_async_result_set_op_res_gssize (simple, res);
+
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+}
+
+static void
+g_local_file_input_stream_read_async (GInputStream        *stream,
+				      void                *buffer,
+				      gsize                count,
+				      int                  io_priority,
+				      GCancellable        *cancellable,
+				      GAsyncReadyCallback  callback,
+				      gpointer             user_data)
+{
+  GLocalFileInputStream *file;
+  GSimpleAsyncResult *simple;
+
+  file = G_LOCAL_FILE_INPUT_STREAM (stream);
+
+  /* Let the kernel do the read if it can, instead of a thread */
+  if (!g_cancellable_is_cancelled (cancellable))
+    {
+      simple = g_simple_async_result_new (G_OBJECT (stream),
+					  callback, user_data,
+					  g_local_file_input_stream_read_async);
+      if (_g_local_file_aio_submit (file->priv->fd, FALSE, buffer, count,
+				    read_async_done, simple))
+	return;
+
+      g_object_unref (simple);
+    }
+
+  G_INPUT_STREAM_CLASS (g_local_file_input_stream_parent_class)->
+    read_async (stream, buffer, count, io_priority,
+		cancellable, callback, user_data);
+}
+
+static gssize
+g_local_file_input_stream_read_finish (GInputStream  *stream,
+				       GAsyncResult  *result,
+				       GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  if (g_simple_async_result_get_source_tag (simple) !=
+      g_local_file_input_stream_read_async)
+    return G_INPUT_STREAM_CLASS (g_local_file_input_stream_parent_class)->
+      read_finish (stream, result, error);
+
+  return g_simple_async_result_get_op_res_gssize (simple);
+}
+
 static gssize
 g_local_file_input_stream_skip (GInputStream  *stream,
 				gsize          count,
@@ -221,6 +318,15 @@ g_local_file_input_stream_close (GInputStream  *stream,
   if (file->priv->fd == -1)
     return TRUE;
 
+#ifdef HAVE_MMAP
+  if (file->priv->map != NULL)
+    {
+      munmap (file->priv->map, file->priv->map_size);
+      file->priv->map = NULL;
+      file->priv->map_size = 0;
+    }
+#endif
+
   while (1)
     {
       res = close (file->priv->fd);
@@ -334,3 +440,74 @@ g_local_file_input_stream_query_info (GFileInputStream  *stream,
 					 attributes,
 					 error);
 }
+
+#ifdef HAVE_MMAP
+
+/* Maps the whole file, or maps it again if it grew since the last
+ * time. Streams that aren't regular files are never mapped.
+ */
+static void
+local_file_input_stream_map (GLocalFileInputStream *file)
+{
+  struct stat buf;
+  gpointer map;
+
+  if (fstat (file->priv->fd, &buf) == -1 || !S_ISREG (buf.st_mode) ||
+      buf.st_size > G_MAXSIZE)
+    {
+      file->priv->map_failed = TRUE;
+      return;
+    }
+
+  if (buf.st_size <= file->priv->map_size)
+    return;
+
+  map = mmap (NULL, buf.st_size, PROT_READ, MAP_PRIVATE, file->priv->fd, 0);
+  if (map == MAP_FAILED)
+    {
+      file->priv->map_failed = TRUE;
+      return;
+    }
+
+  if (file->priv->map != NULL)
+    munmap (file->priv->map, file->priv->map_size);
+
+  file->priv->map = map;
+  file->priv->map_size = buf.st_size;
+}
+
+#endif
+
+static gconstpointer
+g_local_file_input_stream_peek_buffer (GFileInputStream *stream,
+				       gsize            *count)
+{
+#ifdef HAVE_MMAP
+  GLocalFileInputStream *file;
+  off_t pos;
+
+  file = G_LOCAL_FILE_INPUT_STREAM (stream);
+
+  if (file->priv->map_failed)
+    return NULL;
+
+  /* The fd offset stays the stream position, so that read_fn and
+   * everything else that works on the fd directly agree with it.
+   */
+  pos = lseek (file->priv->fd, 0, SEEK_CUR);
+  if (pos == -1)
+    return NULL;
+
+  if (pos >= file->priv->map_size)
+    {
+      local_file_input_stream_map (file);
+      if (pos >= file->priv->map_size)
+	return NULL;
+    }
+
+  *count = file->priv->map_size - pos;
+  return (const char *) file->priv->map + pos;
+#else
+  return NULL;
+#endif
+}
@@ -53,7 +53,8 @@ struct _GLocalFileInputStreamClass
 
 GType              _g_local_file_input_stream_get_type (void) G_GNUC_CONST;
 
-GFileInputStream * _g_local_file_input_stream_new      (int fd);
+GFileInputStream * _g_local_file_input_stream_new      (int                    fd);
+int                _g_local_file_input_stream_get_fd   (GLocalFileInputStream *stream);
 
 G_END_DECLS
 
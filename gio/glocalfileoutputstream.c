@@ -36,8 +36,19 @@
 #include "glibintl.h"
 #include "gioerror.h"
 #include "gcancellable.h"
+#include "gsimpleasyncresult.h"
 #include "glocalfileoutputstream.h"
 #include "glocalfileinfo.h"
+#include "glocalfileaio.h"
+
+#ifdef G_OS_UNIX
+#include <sys/uio.h>
+#include <limits.h>
+#include <stddef.h>
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+#endif
 
 #ifdef G_OS_WIN32
 #include <io.h>
@@ -55,6 +66,15 @@
 
 #include "gioalias.h"
 
+#ifdef G_OS_UNIX
+/* GOutputVector is laid out like struct iovec, so arrays of them can
+ * be passed to writev() as they are.
+ */
+G_STATIC_ASSERT (sizeof (GOutputVector) == sizeof (struct iovec));
+G_STATIC_ASSERT (offsetof (GOutputVector, buffer) == offsetof (struct iovec, iov_base));
+G_STATIC_ASSERT (offsetof (GOutputVector, size) == offsetof (struct iovec, iov_len));
+#endif
+
 #define g_local_file_output_stream_get_type _g_local_file_output_stream_get_type
 G_DEFINE_TYPE (GLocalFileOutputStream, g_local_file_output_stream, G_TYPE_FILE_OUTPUT_STREAM);
 
@@ -78,6 +98,33 @@ static gssize     g_local_file_output_stream_write        (GOutputStream      *s
 							   gsize               count,
 							   GCancellable       *cancellable,
 							   GError            **error);
+static void       g_local_file_output_stream_write_async  (GOutputStream      *stream,
+							   const void         *buffer,
+							   gsize               count,
+							   int                 io_priority,
+							   GCancellable       *cancellable,
+							   GAsyncReadyCallback callback,
+							   gpointer            user_data);
+static gssize     g_local_file_output_stream_write_finish (GOutputStream      *stream,
+							   GAsyncResult       *result,
+							   GError            **error);
+#ifdef G_OS_UNIX
+static gssize     g_local_file_output_stream_writev       (GOutputStream      *stream,
+							   const GOutputVector *vectors,
+							   gsize               n_vectors,
+							   GCancellable       *cancellable,
+							   GError            **error);
+static void       g_local_file_output_stream_writev_async (GOutputStream      *stream,
+							   const GOutputVector *vectors,
+							   gsize               n_vectors,
+							   int                 io_priority,
+							   GCancellable       *cancellable,
+							   GAsyncReadyCallback callback,
+							   gpointer            user_data);
+static gssize     g_local_file_output_stream_writev_finish (GOutputStream     *stream,
+							   GAsyncResult       *result,
+							   GError            **error);
+#endif
 static gboolean   g_local_file_output_stream_close        (GOutputStream      *stream,
 							   GCancellable       *cancellable,
 							   GError            **error);
@@ -126,6 +173,13 @@ g_local_file_output_stream_class_init (GLocalFileOutputStreamClass *klass)
   gobject_class->finalize = g_local_file_output_stream_finalize;
 
   stream_class->write_fn = g_local_file_output_stream_write;
+  stream_class->write_async = g_local_file_output_stream_write_async;
+  stream_class->write_finish = g_local_file_output_stream_write_finish;
+#ifdef G_OS_UNIX
+  stream_class->writev_fn = g_local_file_output_stream_writev;
+  stream_class->writev_async = g_local_file_output_stream_writev_async;
+  stream_class->writev_finish = g_local_file_output_stream_writev_finish;
+#endif
   stream_class->close_fn = g_local_file_output_stream_close;
   file_stream_class->query_info = g_local_file_output_stream_query_info;
   file_stream_class->get_etag = g_local_file_output_stream_get_etag;
@@ -180,6 +234,159 @@ g_local_file_output_stream_write (GOutputStream  *stream,
   return res;
 }
 
+static void
+write_async_done (gssize   res,
+		  int      errsv,
+		  gpointer user_data)
+{
+  GSimpleAsyncResult *simple = user_data;
+
+  if (res == -1)
+    g_simple_async_result_set_error (simple, G_IO_ERROR,
+				     g_io_error_from_errno (errsv),
+				     _("Error writing to file: %s"),
+				     g_strerror (errsv));
+  else
+    g_simple_async_result_set_op_res_gssize (simple, res);
+
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+}
+
+static void
+g_local_file_output_stream_write_async (GOutputStream       *stream,
+					const void          *buffer,
+					gsize                count,
+					int                  io_priority,
+					GCancellable        *cancellable,
+					GAsyncReadyCallback  callback,
+					gpointer             user_data)
+{
+  GLocalFileOutputStream *file;
+  GSimpleAsyncResult *simple;
+
+  file = G_LOCAL_FILE_OUTPUT_STREAM (stream);
+
+  /* Let the kernel do the write if it can, instead of a thread */
+  if (!g_cancellable_is_cancelled (cancellable))
+    {
+      simple = g_simple_async_result_new (G_OBJECT (stream),
+					  callback, user_data,
+					  g_local_file_output_stream_write_async);
+      if (_g_local_file_aio_submit (file->priv->fd, TRUE, (void *) buffer, count,
+				    write_async_done, simple))
+	return;
+
+      g_object_unref (simple);
+    }
+
+  G_OUTPUT_STREAM_CLASS (g_local_file_output_stream_parent_class)->
+    write_async (stream, buffer, count, io_priority,
+		 cancellable, callback, user_data);
+}
+
+static gssize
+g_local_file_output_stream_write_finish (GOutputStream  *stream,
+					 GAsyncResult   *result,
+					 GError        **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  if (g_simple_async_result_get_source_tag (simple) !=
+      g_local_file_output_stream_write_async)
+    return G_OUTPUT_STREAM_CLASS (g_local_file_output_stream_parent_class)->
+      write_finish (stream, result, error);
+
+  return g_simple_async_result_get_op_res_gssize (simple);
+}
+
+#ifdef G_OS_UNIX
+
+static gssize
+g_local_file_output_stream_writev (GOutputStream        *stream,
+				   const GOutputVector  *vectors,
+				   gsize                 n_vectors,
+				   GCancellable         *cancellable,
+				   GError              **error)
+{
+  GLocalFileOutputStream *file;
+  gssize res;
+
+  file = G_LOCAL_FILE_OUTPUT_STREAM (stream);
+
+  while (1)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+	return -1;
+      res = writev (file->priv->fd, (const struct iovec *) vectors,
+		    MIN (n_vectors, IOV_MAX));
+      if (res == -1)
+	{
+          int errsv = errno;
+
+	  if (errsv == EINTR)
+	    continue;
+	  
+	  g_set_error (error, G_IO_ERROR,
+		       g_io_error_from_errno (errsv),
+		       _("Error writing to file: %s"),
+		       g_strerror (errsv));
+	}
+      
+      break;
+    }
+  
+  return res;
+}
+
+static void
+g_local_file_output_stream_writev_async (GOutputStream       *stream,
+					 const GOutputVector *vectors,
+					 gsize                n_vectors,
+					 int                  io_priority,
+					 GCancellable        *cancellable,
+					 GAsyncReadyCallback  callback,
+					 gpointer             user_data)
+{
+  GLocalFileOutputStream *file;
+  GSimpleAsyncResult *simple;
+
+  file = G_LOCAL_FILE_OUTPUT_STREAM (stream);
+
+  if (!g_cancellable_is_cancelled (cancellable))
+    {
+      simple = g_simple_async_result_new (G_OBJECT (stream),
+					  callback, user_data,
+					  g_local_file_output_stream_writev_async);
+      if (_g_local_file_aio_submit_writev (file->priv->fd, vectors, n_vectors,
+					   write_async_done, simple))
+	return;
+
+      g_object_unref (simple);
+    }
+
+  G_OUTPUT_STREAM_CLASS (g_local_file_output_stream_parent_class)->
+    writev_async (stream, vectors, n_vectors, io_priority,
+		  cancellable, callback, user_data);
+}
+
+static gssize
+g_local_file_output_stream_writev_finish (GOutputStream  *stream,
+					  GAsyncResult   *result,
+					  GError        **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  if (g_simple_async_result_get_source_tag (simple) !=
+      g_local_file_output_stream_writev_async)
+    return G_OUTPUT_STREAM_CLASS (g_local_file_output_stream_parent_class)->
+      writev_finish (stream, result, error);
+
+  return g_simple_async_result_get_op_res_gssize (simple);
+}
+
+#endif /* G_OS_UNIX */
+
 static gboolean
 g_local_file_output_stream_close (GOutputStream  *stream,
 				  GCancellable   *cancellable,
@@ -1055,3 +1262,9 @@ _g_local_file_output_stream_replace (const char        *filename,
   
   return G_FILE_OUTPUT_STREAM (stream);
 }
+
+int
+_g_local_file_output_stream_get_fd (GLocalFileOutputStream *stream)
+{
+  return stream->priv->fd;
+}
@@ -66,6 +66,7 @@ GFileOutputStream * _g_local_file_output_stream_replace  (const char       *file
                                                           GFileCreateFlags  flags,
                                                           GCancellable     *cancellable,
                                                           GError          **error);
+int                 _g_local_file_output_stream_get_fd   (GLocalFileOutputStream *stream);
 
 G_END_DECLS
 
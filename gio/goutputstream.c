@@ -21,6 +21,7 @@
  */
 
 #include "config.h"
+#define _GNU_SOURCE /* for splice() */
 #include "goutputstream.h"
 #include "gcancellable.h"
 #include "gasyncresult.h"
@@ -29,6 +30,21 @@
 #include "gioerror.h"
 #include "glibintl.h"
 
+#if defined (G_OS_UNIX) && (defined (HAVE_SPLICE) || defined (HAVE_SENDFILE))
+#define USE_KERNEL_SPLICE 1
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#include "gunixinputstream.h"
+#include "gunixoutputstream.h"
+#include "glocalfileinputstream.h"
+#include "glocalfileoutputstream.h"
+#endif
+
 #include "gioalias.h"
 
 /**
@@ -40,6 +56,10 @@
  * to close a stream (g_output_stream_close()) and to flush pending writes
  * (g_output_stream_flush()). 
  *
+ * To write data that is spread over several buffers, such as a header
+ * and a payload, without copying it together first, use
+ * g_output_stream_writev().
+ *
  * To copy the content of an input stream to an output stream without 
  * manually handling the reads and writes, use g_output_stream_splice(). 
  *
@@ -70,6 +90,21 @@ static void     g_output_stream_real_write_async   (GOutputStream             *s
 static gssize   g_output_stream_real_write_finish  (GOutputStream             *stream,
 						    GAsyncResult              *result,
 						    GError                   **error);
+static gssize   g_output_stream_real_writev        (GOutputStream             *stream,
+						    const GOutputVector       *vectors,
+						    gsize                      n_vectors,
+						    GCancellable              *cancellable,
+						    GError                   **error);
+static void     g_output_stream_real_writev_async  (GOutputStream             *stream,
+						    const GOutputVector       *vectors,
+						    gsize                      n_vectors,
+						    int                        io_priority,
+						    GCancellable              *cancellable,
+						    GAsyncReadyCallback        callback,
+						    gpointer                   data);
+static gssize   g_output_stream_real_writev_finish (GOutputStream             *stream,
+						    GAsyncResult              *result,
+						    GError                   **error);
 static void     g_output_stream_real_splice_async  (GOutputStream             *stream,
 						    GInputStream              *source,
 						    GOutputStreamSpliceFlags   flags,
@@ -140,6 +175,9 @@ g_output_stream_class_init (GOutputStreamClass *klass)
   klass->flush_finish = g_output_stream_real_flush_finish;
   klass->close_async = g_output_stream_real_close_async;
   klass->close_finish = g_output_stream_real_close_finish;
+  klass->writev_fn = g_output_stream_real_writev;
+  klass->writev_async = g_output_stream_real_writev_async;
+  klass->writev_finish = g_output_stream_real_writev_finish;
 }
 
 static void
@@ -228,6 +266,113 @@ g_output_stream_write (GOutputStream  *stream,
   return res; 
 }
 
+/* Sums up the sizes of @vectors, failing if the total can't be
+ * returned as a gssize.
+ */
+static gboolean
+get_vectors_size (const GOutputVector *vectors,
+		  gsize                n_vectors,
+		  gsize               *size)
+{
+  gsize i;
+
+  *size = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      if (vectors[i].size > G_MAXSSIZE - *size)
+	return FALSE;
+      *size += vectors[i].size;
+    }
+
+  return TRUE;
+}
+
+/**
+ * g_output_stream_writev:
+ * @stream: a #GOutputStream.
+ * @vectors: the buffers containing the data to write.
+ * @n_vectors: the number of elements in @vectors
+ * @cancellable: optional cancellable object
+ * @error: location to store the error occuring, or %NULL to ignore
+ *
+ * Tries to write the contents of the @n_vectors buffers in @vectors
+ * into the stream, in order, as if they were one contiguous buffer.
+ * Will block during the operation.
+ *
+ * Streams backed by a file descriptor hand all buffers to the kernel
+ * in a single writev() call, so e.g. a protocol header and its payload
+ * can be written without first copying them into one buffer. Other
+ * streams write the buffers one after the other.
+ *
+ * If the buffers are all empty returns zero and does nothing. A total
+ * size larger than %G_MAXSSIZE will cause a %G_IO_ERROR_INVALID_ARGUMENT
+ * error.
+ *
+ * On success, the number of bytes written to the stream is returned.
+ * As with g_output_stream_write(), it is not an error if this is less
+ * than the total size of the buffers.
+ *
+ * If @cancellable is not NULL, then the operation can be cancelled by
+ * triggering the cancellable object from another thread. If the operation
+ * was cancelled, the error G_IO_ERROR_CANCELLED will be returned. If an
+ * operation was partially finished when the operation was cancelled the
+ * partial result will be returned, without an error.
+ *
+ * On error -1 is returned and @error is set accordingly.
+ *
+ * Return value: Number of bytes written, or -1 on error
+ *
+ * Since: 2.22
+ **/
+gssize
+g_output_stream_writev (GOutputStream        *stream,
+			const GOutputVector  *vectors,
+			gsize                 n_vectors,
+			GCancellable         *cancellable,
+			GError              **error)
+{
+  GOutputStreamClass *class;
+  gsize size;
+  gssize res;
+
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), -1);
+  g_return_val_if_fail (vectors != NULL || n_vectors == 0, -1);
+
+  if (!get_vectors_size (vectors, n_vectors, &size))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		   _("Too large count value passed to %s"), G_STRFUNC);
+      return -1;
+    }
+
+  if (size == 0)
+    return 0;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  if (class->write_fn == NULL) 
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           _("Output stream doesn't implement write"));
+      return -1;
+    }
+  
+  if (!g_output_stream_set_pending (stream, error))
+    return -1;
+  
+  if (cancellable)
+    g_cancellable_push_current (cancellable);
+  
+  res = class->writev_fn (stream, vectors, n_vectors, cancellable, error);
+  
+  if (cancellable)
+    g_cancellable_pop_current (cancellable);
+  
+  g_output_stream_clear_pending (stream);
+
+  return res; 
+}
+
 /**
  * g_output_stream_write_all:
  * @stream: a #GOutputStream.
@@ -392,6 +537,303 @@ g_output_stream_splice (GOutputStream             *stream,
   return res;
 }
 
+#ifdef USE_KERNEL_SPLICE
+
+/* how much to hand to the kernel per call, so that cancellation is
+ * still noticed in reasonable time
+ */
+#define SPLICE_CHUNK_SIZE (1024 * 1024)
+/* the default pipe capacity on Linux */
+#define SPLICE_PIPE_SIZE  (64 * 1024)
+
+/* Only streams which read and write their fd directly, without any
+ * buffering or conversion of their own, can be bypassed. Subclasses
+ * could override read or write, so check for the exact types.
+ */
+static int
+splice_get_input_fd (GInputStream *stream)
+{
+  GType type = G_TYPE_FROM_INSTANCE (stream);
+
+  if (type == G_TYPE_UNIX_INPUT_STREAM)
+    return g_unix_input_stream_get_fd (G_UNIX_INPUT_STREAM (stream));
+  else if (type == G_TYPE_LOCAL_FILE_INPUT_STREAM)
+    return _g_local_file_input_stream_get_fd (G_LOCAL_FILE_INPUT_STREAM (stream));
+
+  return -1;
+}
+
+static int
+splice_get_output_fd (GOutputStream *stream)
+{
+  GType type = G_TYPE_FROM_INSTANCE (stream);
+
+  if (type == G_TYPE_UNIX_OUTPUT_STREAM)
+    return g_unix_output_stream_get_fd (G_UNIX_OUTPUT_STREAM (stream));
+  else if (type == G_TYPE_LOCAL_FILE_OUTPUT_STREAM)
+    return _g_local_file_output_stream_get_fd (G_LOCAL_FILE_OUTPUT_STREAM (stream));
+
+  return -1;
+}
+
+static void
+splice_set_error (GError **error,
+                  int      errsv)
+{
+  g_set_error (error, G_IO_ERROR,
+               g_io_error_from_errno (errsv),
+               _("Error splicing file: %s"),
+               g_strerror (errsv));
+}
+
+/* Like the unix streams, block in poll() rather than in the kernel
+ * copy when there is a cancellable, so that cancelling wakes us up.
+ */
+static gboolean
+splice_wait_fd (int            fd,
+                GIOCondition   condition,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+  GPollFD poll_fds[2];
+  int poll_ret;
+
+  if (cancellable == NULL)
+    return TRUE;
+
+  poll_fds[0].fd = fd;
+  poll_fds[0].events = condition;
+  g_cancellable_make_pollfd (cancellable, &poll_fds[1]);
+  do
+    poll_ret = g_poll (poll_fds, 2, -1);
+  while (poll_ret == -1 && errno == EINTR);
+
+  if (poll_ret == -1)
+    {
+      splice_set_error (error, errno);
+      return FALSE;
+    }
+
+  return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+static gboolean
+splice_write_all (int            fd,
+                  const char    *buffer,
+                  gsize          count,
+                  GCancellable  *cancellable,
+                  GError       **error)
+{
+  gssize res;
+
+  while (count > 0)
+    {
+      if (!splice_wait_fd (fd, G_IO_OUT, cancellable, error))
+        return FALSE;
+
+      res = write (fd, buffer, count);
+      if (res == -1)
+        {
+          if (errno == EINTR)
+            continue;
+          splice_set_error (error, errno);
+          return FALSE;
+        }
+
+      buffer += res;
+      count -= res;
+    }
+
+  return TRUE;
+}
+
+#ifdef HAVE_SENDFILE
+static gssize
+splice_fds_sendfile (int            in_fd,
+                     int            out_fd,
+                     gboolean      *fallback,
+                     GCancellable  *cancellable,
+                     GError       **error)
+{
+  gssize bytes_copied = 0;
+  gssize res;
+
+  while (TRUE)
+    {
+      if (!splice_wait_fd (out_fd, G_IO_OUT, cancellable, error))
+        return -1;
+
+      res = sendfile (out_fd, in_fd, NULL, SPLICE_CHUNK_SIZE);
+      if (res == -1)
+        {
+          int errsv = errno;
+
+          if (errsv == EINTR)
+            continue;
+
+          if (bytes_copied == 0 && (errsv == EINVAL || errsv == ENOSYS))
+            {
+              *fallback = TRUE;
+              return 0;
+            }
+
+          splice_set_error (error, errsv);
+          return -1;
+        }
+
+      if (res == 0)
+        break;
+
+      bytes_copied += res;
+    }
+
+  return bytes_copied;
+}
+#endif
+
+#ifdef HAVE_SPLICE
+static gssize
+splice_fds_pipe (int            in_fd,
+                 int            out_fd,
+                 gboolean      *fallback,
+                 GCancellable  *cancellable,
+                 GError       **error)
+{
+  gssize bytes_copied = 0;
+  gssize n_in, n_out;
+  int pipe_fds[2];
+  char *buffer;
+
+  if (pipe (pipe_fds) == -1)
+    {
+      *fallback = TRUE;
+      return 0;
+    }
+
+  while (TRUE)
+    {
+      if (!splice_wait_fd (in_fd, G_IO_IN, cancellable, error))
+        goto error;
+
+      n_in = splice (in_fd, NULL, pipe_fds[1], NULL, SPLICE_PIPE_SIZE,
+                     SPLICE_F_MOVE | SPLICE_F_MORE);
+      if (n_in == -1)
+        {
+          int errsv = errno;
+
+          if (errsv == EINTR)
+            continue;
+
+          if (bytes_copied == 0 && (errsv == EINVAL || errsv == ENOSYS))
+            {
+              *fallback = TRUE;
+              goto out;
+            }
+
+          splice_set_error (error, errsv);
+          goto error;
+        }
+
+      if (n_in == 0)
+        break;
+
+      while (n_in > 0)
+        {
+          if (!splice_wait_fd (out_fd, G_IO_OUT, cancellable, error))
+            goto error;
+
+          n_out = splice (pipe_fds[0], NULL, out_fd, NULL, n_in,
+                          SPLICE_F_MOVE | SPLICE_F_MORE);
+          if (n_out == -1)
+            {
+              int errsv = errno;
+
+              if (errsv == EINTR)
+                continue;
+
+              if (bytes_copied == 0 && errsv == EINVAL)
+                {
+                  /* the sink doesn't do splice; move what is already
+                   * in the pipe by hand and let the caller do the rest
+                   */
+                  buffer = g_malloc (n_in);
+                  n_out = read (pipe_fds[0], buffer, n_in);
+                  if (n_out != n_in ||
+                      !splice_write_all (out_fd, buffer, n_in, cancellable, error))
+                    {
+                      if (n_out != n_in)
+                        splice_set_error (error, errno);
+                      g_free (buffer);
+                      goto error;
+                    }
+                  g_free (buffer);
+
+                  bytes_copied = n_in;
+                  *fallback = TRUE;
+                  goto out;
+                }
+
+              splice_set_error (error, errsv);
+              goto error;
+            }
+
+          n_in -= n_out;
+          bytes_copied += n_out;
+        }
+    }
+
+ out:
+  close (pipe_fds[0]);
+  close (pipe_fds[1]);
+  return bytes_copied;
+
+ error:
+  close (pipe_fds[0]);
+  close (pipe_fds[1]);
+  return -1;
+}
+#endif
+
+/* Copies everything from @in_fd to @out_fd without going through
+ * userspace. Returns the number of bytes copied, or -1 on error.
+ * If the kernel can't do it for this pair of fds, *fallback is set and
+ * the caller should continue with read() and write(), which pick up at
+ * the current file offsets.
+ */
+static gssize
+splice_fds (int            in_fd,
+            int            out_fd,
+            gboolean      *fallback,
+            GCancellable  *cancellable,
+            GError       **error)
+{
+#ifdef HAVE_SENDFILE
+  struct stat in_stat;
+#endif
+
+  *fallback = FALSE;
+
+#ifdef HAVE_SENDFILE
+  if (fstat (in_fd, &in_stat) == 0 && S_ISREG (in_stat.st_mode))
+    return splice_fds_sendfile (in_fd, out_fd, fallback, cancellable, error);
+#endif
+
+#ifdef HAVE_SPLICE
+  return splice_fds_pipe (in_fd, out_fd, fallback, cancellable, error);
+#else
+  *fallback = TRUE;
+  return 0;
+#endif
+}
+
+#endif /* USE_KERNEL_SPLICE */
+
+/* the fallback copy starts with a small buffer and grows it while
+ * the source keeps filling it, up to SPLICE_BUFFER_MAX
+ */
+#define SPLICE_BUFFER_MIN 8192
+#define SPLICE_BUFFER_MAX (256 * 1024)
+
 static gssize
 g_output_stream_real_splice (GOutputStream             *stream,
                              GInputStream              *source,
@@ -402,8 +844,12 @@ g_output_stream_real_splice (GOutputStream             *stream,
   GOutputStreamClass *class = G_OUTPUT_STREAM_GET_CLASS (stream);
   gssize n_read, n_written;
   gssize bytes_copied;
-  char buffer[8192], *p;
-  gboolean res;
+  char stack_buffer[SPLICE_BUFFER_MIN], *heap_buffer, *buffer, *p;
+  gsize buffer_size;
+  gboolean res, filled;
+#ifdef USE_KERNEL_SPLICE
+  int in_fd, out_fd;
+#endif
 
   bytes_copied = 0;
   if (class->write_fn == NULL) 
@@ -411,13 +857,44 @@ g_output_stream_real_splice (GOutputStream             *stream,
       g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
                            _("Output stream doesn't implement write"));
       res = FALSE;
-      goto notsupported;
+      goto out;
     }
   
   res = TRUE;
+
+#ifdef USE_KERNEL_SPLICE
+  in_fd = splice_get_input_fd (source);
+  out_fd = splice_get_output_fd (stream);
+  if (in_fd != -1 && out_fd != -1)
+    {
+      gboolean fallback;
+
+      if (!g_input_stream_set_pending (source, error))
+        {
+          res = FALSE;
+          goto out;
+        }
+
+      bytes_copied = splice_fds (in_fd, out_fd, &fallback, cancellable, error);
+      g_input_stream_clear_pending (source);
+
+      if (bytes_copied == -1)
+        {
+          res = FALSE;
+          goto out;
+        }
+
+      if (!fallback)
+        goto out;
+    }
+#endif
+
+  heap_buffer = NULL;
+  buffer = stack_buffer;
+  buffer_size = sizeof (stack_buffer);
   do 
     {
-      n_read = g_input_stream_read (source, buffer, sizeof (buffer), cancellable, error);
+      n_read = g_input_stream_read (source, buffer, buffer_size, cancellable, error);
       if (n_read == -1)
 	{
 	  res = FALSE;
@@ -427,6 +904,8 @@ g_output_stream_real_splice (GOutputStream             *stream,
       if (n_read == 0)
 	break;
 
+      filled = (n_read == buffer_size);
+
       p = buffer;
       while (n_read > 0)
 	{
@@ -441,10 +920,21 @@ g_output_stream_real_splice (GOutputStream             *stream,
 	  n_read -= n_written;
 	  bytes_copied += n_written;
 	}
+
+      /* the source filled the buffer, so try larger reads */
+      if (res && filled && buffer_size < SPLICE_BUFFER_MAX)
+        {
+          buffer_size *= 2;
+          g_free (heap_buffer);
+          heap_buffer = g_malloc (buffer_size);
+          buffer = heap_buffer;
+        }
     }
   while (res);
 
- notsupported:
+  g_free (heap_buffer);
+
+ out:
   if (!res)
     error = NULL; /* Ignore further errors */
 
@@ -713,6 +1203,125 @@ g_output_stream_write_finish (GOutputStream  *stream,
   return class->write_finish (stream, result, error);
 }
 
+/**
+ * g_output_stream_writev_async:
+ * @stream: A #GOutputStream.
+ * @vectors: the buffers containing the data to write.
+ * @n_vectors: the number of elements in @vectors
+ * @io_priority: the io priority of the request.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @callback: callback to call when the request is satisfied
+ * @user_data: the data to pass to callback function
+ *
+ * Request an asynchronous write of the buffers in @vectors into the
+ * stream. When the operation is finished @callback will be called.
+ * You can then call g_output_stream_writev_finish() to get the result
+ * of the operation.
+ *
+ * Both @vectors and the buffers it points to must stay valid until
+ * @callback is called.
+ *
+ * See g_output_stream_writev() and g_output_stream_write_async() for
+ * more details.
+ *
+ * Since: 2.22
+ **/
+void
+g_output_stream_writev_async (GOutputStream       *stream,
+			      const GOutputVector *vectors,
+			      gsize                n_vectors,
+			      int                  io_priority,
+			      GCancellable        *cancellable,
+			      GAsyncReadyCallback  callback,
+			      gpointer             user_data)
+{
+  GOutputStreamClass *class;
+  GSimpleAsyncResult *simple;
+  GError *error = NULL;
+  gsize size;
+
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+  g_return_if_fail (vectors != NULL || n_vectors == 0);
+
+  if (!get_vectors_size (vectors, n_vectors, &size))
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (stream),
+					   callback,
+					   user_data,
+					   G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+					   _("Too large count value passed to %s"),
+					   G_STRFUNC);
+      return;
+    }
+
+  if (size == 0)
+    {
+      simple = g_simple_async_result_new (G_OBJECT (stream),
+					  callback,
+					  user_data,
+					  g_output_stream_writev_async);
+      g_simple_async_result_complete_in_idle (simple);
+      g_object_unref (simple);
+      return;
+    }
+
+  if (!g_output_stream_set_pending (stream, &error))
+    {
+      g_simple_async_report_gerror_in_idle (G_OBJECT (stream),
+					    callback,
+					    user_data,
+					    error);
+      g_error_free (error);
+      return;
+    }
+  
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  stream->priv->outstanding_callback = callback;
+  g_object_ref (stream);
+  class->writev_async (stream, vectors, n_vectors, io_priority, cancellable,
+		       async_ready_callback_wrapper, user_data);
+}
+
+/**
+ * g_output_stream_writev_finish:
+ * @stream: a #GOutputStream.
+ * @result: a #GAsyncResult.
+ * @error: a #GError location to store the error occuring, or %NULL to 
+ * ignore.
+ * 
+ * Finishes a stream writev operation.
+ * 
+ * Returns: a #gssize containing the number of bytes written to the stream.
+ *
+ * Since: 2.22
+ **/
+gssize
+g_output_stream_writev_finish (GOutputStream  *stream,
+			       GAsyncResult   *result,
+			       GError        **error)
+{
+  GSimpleAsyncResult *simple;
+  GOutputStreamClass *class;
+
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), -1);
+  g_return_val_if_fail (G_IS_ASYNC_RESULT (result), -1);
+
+  if (G_IS_SIMPLE_ASYNC_RESULT (result))
+    {
+      simple = G_SIMPLE_ASYNC_RESULT (result);
+      if (g_simple_async_result_propagate_error (simple, error))
+	return -1;
+
+      /* Special case writes of 0 bytes */
+      if (g_simple_async_result_get_source_tag (simple) == g_output_stream_writev_async)
+	return 0;
+    }
+  
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+  return class->writev_finish (stream, result, error);
+}
+
 typedef struct {
   GInputStream *source;
   gpointer user_data;
@@ -1180,6 +1789,103 @@ g_output_stream_real_write_finish (GOutputStream  *stream,
   return op->count_written;
 }
 
+/* Writes the buffers one by one, stopping at the first short write.
+ * An error after some data went out is dropped in favour of returning
+ * the partial count, like a short write(2).
+ */
+static gssize
+g_output_stream_real_writev (GOutputStream        *stream,
+			     const GOutputVector  *vectors,
+			     gsize                 n_vectors,
+			     GCancellable         *cancellable,
+			     GError              **error)
+{
+  GOutputStreamClass *class;
+  gsize written, i;
+  gssize res;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  written = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      if (vectors[i].size == 0)
+	continue;
+
+      res = class->write_fn (stream, vectors[i].buffer, vectors[i].size,
+			     cancellable, written == 0 ? error : NULL);
+      if (res == -1)
+	return written == 0 ? -1 : written;
+
+      written += res;
+      if (res < vectors[i].size)
+	break;
+    }
+
+  return written;
+}
+
+typedef struct {
+  const GOutputVector *vectors;
+  gsize                n_vectors;
+  gssize               count_written;
+} WritevData;
+
+static void
+writev_async_thread (GSimpleAsyncResult *res,
+		     GObject            *object,
+		     GCancellable       *cancellable)
+{
+  WritevData *op;
+  GOutputStreamClass *class;
+  GError *error = NULL;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (object);
+  op = g_simple_async_result_get_op_res_gpointer (res);
+  op->count_written = class->writev_fn (G_OUTPUT_STREAM (object), op->vectors, op->n_vectors,
+					cancellable, &error);
+  if (op->count_written == -1)
+    {
+      g_simple_async_result_set_from_error (res, error);
+      g_error_free (error);
+    }
+}
+
+static void
+g_output_stream_real_writev_async (GOutputStream       *stream,
+				   const GOutputVector *vectors,
+				   gsize                n_vectors,
+				   int                  io_priority,
+				   GCancellable        *cancellable,
+				   GAsyncReadyCallback  callback,
+				   gpointer             user_data)
+{
+  GSimpleAsyncResult *res;
+  WritevData *op;
+
+  op = g_new0 (WritevData, 1);
+  res = g_simple_async_result_new (G_OBJECT (stream), callback, user_data, g_output_stream_real_writev_async);
+  g_simple_async_result_set_op_res_gpointer (res, op, g_free);
+  op->vectors = vectors;
+  op->n_vectors = n_vectors;
+  
+  g_simple_async_result_run_in_thread (res, writev_async_thread, io_priority, cancellable);
+  g_object_unref (res);
+}
+
+static gssize
+g_output_stream_real_writev_finish (GOutputStream  *stream,
+				    GAsyncResult   *result,
+				    GError        **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+  WritevData *op;
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) == g_output_stream_real_writev_async);
+  op = g_simple_async_result_get_op_res_gpointer (simple);
+  return op->count_written;
+}
+
 typedef struct {
   GInputStream *source;
   GOutputStreamSpliceFlags flags;
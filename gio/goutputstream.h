@@ -121,11 +121,26 @@ struct _GOutputStreamClass
                                  GAsyncResult             *result,
                                  GError                  **error);
 
+  /* Vectored writes: (optional in derived classes) */
+
+  gssize      (* writev_fn)     (GOutputStream            *stream,
+                                 const GOutputVector      *vectors,
+                                 gsize                     n_vectors,
+                                 GCancellable             *cancellable,
+                                 GError                  **error);
+  void        (* writev_async)  (GOutputStream            *stream,
+                                 const GOutputVector      *vectors,
+                                 gsize                     n_vectors,
+                                 int                       io_priority,
+                                 GCancellable             *cancellable,
+                                 GAsyncReadyCallback       callback,
+                                 gpointer                  user_data);
+  gssize      (* writev_finish) (GOutputStream            *stream,
+                                 GAsyncResult             *result,
+                                 GError                  **error);
+
   /*< private >*/
   /* Padding for future expansion */
-  void (*_g_reserved1) (void);
-  void (*_g_reserved2) (void);
-  void (*_g_reserved3) (void);
   void (*_g_reserved4) (void);
   void (*_g_reserved5) (void);
   void (*_g_reserved6) (void);
@@ -140,6 +155,11 @@ gssize   g_output_stream_write         (GOutputStream             *stream,
 					gsize                      count,
 					GCancellable              *cancellable,
 					GError                   **error);
+gssize   g_output_stream_writev        (GOutputStream             *stream,
+					const GOutputVector       *vectors,
+					gsize                      n_vectors,
+					GCancellable              *cancellable,
+					GError                   **error);
 gboolean g_output_stream_write_all     (GOutputStream             *stream,
 					const void                *buffer,
 					gsize                      count,
@@ -167,6 +187,16 @@ void     g_output_stream_write_async   (GOutputStream             *stream,
 gssize   g_output_stream_write_finish  (GOutputStream             *stream,
 					GAsyncResult              *result,
 					GError                   **error);
+void     g_output_stream_writev_async  (GOutputStream             *stream,
+					const GOutputVector       *vectors,
+					gsize                      n_vectors,
+					int                        io_priority,
+					GCancellable              *cancellable,
+					GAsyncReadyCallback        callback,
+					gpointer                   user_data);
+gssize   g_output_stream_writev_finish (GOutputStream             *stream,
+					GAsyncResult              *result,
+					GError                   **error);
 void     g_output_stream_splice_async  (GOutputStream             *stream,
 					GInputStream              *source,
 					GOutputStreamSpliceFlags   flags,
@@ -24,10 +24,13 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -40,6 +43,17 @@
 
 #include "gioalias.h"
 
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+/* GOutputVector is laid out like struct iovec, so arrays of them can
+ * be passed to writev() as they are.
+ */
+G_STATIC_ASSERT (sizeof (GOutputVector) == sizeof (struct iovec));
+G_STATIC_ASSERT (offsetof (GOutputVector, buffer) == offsetof (struct iovec, iov_base));
+G_STATIC_ASSERT (offsetof (GOutputVector, size) == offsetof (struct iovec, iov_len));
+
 /**
  * SECTION:gunixoutputstream
  * @short_description: Streaming output operations for Unix file descriptors
@@ -82,6 +96,11 @@ static gssize   g_unix_output_stream_write        (GOutputStream        *stream,
 						   gsize                 count,
 						   GCancellable         *cancellable,
 						   GError              **error);
+static gssize   g_unix_output_stream_writev       (GOutputStream        *stream,
+						   const GOutputVector  *vectors,
+						   gsize                 n_vectors,
+						   GCancellable         *cancellable,
+						   GError              **error);
 static gboolean g_unix_output_stream_close        (GOutputStream        *stream,
 						   GCancellable         *cancellable,
 						   GError              **error);
@@ -95,6 +114,16 @@ static void     g_unix_output_stream_write_async  (GOutputStream        *stream,
 static gssize   g_unix_output_stream_write_finish (GOutputStream        *stream,
 						   GAsyncResult         *result,
 						   GError              **error);
+static void     g_unix_output_stream_writev_async (GOutputStream        *stream,
+						   const GOutputVector  *vectors,
+						   gsize                 n_vectors,
+						   int                   io_priority,
+						   GCancellable         *cancellable,
+						   GAsyncReadyCallback   callback,
+						   gpointer              data);
+static gssize   g_unix_output_stream_writev_finish (GOutputStream       *stream,
+						   GAsyncResult         *result,
+						   GError              **error);
 static void     g_unix_output_stream_close_async  (GOutputStream        *stream,
 						   int                   io_priority,
 						   GCancellable         *cancellable,
@@ -133,6 +162,9 @@ g_unix_output_stream_class_init (GUnixOutputStreamClass *klass)
   stream_class->write_finish = g_unix_output_stream_write_finish;
   stream_class->close_async = g_unix_output_stream_close_async;
   stream_class->close_finish = g_unix_output_stream_close_finish;
+  stream_class->writev_fn = g_unix_output_stream_writev;
+  stream_class->writev_async = g_unix_output_stream_writev_async;
+  stream_class->writev_finish = g_unix_output_stream_writev_finish;
 
    /**
    * GUnixOutputStream:fd:
@@ -372,6 +404,70 @@ g_unix_output_stream_write (GOutputStream  *stream,
   return res;
 }
 
+static gssize
+g_unix_output_stream_writev (GOutputStream        *stream,
+			     const GOutputVector  *vectors,
+			     gsize                 n_vectors,
+			     GCancellable         *cancellable,
+			     GError              **error)
+{
+  GUnixOutputStream *unix_stream;
+  gssize res;
+  GPollFD poll_fds[2];
+  int poll_ret;
+
+  unix_stream = G_UNIX_OUTPUT_STREAM (stream);
+
+  if (cancellable)
+    {
+      poll_fds[0].fd = unix_stream->priv->fd;
+      poll_fds[0].events = G_IO_OUT;
+      g_cancellable_make_pollfd (cancellable, &poll_fds[1]);
+      do
+	poll_ret = g_poll (poll_fds, 2, -1);
+      while (poll_ret == -1 && errno == EINTR);
+      
+      if (poll_ret == -1)
+	{
+          int errsv = errno;
+
+	  g_set_error (error, G_IO_ERROR,
+		       g_io_error_from_errno (errsv),
+		       _("Error writing to unix: %s"),
+		       g_strerror (errsv));
+	  return -1;
+	}
+    }
+      
+  while (1)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+	return -1;
+
+      /* Anything beyond IOV_MAX is left for the caller to retry, like
+       * any other short write.
+       */
+      res = writev (unix_stream->priv->fd, (const struct iovec *) vectors,
+		    MIN (n_vectors, IOV_MAX));
+      if (res == -1)
+	{
+          int errsv = errno;
+
+	  if (errsv == EINTR)
+	    continue;
+	  
+	  g_set_error (error, G_IO_ERROR,
+		       g_io_error_from_errno (errsv),
+		       _("Error writing to unix: %s"),
+		       g_strerror (errsv));
+	}
+      
+      break;
+    }
+  
+  return res;
+}
+
 static gboolean
 g_unix_output_stream_close (GOutputStream  *stream,
 			    GCancellable   *cancellable,
@@ -407,6 +503,8 @@ g_unix_output_stream_close (GOutputStream  *stream,
 typedef struct {
   gsize count;
   const void *buffer;
+  const GOutputVector *vectors;
+  gsize n_vectors;
   GAsyncReadyCallback callback;
   gpointer user_data;
   GCancellable *cancellable;
@@ -430,7 +528,12 @@ write_async_cb (WriteAsyncData *data,
 	  break;
 	}
       
-      count_written = write (data->stream->priv->fd, data->buffer, data->count);
+      if (data->vectors)
+	count_written = writev (data->stream->priv->fd,
+				(const struct iovec *) data->vectors,
+				MIN (data->n_vectors, IOV_MAX));
+      else
+	count_written = write (data->stream->priv->fd, data->buffer, data->count);
       if (count_written == -1)
 	{
           int errsv = errno;
@@ -449,7 +552,9 @@ write_async_cb (WriteAsyncData *data,
   simple = g_simple_async_result_new (G_OBJECT (data->stream),
 				      data->callback,
 				      data->user_data,
-				      g_unix_output_stream_write_async);
+				      data->vectors ?
+				        (gpointer) g_unix_output_stream_writev_async :
+				        (gpointer) g_unix_output_stream_write_async);
   
   g_simple_async_result_set_op_res_gssize (simple, count_written);
 
@@ -514,6 +619,52 @@ g_unix_output_stream_write_finish (GOutputStream  *stream,
   return nwritten;
 }
 
+static void
+g_unix_output_stream_writev_async (GOutputStream       *stream,
+				   const GOutputVector *vectors,
+				   gsize                n_vectors,
+				   int                  io_priority,
+				   GCancellable        *cancellable,
+				   GAsyncReadyCallback  callback,
+				   gpointer             user_data)
+{
+  GSource *source;
+  GUnixOutputStream *unix_stream;
+  WriteAsyncData *data;
+
+  unix_stream = G_UNIX_OUTPUT_STREAM (stream);
+
+  data = g_new0 (WriteAsyncData, 1);
+  data->vectors = vectors;
+  data->n_vectors = n_vectors;
+  data->callback = callback;
+  data->user_data = user_data;
+  data->cancellable = cancellable;
+  data->stream = unix_stream;
+
+  source = _g_fd_source_new (unix_stream->priv->fd,
+			     G_IO_OUT,
+			     cancellable);
+  
+  g_source_set_callback (source, (GSourceFunc)write_async_cb, data, g_free);
+  g_source_attach (source, NULL);
+  
+  g_source_unref (source);
+}
+
+static gssize
+g_unix_output_stream_writev_finish (GOutputStream  *stream,
+				    GAsyncResult   *result,
+				    GError        **error)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = G_SIMPLE_ASYNC_RESULT (result);
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) == g_unix_output_stream_writev_async);
+  
+  return g_simple_async_result_get_op_res_gssize (simple);
+}
+
 typedef struct {
   GOutputStream *stream;
   GAsyncReadyCallback callback;
@@ -96,6 +96,7 @@ g_inotify_directory_monitor_constructor (GType type,
   /* FIXME: what to do about errors here? we can't return NULL or another
    * kind of error and an assertion is probably too hard */
   g_assert (sub != NULL);
+  sub->recursive = (G_LOCAL_DIRECTORY_MONITOR (obj)->flags & G_FILE_MONITOR_WATCH_RECURSIVE) != 0;
   g_assert (_ih_sub_add (sub));
 
   inotify_monitor->sub = sub;
@@ -28,8 +28,12 @@
 #include <time.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
 /* Just include the local header to stop all the pain */
 #include <sys/inotify.h>
+#include <glib/gstdio.h>
 #include <gio/glocalfile.h>
 #include <gio/gfilemonitor.h>
 #include <gio/gfile.h>
@@ -47,6 +51,40 @@ static gboolean ih_debug_enabled = FALSE;
 static void ih_event_callback (ik_event_t *event, inotify_sub *sub);
 static void ih_not_missing_callback (inotify_sub *sub);
 
+/* Recursive monitoring
+ *
+ * A recursive subscription gets a private subscription for every
+ * directory below it, all reporting to the same monitor. They are
+ * kept in a tree that mirrors the directories, with a path index on
+ * the root. New directories are not scanned from the event callback:
+ * they are queued and scanned from an idle in batches, so a burst of
+ * directory creations (an unpacked tarball, say) is handled in a few
+ * passes. Subscriptions that are dropped while events are being
+ * dispatched are freed from the idle as well.
+ */
+#define IH_SCAN_BATCH 256 /* directories per idle dispatch */
+
+typedef struct ih_tree_dir_s ih_tree_dir_t;
+
+struct ih_tree_dir_s {
+  inotify_sub   *sub;
+  ih_tree_dir_t *root;
+  ih_tree_dir_t *parent;
+  GList         *children;
+  GList         *link;          /* in parent->children */
+  GList         *pending_link;  /* in pending_dirs, while waiting for a scan */
+  gboolean       watched;
+  GHashTable    *dirs;          /* root only: path -> ih_tree_dir_t */
+};
+
+static GQueue *pending_dirs = NULL;
+static GSList *dead_subs = NULL;
+static guint pending_source = 0;
+
+static void     ih_tree_queue_scan (ih_tree_dir_t *dir);
+static gboolean ih_tree_event      (ih_tree_dir_t *dir,
+				    ik_event_t    *event);
+
 /* We share this lock with inotify-kernel.c and inotify-missing.c
  *
  * inotify-kernel.c takes the lock when it reads events from
@@ -102,16 +140,264 @@ _ih_startup (void)
   return TRUE;
 }
 
+static void
+ih_tree_dir_remove (ih_tree_dir_t *dir);
+
+static gboolean
+ih_process_pending (gpointer user_data);
+
+static void
+ih_ensure_pending_source (void)
+{
+  if (pending_source == 0)
+    pending_source = g_idle_add (ih_process_pending, NULL);
+}
+
+static void
+ih_tree_queue_scan (ih_tree_dir_t *dir)
+{
+  if (pending_dirs == NULL)
+    pending_dirs = g_queue_new ();
+
+  if (dir->pending_link == NULL)
+    {
+      g_queue_push_tail (pending_dirs, dir);
+      dir->pending_link = g_queue_peek_tail_link (pending_dirs);
+    }
+
+  ih_ensure_pending_source ();
+}
+
+static void
+ih_tree_unqueue_scan (ih_tree_dir_t *dir)
+{
+  if (dir->pending_link)
+    {
+      g_queue_delete_link (pending_dirs, dir->pending_link);
+      dir->pending_link = NULL;
+    }
+}
+
+/* Takes ownership of @path */
+static ih_tree_dir_t *
+ih_tree_dir_add (ih_tree_dir_t *parent,
+		 gchar         *path)
+{
+  ih_tree_dir_t *root = parent->root;
+  ih_tree_dir_t *dir;
+
+  dir = g_hash_table_lookup (root->dirs, path);
+  if (dir != NULL || strcmp (path, root->sub->dirname) == 0)
+    {
+      g_free (path);
+      return NULL;
+    }
+
+  dir = g_slice_new0 (ih_tree_dir_t);
+  dir->sub = _ih_sub_new (path, NULL, root->sub->user_data);
+  dir->sub->tree_dir = dir;
+  dir->root = root;
+  dir->parent = parent;
+  parent->children = g_list_prepend (parent->children, dir);
+  dir->link = parent->children;
+  g_hash_table_insert (root->dirs, dir->sub->dirname, dir);
+  g_free (path);
+
+  ih_tree_queue_scan (dir);
+
+  return dir;
+}
+
+/* Drops the directory and everything below it. Not used for the
+ * root, whose subscription belongs to the monitor.
+ */
+static void
+ih_tree_dir_remove (ih_tree_dir_t *dir)
+{
+  inotify_sub *sub = dir->sub;
+
+  while (dir->children)
+    ih_tree_dir_remove (dir->children->data);
+
+  ih_tree_unqueue_scan (dir);
+  g_hash_table_remove (dir->root->dirs, sub->dirname);
+  dir->parent->children = g_list_delete_link (dir->parent->children, dir->link);
+
+  /* We may be called while the event is still being dispatched
+   * to this subscription, so only free it later.
+   */
+  sub->cancelled = TRUE;
+  sub->tree_dir = NULL;
+  _im_rm (sub);
+  _ip_stop_watching (sub);
+  dead_subs = g_slist_prepend (dead_subs, sub);
+  ih_ensure_pending_source ();
+
+  g_slice_free (ih_tree_dir_t, dir);
+}
+
+static gboolean
+ih_tree_is_dir (const gchar   *dirname,
+		struct dirent *entry)
+{
+  struct stat statbuf;
+  gchar *path;
+  gboolean is_dir;
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+  if (entry->d_type != DT_UNKNOWN)
+    return entry->d_type == DT_DIR;
+#endif
+
+  /* Don't follow symlinks, they could make us loop */
+  path = g_build_filename (dirname, entry->d_name, NULL);
+  is_dir = g_lstat (path, &statbuf) == 0 && S_ISDIR (statbuf.st_mode);
+  g_free (path);
+
+  return is_dir;
+}
+
+static void
+ih_tree_scan (ih_tree_dir_t *dir)
+{
+  struct dirent *entry;
+  DIR *d;
+
+  if (!dir->watched)
+    {
+      /* The root is on the missing list, which scans it again
+       * once it is back
+       */
+      if (dir->parent == NULL)
+	return;
+
+      /* It went away before we got to it */
+      if (!_ip_start_watching (dir->sub))
+	{
+	  ih_tree_dir_remove (dir);
+	  return;
+	}
+      dir->watched = TRUE;
+    }
+
+  d = opendir (dir->sub->dirname);
+  if (d == NULL)
+    return;
+
+  while ((entry = readdir (d)) != NULL)
+    {
+      if (strcmp (entry->d_name, ".") == 0 ||
+	  strcmp (entry->d_name, "..") == 0)
+	continue;
+
+      if (ih_tree_is_dir (dir->sub->dirname, entry))
+	ih_tree_dir_add (dir, g_build_filename (dir->sub->dirname, entry->d_name, NULL));
+    }
+
+  closedir (d);
+}
+
+static gboolean
+ih_process_pending (gpointer user_data)
+{
+  ih_tree_dir_t *dir;
+  gboolean more;
+  int i;
+
+  G_LOCK (inotify_lock);
+
+  for (i = 0; i < IH_SCAN_BATCH && pending_dirs && !g_queue_is_empty (pending_dirs); i++)
+    {
+      dir = g_queue_pop_head (pending_dirs);
+      dir->pending_link = NULL;
+      ih_tree_scan (dir);
+    }
+
+  while (dead_subs)
+    {
+      _ih_sub_free (dead_subs->data);
+      dead_subs = g_slist_delete_link (dead_subs, dead_subs);
+    }
+
+  more = pending_dirs && !g_queue_is_empty (pending_dirs);
+  if (!more)
+    pending_source = 0;
+
+  G_UNLOCK (inotify_lock);
+
+  return more;
+}
+
+/* Keeps the tree in sync with the directory, returns whether
+ * the event should be reported.
+ */
+static gboolean
+ih_tree_event (ih_tree_dir_t *dir,
+	       ik_event_t    *event)
+{
+  ih_tree_dir_t *child;
+  gchar *path;
+
+  if ((event->mask & IN_ISDIR) && event->name && *event->name)
+    {
+      path = g_build_filename (dir->sub->dirname, event->name, NULL);
+
+      if (event->mask & (IN_CREATE|IN_MOVED_TO))
+	ih_tree_dir_add (dir, path);
+      else if (event->mask & (IN_DELETE|IN_MOVED_FROM))
+	{
+	  child = g_hash_table_lookup (dir->root->dirs, path);
+	  if (child)
+	    ih_tree_dir_remove (child);
+	  g_free (path);
+	}
+      else
+	g_free (path);
+    }
+
+  if (event->mask & (IN_DELETE_SELF|IN_MOVE_SELF|IN_UNMOUNT))
+    {
+      /* The subscription goes on the missing list */
+      dir->watched = FALSE;
+
+      /* Below the root, the parent directory already reports this */
+      if (dir->parent)
+	return FALSE;
+
+      while (dir->children)
+	ih_tree_dir_remove (dir->children->data);
+      ih_tree_unqueue_scan (dir);
+    }
+
+  return TRUE;
+}
+
 /**
  * Adds a subscription to be monitored.
  */
 gboolean
 _ih_sub_add (inotify_sub *sub)
 {
+  ih_tree_dir_t *root = NULL;
+
   G_LOCK (inotify_lock);
+
+  if (sub->recursive)
+    {
+      root = g_slice_new0 (ih_tree_dir_t);
+      root->sub = sub;
+      root->root = root;
+      root->dirs = g_hash_table_new (g_str_hash, g_str_equal);
+      sub->tree_dir = root;
+    }
 	
   if (!_ip_start_watching (sub))
     _im_add (sub);
+  else if (root)
+    {
+      root->watched = TRUE;
+      ih_tree_queue_scan (root);
+    }
   
   G_UNLOCK (inotify_lock);
   return TRUE;
@@ -131,6 +417,18 @@ _ih_sub_cancel (inotify_sub *sub)
       sub->cancelled = TRUE;
       _im_rm (sub);
       _ip_stop_watching (sub);
+
+      if (sub->tree_dir)
+	{
+	  ih_tree_dir_t *root = sub->tree_dir;
+
+	  while (root->children)
+	    ih_tree_dir_remove (root->children->data);
+	  ih_tree_unqueue_scan (root);
+	  g_hash_table_destroy (root->dirs);
+	  g_slice_free (ih_tree_dir_t, root);
+	  sub->tree_dir = NULL;
+	}
     }
   
   G_UNLOCK (inotify_lock);
@@ -148,6 +446,9 @@ ih_event_callback (ik_event_t  *event,
   GFile* parent;
   GFile* child;
   
+  if (sub->tree_dir && !ih_tree_event (sub->tree_dir, event))
+    return;
+
   eflags = ih_mask_to_EventFlags (event->mask);
   parent = g_file_new_for_path (sub->dirname);
   if (event->name)
@@ -173,6 +474,15 @@ ih_not_missing_callback (inotify_sub *sub)
   guint32 mask;
   GFile* parent;
   GFile* child;
+
+  if (sub->tree_dir)
+    {
+      ih_tree_dir_t *dir = sub->tree_dir;
+
+      /* Pick up whatever was created below it in the meantime */
+      dir->watched = TRUE;
+      ih_tree_queue_scan (dir);
+    }
   
   parent = g_file_new_for_path (sub->dirname);
 
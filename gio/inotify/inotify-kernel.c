@@ -23,22 +23,27 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <glib.h>
 #include "inotify-kernel.h"
 #include <sys/inotify.h>
 
-/* Timings for pairing MOVED_TO / MOVED_FROM events */
-#define PROCESS_EVENTS_TIME 1000 /* milliseconds (1 hz) */
-#define DEFAULT_HOLD_UNTIL_TIME 0 /* 0 millisecond */
-#define MOVE_HOLD_UNTIL_TIME 0 /* 0 milliseconds */
+/* How long a MOVED_FROM event waits for its MOVED_TO. The kernel
+ * queues both halves of a rename back to back, so the pair nearly
+ * always shows up in the same read and is matched right away; the
+ * hold only matters when a read splits them, or when the file moved
+ * out of the watched directories. Can be overridden with
+ * GIO_INOTIFY_MOVE_HOLD (in milliseconds).
+ */
+#define DEFAULT_MOVE_HOLD_TIME 10 /* milliseconds */
 
 static int inotify_instance_fd = -1;
 static GQueue *events_to_process = NULL;
-static GQueue *event_queue = NULL;
 static GHashTable * cookie_hash = NULL;
 static GIOChannel *inotify_read_ioc;
 static GPollFD ik_poll_fd;
@@ -51,7 +56,8 @@ static gboolean ik_process_eq_callback (gpointer user_data);
 static guint32 ik_move_matches = 0;
 static guint32 ik_move_misses = 0;
 
-static gboolean process_eq_running = FALSE;
+static gint64 move_hold_time; /* microseconds */
+static guint process_eq_source = 0;
 
 /* We use the lock from inotify-helper.c
  *
@@ -68,12 +74,28 @@ G_LOCK_EXTERN (inotify_lock);
 
 typedef struct ik_event_internal {
   ik_event_t *event;
-  gboolean seen;
   gboolean sent;
-  GTimeVal hold_until;
+  gint64 hold_until; /* monotonic, microseconds */
   struct ik_event_internal *pair;
 } ik_event_internal_t;
 
+static gint64
+ik_get_time (void)
+{
+#if defined (HAVE_CLOCK_GETTIME) && defined (HAVE_MONOTONIC_CLOCK)
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0)
+    return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+#endif
+  {
+    GTimeVal tv;
+
+    g_get_current_time (&tv);
+    return (gint64) tv.tv_sec * G_USEC_PER_SEC + tv.tv_usec;
+  }
+}
+
 /* In order to perform non-sleeping inotify event chunking we need
  * a custom GSource
  */
@@ -181,6 +203,7 @@ static GSourceFuncs ik_source_funcs =
 gboolean _ik_startup (void (*cb)(ik_event_t *event))
 {
   static gboolean initialized = FALSE;
+  const char *env;
   GSource *source;
   
   user_cb = cb;
@@ -190,6 +213,12 @@ gboolean _ik_startup (void (*cb)(ik_event_t *event))
   
   initialized = TRUE;
   inotify_instance_fd = inotify_init ();
+
+  env = g_getenv ("GIO_INOTIFY_MOVE_HOLD");
+  if (env != NULL)
+    move_hold_time = MAX (atoi (env), 0) * (gint64) 1000;
+  else
+    move_hold_time = DEFAULT_MOVE_HOLD_TIME * (gint64) 1000;
   
   if (inotify_instance_fd < 0)
     return FALSE;
@@ -207,24 +236,21 @@ gboolean _ik_startup (void (*cb)(ik_event_t *event))
   g_source_unref (source);
 
   cookie_hash = g_hash_table_new (g_direct_hash, g_direct_equal);
-  event_queue = g_queue_new ();
   events_to_process = g_queue_new ();
   
   return TRUE;
 }
 
 static ik_event_internal_t *
-ik_event_internal_new (ik_event_t *event)
+ik_event_internal_new (ik_event_t *event,
+                       gint64      now)
 {
-  ik_event_internal_t *internal_event = g_new0 (ik_event_internal_t, 1);
-  GTimeVal tv;
+  ik_event_internal_t *internal_event = g_slice_new0 (ik_event_internal_t);
   
   g_assert (event);
   
-  g_get_current_time (&tv);
-  g_time_val_add (&tv, DEFAULT_HOLD_UNTIL_TIME);
   internal_event->event = event;
-  internal_event->hold_until = tv;
+  internal_event->hold_until = now;
   
   return internal_event;
 }
@@ -437,64 +463,6 @@ ik_read_events (gsize  *buffer_size_out,
   *buffer_out = buffer;
 }
 
-static gboolean
-ik_read_callback (gpointer user_data)
-{
-  gchar *buffer;
-  gsize buffer_size, buffer_i, events;
-  
-  G_LOCK (inotify_lock);
-  ik_read_events (&buffer_size, &buffer);
-  
-  buffer_i = 0;
-  events = 0;
-  while (buffer_i < buffer_size)
-    {
-      struct inotify_event *event;
-      gsize event_size;
-      event = (struct inotify_event *)&buffer[buffer_i];
-      event_size = sizeof(struct inotify_event) + event->len;
-      g_queue_push_tail (events_to_process, ik_event_internal_new (ik_event_new (&buffer[buffer_i])));
-      buffer_i += event_size;
-      events++;
-    }
-  
-  /* If the event process callback is off, turn it back on */
-  if (!process_eq_running && events)
-    {
-      process_eq_running = TRUE;
-      g_timeout_add (PROCESS_EVENTS_TIME, ik_process_eq_callback, NULL);
-    }
-  
-  G_UNLOCK (inotify_lock);
-  
-  return TRUE;
-}
-
-static gboolean
-g_timeval_lt (GTimeVal *val1, 
-              GTimeVal *val2)
-{
-  if (val1->tv_sec < val2->tv_sec)
-    return TRUE;
-  
-  if (val1->tv_sec > val2->tv_sec)
-    return FALSE;
-  
-  /* val1->tv_sec == val2->tv_sec */
-  if (val1->tv_usec < val2->tv_usec)
-    return TRUE;
-  
-  return FALSE;
-}
-
-static gboolean
-g_timeval_eq (GTimeVal *val1, 
-              GTimeVal *val2)
-{
-  return (val1->tv_sec == val2->tv_sec) && (val1->tv_usec == val2->tv_usec);
-}
-
 static void
 ik_pair_events (ik_event_internal_t *event1, 
                 ik_event_internal_t *event2)
@@ -508,67 +476,30 @@ ik_pair_events (ik_event_internal_t *event1,
   /* Pair the internal structures and the ik_event_t structures */
   event1->pair = event2;
   event1->event->pair = event2->event;
-  
-  if (g_timeval_lt (&event1->hold_until, &event2->hold_until))
-    event1->hold_until = event2->hold_until;
-  
-  event2->hold_until = event1->hold_until;
+
+  /* The MOVED_TO goes out together with its MOVED_FROM */
+  event2->sent = TRUE;
 }
 
 static void
-ik_event_add_microseconds (ik_event_internal_t *event, 
-                           glong                ms)
+ik_queue_event (ik_event_internal_t *event)
 {
-  g_assert (event);
-  g_time_val_add (&event->hold_until, ms);
-}
+  ik_event_internal_t *match;
 
-static gboolean
-ik_event_ready (ik_event_internal_t *event)
-{
-  GTimeVal tv;
-  g_assert (event);
-  
-  g_get_current_time (&tv);
-  
-  /* An event is ready if,
-   *
-   * it has no cookie -- there is nothing to be gained by holding it
-   * or, it is already paired -- we don't need to hold it anymore
-   * or, we have held it long enough
+  /* Moves are paired as they come in. A MOVED_FROM is held back for
+   * a little while in case its MOVED_TO is still in the kernel
+   * queue; the kernel never sends the MOVED_TO first, so there is no
+   * point in holding those.
    */
-  return
-    event->event->cookie == 0 ||
-    event->pair != NULL ||
-    g_timeval_lt (&event->hold_until, &tv) ||
-    g_timeval_eq (&event->hold_until, &tv);
-}
-
-static void
-ik_pair_moves (gpointer data, 
-               gpointer user_data)
-{
-  ik_event_internal_t *event = (ik_event_internal_t *)data;
-  
-  if (event->seen == TRUE || event->sent == TRUE)
-    return;
-  
   if (event->event->cookie != 0)
     {
-      /* When we get a MOVED_FROM event we delay sending the event by
-       * MOVE_HOLD_UNTIL_TIME microseconds. We need to do this because a
-       * MOVED_TO pair _might_ be coming in the near future */
       if (event->event->mask & IN_MOVED_FROM)
 	{
 	  g_hash_table_insert (cookie_hash, GINT_TO_POINTER (event->event->cookie), event);
-	  /* because we don't deliver move events there is no point in waiting for the match right now. */
-	  ik_event_add_microseconds (event, MOVE_HOLD_UNTIL_TIME);
+	  event->hold_until += move_hold_time;
 	}
       else if (event->event->mask & IN_MOVED_TO)
 	{
-	  /* We need to check if we are waiting for this MOVED_TO events cookie to pair it with
-	   * a MOVED_FROM */
-	  ik_event_internal_t *match = NULL;
 	  match = g_hash_table_lookup (cookie_hash, GINT_TO_POINTER (event->event->cookie));
 	  if (match)
 	    {
@@ -577,17 +508,40 @@ ik_pair_moves (gpointer data,
 	    }
 	}
     }
-  event->seen = TRUE;
+
+  g_queue_push_tail (events_to_process, event);
+}
+
+static gboolean
+ik_event_ready (ik_event_internal_t *event,
+                gint64               now)
+{
+  g_assert (event);
+  
+  /* An event is ready if,
+   *
+   * it has no cookie -- there is nothing to be gained by holding it
+   * or, it is already paired -- we don't need to hold it anymore
+   * or, we have held it long enough
+   */
+  return
+    event->event->cookie == 0 ||
+    event->pair != NULL ||
+    event->hold_until <= now;
 }
 
 static void
 ik_process_events (void)
 {
-  g_queue_foreach (events_to_process, ik_pair_moves, NULL);
+  ik_event_internal_t *event;
+  gint64 now;
+  gint64 delay;
+
+  now = ik_get_time ();
 
   while (!g_queue_is_empty (events_to_process))
     {
-      ik_event_internal_t *event = g_queue_peek_head (events_to_process);
+      event = g_queue_peek_head (events_to_process);
       
       /* This must have been sent as part of a MOVED_TO/MOVED_FROM */
       if (event->sent)
@@ -595,28 +549,27 @@ ik_process_events (void)
 	  /* Pop event */
 	  g_queue_pop_head (events_to_process);
 	  /* Free the internal event structure */
-	  g_free (event);
+	  g_slice_free (ik_event_internal_t, event);
 	  continue;
 	}
       
-      /* The event isn't ready yet */
-      if (!ik_event_ready (event))
+      /* The event isn't ready yet. Everything behind it waits
+       * too, so that events are delivered in order.
+       */
+      if (!ik_event_ready (event, now))
 	break;
       
       /* Pop it */
-      event = g_queue_pop_head (events_to_process);
+      g_queue_pop_head (events_to_process);
       
-      /* Check if this is a MOVED_FROM that is also sitting in the cookie_hash */
+      /* Check if this is a MOVED_FROM that is still sitting in the cookie_hash */
       if (event->event->cookie && event->pair == NULL &&
-	  g_hash_table_lookup (cookie_hash, GINT_TO_POINTER (event->event->cookie)))
+	  g_hash_table_lookup (cookie_hash, GINT_TO_POINTER (event->event->cookie)) == event)
 	g_hash_table_remove (cookie_hash, GINT_TO_POINTER (event->event->cookie));
       
       if (event->pair)
 	{
 	  /* We send out paired MOVED_FROM/MOVED_TO events in the same event buffer */
-	  /* g_assert (event->event->mask == IN_MOVED_FROM && event->pair->event->mask == IN_MOVED_TO); */
-	  /* Copy the paired data */
-	  event->pair->sent = TRUE;
 	  event->sent = TRUE;
 	  ik_move_matches++;
 	}
@@ -636,38 +589,67 @@ ik_process_events (void)
 	    event->event->mask = IN_CREATE|(event->event->mask & IN_ISDIR);
 	}
       
-      /* Push the ik_event_t onto the event queue */
-      g_queue_push_tail (event_queue, event->event);
+      user_cb (event->event);
       /* Free the internal event structure */
-      g_free (event);
+      g_slice_free (ik_event_internal_t, event);
+    }
+
+  /* Wake up when the held event at the head of the queue is due */
+  if (process_eq_source != 0)
+    {
+      g_source_remove (process_eq_source);
+      process_eq_source = 0;
+    }
+
+  if (!g_queue_is_empty (events_to_process))
+    {
+      event = g_queue_peek_head (events_to_process);
+      delay = (event->hold_until - now + 999) / 1000;
+      process_eq_source = g_timeout_add (MAX (delay, 1), ik_process_eq_callback, NULL);
     }
 }
 
 static gboolean
-ik_process_eq_callback (gpointer user_data)
+ik_read_callback (gpointer user_data)
 {
-  gboolean res;
+  gchar *buffer;
+  gsize buffer_size, buffer_i;
+  gint64 now;
   
-  /* Try and move as many events to the event queue */
   G_LOCK (inotify_lock);
-  ik_process_events ();
+  ik_read_events (&buffer_size, &buffer);
   
-  while (!g_queue_is_empty (event_queue))
+  now = ik_get_time ();
+  buffer_i = 0;
+  while (buffer_i < buffer_size)
     {
-      ik_event_t *event = g_queue_pop_head (event_queue);
-      
-      user_cb (event);
+      struct inotify_event *event;
+      gsize event_size;
+      event = (struct inotify_event *)&buffer[buffer_i];
+      event_size = sizeof(struct inotify_event) + event->len;
+      ik_queue_event (ik_event_internal_new (ik_event_new (&buffer[buffer_i]), now));
+      buffer_i += event_size;
     }
-
-  res = TRUE;
   
-  if (g_queue_get_length (events_to_process) == 0)
-    {
-      process_eq_running = FALSE;
-      res = FALSE;
-    }
+  /* Deliver everything that doesn't have to wait right away */
+  if (buffer_size > 0)
+    ik_process_events ();
   
   G_UNLOCK (inotify_lock);
   
-  return res;
+  return TRUE;
+}
+
+static gboolean
+ik_process_eq_callback (gpointer user_data)
+{
+  G_LOCK (inotify_lock);
+
+  /* ik_process_events() schedules a new timeout if needed */
+  process_eq_source = 0;
+  ik_process_events ();
+
+  G_UNLOCK (inotify_lock);
+  
+  return FALSE;
 }
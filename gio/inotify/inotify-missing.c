@@ -33,8 +33,12 @@
 static gboolean im_debug_enabled = FALSE;
 #define IM_W if (im_debug_enabled) g_warning
 
-/* We put inotify_sub's that are missing on this list */
-static GList *missing_sub_list = NULL;
+/* We put inotify_sub's that are missing in this table, grouped by
+ * the directory they are waiting for: dirname -> GList of subs.
+ * A directory only needs to be checked once per scan, however many
+ * subscriptions wait for it.
+ */
+static GHashTable *missing_sub_table = NULL;
 static gboolean im_scan_missing (gpointer user_data);
 static gboolean scan_missing_running = FALSE;
 static void (*missing_cb)(inotify_sub *sub) = NULL;
@@ -50,6 +54,7 @@ _im_startup (void (*callback)(inotify_sub *sub))
   if (!initialized)
     {
       missing_cb = callback;
+      missing_sub_table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
       initialized = TRUE;
     }
 }
@@ -58,14 +63,18 @@ _im_startup (void (*callback)(inotify_sub *sub))
 void
 _im_add (inotify_sub *sub)
 {
-  if (g_list_find (missing_sub_list, sub))
+  GList *subs;
+
+  subs = g_hash_table_lookup (missing_sub_table, sub->dirname);
+  if (g_list_find (subs, sub))
     {
       IM_W ("asked to add %s to missing list but it's already on the list!\n", sub->dirname);
       return;
     }
 
   IM_W ("adding %s to missing list\n", sub->dirname);
-  missing_sub_list = g_list_prepend (missing_sub_list, sub);
+  subs = g_list_prepend (subs, sub);
+  g_hash_table_insert (missing_sub_table, g_strdup (sub->dirname), subs);
 
   /* If the timeout is turned off, we turn it back on */
   if (!scan_missing_running)
@@ -79,9 +88,11 @@ _im_add (inotify_sub *sub)
 void
 _im_rm (inotify_sub *sub)
 {
+  GList *subs;
   GList *link;
   
-  link = g_list_find (missing_sub_list, sub);
+  subs = g_hash_table_lookup (missing_sub_table, sub->dirname);
+  link = g_list_find (subs, sub);
 
   if (!link)
     {
@@ -91,54 +102,58 @@ _im_rm (inotify_sub *sub)
 
   IM_W ("removing %s from missing list\n", sub->dirname);
 
-  missing_sub_list = g_list_remove_link (missing_sub_list, link);
-  g_list_free_1 (link);
+  subs = g_list_delete_link (subs, link);
+  if (subs == NULL)
+    g_hash_table_remove (missing_sub_table, sub->dirname);
+  else
+    g_hash_table_insert (missing_sub_table, g_strdup (sub->dirname), subs);
 }
 
-/* Scans the list of missing subscriptions checking if they
- * are available yet.
- */
 static gboolean
-im_scan_missing (gpointer user_data)
+im_scan_dir (gpointer key, 
+             gpointer value, 
+             gpointer user_data)
 {
-  GList *nolonger_missing = NULL;
+  GList *subs = value;
   GList *l;
   
-  G_LOCK (inotify_lock);
-  
-  IM_W ("scanning missing list with %d items\n", g_list_length (missing_sub_list));
-  for (l = missing_sub_list; l; l = l->next)
+  IM_W ("checking %s\n", (char *) key);
+
+  /* Once the first subscription could be watched, the directory
+   * is there and the rest only attach to the same watch.
+   */
+  if (!_ip_start_watching (subs->data))
+    return FALSE;
+
+  for (l = subs->next; l; l = l->next)
+    _ip_start_watching (l->data);
+
+  for (l = subs; l; l = l->next)
     {
       inotify_sub *sub = l->data;
-      gboolean not_m = FALSE;
-      
-      IM_W ("checking %p\n", sub);
-      g_assert (sub);
-      g_assert (sub->dirname);
-      not_m = _ip_start_watching (sub);
-
-      if (not_m)
-	{
-	  missing_cb (sub);
-	  IM_W ("removed %s from missing list\n", sub->dirname);
-	  /* We have to build a list of list nodes to remove from the
-	   * missing_sub_list. We do the removal outside of this loop.
-	   */
-	  nolonger_missing = g_list_prepend (nolonger_missing, l);
-	} 
-    }
 
-  for (l = nolonger_missing; l ; l = l->next)
-    {
-      GList *llink = l->data;
-      missing_sub_list = g_list_remove_link (missing_sub_list, llink);
-      g_list_free_1 (llink);
+      missing_cb (sub);
+      IM_W ("removed %s from missing list\n", sub->dirname);
     }
 
-  g_list_free (nolonger_missing);
+  g_list_free (subs);
+
+  return TRUE;
+}
+
+/* Scans the list of missing subscriptions checking if they
+ * are available yet.
+ */
+static gboolean
+im_scan_missing (gpointer user_data)
+{
+  G_LOCK (inotify_lock);
+  
+  IM_W ("scanning missing list with %d directories\n", g_hash_table_size (missing_sub_table));
+  g_hash_table_foreach_remove (missing_sub_table, im_scan_dir, NULL);
   
   /* If the missing list is now empty, we disable the timeout */
-  if (missing_sub_list == NULL)
+  if (g_hash_table_size (missing_sub_table) == 0)
     {
       scan_missing_running = FALSE;
       G_UNLOCK (inotify_lock);
@@ -151,17 +166,26 @@ im_scan_missing (gpointer user_data)
     }
 }
 
-
-/* inotify_lock must be held */
-void
-_im_diag_dump (GIOChannel *ioc)
+static void
+im_diag_dump_dir (gpointer key, 
+                  gpointer value, 
+                  gpointer user_data)
 {
+  GIOChannel *ioc = user_data;
   GList *l;
-  g_io_channel_write_chars (ioc, "missing list:\n", -1, NULL, NULL);
-  for (l = missing_sub_list; l; l = l->next)
+
+  for (l = value; l; l = l->next)
     {
       inotify_sub *sub = l->data;
       g_io_channel_write_chars (ioc, sub->dirname, -1, NULL, NULL);
       g_io_channel_write_chars (ioc, "\n", -1, NULL, NULL);
     }
 }
+
+/* inotify_lock must be held */
+void
+_im_diag_dump (GIOChannel *ioc)
+{
+  g_io_channel_write_chars (ioc, "missing list:\n", -1, NULL, NULL);
+  g_hash_table_foreach (missing_sub_table, im_diag_dump_dir, ioc);
+}
@@ -54,8 +54,12 @@ typedef struct ip_watched_dir_s {
   /* Inotify state */
   gint32 wd;
   
-  /* List of inotify subscriptions */
+  /* List of inotify subscriptions for the whole directory */
   GList *subs;
+  /* filename -> GList of subscriptions for a single file in it,
+   * so that an event only looks at the subscriptions it matches
+   */
+  GHashTable *file_subs;
 } ip_watched_dir_t;
 
 static gboolean     ip_debug_enabled = FALSE;
@@ -118,10 +122,29 @@ static void
 ip_map_sub_dir (inotify_sub      *sub, 
                 ip_watched_dir_t *dir)
 {
+  GList *file_list;
+
   /* Associate subscription and directory */
   g_assert (dir && sub);
   g_hash_table_insert (sub_dir_hash, sub, dir);
-  dir->subs = g_list_prepend (dir->subs, sub);
+
+  if (sub->filename)
+    {
+      if (dir->file_subs == NULL)
+	dir->file_subs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      file_list = g_hash_table_lookup (dir->file_subs, sub->filename);
+      file_list = g_list_prepend (file_list, sub);
+      g_hash_table_insert (dir->file_subs, g_strdup (sub->filename), file_list);
+    }
+  else
+    dir->subs = g_list_prepend (dir->subs, sub);
+}
+
+static gboolean
+ip_watched_dir_has_subs (ip_watched_dir_t *dir)
+{
+  return dir->subs != NULL ||
+    (dir->file_subs != NULL && g_hash_table_size (dir->file_subs) > 0);
 }
 
 static void
@@ -219,23 +242,54 @@ static void
 ip_unmap_sub_dir (inotify_sub       *sub, 
                   ip_watched_dir_t *dir)
 {
+  GList *file_list;
+
   g_assert (sub && dir);
   g_hash_table_remove (sub_dir_hash, sub);
-  dir->subs = g_list_remove (dir->subs, sub);
+
+  if (sub->filename)
+    {
+      file_list = g_hash_table_lookup (dir->file_subs, sub->filename);
+      file_list = g_list_remove (file_list, sub);
+      if (file_list == NULL)
+	g_hash_table_remove (dir->file_subs, sub->filename);
+      else
+	g_hash_table_insert (dir->file_subs, g_strdup (sub->filename), file_list);
+    }
+  else
+    dir->subs = g_list_remove (dir->subs, sub);
+}
+
+static void
+ip_unmap_sub (gpointer data, 
+              gpointer user_data)
+{
+  g_hash_table_remove (sub_dir_hash, data);
+}
+
+static void
+ip_unmap_file_subs (gpointer key, 
+                    gpointer value, 
+                    gpointer user_data)
+{
+  GList *file_list = value;
+
+  g_list_foreach (file_list, ip_unmap_sub, NULL);
+  g_list_free (file_list);
 }
 
 static void
 ip_unmap_all_subs (ip_watched_dir_t *dir)
 {
-  GList *l = NULL;
-  
-  for (l = dir->subs; l; l = l->next)
-    {
-      inotify_sub *sub = l->data;
-      g_hash_table_remove (sub_dir_hash, sub);
-    }
+  g_list_foreach (dir->subs, ip_unmap_sub, NULL);
   g_list_free (dir->subs);
   dir->subs = NULL;
+
+  if (dir->file_subs)
+    {
+      g_hash_table_foreach (dir->file_subs, ip_unmap_file_subs, NULL);
+      g_hash_table_remove_all (dir->file_subs);
+    }
 }
 
 gboolean
@@ -250,7 +304,7 @@ _ip_stop_watching (inotify_sub *sub)
   ip_unmap_sub_dir (sub, dir);
   
   /* No one is subscribing to this directory any more */
-  if (dir->subs == NULL)
+  if (!ip_watched_dir_has_subs (dir))
     {
       _ik_ignore (dir->path, dir->wd);
       ip_unmap_wd_dir (dir->wd, dir);
@@ -277,24 +331,38 @@ ip_watched_dir_new (const char *path,
 static void
 ip_watched_dir_free (ip_watched_dir_t *dir)
 {
-  g_assert (dir->subs == NULL);
+  g_assert (!ip_watched_dir_has_subs (dir));
+  if (dir->file_subs)
+    g_hash_table_destroy (dir->file_subs);
   g_free (dir->path);
   g_free (dir);
 }
 
+static void
+ip_add_missing (gpointer data, 
+                gpointer user_data)
+{
+  _im_add (data);
+}
+
+static void
+ip_add_missing_file_subs (gpointer key, 
+                          gpointer value, 
+                          gpointer user_data)
+{
+  g_list_foreach (value, ip_add_missing, NULL);
+}
+
 static void
 ip_wd_delete (gpointer data, 
               gpointer user_data)
 {
   ip_watched_dir_t *dir = data;
-  GList *l = NULL;
   
-  for (l = dir->subs; l; l = l->next)
-    {
-      inotify_sub *sub = l->data;
-      /* Add subscription to missing list */
-      _im_add (sub);
-    }
+  /* Add subscriptions to missing list */
+  g_list_foreach (dir->subs, ip_add_missing, NULL);
+  if (dir->file_subs)
+    g_hash_table_foreach (dir->file_subs, ip_add_missing_file_subs, NULL);
   ip_unmap_all_subs (dir);
   /* Unassociate the path and the directory */
   ip_unmap_path_dir (dir->path, dir);
@@ -302,85 +370,76 @@ ip_wd_delete (gpointer data,
 }
 
 static void
-ip_event_dispatch (GList      *dir_list, 
-                   GList      *pair_dir_list, 
-                   ik_event_t *event)
+ip_collect_subs (GList       *dir_list, 
+                 const char  *name, 
+                 GPtrArray   *subs)
 {
-  GList *dirl;
-  
-  if (!event)
-    return;
+  GList *dirl, *subl;
 
   for (dirl = dir_list; dirl; dirl = dirl->next)
     {
-      GList *subl;
       ip_watched_dir_t *dir = dirl->data;
       
       for (subl = dir->subs; subl; subl = subl->next)
+	g_ptr_array_add (subs, subl->data);
+
+      /* Subscriptions with a filename only get
+       * events for that name.
+       *
+       * FIXME: We might need to synthesize
+       * DELETE/UNMOUNT events when
+       * the filename doesn't match
+       */
+      if (dir->file_subs && name && *name)
 	{
-	  inotify_sub *sub = subl->data;
-	  
-	  /* If the subscription and the event
-	   * contain a filename and they don't
-	   * match, we don't deliver this event.
-	   */
-	  if (sub->filename &&
-	      event->name &&
-	      strcmp (sub->filename, event->name))
-	    continue;
-	  
-	  /* If the subscription has a filename
-	   * but this event doesn't, we don't
-	   * deliever this event.
-	   */
-	  if (sub->filename && !event->name)
-	    continue;
-	  
-	  /* FIXME: We might need to synthesize
-	   * DELETE/UNMOUNT events when
-	   * the filename doesn't match
-	   */
-	  
-	  event_callback (event, sub);
+	  subl = g_hash_table_lookup (dir->file_subs, name);
+	  for (; subl; subl = subl->next)
+	    g_ptr_array_add (subs, subl->data);
 	}
     }
+}
+
+static void
+ip_deliver (GPtrArray  *subs, 
+            ik_event_t *event)
+{
+  guint i;
+
+  /* The callback may cancel subscriptions, but they are
+   * only freed later, so checking the flag is enough
+   */
+  for (i = 0; i < subs->len; i++)
+    {
+      inotify_sub *sub = g_ptr_array_index (subs, i);
+
+      if (!sub->cancelled)
+	event_callback (event, sub);
+    }
+}
+
+static void
+ip_event_dispatch (GList      *dir_list, 
+                   GList      *pair_dir_list, 
+                   ik_event_t *event)
+{
+  static GPtrArray *subs = NULL;
+  
+  if (!event)
+    return;
+
+  if (subs == NULL)
+    subs = g_ptr_array_new ();
+
+  ip_collect_subs (dir_list, event->name, subs);
+  ip_deliver (subs, event);
+  g_ptr_array_set_size (subs, 0);
   
   if (!event->pair)
     return;
   
-  for (dirl = pair_dir_list; dirl; dirl = dirl->next)
-    {
-      GList *subl;
-      ip_watched_dir_t *dir = dirl->data;
-      
-      for (subl = dir->subs; subl; subl = subl->next)
-	{
-	  inotify_sub *sub = subl->data;
-	  
-	  /* If the subscription and the event
-	   * contain a filename and they don't
-	   * match, we don't deliver this event.
-	   */
-	  if (sub->filename &&
-	      event->pair->name &&
-	      strcmp (sub->filename, event->pair->name))
-	    continue;
-	  
-	  /* If the subscription has a filename
-	   * but this event doesn't, we don't
-	   * deliever this event.
-	   */
-	  if (sub->filename && !event->pair->name)
-	    continue;
-	  
-	  /* FIXME: We might need to synthesize
-	   * DELETE/UNMOUNT events when
-	   * the filename doesn't match
-	   */
-	  
-	  event_callback (event->pair, sub);
-	}
-    }
+  ip_collect_subs (pair_dir_list, event->pair->name, subs);
+  ip_deliver (subs, event->pair);
+  g_ptr_array_set_size (subs, 0);
 }
 
 static void
@@ -30,6 +30,9 @@ typedef struct
 	gchar*   filename;
 	gboolean cancelled;
 	gpointer user_data;
+	/* Recursive monitoring, see inotify-helper.c */
+	gboolean recursive;
+	gpointer tree_dir;
 } inotify_sub;
 
 inotify_sub* _ih_sub_new (const gchar* dirname, const gchar* filename, gpointer user_data);
@@ -0,0 +1,412 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+#include <glib/glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <sys/resource.h>
+#include <string.h>
+#include <unistd.h>
+
+#define N_READS 1000
+#define RECORD_SIZE 16
+
+typedef struct
+{
+  GMainLoop *loop;
+  int pending;
+} ReadState;
+
+typedef struct
+{
+  ReadState *state;
+  int index;
+  char buffer[RECORD_SIZE];
+} Read;
+
+/* record i of the file is "record %08d\n" with i filled in */
+static char *
+create_record_file (int n_records)
+{
+  GError *error = NULL;
+  GString *contents;
+  char *filename;
+  int fd, i;
+
+  contents = g_string_new (NULL);
+  for (i = 0; i < n_records; i++)
+    g_string_append_printf (contents, "record %08d\n", i);
+  g_assert_cmpint (contents->len, ==, n_records * RECORD_SIZE);
+
+  fd = g_file_open_tmp ("async-file-io-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (filename, contents->str, contents->len, &error);
+  g_assert_no_error (error);
+  g_string_free (contents, TRUE);
+
+  return filename;
+}
+
+/* one stream per read needs an fd each */
+static int
+get_n_reads (void)
+{
+  struct rlimit limit;
+
+  if (getrlimit (RLIMIT_NOFILE, &limit) == 0 &&
+      limit.rlim_cur < N_READS + 64)
+    {
+      limit.rlim_cur = MIN (limit.rlim_max, N_READS + 64);
+      setrlimit (RLIMIT_NOFILE, &limit);
+      getrlimit (RLIMIT_NOFILE, &limit);
+    }
+
+  if (limit.rlim_cur < N_READS + 64)
+    {
+      g_test_message ("only %d file descriptors available",
+                      (int) limit.rlim_cur);
+      return limit.rlim_cur - 64;
+    }
+
+  return N_READS;
+}
+
+static void
+read_done (GObject      *source,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+  Read *data = user_data;
+  GError *error = NULL;
+  char expected[RECORD_SIZE + 1];
+  gssize res;
+
+  res = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, RECORD_SIZE);
+
+  g_snprintf (expected, sizeof (expected), "record %08d\n", data->index);
+  g_assert (memcmp (data->buffer, expected, RECORD_SIZE) == 0);
+  g_assert_cmpint (g_seekable_tell (G_SEEKABLE (source)), ==,
+                   (data->index + 1) * RECORD_SIZE);
+
+  if (--data->state->pending == 0)
+    g_main_loop_quit (data->state->loop);
+}
+
+static void
+test_concurrent_reads (void)
+{
+  ReadState state;
+  GFileInputStream **streams;
+  GError *error = NULL;
+  GFile *file;
+  Read *reads;
+  char *filename;
+  int n_reads, i;
+
+  n_reads = get_n_reads ();
+  filename = create_record_file (n_reads);
+  file = g_file_new_for_path (filename);
+
+  state.loop = g_main_loop_new (NULL, FALSE);
+  state.pending = n_reads;
+
+  /* start all reads before any of them can complete */
+  streams = g_new (GFileInputStream *, n_reads);
+  reads = g_new0 (Read, n_reads);
+  for (i = 0; i < n_reads; i++)
+    {
+      streams[i] = g_file_read (file, NULL, &error);
+      g_assert_no_error (error);
+      g_seekable_seek (G_SEEKABLE (streams[i]), i * RECORD_SIZE,
+                       G_SEEK_SET, NULL, &error);
+      g_assert_no_error (error);
+
+      reads[i].state = &state;
+      reads[i].index = i;
+      g_input_stream_read_async (G_INPUT_STREAM (streams[i]),
+                                 reads[i].buffer, RECORD_SIZE,
+                                 G_PRIORITY_DEFAULT, NULL,
+                                 read_done, &reads[i]);
+    }
+
+  g_main_loop_run (state.loop);
+  g_assert_cmpint (state.pending, ==, 0);
+
+  for (i = 0; i < n_reads; i++)
+    g_object_unref (streams[i]);
+  g_free (streams);
+  g_free (reads);
+  g_main_loop_unref (state.loop);
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
+typedef struct
+{
+  GMainLoop *loop;
+  GOutputStream *out;
+  GInputStream *in;
+  const char *data;
+  gsize length;
+  gsize offset;
+  char *buffer;
+} CopyState;
+
+static void
+copy_read_done (GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  CopyState *state = user_data;
+  GError *error = NULL;
+  gssize res;
+
+  res = g_input_stream_read_finish (state->in, result, &error);
+  g_assert_no_error (error);
+
+  if (res == 0)
+    {
+      g_main_loop_quit (state->loop);
+      return;
+    }
+
+  state->offset += res;
+  g_input_stream_read_async (state->in, state->buffer + state->offset, 1000,
+                             G_PRIORITY_DEFAULT, NULL,
+                             copy_read_done, state);
+}
+
+static void
+copy_write_done (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  CopyState *state = user_data;
+  GError *error = NULL;
+  gssize res;
+
+  res = g_output_stream_write_finish (state->out, result, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, >, 0);
+
+  state->offset += res;
+  if (state->offset < state->length)
+    {
+      g_output_stream_write_async (state->out, state->data + state->offset,
+                                   MIN (1000, state->length - state->offset),
+                                   G_PRIORITY_DEFAULT, NULL,
+                                   copy_write_done, state);
+      return;
+    }
+
+  g_main_loop_quit (state->loop);
+}
+
+static void
+test_write_read (void)
+{
+  CopyState state = { 0, };
+  GError *error = NULL;
+  GFile *file;
+  char *filename;
+  GString *data;
+  int fd, i;
+
+  data = g_string_new (NULL);
+  for (i = 0; i < 10000; i++)
+    g_string_append_printf (data, "%d ", i);
+
+  fd = g_file_open_tmp ("async-file-io-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+  file = g_file_new_for_path (filename);
+
+  /* chunks written one after the other must land back to back */
+  state.loop = g_main_loop_new (NULL, FALSE);
+  state.data = data->str;
+  state.length = data->len;
+  state.out = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
+                                               G_FILE_CREATE_NONE,
+                                               NULL, &error));
+  g_assert_no_error (error);
+  g_output_stream_write_async (state.out, state.data, 1000,
+                               G_PRIORITY_DEFAULT, NULL,
+                               copy_write_done, &state);
+  g_main_loop_run (state.loop);
+  g_assert_cmpint (state.offset, ==, data->len);
+  g_output_stream_close (state.out, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (state.out);
+
+  /* and reads continue where the previous one stopped */
+  state.offset = 0;
+  state.buffer = g_malloc (data->len + 1000);
+  state.in = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+  g_assert_no_error (error);
+  g_input_stream_read_async (state.in, state.buffer, 1000,
+                             G_PRIORITY_DEFAULT, NULL,
+                             copy_read_done, &state);
+  g_main_loop_run (state.loop);
+  g_assert_cmpint (state.offset, ==, data->len);
+  g_assert (memcmp (state.buffer, data->str, data->len) == 0);
+  g_object_unref (state.in);
+
+  g_free (state.buffer);
+  g_main_loop_unref (state.loop);
+  g_string_free (data, TRUE);
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
+static void
+writev_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  GError *error = NULL;
+  gssize res;
+
+  res = g_output_stream_writev_finish (G_OUTPUT_STREAM (source), result, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, 2 * RECORD_SIZE);
+
+  g_main_loop_quit (user_data);
+}
+
+static void
+test_writev (void)
+{
+  GOutputVector vectors[2] = {
+    { "record 00000000\n", RECORD_SIZE },
+    { "record 00000001\n", RECORD_SIZE }
+  };
+  GFileOutputStream *out;
+  GMainLoop *loop;
+  GError *error = NULL;
+  GFile *file;
+  char *filename, *contents;
+  gsize length;
+  gssize res;
+  int fd;
+
+  fd = g_file_open_tmp ("async-file-io-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+  file = g_file_new_for_path (filename);
+
+  out = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error);
+  g_assert_no_error (error);
+
+  res = g_output_stream_writev (G_OUTPUT_STREAM (out), vectors, 2, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, 2 * RECORD_SIZE);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_output_stream_writev_async (G_OUTPUT_STREAM (out), vectors, 2,
+                                G_PRIORITY_DEFAULT, NULL, writev_done, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+
+  g_assert_cmpint (g_seekable_tell (G_SEEKABLE (out)), ==, 4 * RECORD_SIZE);
+  g_output_stream_close (G_OUTPUT_STREAM (out), NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (out);
+
+  g_file_get_contents (filename, &contents, &length, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (length, ==, 4 * RECORD_SIZE);
+  g_assert (memcmp (contents, "record 00000000\nrecord 00000001\n"
+                              "record 00000000\nrecord 00000001\n", length) == 0);
+  g_free (contents);
+
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
+static void
+cancelled_read_done (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  GError *error = NULL;
+  gssize res;
+
+  res = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_cmpint (res, ==, -1);
+  g_error_free (error);
+
+  g_main_loop_quit (user_data);
+}
+
+static void
+test_cancelled_read (void)
+{
+  GCancellable *cancellable;
+  GFileInputStream *in;
+  GMainLoop *loop;
+  GError *error = NULL;
+  GFile *file;
+  char *filename;
+  char buffer[RECORD_SIZE];
+
+  filename = create_record_file (1);
+  file = g_file_new_for_path (filename);
+  in = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+  loop = g_main_loop_new (NULL, FALSE);
+  g_input_stream_read_async (G_INPUT_STREAM (in), buffer, sizeof (buffer),
+                             G_PRIORITY_DEFAULT, cancellable,
+                             cancelled_read_done, loop);
+  g_main_loop_run (loop);
+
+  g_main_loop_unref (loop);
+  g_object_unref (cancellable);
+  g_object_unref (in);
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_thread_init (NULL);
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/async-file-io/concurrent-reads", test_concurrent_reads);
+  g_test_add_func ("/async-file-io/write-read", test_write_read);
+  g_test_add_func ("/async-file-io/writev", test_writev);
+  g_test_add_func ("/async-file-io/cancelled-read", test_cancelled_read);
+
+  return g_test_run ();
+}
@@ -45,6 +45,134 @@ test_read_byte (void)
   g_assert_cmpint (g_buffered_input_stream_read_byte (G_BUFFERED_INPUT_STREAM (in), NULL, NULL), ==, 'g');
 }
 
+static void
+test_fill_in_place (void)
+{
+  GInputStream *base;
+  GInputStream *in;
+  const char *before, *after;
+  char buffer[8];
+  gsize count;
+  int i;
+
+  base = g_memory_input_stream_new_from_data ("0123456789abcdefghijklmnopqrstuvwxyz", -1, NULL);
+  in = g_buffered_input_stream_new_sized (base, 16);
+
+  g_assert_cmpint (g_buffered_input_stream_fill (G_BUFFERED_INPUT_STREAM (in), 8, NULL, NULL), ==, 8);
+  g_assert_cmpint (g_input_stream_read (in, buffer, 2, NULL, NULL), ==, 2);
+
+  /* there is enough room after the data, so it stays where it is */
+  before = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (in), &count);
+  g_assert_cmpint (count, ==, 6);
+  g_assert_cmpint (g_buffered_input_stream_fill (G_BUFFERED_INPUT_STREAM (in), -1, NULL, NULL), ==, 8);
+  after = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (in), &count);
+  g_assert (before == after);
+  g_assert_cmpint (count, ==, 14);
+  g_assert (memcmp (after, "23456789abcdef", count) == 0);
+
+  /* only a nearly full buffer gets compacted */
+  g_assert_cmpint (g_input_stream_read (in, buffer, 8, NULL, NULL), ==, 8);
+  g_assert_cmpint (g_buffered_input_stream_fill (G_BUFFERED_INPUT_STREAM (in), -1, NULL, NULL), ==, 10);
+  after = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (in), &count);
+  g_assert_cmpint (count, ==, 16);
+  g_assert (memcmp (after, "abcdefghijklmnop", count) == 0);
+
+  for (i = 0; i < 2; i++)
+    g_assert_cmpint (g_input_stream_read (in, buffer, 8, NULL, NULL), ==, 8);
+  g_assert_cmpint (g_input_stream_read (in, buffer, 8, NULL, NULL), ==, 8);
+  g_assert (memcmp (buffer, "qrstuvwx", 8) == 0);
+
+  g_object_unref (in);
+  g_object_unref (base);
+}
+
+static void
+test_fill_small_buffer (void)
+{
+  GInputStream *base;
+  GInputStream *in;
+  GString *data;
+  const char *rest;
+  char buffer[1];
+  gsize count, size;
+
+  /* a full tail in a tiny buffer still gets room to fill */
+  for (size = 2; size <= 3; size++)
+    {
+      base = g_memory_input_stream_new_from_data ("abcdefghijk", -1, NULL);
+      in = g_buffered_input_stream_new_sized (base, size);
+      data = g_string_new (NULL);
+
+      /* fill only returns 0 at the end of the stream */
+      while (g_buffered_input_stream_fill (G_BUFFERED_INPUT_STREAM (in), -1, NULL, NULL) > 0)
+        {
+          g_assert_cmpint (g_input_stream_read (in, buffer, 1, NULL, NULL), ==, 1);
+          g_string_append_c (data, buffer[0]);
+        }
+
+      rest = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (in), &count);
+      g_string_append_len (data, rest, count);
+      g_assert_cmpstr (data->str, ==, "abcdefghijk");
+
+      g_string_free (data, TRUE);
+      g_object_unref (in);
+      g_object_unref (base);
+    }
+}
+
+static void
+test_readahead (void)
+{
+  GInputStream *base;
+  GInputStream *in;
+  char *data;
+  char buffer[1024];
+  gsize size = 1024 * 1024, i;
+
+  data = g_malloc (size);
+  for (i = 0; i < size; i++)
+    data[i] = i % 251;
+
+  /* sequential reads grow the default buffer */
+  base = g_memory_input_stream_new_from_data (data, size, NULL);
+  in = g_buffered_input_stream_new (base);
+  g_assert_cmpint (g_buffered_input_stream_get_buffer_size (G_BUFFERED_INPUT_STREAM (in)), ==, 4096);
+
+  for (i = 0; i < size; i += sizeof (buffer))
+    {
+      g_assert_cmpint (g_input_stream_read (in, buffer, sizeof (buffer), NULL, NULL), ==, sizeof (buffer));
+      g_assert (memcmp (buffer, data + i, sizeof (buffer)) == 0);
+    }
+  g_assert_cmpint (g_input_stream_read (in, buffer, sizeof (buffer), NULL, NULL), ==, 0);
+  g_assert_cmpint (g_buffered_input_stream_get_buffer_size (G_BUFFERED_INPUT_STREAM (in)), ==, 64 * 1024);
+
+  g_object_unref (in);
+  g_object_unref (base);
+
+  /* but an explicitly chosen size is kept */
+  base = g_memory_input_stream_new_from_data (data, size, NULL);
+  in = g_buffered_input_stream_new_sized (base, 2048);
+
+  for (i = 0; i < size; i += sizeof (buffer))
+    g_assert_cmpint (g_input_stream_read (in, buffer, sizeof (buffer), NULL, NULL), ==, sizeof (buffer));
+  g_assert_cmpint (g_buffered_input_stream_get_buffer_size (G_BUFFERED_INPUT_STREAM (in)), ==, 2048);
+
+  g_object_unref (in);
+  g_object_unref (base);
+
+  /* even when it happens to be the default size */
+  base = g_memory_input_stream_new_from_data (data, size, NULL);
+  in = g_buffered_input_stream_new_sized (base, 4096);
+
+  for (i = 0; i < size; i += sizeof (buffer))
+    g_assert_cmpint (g_input_stream_read (in, buffer, sizeof (buffer), NULL, NULL), ==, sizeof (buffer));
+  g_assert_cmpint (g_buffered_input_stream_get_buffer_size (G_BUFFERED_INPUT_STREAM (in)), ==, 4096);
+
+  g_object_unref (in);
+  g_object_unref (base);
+  g_free (data);
+}
+
 
 int
 main (int   argc,
@@ -55,6 +183,9 @@ main (int   argc,
   g_test_bug_base ("http://bugzilla.gnome.org/");
 
   g_test_add_func ("/buffered-input-stream/read-byte", test_read_byte);
+  g_test_add_func ("/buffered-input-stream/fill-in-place", test_fill_in_place);
+  g_test_add_func ("/buffered-input-stream/fill-small-buffer", test_fill_small_buffer);
+  g_test_add_func ("/buffered-input-stream/readahead", test_readahead);
 
   return g_test_run();
 }
@@ -0,0 +1,741 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+#include <glib/glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The tests run against a private mime database in a temporary
+ * directory, set up in main() before GIO looks at the environment.
+ * Besides the globs and magic below, it has N_EXTENSIONS made up
+ * extensions and N_MAGIC made up magic rules, to give the matchers
+ * a realistic size.
+ */
+static char *data_dir;
+static char *globs;
+
+#define GLOBS \
+  "text/plain:*.txt\n" \
+  "image/png:*.png\n" \
+  "application/x-foo:*.foo\n" \
+  "application/x-gzip:*.gz\n" \
+  "application/x-compressed-tar:*.tar.gz\n" \
+  "text/x-utf8:*.\303\251t\303\251\n" \
+  "text/x-makefile:Makefile\n" \
+  "text/x-makefile:Makefile.*\n" \
+  "text/x-readme:README*\n" \
+  "application/x-troff-man:*.[1-9]\n" \
+  "video/x-anim:*.anim[1-9j]\n" \
+  "video/x-vdr:[0-9][0-9][0-9].vdr\n" \
+  "application/x-sharedlib:*.so.[0-9]*\n"
+
+#define SUBCLASSES \
+  "application/x-foo text/plain\n"
+
+#define FOO_XML \
+  "<?xml version=\"1.0\"?>\n" \
+  "<mime-info xmlns=\"http://www.freedesktop.org/standards/shared-mime-info\">\n" \
+  "  <mime-type type=\"application/x-foo\">\n" \
+  "    <comment>Foo document</comment>\n" \
+  "    <comment xml:lang=\"xx\">Foo xx</comment>\n" \
+  "  </mime-type>\n" \
+  "</mime-info>\n"
+
+#define ICONS \
+  "application/x-foo:foo-icon\n"
+
+#define GENERIC_ICONS \
+  "application/x-foo:foo-x-generic\n"
+
+#define TREEMAGIC \
+  "MIME-TreeMagic\0\n" \
+  "[50:x-content/foo]\n" \
+  ">\"foo.dir\"=directory\n" \
+  "1>\"foo.dir/bar\"=file\n"
+
+#define N_EXTENSIONS 1000
+
+#define N_MAGIC 500
+
+#define N_THREADS 4
+#define N_GUESSES 100000
+
+#define N_NAMES 1000
+#define N_CLASSIFICATIONS 1000000
+
+#define SAMPLE_SIZE 1024
+#define N_SNIFFS 100000
+
+static void
+write_mime_file (const char *name,
+		 const char *contents,
+		 gssize      length)
+{
+  GError *error = NULL;
+  char *path;
+
+  path = g_build_filename (data_dir, "mime", name, NULL);
+  g_file_set_contents (path, contents, length, &error);
+  g_assert_no_error (error);
+  g_free (path);
+}
+
+static void
+append_magic_header (GString    *magic,
+		     int         priority,
+		     const char *mime_type)
+{
+  g_string_append_printf (magic, "[%d:%s]\n", priority, mime_type);
+}
+
+static void
+append_magic_line (GString    *magic,
+		   int         indent,
+		   int         offset,
+		   const char *value,
+		   int         length,
+		   const char *mask,
+		   int         range)
+{
+  if (indent > 0)
+    g_string_append_printf (magic, "%d", indent);
+  g_string_append_printf (magic, ">%d=", offset);
+  g_string_append_c (magic, length >> 8);
+  g_string_append_c (magic, length & 0xff);
+  g_string_append_len (magic, value, length);
+  if (mask != NULL)
+    {
+      g_string_append_c (magic, '&');
+      g_string_append_len (magic, mask, length);
+    }
+  if (range > 1)
+    g_string_append_printf (magic, "+%d", range);
+  g_string_append_c (magic, '\n');
+}
+
+static void
+make_magic_value (int   i,
+		  char *value)
+{
+  value[0] = (i * 37 + 11) & 0xff;
+  value[1] = 'm';
+  value[2] = 'g';
+  value[3] = i & 0xff;
+  value[4] = i >> 8;
+}
+
+static void
+append_magic (GString *magic)
+{
+  char value[5];
+  char *type;
+  int i;
+
+  append_magic_header (magic, 90, "application/x-nested");
+  append_magic_line (magic, 0, 0, "NEST", 4, NULL, 1);
+  append_magic_line (magic, 1, 8, "ok", 2, NULL, 1);
+  append_magic_header (magic, 80, "application/x-masked");
+  append_magic_line (magic, 0, 0, "\312\360", 2, "\377\360", 1);
+  append_magic_header (magic, 70, "application/x-ranged");
+  append_magic_line (magic, 0, 0, "<?foo", 5, NULL, 64);
+  append_magic_header (magic, 60, "application/x-lowmask");
+  append_magic_line (magic, 0, 12, "\340", 1, "\360", 1);
+  append_magic_header (magic, 50, "image/png");
+  append_magic_line (magic, 0, 0, "\211PNG\r\n\032\n", 8, NULL, 1);
+  append_magic_header (magic, 50, "application/x-gzip");
+  append_magic_line (magic, 0, 0, "\037\213", 2, NULL, 1);
+  append_magic_header (magic, 40, "application/x-alt");
+  append_magic_line (magic, 0, 4, "ALT1", 4, NULL, 1);
+  append_magic_line (magic, 0, 16, "ALT2", 4, NULL, 1);
+
+  for (i = 0; i < N_MAGIC; i++)
+    {
+      type = g_strdup_printf ("application/x-magic%d", i);
+      make_magic_value (i, value);
+      append_magic_header (magic, 45, type);
+      append_magic_line (magic, 0, i % 16, value, sizeof (value), NULL, i % 10 == 0 ? 8 : 1);
+      g_free (type);
+    }
+}
+
+static void
+remove_mime_file (const char *name)
+{
+  char *path;
+
+  path = g_build_filename (data_dir, "mime", name, NULL);
+  g_unlink (path);
+  g_free (path);
+}
+
+static void
+test_guess (void)
+{
+  gboolean uncertain;
+  char *type;
+
+  type = g_content_type_guess ("foo.txt", NULL, 0, &uncertain);
+  g_assert_cmpstr (type, ==, "text/plain");
+  g_assert (!uncertain);
+  g_free (type);
+
+  type = g_content_type_guess ("/some/dir/picture.png", NULL, 0, &uncertain);
+  g_assert_cmpstr (type, ==, "image/png");
+  g_free (type);
+
+  type = g_content_type_guess ("unknown", (const guchar *) "hello", 5, &uncertain);
+  g_assert_cmpstr (type, ==, "text/plain");
+  g_free (type);
+
+  g_assert (g_content_type_is_a ("application/x-foo", "text/plain"));
+  g_assert (!g_content_type_is_a ("image/png", "text/plain"));
+}
+
+static void
+assert_guess (const char *file_name,
+	      const char *expected)
+{
+  char *type;
+
+  type = g_content_type_guess (file_name, NULL, 0, NULL);
+  g_assert_cmpstr (type, ==, expected);
+  g_free (type);
+}
+
+static void
+test_globs (void)
+{
+  /* suffixes, longest match first, then case insensitive */
+  assert_guess ("file.ext42", "application/x-ext42");
+  assert_guess ("file.tar.gz", "application/x-compressed-tar");
+  assert_guess ("file.gz", "application/x-gzip");
+  assert_guess ("FILE.TXT", "text/plain");
+  assert_guess ("fiche.\303\251t\303\251", "text/x-utf8");
+  assert_guess (".txt", "text/plain");
+  assert_guess ("txt", "application/octet-stream");
+
+  /* literals, and full globs when no suffix matches */
+  assert_guess ("Makefile", "text/x-makefile");
+  assert_guess ("Makefile.am", "text/x-makefile");
+  assert_guess ("README", "text/x-readme");
+  assert_guess ("README.txt", "text/plain");
+  assert_guess ("ls.1", "application/x-troff-man");
+  assert_guess ("ls.0", "application/octet-stream");
+  assert_guess ("logo.anim7", "video/x-anim");
+  assert_guess ("logo.animj", "video/x-anim");
+  assert_guess ("logo.animk", "application/octet-stream");
+  assert_guess ("123.vdr", "video/x-vdr");
+  assert_guess ("12a.vdr", "application/octet-stream");
+  assert_guess ("libfoo.so.0", "application/x-sharedlib");
+  assert_guess ("libfoo.so.2.0", "application/x-sharedlib");
+  assert_guess ("libfoo.so", "application/octet-stream");
+
+  /* file names are bytes, not necessarily UTF-8 */
+  assert_guess ("READ\360", "application/octet-stream");
+  assert_guess ("README\360", "text/x-readme");
+  assert_guess ("fi\377le.txt", "text/plain");
+  assert_guess ("file.t\303", "application/octet-stream");
+  assert_guess ("\251.txt", "text/plain");
+  assert_guess ("logo.anim\342\202", "application/octet-stream");
+}
+
+static void
+test_glob_performance (void)
+{
+  char *names[N_NAMES];
+  double elapsed;
+  char *type;
+  int i;
+
+  if (!g_test_perf ())
+    return;
+
+  for (i = 0; i < N_NAMES; i++)
+    {
+      switch (i % 5)
+	{
+	case 0:
+	  names[i] = g_strdup_printf ("file%d.ext%d", i, i % N_EXTENSIONS);
+	  break;
+	case 1:
+	  names[i] = g_strdup_printf ("Picture %d.PNG", i);
+	  break;
+	case 2:
+	  names[i] = g_strdup_printf ("page%d.%d", i, i % 10);
+	  break;
+	case 3:
+	  names[i] = g_strdup_printf ("libfoo-%d.so.%d", i, i % 10);
+	  break;
+	default:
+	  names[i] = g_strdup_printf ("no extension %d", i);
+	  break;
+	}
+    }
+
+  g_test_timer_start ();
+  for (i = 0; i < N_CLASSIFICATIONS; i++)
+    {
+      type = g_content_type_guess (names[i % N_NAMES], NULL, 0, NULL);
+      g_free (type);
+    }
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_maximized_result (N_CLASSIFICATIONS / elapsed,
+			   "%.0f file names/s", N_CLASSIFICATIONS / elapsed);
+
+  for (i = 0; i < N_NAMES; i++)
+    g_free (names[i]);
+}
+
+static void
+assert_sniff (const char *data,
+	      gsize       length,
+	      const char *expected)
+{
+  char *type;
+
+  type = g_content_type_guess (NULL, (const guchar *) data, length, NULL);
+  g_assert_cmpstr (type, ==, expected);
+  g_free (type);
+}
+
+static void
+make_magic_sample (int   i,
+		   char *data)
+{
+  memset (data, 0, SAMPLE_SIZE);
+  make_magic_value (i, data + i % 16 + (i % 10 == 0 ? 5 : 0));
+}
+
+static void
+test_magic (void)
+{
+  char data[SAMPLE_SIZE];
+
+  assert_sniff ("NEST....ok", 10, "application/x-nested");
+  assert_sniff ("NEST....no", 10, "text/plain");
+  assert_sniff ("\312\363\0\0", 4, "application/x-masked");
+  assert_sniff ("\312\343\0\0", 4, "application/octet-stream");
+  assert_sniff ("0123456789<?foo", 15, "application/x-ranged");
+  assert_sniff ("<?fo", 4, "text/plain");
+  assert_sniff ("abcdefghijkl\345\0", 14, "application/x-lowmask");
+  assert_sniff ("\211PNG\r\n\032\n\0\0", 10, "image/png");
+  assert_sniff ("\211PN\0", 4, "application/octet-stream");
+  assert_sniff ("\037\213\010\0", 4, "application/x-gzip");
+  assert_sniff ("....ALT1", 8, "application/x-alt");
+  assert_sniff ("................ALT2", 20, "application/x-alt");
+  assert_sniff ("....ALT2........ALT1", 20, "text/plain");
+
+  make_magic_sample (123, data);
+  assert_sniff (data, SAMPLE_SIZE, "application/x-magic123");
+  make_magic_sample (120, data);
+  assert_sniff (data, SAMPLE_SIZE, "application/x-magic120");
+}
+
+static void
+test_magic_performance (void)
+{
+  char samples[5][SAMPLE_SIZE];
+  double elapsed;
+  char *type;
+  int i;
+
+  if (!g_test_perf ())
+    return;
+
+  memset (samples, 'a', sizeof (samples));
+  memcpy (samples[0], "\211PNG\r\n\032\n", 8);
+  memcpy (samples[1], "\037\213\010\0", 4);
+  make_magic_sample (N_MAGIC - 1, samples[2]);
+  for (i = 0; i < SAMPLE_SIZE; i++)
+    samples[4][i] = (i * 7919) >> 3;
+
+  g_test_timer_start ();
+  for (i = 0; i < N_SNIFFS; i++)
+    {
+      type = g_content_type_guess (NULL, (const guchar *) samples[i % 5], SAMPLE_SIZE, NULL);
+      g_free (type);
+    }
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_maximized_result (N_SNIFFS / elapsed, "%.0f buffers/s", N_SNIFFS / elapsed);
+}
+
+static gpointer
+guess_thread (gpointer data)
+{
+  gboolean uncertain;
+  char *type;
+  int i;
+
+  for (i = 0; i < N_GUESSES; i++)
+    {
+      type = g_content_type_guess ("file.foo", NULL, 0, &uncertain);
+      g_assert_cmpstr (type, ==, "application/x-foo");
+      g_free (type);
+
+      g_assert (g_content_type_is_a ("application/x-foo", "text/plain"));
+    }
+
+  return NULL;
+}
+
+static void
+test_description (void)
+{
+  char *description;
+
+  description = g_content_type_get_description ("application/x-foo");
+  g_assert_cmpstr (description, ==, "Foo document");
+  g_free (description);
+
+  description = g_content_type_get_description ("application/x-none");
+  g_assert_cmpstr (description, ==, "application/x-none type");
+  g_free (description);
+}
+
+static void
+test_icon (void)
+{
+  const char * const *names;
+  GIcon *icon;
+
+  icon = g_content_type_get_icon ("application/x-foo");
+  g_assert (G_IS_THEMED_ICON (icon));
+  names = g_themed_icon_get_names (G_THEMED_ICON (icon));
+  g_assert_cmpstr (names[0], ==, "foo-icon");
+  g_object_unref (icon);
+}
+
+static void
+test_tree (void)
+{
+  GError *error = NULL;
+  GFile *root;
+  char *path;
+  char **types;
+
+  path = g_build_filename (data_dir, "tree", "foo.dir", NULL);
+  g_assert (g_mkdir_with_parents (path, 0700) == 0);
+  g_free (path);
+
+  path = g_build_filename (data_dir, "tree", NULL);
+  root = g_file_new_for_path (path);
+  g_free (path);
+
+  types = g_content_type_guess_for_tree (root);
+  g_assert (types[0] == NULL);
+  g_strfreev (types);
+
+  path = g_build_filename (data_dir, "tree", "foo.dir", "bar", NULL);
+  g_file_set_contents (path, "bar", -1, &error);
+  g_assert_no_error (error);
+
+  types = g_content_type_guess_for_tree (root);
+  g_assert_cmpstr (types[0], ==, "x-content/foo");
+  g_assert (types[1] == NULL);
+  g_strfreev (types);
+
+  g_unlink (path);
+  g_free (path);
+  path = g_build_filename (data_dir, "tree", "foo.dir", NULL);
+  g_rmdir (path);
+  g_free (path);
+  path = g_build_filename (data_dir, "tree", NULL);
+  g_rmdir (path);
+  g_free (path);
+  g_object_unref (root);
+}
+
+static int
+count_info_caches (void)
+{
+  const char *name;
+  char *path;
+  GDir *dir;
+  int n_caches;
+
+  path = g_build_filename (data_dir, "cache", "glib-2.0", NULL);
+  dir = g_dir_open (path, 0, NULL);
+  g_free (path);
+  if (dir == NULL)
+    return 0;
+
+  n_caches = 0;
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (g_str_has_prefix (name, "mime-info-") &&
+	  g_str_has_suffix (name, ".cache"))
+	n_caches++;
+    }
+  g_dir_close (dir);
+
+  return n_caches;
+}
+
+static void
+test_info_cache (void)
+{
+  char *description;
+  GIcon *icon;
+  int i;
+
+  /* descriptions, icons and tree magic go to a cache file, which
+   * the previous tests have started to write in a thread
+   */
+  for (i = 0; i < 200 && count_info_caches () == 0; i++)
+    g_usleep (G_USEC_PER_SEC / 20);
+  g_assert_cmpint (count_info_caches (), ==, 1);
+
+  /* and which is used once it is written */
+  for (i = 0; i < 3; i++)
+    {
+      description = g_content_type_get_description ("application/x-foo");
+      g_assert_cmpstr (description, ==, "Foo document");
+      g_free (description);
+
+      icon = g_content_type_get_icon ("application/x-foo");
+      g_assert_cmpstr (g_themed_icon_get_names (G_THEMED_ICON (icon))[0], ==, "foo-icon");
+      g_object_unref (icon);
+
+      test_tree ();
+      g_usleep (G_USEC_PER_SEC / 20);
+    }
+  g_assert_cmpint (count_info_caches (), ==, 1);
+}
+
+static void
+remove_info_cache (void)
+{
+  const char *name;
+  char *path;
+  char *file;
+  GDir *dir;
+
+  path = g_build_filename (data_dir, "cache", "glib-2.0", NULL);
+  dir = g_dir_open (path, 0, NULL);
+  if (dir != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+	{
+	  file = g_build_filename (path, name, NULL);
+	  g_unlink (file);
+	  g_free (file);
+	}
+      g_dir_close (dir);
+    }
+  g_rmdir (path);
+  g_free (path);
+
+  path = g_build_filename (data_dir, "cache", NULL);
+  g_rmdir (path);
+  g_free (path);
+}
+
+static void
+run_guess_threads (int n_threads)
+{
+  GThread *threads[N_THREADS];
+  double elapsed;
+  int i;
+
+  g_test_timer_start ();
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_create (guess_thread, NULL, TRUE, NULL);
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+  elapsed = g_test_timer_elapsed ();
+
+  if (g_test_perf ())
+    g_test_maximized_result (n_threads * N_GUESSES / elapsed,
+			     "%d threads: %.0f guesses/s",
+			     n_threads, n_threads * N_GUESSES / elapsed);
+}
+
+static void
+test_threads (void)
+{
+  run_guess_threads (1);
+  run_guess_threads (N_THREADS);
+}
+
+static void
+test_reload (void)
+{
+  char *contents;
+  char *type;
+  int i;
+
+  type = g_content_type_guess ("file.bar", NULL, 0, NULL);
+  g_assert_cmpstr (type, !=, "application/x-bar");
+  g_free (type);
+
+  contents = g_strconcat (globs, "application/x-bar:*.bar\n", NULL);
+  write_mime_file ("globs", contents, -1);
+  g_free (contents);
+
+  /* The files are checked for changes every 5 seconds, without
+   * needing a main loop.
+   */
+  for (i = 0; i < 200; i++)
+    {
+      type = g_content_type_guess ("file.bar", NULL, 0, NULL);
+      if (strcmp (type, "application/x-bar") == 0)
+	break;
+      g_free (type);
+      type = NULL;
+
+      g_usleep (G_USEC_PER_SEC / 20);
+    }
+
+  g_assert_cmpstr (type, ==, "application/x-bar");
+  g_free (type);
+
+  write_mime_file ("globs", globs, -1);
+}
+
+static void
+test_info_cache_unwritable (void)
+{
+  char *contents;
+  char *description;
+  char *path;
+  char *type;
+  int i;
+
+  /* without a place for the cache, types are still looked up one
+   * by one after the database changes
+   */
+  remove_info_cache ();
+  path = g_build_filename (data_dir, "cache", NULL);
+  g_assert (g_file_set_contents (path, "", 0, NULL));
+
+  contents = g_strconcat (globs, "application/x-bar:*.bar\n", NULL);
+  write_mime_file ("globs", contents, -1);
+  g_free (contents);
+
+  for (i = 0; i < 200; i++)
+    {
+      type = g_content_type_guess ("file.bar", NULL, 0, NULL);
+      if (strcmp (type, "application/x-bar") == 0)
+	break;
+      g_free (type);
+      type = NULL;
+
+      g_usleep (G_USEC_PER_SEC / 20);
+    }
+  g_assert_cmpstr (type, ==, "application/x-bar");
+  g_free (type);
+
+  for (i = 0; i < 10; i++)
+    {
+      description = g_content_type_get_description ("application/x-foo");
+      g_assert_cmpstr (description, ==, "Foo document");
+      g_free (description);
+
+      test_tree ();
+      g_usleep (G_USEC_PER_SEC / 20);
+    }
+  g_assert (g_file_test (path, G_FILE_TEST_IS_REGULAR));
+
+  g_unlink (path);
+  g_free (path);
+  write_mime_file ("globs", globs, -1);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GString *contents;
+  char *mime_dir;
+  char *path;
+  int res;
+  int i;
+
+  data_dir = g_build_filename (g_get_tmp_dir (), "content-type-XXXXXX", NULL);
+  g_assert (mkdtemp (data_dir) != NULL);
+  mime_dir = g_build_filename (data_dir, "mime", NULL);
+  g_mkdir (mime_dir, 0700);
+  path = g_build_filename (mime_dir, "application", NULL);
+  g_mkdir (path, 0700);
+  g_free (path);
+  contents = g_string_new (GLOBS);
+  for (i = 0; i < N_EXTENSIONS; i++)
+    g_string_append_printf (contents, "application/x-ext%d:*.ext%d\n", i, i);
+  globs = g_string_free (contents, FALSE);
+  write_mime_file ("globs", globs, -1);
+  write_mime_file ("subclasses", SUBCLASSES, -1);
+  write_mime_file ("application/x-foo.xml", FOO_XML, -1);
+  write_mime_file ("icons", ICONS, -1);
+  write_mime_file ("generic-icons", GENERIC_ICONS, -1);
+  write_mime_file ("treemagic", TREEMAGIC, sizeof (TREEMAGIC) - 1);
+
+  contents = g_string_new_len ("MIME-Magic\0\n", 12);
+  append_magic (contents);
+  write_mime_file ("magic", contents->str, contents->len);
+  g_string_free (contents, TRUE);
+
+  g_setenv ("XDG_DATA_HOME", data_dir, TRUE);
+  g_setenv ("XDG_DATA_DIRS", data_dir, TRUE);
+  path = g_build_filename (data_dir, "cache", NULL);
+  g_setenv ("XDG_CACHE_HOME", path, TRUE);
+  g_free (path);
+
+  g_thread_init (NULL);
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/content-type/guess", test_guess);
+  g_test_add_func ("/content-type/globs", test_globs);
+  g_test_add_func ("/content-type/glob-performance", test_glob_performance);
+  g_test_add_func ("/content-type/magic", test_magic);
+  g_test_add_func ("/content-type/magic-performance", test_magic_performance);
+  g_test_add_func ("/content-type/description", test_description);
+  g_test_add_func ("/content-type/icon", test_icon);
+  g_test_add_func ("/content-type/tree", test_tree);
+  g_test_add_func ("/content-type/info-cache", test_info_cache);
+  g_test_add_func ("/content-type/threads", test_threads);
+  g_test_add_func ("/content-type/reload", test_reload);
+  g_test_add_func ("/content-type/info-cache-unwritable", test_info_cache_unwritable);
+
+  res = g_test_run ();
+
+  remove_mime_file ("globs");
+  remove_mime_file ("subclasses");
+  remove_mime_file ("magic");
+  remove_mime_file ("application/x-foo.xml");
+  remove_mime_file ("icons");
+  remove_mime_file ("generic-icons");
+  remove_mime_file ("treemagic");
+  remove_info_cache ();
+  path = g_build_filename (mime_dir, "application", NULL);
+  g_rmdir (path);
+  g_free (path);
+  g_rmdir (mime_dir);
+  g_rmdir (data_dir);
+  g_free (mime_dir);
+  g_free (data_dir);
+  g_free (globs);
+
+  return res;
+}
@@ -21,9 +21,11 @@
  */
 
 #include <glib/glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define MAX_LINES 	0xFFF
 #define MAX_BYTES	0x10000	
@@ -117,6 +119,89 @@ test_read_lines_CR_LF (void)
   test_read_lines (G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
 }
 
+static void
+test_read_lines_any (void)
+{
+  GInputStream *stream;
+  GInputStream *base_stream;
+  const char *chunks[] = { "a\r", "\nb", "\r", "c\r\r\n", "d\n\re\n", "f" };
+  const char *lines[] = { "a", "b", "c", "", "d", "", "e", "f" };
+  GError *error = NULL;
+  char *data;
+  gsize length;
+  int i;
+
+  /* every chunk is a separate read, so line ends get split across fills */
+  base_stream = g_memory_input_stream_new ();
+  for (i = 0; i < G_N_ELEMENTS (chunks); i++)
+    g_memory_input_stream_add_data (G_MEMORY_INPUT_STREAM (base_stream), chunks[i], -1, NULL);
+
+  stream = G_INPUT_STREAM (g_data_input_stream_new (base_stream));
+  g_data_input_stream_set_newline_type (G_DATA_INPUT_STREAM (stream), G_DATA_STREAM_NEWLINE_TYPE_ANY);
+
+  for (i = 0; i < G_N_ELEMENTS (lines); i++)
+    {
+      data = g_data_input_stream_read_line (G_DATA_INPUT_STREAM (stream), &length, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpstr (data, ==, lines[i]);
+      g_assert_cmpint (length, ==, strlen (lines[i]));
+      g_free (data);
+    }
+
+  data = g_data_input_stream_read_line (G_DATA_INPUT_STREAM (stream), &length, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (data == NULL);
+
+  g_object_unref (base_stream);
+  g_object_unref (stream);
+}
+
+
+static void
+test_read_line_borrowed (void)
+{
+  GInputStream *stream;
+  GInputStream *base_stream;
+  GError *error = NULL;
+  const char *line, *buffer;
+  gsize length, available;
+  int i;
+
+  base_stream = g_memory_input_stream_new_from_data ("first\nsecond\r\nthird", -1, NULL);
+  stream = G_INPUT_STREAM (g_data_input_stream_new (base_stream));
+  g_data_input_stream_set_newline_type (G_DATA_INPUT_STREAM (stream), G_DATA_STREAM_NEWLINE_TYPE_ANY);
+
+  line = g_data_input_stream_read_line_borrowed (G_DATA_INPUT_STREAM (stream), &length, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (length, ==, 5);
+  g_assert (strncmp (line, "first", length) == 0);
+
+  /* the line points into the buffer, which has moved past it */
+  buffer = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (stream), &available);
+  g_assert (buffer == line + 6);
+  g_assert_cmpint (available, ==, 13);
+
+  line = g_data_input_stream_read_line_borrowed (G_DATA_INPUT_STREAM (stream), &length, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (length, ==, 6);
+  g_assert (strncmp (line, "second", length) == 0);
+
+  line = g_data_input_stream_read_line_borrowed (G_DATA_INPUT_STREAM (stream), &length, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (length, ==, 5);
+  g_assert (strncmp (line, "third", length) == 0);
+
+  for (i = 0; i < 2; i++)
+    {
+      line = g_data_input_stream_read_line_borrowed (G_DATA_INPUT_STREAM (stream), &length, NULL, &error);
+      g_assert_no_error (error);
+      g_assert (line == NULL);
+      g_assert_cmpint (length, ==, 0);
+    }
+
+  g_object_unref (base_stream);
+  g_object_unref (stream);
+}
 
 static void
 test_read_until (void)
@@ -163,6 +248,114 @@ test_read_until (void)
   g_object_unref (stream);
 }
 
+static void
+test_read_until_chars (void)
+{
+  GInputStream *stream;
+  GInputStream *base_stream;
+  const char *stop_chars[] = { ",", ";,", "\377;,", "" };
+  const char *parts[][4] = {
+    { "one;two", "three\377four", "five\n", NULL },
+    { "one", "two", "three\377four", "five\n" },
+    { "one", "two", "three", "four" },
+    { "one;two,three\377four,five\n", NULL, NULL, NULL },
+  };
+  GError *error = NULL;
+  char *data;
+  int i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (stop_chars); i++)
+    {
+      base_stream = g_memory_input_stream_new_from_data ("one;two,three\377four,five\n", -1, NULL);
+      stream = G_INPUT_STREAM (g_data_input_stream_new (base_stream));
+
+      for (j = 0; j < 4 && parts[i][j] != NULL; j++)
+        {
+          data = g_data_input_stream_read_until (G_DATA_INPUT_STREAM (stream),
+                                                 stop_chars[i], NULL, NULL, &error);
+          g_assert_no_error (error);
+          g_assert_cmpstr (data, ==, parts[i][j]);
+          g_free (data);
+        }
+
+      g_object_unref (base_stream);
+      g_object_unref (stream);
+    }
+}
+
+static void
+test_read_lines_performance (void)
+{
+  const gsize size = 100 * 1024 * 1024;
+  const char *log_line = "Oct 18 12:00:00 host daemon[1234]: "
+                         "connection from 192.168.0.1 port 22 accepted\n";
+  GFileInputStream *file_stream;
+  GDataInputStream *stream;
+  GError *error = NULL;
+  GFile *file;
+  FILE *f;
+  char *filename, *line;
+  gsize written, length, n_lines;
+  gdouble elapsed;
+  int fd;
+
+  if (!g_test_perf ())
+    return;
+
+  fd = g_file_open_tmp ("data-input-stream-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  f = fdopen (fd, "w");
+  for (written = 0; written < size; written += strlen (log_line))
+    fputs (log_line, f);
+  fclose (f);
+
+  file = g_file_new_for_path (filename);
+  file_stream = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+  stream = g_data_input_stream_new (G_INPUT_STREAM (file_stream));
+
+  n_lines = 0;
+  g_test_timer_start ();
+  while ((line = g_data_input_stream_read_line (stream, &length, NULL, &error)) != NULL)
+    {
+      n_lines++;
+      g_free (line);
+    }
+  elapsed = g_test_timer_elapsed ();
+  g_assert_no_error (error);
+  g_assert_cmpint (n_lines, ==, written / strlen (log_line));
+
+  g_test_maximized_result (written / elapsed / (1024 * 1024),
+                           "read %" G_GSIZE_FORMAT " lines at %.1f MB/s",
+                           n_lines, written / elapsed / (1024 * 1024));
+
+  g_object_unref (stream);
+  g_object_unref (file_stream);
+
+  /* and again without copying the lines out */
+  file_stream = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+  stream = g_data_input_stream_new (G_INPUT_STREAM (file_stream));
+
+  n_lines = 0;
+  g_test_timer_start ();
+  while (g_data_input_stream_read_line_borrowed (stream, &length, NULL, &error) != NULL)
+    n_lines++;
+  elapsed = g_test_timer_elapsed ();
+  g_assert_no_error (error);
+  g_assert_cmpint (n_lines, ==, written / strlen (log_line));
+
+  g_test_maximized_result (written / elapsed / (1024 * 1024),
+                           "read %" G_GSIZE_FORMAT " borrowed lines at %.1f MB/s",
+                           n_lines, written / elapsed / (1024 * 1024));
+
+  g_object_unref (stream);
+  g_object_unref (file_stream);
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
 enum TestDataType {
   TEST_DATA_BYTE = 0,
   TEST_DATA_INT16,
@@ -323,8 +516,12 @@ main (int   argc,
   g_test_add_func ("/data-input-stream/read-lines-LF", test_read_lines_LF);
   g_test_add_func ("/data-input-stream/read-lines-CR", test_read_lines_CR);
   g_test_add_func ("/data-input-stream/read-lines-CR-LF", test_read_lines_CR_LF);
+  g_test_add_func ("/data-input-stream/read-lines-any", test_read_lines_any);
+  g_test_add_func ("/data-input-stream/read-line-borrowed", test_read_line_borrowed);
   g_test_add_func ("/data-input-stream/read-until", test_read_until);
+  g_test_add_func ("/data-input-stream/read-until-chars", test_read_until_chars);
   g_test_add_func ("/data-input-stream/read-int", test_read_int);
+  g_test_add_func ("/data-input-stream/read-lines-performance", test_read_lines_performance);
 
   return g_test_run();
 }
@@ -0,0 +1,245 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+#include <glib/glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+  goffset current;
+  goffset total;
+  int n_calls;
+  GCancellable *cancel_at_first_chunk;
+  gboolean cancelled_early;
+} Progress;
+
+static void
+progress_cb (goffset  current_num_bytes,
+             goffset  total_num_bytes,
+             gpointer user_data)
+{
+  Progress *progress = user_data;
+
+  g_assert_cmpint (current_num_bytes, >=, progress->current);
+
+  progress->current = current_num_bytes;
+  progress->total = total_num_bytes;
+  progress->n_calls++;
+
+  if (progress->cancel_at_first_chunk &&
+      current_num_bytes < total_num_bytes)
+    {
+      g_cancellable_cancel (progress->cancel_at_first_chunk);
+      progress->cancelled_early = TRUE;
+    }
+}
+
+/* writes @size bytes of a pattern that differs between chunks to a new
+ * temporary file, returning its name
+ */
+static char *
+create_source_file (gsize size)
+{
+  GError *error = NULL;
+  char *filename;
+  char *buffer;
+  gsize chunk, i;
+  int fd;
+
+  fd = g_file_open_tmp ("file-copy-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+
+  buffer = g_malloc (64 * 1024);
+  for (i = 0; i < size; i += chunk)
+    {
+      chunk = MIN (size - i, 64 * 1024);
+      memset (buffer, 'a' + (i / chunk) % 26, chunk);
+      g_assert_cmpint (write (fd, buffer, chunk), ==, chunk);
+    }
+  g_free (buffer);
+  close (fd);
+
+  return filename;
+}
+
+static void
+assert_same_contents (const char *filename1,
+                      const char *filename2)
+{
+  char *contents1, *contents2;
+  gsize length1, length2;
+  GError *error = NULL;
+
+  g_file_get_contents (filename1, &contents1, &length1, &error);
+  g_assert_no_error (error);
+  g_file_get_contents (filename2, &contents2, &length2, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (length1, ==, length2);
+  g_assert (memcmp (contents1, contents2, length1) == 0);
+
+  g_free (contents1);
+  g_free (contents2);
+}
+
+static void
+test_copy (void)
+{
+  const gsize size = 3 * 1024 * 1024 + 4321;
+  Progress progress = { 0, };
+  GFile *source, *destination;
+  GError *error = NULL;
+  char *source_name, *destination_name;
+  gboolean res;
+
+  source_name = create_source_file (size);
+  destination_name = g_strconcat (source_name, ".copy", NULL);
+  source = g_file_new_for_path (source_name);
+  destination = g_file_new_for_path (destination_name);
+
+  res = g_file_copy (source, destination, G_FILE_COPY_NONE, NULL,
+                     progress_cb, &progress, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  g_assert_cmpint (progress.n_calls, >, 0);
+  g_assert_cmpint (progress.current, ==, size);
+  g_assert_cmpint (progress.total, ==, size);
+  assert_same_contents (source_name, destination_name);
+
+  res = g_file_copy (source, destination, G_FILE_COPY_NONE, NULL,
+                     NULL, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS);
+  g_assert (!res);
+  g_clear_error (&error);
+
+  /* overwriting a longer file must not leave its tail behind */
+  g_assert (g_file_set_contents (destination_name, "x", -1, NULL));
+  g_unlink (source_name);
+  g_free (source_name);
+  source_name = create_source_file (size / 2);
+  g_object_unref (source);
+  source = g_file_new_for_path (source_name);
+
+  res = g_file_copy (source, destination, G_FILE_COPY_OVERWRITE, NULL,
+                     NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  assert_same_contents (source_name, destination_name);
+
+  g_unlink (source_name);
+  g_unlink (destination_name);
+  g_object_unref (source);
+  g_object_unref (destination);
+  g_free (source_name);
+  g_free (destination_name);
+}
+
+static void
+test_copy_cancel (void)
+{
+  Progress progress = { 0, };
+  GFile *source, *destination;
+  GError *error = NULL;
+  char *source_name, *destination_name;
+  gboolean res;
+
+  source_name = create_source_file (8 * 1024 * 1024);
+  destination_name = g_strconcat (source_name, ".copy", NULL);
+  source = g_file_new_for_path (source_name);
+  destination = g_file_new_for_path (destination_name);
+
+  progress.cancel_at_first_chunk = g_cancellable_new ();
+  res = g_file_copy (source, destination, G_FILE_COPY_NONE,
+                     progress.cancel_at_first_chunk,
+                     progress_cb, &progress, &error);
+
+  /* a filesystem that clones files copies it all in one step */
+  if (progress.cancelled_early)
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+      g_assert (!res);
+      g_clear_error (&error);
+    }
+  else
+    {
+      g_assert_no_error (error);
+      g_assert (res);
+    }
+
+  g_unlink (source_name);
+  g_unlink (destination_name);
+  g_object_unref (progress.cancel_at_first_chunk);
+  g_object_unref (source);
+  g_object_unref (destination);
+  g_free (source_name);
+  g_free (destination_name);
+}
+
+static void
+test_copy_performance (void)
+{
+  const gsize size = 1024 * 1024 * 1024;
+  GFile *source, *destination;
+  GError *error = NULL;
+  char *source_name, *destination_name;
+  gdouble elapsed;
+
+  if (!g_test_perf ())
+    return;
+
+  source_name = create_source_file (size);
+  destination_name = g_strconcat (source_name, ".copy", NULL);
+  source = g_file_new_for_path (source_name);
+  destination = g_file_new_for_path (destination_name);
+
+  g_test_timer_start ();
+  g_file_copy (source, destination, G_FILE_COPY_NONE, NULL,
+               NULL, NULL, &error);
+  elapsed = g_test_timer_elapsed ();
+  g_assert_no_error (error);
+
+  g_test_maximized_result (size / elapsed / (1024 * 1024),
+                           "copied 1 GB at %.1f MB/s",
+                           size / elapsed / (1024 * 1024));
+
+  g_unlink (source_name);
+  g_unlink (destination_name);
+  g_object_unref (source);
+  g_object_unref (destination);
+  g_free (source_name);
+  g_free (destination_name);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/file-copy/copy", test_copy);
+  g_test_add_func ("/file-copy/cancel", test_copy_cancel);
+  g_test_add_func ("/file-copy/performance", test_copy_performance);
+
+  return g_test_run ();
+}
@@ -0,0 +1,708 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+#include <glib/glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define N_PERF_FILES 100000
+#define N_PERF_DIRS 100
+
+/* Enough children for the thumbnail directories to be read */
+#define N_THUMBNAIL_FILES 300
+
+/* Where the thumbnail tests create their thumbnails */
+static char *thumbnail_root;
+
+static char *
+make_dir (void)
+{
+  char *path;
+
+  path = g_build_filename (g_get_tmp_dir (), "file-enumerator-XXXXXX", NULL);
+  g_assert (mkdtemp (path) != NULL);
+
+  return path;
+}
+
+static void
+remove_dir (const char *path)
+{
+  const char *name;
+  char *child;
+  GDir *dir;
+
+  dir = g_dir_open (path, 0, NULL);
+  g_assert (dir != NULL);
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      child = g_build_filename (path, name, NULL);
+      if (g_file_test (child, G_FILE_TEST_IS_DIR) &&
+	  !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+	remove_dir (child);
+      else
+	g_unlink (child);
+      g_free (child);
+    }
+  g_dir_close (dir);
+  g_rmdir (path);
+}
+
+static void
+create_entry (const char *dir,
+	      const char *name,
+	      GFileType   type,
+	      const char *target)
+{
+  char *path;
+
+  path = g_build_filename (dir, name, NULL);
+  switch (type)
+    {
+    case G_FILE_TYPE_REGULAR:
+      g_assert (g_file_set_contents (path, "", 0, NULL));
+      break;
+    case G_FILE_TYPE_DIRECTORY:
+      g_assert (g_mkdir (path, 0700) == 0);
+      break;
+    case G_FILE_TYPE_SYMBOLIC_LINK:
+      g_assert (symlink (target, path) == 0);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+  g_free (path);
+}
+
+static GHashTable *
+enumerate_types (const char          *path,
+		 const char          *attributes,
+		 GFileQueryInfoFlags  flags)
+{
+  GFileEnumerator *enumerator;
+  GHashTable *types;
+  GError *error = NULL;
+  GFileInfo *info;
+  GFile *dir;
+
+  types = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  dir = g_file_new_for_path (path);
+  enumerator = g_file_enumerate_children (dir, attributes, flags, NULL, &error);
+  g_assert_no_error (error);
+
+  while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+    {
+      g_hash_table_insert (types, g_strdup (g_file_info_get_name (info)),
+			   GINT_TO_POINTER (g_file_info_get_file_type (info)));
+      g_object_unref (info);
+    }
+  g_assert_no_error (error);
+
+  g_object_unref (enumerator);
+  g_object_unref (dir);
+
+  return types;
+}
+
+#define TYPE_OF(types, name) \
+  ((GFileType) GPOINTER_TO_INT (g_hash_table_lookup ((types), (name))))
+
+static void
+test_file_types (void)
+{
+  GHashTable *types;
+  char *path;
+
+  path = make_dir ();
+  create_entry (path, "file", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "dir", G_FILE_TYPE_DIRECTORY, NULL);
+  create_entry (path, "link-to-file", G_FILE_TYPE_SYMBOLIC_LINK, "file");
+  create_entry (path, "link-to-dir", G_FILE_TYPE_SYMBOLIC_LINK, "dir");
+  create_entry (path, "broken-link", G_FILE_TYPE_SYMBOLIC_LINK, "nowhere");
+
+  /* The types have to be the same whether or not they come
+   * from stat(), and whatever the order of the attributes.
+   */
+  types = enumerate_types (path, "standard::name,standard::type",
+			   G_FILE_QUERY_INFO_NONE);
+  g_assert_cmpint (g_hash_table_size (types), ==, 5);
+  g_assert_cmpint (TYPE_OF (types, "file"), ==, G_FILE_TYPE_REGULAR);
+  g_assert_cmpint (TYPE_OF (types, "dir"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (types, "link-to-file"), ==, G_FILE_TYPE_REGULAR);
+  g_assert_cmpint (TYPE_OF (types, "link-to-dir"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (types, "broken-link"), ==, G_FILE_TYPE_SYMBOLIC_LINK);
+  g_hash_table_unref (types);
+
+  types = enumerate_types (path, "standard::type,standard::name",
+			   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+  g_assert_cmpint (g_hash_table_size (types), ==, 5);
+  g_assert_cmpint (TYPE_OF (types, "file"), ==, G_FILE_TYPE_REGULAR);
+  g_assert_cmpint (TYPE_OF (types, "dir"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (types, "link-to-file"), ==, G_FILE_TYPE_SYMBOLIC_LINK);
+  g_assert_cmpint (TYPE_OF (types, "link-to-dir"), ==, G_FILE_TYPE_SYMBOLIC_LINK);
+  g_assert_cmpint (TYPE_OF (types, "broken-link"), ==, G_FILE_TYPE_SYMBOLIC_LINK);
+  g_hash_table_unref (types);
+
+  types = enumerate_types (path, "standard::name,standard::type,standard::size",
+			   G_FILE_QUERY_INFO_NONE);
+  g_assert_cmpint (TYPE_OF (types, "link-to-dir"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (types, "broken-link"), ==, G_FILE_TYPE_SYMBOLIC_LINK);
+  g_hash_table_unref (types);
+
+  remove_dir (path);
+  g_free (path);
+}
+
+static void
+time_enumeration (const char *path,
+		  const char *attributes)
+{
+  GFileEnumerator *enumerator;
+  GError *error = NULL;
+  GFileInfo *info;
+  GFile *dir;
+  double elapsed;
+  int n;
+
+  dir = g_file_new_for_path (path);
+
+  g_test_timer_start ();
+  enumerator = g_file_enumerate_children (dir, attributes,
+					  G_FILE_QUERY_INFO_NONE,
+					  NULL, &error);
+  g_assert_no_error (error);
+  n = 0;
+  while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+    {
+      n++;
+      g_object_unref (info);
+    }
+  g_assert_no_error (error);
+  g_object_unref (enumerator);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpint (n, ==, N_PERF_FILES);
+  g_test_maximized_result (n / elapsed,
+			   "enumerated %s at %.0f files/s",
+			   attributes, n / elapsed);
+
+  g_object_unref (dir);
+}
+
+static void
+test_enumerate_performance (void)
+{
+  char *path, *name;
+  int i;
+
+  if (!g_test_perf ())
+    return;
+
+  path = make_dir ();
+  for (i = 0; i < N_PERF_FILES; i++)
+    {
+      name = g_strdup_printf ("file-%06d", i);
+      create_entry (path, name, G_FILE_TYPE_REGULAR, NULL);
+      g_free (name);
+    }
+
+  time_enumeration (path, "standard::name");
+  time_enumeration (path, "standard::name,standard::type");
+  time_enumeration (path, "standard::name,standard::type,standard::size");
+
+  remove_dir (path);
+  g_free (path);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GFile *root;
+  GHashTable *found;
+  gboolean done;
+  gboolean result;
+  GError *error;
+} WalkState;
+
+static void
+walk_batch (GFile    *directory,
+	    GList    *infos,
+	    gpointer  user_data)
+{
+  WalkState *state = user_data;
+  GFileInfo *info;
+  char *relative;
+  GFile *child;
+  GList *l;
+
+  for (l = infos; l != NULL; l = l->next)
+    {
+      info = l->data;
+      child = g_file_get_child (directory, g_file_info_get_name (info));
+      relative = g_file_get_relative_path (state->root, child);
+      g_assert (relative != NULL);
+      g_assert (g_hash_table_lookup (state->found, relative) == NULL);
+      g_hash_table_insert (state->found, relative,
+			   GINT_TO_POINTER (g_file_info_get_file_type (info)));
+      g_object_unref (child);
+    }
+}
+
+static gboolean
+walk_prune (GFile     *directory,
+	    GFileInfo *info,
+	    gpointer   user_data)
+{
+  return strcmp (g_file_info_get_name (info), "skip") == 0;
+}
+
+static void
+walk_done (GObject      *source,
+	   GAsyncResult *res,
+	   gpointer      user_data)
+{
+  WalkState *state = user_data;
+
+  state->result = g_file_walk_finish (G_FILE (source), res, &state->error);
+  state->done = TRUE;
+  g_main_loop_quit (state->loop);
+}
+
+static void
+walk_state_init (WalkState  *state,
+		 const char *path)
+{
+  memset (state, 0, sizeof (WalkState));
+  state->loop = g_main_loop_new (NULL, FALSE);
+  state->root = g_file_new_for_path (path);
+  state->found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static void
+walk_state_clear (WalkState *state)
+{
+  g_main_loop_unref (state->loop);
+  g_object_unref (state->root);
+  g_hash_table_unref (state->found);
+  g_clear_error (&state->error);
+}
+
+static void
+test_walk (void)
+{
+  WalkState state;
+  char *path, *sub;
+
+  path = make_dir ();
+  create_entry (path, "a", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "b", G_FILE_TYPE_DIRECTORY, NULL);
+  create_entry (path, "b/c", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "b/d", G_FILE_TYPE_DIRECTORY, NULL);
+  create_entry (path, "b/d/e", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "skip", G_FILE_TYPE_DIRECTORY, NULL);
+  create_entry (path, "skip/f", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "loop", G_FILE_TYPE_SYMBOLIC_LINK, ".");
+
+  walk_state_init (&state, path);
+  g_file_walk_async (state.root, "standard::name", G_FILE_QUERY_INFO_NONE,
+		     2, G_PRIORITY_DEFAULT, NULL,
+		     walk_prune, walk_batch, &state,
+		     walk_done, &state);
+  g_assert (!state.done);
+  g_main_loop_run (state.loop);
+
+  g_assert_no_error (state.error);
+  g_assert (state.result);
+
+  /* skip/f is pruned, and the symlink is reported but not followed */
+  g_assert_cmpint (g_hash_table_size (state.found), ==, 7);
+  g_assert_cmpint (TYPE_OF (state.found, "a"), ==, G_FILE_TYPE_REGULAR);
+  g_assert_cmpint (TYPE_OF (state.found, "b"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (state.found, "b/c"), ==, G_FILE_TYPE_REGULAR);
+  g_assert_cmpint (TYPE_OF (state.found, "b/d"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (state.found, "b/d/e"), ==, G_FILE_TYPE_REGULAR);
+  g_assert_cmpint (TYPE_OF (state.found, "skip"), ==, G_FILE_TYPE_DIRECTORY);
+  g_assert_cmpint (TYPE_OF (state.found, "loop"), ==, G_FILE_TYPE_DIRECTORY);
+  walk_state_clear (&state);
+
+  /* a walk that can't start fails */
+  sub = g_build_filename (path, "a", NULL);
+  walk_state_init (&state, sub);
+  g_file_walk_async (state.root, "standard::name", G_FILE_QUERY_INFO_NONE,
+		     0, G_PRIORITY_DEFAULT, NULL,
+		     NULL, walk_batch, &state,
+		     walk_done, &state);
+  g_main_loop_run (state.loop);
+  g_assert_error (state.error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY);
+  g_assert (!state.result);
+  walk_state_clear (&state);
+  g_free (sub);
+
+  remove_dir (path);
+  g_free (path);
+}
+
+static void
+test_walk_cancelled (void)
+{
+  GCancellable *cancellable;
+  WalkState state;
+  char *path;
+
+  path = make_dir ();
+  create_entry (path, "a", G_FILE_TYPE_REGULAR, NULL);
+
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  walk_state_init (&state, path);
+  g_file_walk_async (state.root, "standard::name", G_FILE_QUERY_INFO_NONE,
+		     0, G_PRIORITY_DEFAULT, cancellable,
+		     NULL, walk_batch, &state,
+		     walk_done, &state);
+  g_assert (!state.done);
+  g_main_loop_run (state.loop);
+  g_assert_error (state.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_cmpint (g_hash_table_size (state.found), ==, 0);
+  walk_state_clear (&state);
+
+  g_object_unref (cancellable);
+  remove_dir (path);
+  g_free (path);
+}
+
+static void
+time_walk (const char *path,
+	   int         max_parallel,
+	   int         n_expected)
+{
+  WalkState state;
+  double elapsed;
+
+  walk_state_init (&state, path);
+
+  g_test_timer_start ();
+  g_file_walk_async (state.root, "standard::name,standard::size",
+		     G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		     max_parallel, G_PRIORITY_DEFAULT, NULL,
+		     NULL, walk_batch, &state,
+		     walk_done, &state);
+  g_main_loop_run (state.loop);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_no_error (state.error);
+  g_assert_cmpint (g_hash_table_size (state.found), ==, n_expected);
+  g_test_maximized_result (n_expected / elapsed,
+			   "walked %d directories at a time at %.0f files/s",
+			   max_parallel, n_expected / elapsed);
+
+  walk_state_clear (&state);
+}
+
+static void
+test_walk_performance (void)
+{
+  char *path, *name;
+  int i, j;
+
+  if (!g_test_perf ())
+    return;
+
+  path = make_dir ();
+  for (i = 0; i < N_PERF_DIRS; i++)
+    {
+      name = g_strdup_printf ("dir-%03d", i);
+      create_entry (path, name, G_FILE_TYPE_DIRECTORY, NULL);
+      g_free (name);
+      for (j = 0; j < N_PERF_FILES / N_PERF_DIRS; j++)
+	{
+	  name = g_strdup_printf ("dir-%03d/file-%04d", i, j);
+	  create_entry (path, name, G_FILE_TYPE_REGULAR, NULL);
+	  g_free (name);
+	}
+    }
+
+  time_walk (path, 1, N_PERF_DIRS + N_PERF_FILES);
+  time_walk (path, 4, N_PERF_DIRS + N_PERF_FILES);
+
+  remove_dir (path);
+  g_free (path);
+}
+
+static char *
+get_thumbnail_path (const char *dir,
+		    const char *name,
+		    const char *thumbnail_dir)
+{
+  char *path, *uri, *md5, *basename, *thumbnail;
+
+  path = g_build_filename (dir, name, NULL);
+  uri = g_filename_to_uri (path, NULL, NULL);
+  md5 = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  basename = g_strconcat (md5, ".png", NULL);
+  thumbnail = g_build_filename (thumbnail_root, thumbnail_dir, basename, NULL);
+
+  g_free (basename);
+  g_free (md5);
+  g_free (uri);
+  g_free (path);
+
+  return thumbnail;
+}
+
+static void
+create_thumbnail (const char *dir,
+		  const char *name,
+		  const char *thumbnail_dir,
+		  gboolean    create)
+{
+  char *thumbnail;
+
+  thumbnail = get_thumbnail_path (dir, name, thumbnail_dir);
+  if (create)
+    g_assert (g_file_set_contents (thumbnail, "", 0, NULL));
+  else
+    g_unlink (thumbnail);
+  g_free (thumbnail);
+}
+
+static GHashTable *
+enumerate_thumbnails (const char *path)
+{
+  GFileEnumerator *enumerator;
+  GHashTable *thumbnails;
+  GError *error = NULL;
+  GFileInfo *info;
+  GFile *dir;
+  const char *thumbnail;
+
+  thumbnails = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  dir = g_file_new_for_path (path);
+  enumerator = g_file_enumerate_children (dir, "standard::name,thumbnail::*",
+					  G_FILE_QUERY_INFO_NONE, NULL, &error);
+  g_assert_no_error (error);
+
+  while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+    {
+      thumbnail = g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_THUMBNAIL_PATH);
+      if (thumbnail != NULL)
+	{
+	  g_assert (g_file_test (thumbnail, G_FILE_TEST_IS_REGULAR));
+	  thumbnail = "normal";
+	}
+      else if (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_THUMBNAILING_FAILED))
+	thumbnail = "failed";
+      else
+	thumbnail = "none";
+      g_hash_table_insert (thumbnails, g_strdup (g_file_info_get_name (info)),
+			   g_strdup (thumbnail));
+      g_object_unref (info);
+    }
+  g_assert_no_error (error);
+
+  g_object_unref (enumerator);
+  g_object_unref (dir);
+
+  return thumbnails;
+}
+
+static void
+test_thumbnails (void)
+{
+  GHashTable *thumbnails;
+  char *path, *thumbnail_dir;
+
+  path = make_dir ();
+  create_entry (path, "a", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "b", G_FILE_TYPE_REGULAR, NULL);
+  create_entry (path, "c", G_FILE_TYPE_REGULAR, NULL);
+
+  /* no thumbnail directories at all */
+  thumbnails = enumerate_thumbnails (path);
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "a"), ==, "none");
+  g_hash_table_unref (thumbnails);
+
+  thumbnail_dir = g_build_filename (thumbnail_root, "normal", NULL);
+  g_assert (g_mkdir_with_parents (thumbnail_dir, 0700) == 0);
+  g_free (thumbnail_dir);
+  thumbnail_dir = g_build_filename (thumbnail_root, "fail",
+				    "gnome-thumbnail-factory", NULL);
+  g_assert (g_mkdir_with_parents (thumbnail_dir, 0700) == 0);
+  g_free (thumbnail_dir);
+
+  create_thumbnail (path, "a", "normal", TRUE);
+  create_thumbnail (path, "b", "fail/gnome-thumbnail-factory", TRUE);
+
+  thumbnails = enumerate_thumbnails (path);
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "a"), ==, "normal");
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "b"), ==, "failed");
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "c"), ==, "none");
+  g_hash_table_unref (thumbnails);
+
+  /* changes to the thumbnail directories are picked up */
+  create_thumbnail (path, "a", "normal", FALSE);
+  create_thumbnail (path, "c", "normal", TRUE);
+
+  thumbnails = enumerate_thumbnails (path);
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "a"), ==, "none");
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "b"), ==, "failed");
+  g_assert_cmpstr (g_hash_table_lookup (thumbnails, "c"), ==, "normal");
+  g_hash_table_unref (thumbnails);
+
+  remove_dir (thumbnail_root);
+  remove_dir (path);
+  g_free (path);
+}
+
+static void
+settle_thumbnail_dirs (void)
+{
+  struct utimbuf times;
+  char *path;
+
+  /* Make the thumbnail directories look like nothing has
+   * written to them in a while
+   */
+  times.actime = times.modtime = time (NULL) - 10;
+  path = g_build_filename (thumbnail_root, "normal", NULL);
+  g_assert (g_utime (path, &times) == 0);
+  g_free (path);
+  path = g_build_filename (thumbnail_root, "fail",
+			   "gnome-thumbnail-factory", NULL);
+  g_assert (g_utime (path, &times) == 0);
+  g_free (path);
+}
+
+static const char *
+expected_thumbnail (int i)
+{
+  return i % 3 == 0 ? "normal" : i % 3 == 1 ? "failed" : "none";
+}
+
+static void
+check_thumbnails (const char *path,
+		  int         changed)
+{
+  GHashTable *thumbnails;
+  const char *expected;
+  char name[32];
+  int i;
+
+  thumbnails = enumerate_thumbnails (path);
+  g_assert_cmpint (g_hash_table_size (thumbnails), ==, N_THUMBNAIL_FILES);
+  for (i = 0; i < N_THUMBNAIL_FILES; i++)
+    {
+      g_snprintf (name, sizeof (name), "f%d", i);
+      expected = expected_thumbnail (i);
+      if (i == changed)
+	expected = strcmp (expected, "normal") == 0 ? "none" : "normal";
+      g_assert_cmpstr (g_hash_table_lookup (thumbnails, name), ==, expected);
+    }
+  g_hash_table_unref (thumbnails);
+}
+
+static void
+test_thumbnail_index (void)
+{
+  char *path, *thumbnail_dir, *thumbnail;
+  char name[32];
+  int i;
+
+  path = make_dir ();
+  thumbnail_dir = g_build_filename (thumbnail_root, "fail",
+				    "gnome-thumbnail-factory", NULL);
+  g_assert (g_mkdir_with_parents (thumbnail_dir, 0700) == 0);
+  g_free (thumbnail_dir);
+  thumbnail_dir = g_build_filename (thumbnail_root, "normal", NULL);
+  g_assert (g_mkdir_with_parents (thumbnail_dir, 0700) == 0);
+  g_free (thumbnail_dir);
+
+  for (i = 0; i < N_THUMBNAIL_FILES; i++)
+    {
+      g_snprintf (name, sizeof (name), "f%d", i);
+      create_entry (path, name, G_FILE_TYPE_REGULAR, NULL);
+      if (i % 3 == 0)
+	create_thumbnail (path, name, "normal", TRUE);
+      else if (i % 3 == 1)
+	create_thumbnail (path, name, "fail/gnome-thumbnail-factory", TRUE);
+      else
+	{
+	  /* only regular files are thumbnails */
+	  thumbnail = get_thumbnail_path (path, name, "normal");
+	  g_assert (g_mkdir (thumbnail, 0700) == 0);
+	  g_free (thumbnail);
+	}
+    }
+
+  /* the names are read once the directories have settled */
+  settle_thumbnail_dirs ();
+  check_thumbnails (path, -1);
+  check_thumbnails (path, -1);
+
+  /* while a thumbnailer writes, and after it is done */
+  create_thumbnail (path, "f3", "normal", FALSE);
+  check_thumbnails (path, 3);
+  settle_thumbnail_dirs ();
+  check_thumbnails (path, 3);
+
+  remove_dir (thumbnail_root);
+  remove_dir (path);
+  g_free (path);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  char *dir;
+  int ret;
+
+  /* The thumbnail directories are only looked up once, so keep
+   * them out of the home directory up front.
+   */
+  dir = make_dir ();
+  thumbnail_root = g_build_filename (dir, "thumbnails", NULL);
+  g_setenv ("GIO_THUMBNAIL_DIR", thumbnail_root, TRUE);
+
+  g_thread_init (NULL);
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/file-enumerator/file-types", test_file_types);
+  g_test_add_func ("/file-enumerator/performance", test_enumerate_performance);
+  g_test_add_func ("/file-enumerator/walk", test_walk);
+  g_test_add_func ("/file-enumerator/walk-cancelled", test_walk_cancelled);
+  g_test_add_func ("/file-enumerator/walk-performance", test_walk_performance);
+  g_test_add_func ("/file-enumerator/thumbnails", test_thumbnails);
+  g_test_add_func ("/file-enumerator/thumbnail-index", test_thumbnail_index);
+
+  ret = g_test_run ();
+
+  remove_dir (dir);
+  g_free (dir);
+  g_free (thumbnail_root);
+
+  return ret;
+}
@@ -0,0 +1,170 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+#include <glib/glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DATA "abcdefghijklmnopqrstuvwxyz"
+
+static char *
+create_file (const char *contents,
+             gsize       length)
+{
+  GError *error = NULL;
+  char *filename;
+  int fd;
+
+  fd = g_file_open_tmp ("file-input-stream-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (filename, contents, length, &error);
+  g_assert_no_error (error);
+
+  return filename;
+}
+
+static void
+test_peek_buffer (void)
+{
+  GFileInputStream *in;
+  GError *error = NULL;
+  GFile *file;
+  const char *data;
+  char *filename;
+  char buf[4];
+  gsize count;
+  gssize res;
+
+  filename = create_file (DATA, strlen (DATA));
+  file = g_file_new_for_path (filename);
+  in = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert (data != NULL);
+  g_assert_cmpint (count, ==, strlen (DATA));
+  g_assert (memcmp (data, DATA, count) == 0);
+
+  /* peeking doesn't consume, reading and skipping do */
+  res = g_input_stream_read (G_INPUT_STREAM (in), buf, sizeof (buf), NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, sizeof (buf));
+  g_assert (memcmp (buf, "abcd", sizeof (buf)) == 0);
+
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert_cmpint (count, ==, strlen (DATA) - 4);
+  g_assert (memcmp (data, DATA + 4, count) == 0);
+
+  res = g_input_stream_skip (G_INPUT_STREAM (in), 10, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, 10);
+
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert_cmpint (count, ==, strlen (DATA) - 14);
+  g_assert (memcmp (data, DATA + 14, count) == 0);
+
+  /* seeking moves the window around */
+  g_seekable_seek (G_SEEKABLE (in), -3, G_SEEK_END, NULL, &error);
+  g_assert_no_error (error);
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert_cmpint (count, ==, 3);
+  g_assert (memcmp (data, "xyz", count) == 0);
+
+  g_seekable_seek (G_SEEKABLE (in), 0, G_SEEK_END, NULL, &error);
+  g_assert_no_error (error);
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert (data == NULL);
+  g_assert_cmpint (count, ==, 0);
+
+  g_input_stream_close (G_INPUT_STREAM (in), NULL, &error);
+  g_assert_no_error (error);
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert (data == NULL);
+  g_assert_cmpint (count, ==, 0);
+
+  g_object_unref (in);
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
+static void
+test_peek_buffer_growing (void)
+{
+  GFileInputStream *in;
+  GOutputStream *out;
+  GError *error = NULL;
+  GFile *file;
+  const char *data;
+  char *filename;
+  gsize count;
+
+  filename = create_file ("", 0);
+  file = g_file_new_for_path (filename);
+  in = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+
+  /* an empty file has nothing to map, but may still grow */
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert (data == NULL);
+  g_assert_cmpint (count, ==, 0);
+
+  out = G_OUTPUT_STREAM (g_file_append_to (file, G_FILE_CREATE_NONE, NULL, &error));
+  g_assert_no_error (error);
+  g_output_stream_write_all (out, DATA, strlen (DATA), NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert_cmpint (count, ==, strlen (DATA));
+  g_assert (memcmp (data, DATA, count) == 0);
+
+  /* data appended after the end of the mapping gets mapped too */
+  g_seekable_seek (G_SEEKABLE (in), 0, G_SEEK_END, NULL, &error);
+  g_assert_no_error (error);
+  g_output_stream_write_all (out, "0123", 4, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  data = g_file_input_stream_peek_buffer (in, &count);
+  g_assert_cmpint (count, ==, 4);
+  g_assert (memcmp (data, "0123", count) == 0);
+
+  g_object_unref (out);
+  g_object_unref (in);
+  g_unlink (filename);
+  g_object_unref (file);
+  g_free (filename);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/file-input-stream/peek-buffer", test_peek_buffer);
+  g_test_add_func ("/file-input-stream/peek-buffer-growing", test_peek_buffer_growing);
+
+  return g_test_run ();
+}
@@ -0,0 +1,689 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+#include <glib/glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Give up on an event after this long */
+#define EVENT_TIMEOUT 5.0 /* seconds */
+
+/* Events used to be held back for up to a second. Other backends
+ * than inotify may poll, so only check the latency with inotify.
+ */
+#define MAX_LATENCY 0.5 /* seconds */
+
+#define assert_latency(monitor, latency) \
+  G_STMT_START { \
+    if (is_inotify (monitor)) \
+      g_assert_cmpfloat (latency, <, MAX_LATENCY); \
+  } G_STMT_END
+
+#define N_BATCH_FILES 200
+
+/* A tree of 10 * 10 * 10 directories, for the performance test */
+#define TREE_FANOUT 10
+#define TREE_DEPTH 3
+
+typedef struct
+{
+  GFileMonitorEvent event_type;
+  char *basename;
+} RecordedEvent;
+
+static char *test_dir;
+static GList *events;
+
+static gboolean
+is_inotify (GFileMonitor *monitor)
+{
+  return strcmp (G_OBJECT_TYPE_NAME (monitor), "GInotifyDirectoryMonitor") == 0;
+}
+
+static void
+monitor_changed (GFileMonitor      *monitor,
+		 GFile             *file,
+		 GFile             *other_file,
+		 GFileMonitorEvent  event_type,
+		 gpointer           user_data)
+{
+  RecordedEvent *event;
+
+  event = g_new (RecordedEvent, 1);
+  event->event_type = event_type;
+  event->basename = g_file_get_basename (file);
+  events = g_list_append (events, event);
+}
+
+static int n_batches;
+
+static void
+monitor_changes (GFileMonitor             *monitor,
+		 const GFileMonitorChange *changes,
+		 guint                     n_changes,
+		 gpointer                  user_data)
+{
+  guint i;
+
+  g_assert_cmpuint (n_changes, >, 0);
+  for (i = 0; i < n_changes; i++)
+    monitor_changed (monitor, changes[i].file, changes[i].other_file,
+		     changes[i].event_type, NULL);
+  n_batches++;
+}
+
+static int
+count_events (GFileMonitorEvent event_type)
+{
+  GList *l;
+  int n;
+
+  n = 0;
+  for (l = events; l; l = l->next)
+    {
+      RecordedEvent *event = l->data;
+
+      if (event->event_type == event_type)
+	n++;
+    }
+
+  return n;
+}
+
+static void
+clear_events (void)
+{
+  GList *l;
+
+  for (l = events; l; l = l->next)
+    {
+      RecordedEvent *event = l->data;
+
+      g_free (event->basename);
+      g_free (event);
+    }
+  g_list_free (events);
+  events = NULL;
+}
+
+static gboolean
+has_event (GFileMonitorEvent  event_type,
+	   const char        *basename)
+{
+  GList *l;
+
+  for (l = events; l; l = l->next)
+    {
+      RecordedEvent *event = l->data;
+
+      if (event->event_type == event_type &&
+	  strcmp (event->basename, basename) == 0)
+	return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Runs the main loop until the event shows up, returns how long that took */
+static gdouble
+wait_for_event (GFileMonitorEvent  event_type,
+		const char        *basename)
+{
+  GTimer *timer;
+  gdouble elapsed;
+
+  timer = g_timer_new ();
+  while (!has_event (event_type, basename) &&
+	 g_timer_elapsed (timer, NULL) < EVENT_TIMEOUT)
+    {
+      while (g_main_context_iteration (NULL, FALSE))
+	;
+      g_usleep (1000);
+    }
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  g_assert (has_event (event_type, basename));
+
+  return elapsed;
+}
+
+static char *
+create_file (const char *dir,
+	     const char *name)
+{
+  GError *error = NULL;
+  char *path;
+
+  path = g_build_filename (dir, name, NULL);
+  g_file_set_contents (path, "data", -1, &error);
+  g_assert_no_error (error);
+
+  return path;
+}
+
+static GFileMonitor *
+monitor_directory_with_flags (const char        *path,
+			      GFileMonitorFlags  flags)
+{
+  GError *error = NULL;
+  GFileMonitor *monitor;
+  GFile *dir;
+
+  dir = g_file_new_for_path (path);
+  monitor = g_file_monitor_directory (dir, flags, NULL, &error);
+  g_assert_no_error (error);
+  g_signal_connect (monitor, "changed", G_CALLBACK (monitor_changed), NULL);
+  g_object_unref (dir);
+
+  return monitor;
+}
+
+static GFileMonitor *
+monitor_directory (const char *path)
+{
+  return monitor_directory_with_flags (path, G_FILE_MONITOR_NONE);
+}
+
+/* Lets the monitor catch up with queued work */
+static void
+run_main_loop (gdouble seconds)
+{
+  GTimer *timer;
+
+  timer = g_timer_new ();
+  while (g_timer_elapsed (timer, NULL) < seconds)
+    {
+      while (g_main_context_iteration (NULL, FALSE))
+	;
+      g_usleep (1000);
+    }
+  g_timer_destroy (timer);
+}
+
+static gboolean
+keep_busy (gpointer data)
+{
+  return TRUE;
+}
+
+/* Like run_main_loop(), but keeps the monitors' idles from running */
+static void
+run_main_loop_without_idles (gdouble seconds)
+{
+  GTimer *timer;
+  guint id;
+
+  id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE - 1, keep_busy, NULL, NULL);
+  timer = g_timer_new ();
+  while (g_timer_elapsed (timer, NULL) < seconds)
+    g_main_context_iteration (NULL, FALSE);
+  g_timer_destroy (timer);
+  g_source_remove (id);
+}
+
+static void
+test_create (void)
+{
+  GFileMonitor *monitor;
+  gdouble latency;
+  char *path;
+
+  monitor = monitor_directory (test_dir);
+
+  path = create_file (test_dir, "created");
+  latency = wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "created");
+  assert_latency (monitor, latency);
+
+  g_unlink (path);
+  latency = wait_for_event (G_FILE_MONITOR_EVENT_DELETED, "created");
+  assert_latency (monitor, latency);
+
+  g_free (path);
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+test_rename (void)
+{
+  GFileMonitor *monitor;
+  gdouble latency;
+  char *from, *to;
+
+  from = create_file (test_dir, "from");
+  to = g_build_filename (test_dir, "to", NULL);
+
+  monitor = monitor_directory (test_dir);
+
+  /* both halves of the move are paired and sent together */
+  g_assert (g_rename (from, to) == 0);
+  latency = wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "to");
+  assert_latency (monitor, latency);
+  g_assert (has_event (G_FILE_MONITOR_EVENT_DELETED, "from"));
+
+  g_unlink (to);
+  g_free (from);
+  g_free (to);
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+test_move_out (void)
+{
+  GFileMonitor *monitor;
+  gdouble latency;
+  char *other_dir;
+  char *from, *to;
+
+  other_dir = g_build_filename (test_dir, "other", NULL);
+  g_assert (g_mkdir (other_dir, 0700) == 0);
+  from = create_file (test_dir, "moved");
+  to = g_build_filename (other_dir, "moved", NULL);
+
+  monitor = monitor_directory (test_dir);
+
+  /* an unpaired move turns into a delete once it has been held */
+  g_assert (g_rename (from, to) == 0);
+  latency = wait_for_event (G_FILE_MONITOR_EVENT_DELETED, "moved");
+  assert_latency (monitor, latency);
+
+  g_unlink (to);
+  g_rmdir (other_dir);
+  g_free (other_dir);
+  g_free (from);
+  g_free (to);
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+test_recursive (void)
+{
+  GFileMonitor *monitor;
+  char *a, *b, *c, *deep, *file;
+
+  a = g_build_filename (test_dir, "a", NULL);
+  b = g_build_filename (a, "b", NULL);
+  g_assert (g_mkdir_with_parents (b, 0700) == 0);
+
+  monitor = monitor_directory_with_flags (test_dir, G_FILE_MONITOR_WATCH_RECURSIVE);
+  if (!is_inotify (monitor))
+    {
+      g_test_message ("recursive monitoring is not supported by %s",
+		      G_OBJECT_TYPE_NAME (monitor));
+      g_object_unref (monitor);
+      g_rmdir (b);
+      g_rmdir (a);
+      g_free (a);
+      g_free (b);
+      return;
+    }
+  run_main_loop (0.1);
+
+  /* existing subdirectories are watched */
+  file = create_file (b, "in-b");
+  wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "in-b");
+  g_unlink (file);
+  wait_for_event (G_FILE_MONITOR_EVENT_DELETED, "in-b");
+  g_free (file);
+
+  /* and so are new ones */
+  c = g_build_filename (a, "c", NULL);
+  g_assert (g_mkdir (c, 0700) == 0);
+  wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "c");
+  run_main_loop (0.1);
+  file = create_file (c, "in-c");
+  wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "in-c");
+  g_unlink (file);
+  g_free (file);
+
+  /* directories that appear together with their parent are found
+   * by scanning the parent
+   */
+  deep = g_build_filename (c, "d", "e", NULL);
+  g_assert (g_mkdir_with_parents (deep, 0700) == 0);
+  run_main_loop (0.1);
+  file = create_file (deep, "in-e");
+  wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "in-e");
+  g_unlink (file);
+  g_free (file);
+  g_rmdir (deep);
+  g_free (deep);
+  deep = g_build_filename (c, "d", NULL);
+  g_rmdir (deep);
+  g_free (deep);
+
+  /* removed directories are dropped from the tree */
+  g_rmdir (c);
+  wait_for_event (G_FILE_MONITOR_EVENT_DELETED, "c");
+  g_rmdir (b);
+  wait_for_event (G_FILE_MONITOR_EVENT_DELETED, "b");
+
+  g_rmdir (a);
+  g_free (a);
+  g_free (b);
+  g_free (c);
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+make_tree (const char *path,
+	   int         depth,
+	   GPtrArray  *dirs)
+{
+  char *child;
+  char name[16];
+  int i;
+
+  if (depth == 0)
+    return;
+
+  for (i = 0; i < TREE_FANOUT; i++)
+    {
+      g_snprintf (name, sizeof (name), "d%d", i);
+      child = g_build_filename (path, name, NULL);
+      g_assert (g_mkdir (child, 0700) == 0);
+      make_tree (child, depth - 1, dirs);
+      g_ptr_array_add (dirs, child);
+    }
+}
+
+static void
+test_recursive_performance (void)
+{
+  GFileMonitor *monitor;
+  GPtrArray *dirs;
+  char *root;
+  char *file;
+  gdouble elapsed;
+  guint i;
+
+  if (!g_test_perf ())
+    return;
+
+  root = g_build_filename (test_dir, "tree", NULL);
+  g_assert (g_mkdir (root, 0700) == 0);
+  dirs = g_ptr_array_new ();
+  make_tree (root, TREE_DEPTH, dirs);
+
+  g_test_timer_start ();
+  monitor = monitor_directory_with_flags (root, G_FILE_MONITOR_WATCH_RECURSIVE);
+  if (is_inotify (monitor))
+    {
+      /* the bottom of the tree is only watched after the levels
+       * above it have been scanned
+       */
+      file = create_file (g_ptr_array_index (dirs, 0), "last");
+      while (!has_event (G_FILE_MONITOR_EVENT_CREATED, "last") &&
+	     g_test_timer_elapsed () < EVENT_TIMEOUT)
+	{
+	  while (g_main_context_iteration (NULL, FALSE))
+	    ;
+	  g_unlink (file);
+	  g_free (file);
+	  file = create_file (g_ptr_array_index (dirs, 0), "last");
+	}
+      elapsed = g_test_timer_elapsed ();
+      g_assert (has_event (G_FILE_MONITOR_EVENT_CREATED, "last"));
+      g_test_maximized_result (dirs->len / elapsed,
+			       "watched %u directories in %.3f s (%.0f directories/s)",
+			       dirs->len, elapsed, dirs->len / elapsed);
+      g_unlink (file);
+      g_free (file);
+    }
+
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+  clear_events ();
+
+  for (i = 0; i < dirs->len; i++)
+    {
+      g_rmdir (g_ptr_array_index (dirs, i));
+      g_free (g_ptr_array_index (dirs, i));
+    }
+  g_ptr_array_free (dirs, TRUE);
+  g_rmdir (root);
+  g_free (root);
+}
+
+static void
+test_recursive_root_removed (void)
+{
+  GFileMonitor *monitor;
+  GTimer *timer;
+  char *root, *sub, *file;
+
+  root = g_build_filename (test_dir, "root", NULL);
+  sub = g_build_filename (root, "sub", NULL);
+  g_assert (g_mkdir_with_parents (sub, 0700) == 0);
+
+  monitor = monitor_directory_with_flags (root, G_FILE_MONITOR_WATCH_RECURSIVE);
+  if (!is_inotify (monitor))
+    {
+      g_object_unref (monitor);
+      g_rmdir (sub);
+      g_rmdir (root);
+      g_free (sub);
+      g_free (root);
+      return;
+    }
+
+  /* the root goes away before it was scanned */
+  g_rmdir (sub);
+  g_rmdir (root);
+  run_main_loop_without_idles (0.1);
+  run_main_loop (0.2);
+
+  /* and is watched again once it is back */
+  clear_events ();
+  g_assert (g_mkdir (root, 0700) == 0);
+  timer = g_timer_new ();
+  while (!has_event (G_FILE_MONITOR_EVENT_CREATED, "root") &&
+	 g_timer_elapsed (timer, NULL) < 2 * EVENT_TIMEOUT)
+    run_main_loop (0.1);
+  g_timer_destroy (timer);
+  g_assert (has_event (G_FILE_MONITOR_EVENT_CREATED, "root"));
+  run_main_loop (0.1);
+
+  file = create_file (root, "in-root");
+  wait_for_event (G_FILE_MONITOR_EVENT_CREATED, "in-root");
+  g_unlink (file);
+  g_free (file);
+
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+  g_rmdir (root);
+  g_free (sub);
+  g_free (root);
+}
+
+static void
+test_batch (void)
+{
+  GError *error = NULL;
+  GFileMonitor *monitor;
+  GFile *dir;
+  char *path;
+  char name[32];
+  int i;
+
+  dir = g_file_new_for_path (test_dir);
+  monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, &error);
+  g_assert_no_error (error);
+  g_signal_connect (monitor, "changes", G_CALLBACK (monitor_changes), NULL);
+  g_object_unref (dir);
+
+  n_batches = 0;
+  for (i = 0; i < N_BATCH_FILES; i++)
+    {
+      g_snprintf (name, sizeof (name), "batch%d", i);
+      g_free (create_file (test_dir, name));
+    }
+
+  g_snprintf (name, sizeof (name), "batch%d", N_BATCH_FILES - 1);
+  wait_for_event (G_FILE_MONITOR_EVENT_CREATED, name);
+  for (i = 0; i < N_BATCH_FILES; i++)
+    {
+      g_snprintf (name, sizeof (name), "batch%d", i);
+      g_assert (has_event (G_FILE_MONITOR_EVENT_CREATED, name));
+    }
+
+  /* the changes were delivered in a few emissions, not one each */
+  g_assert_cmpint (n_batches, <, N_BATCH_FILES);
+
+  for (i = 0; i < N_BATCH_FILES; i++)
+    {
+      g_snprintf (name, sizeof (name), "batch%d", i);
+      path = g_build_filename (test_dir, name, NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+  run_main_loop (0.1);
+
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+test_rate_limit (void)
+{
+  GFileMonitor *monitor;
+  GFile *file;
+  char *path;
+  int i;
+
+  monitor = monitor_directory (test_dir);
+  g_file_monitor_set_rate_limit (monitor, 50);
+  g_signal_connect (monitor, "changes", G_CALLBACK (monitor_changes), NULL);
+
+  /* drive the rate limiter directly, the way a backend would */
+  path = g_build_filename (test_dir, "limited", NULL);
+  file = g_file_new_for_path (path);
+  for (i = 0; i < 10; i++)
+    g_file_monitor_emit_event (monitor, file, NULL, G_FILE_MONITOR_EVENT_CHANGED);
+
+  /* the first change goes out right away, in both signals */
+  run_main_loop (0.01);
+  g_assert_cmpint (count_events (G_FILE_MONITOR_EVENT_CHANGED), ==, 2);
+
+  /* the rest is sent once after the rate limit */
+  run_main_loop (0.2);
+  g_assert_cmpint (count_events (G_FILE_MONITOR_EVENT_CHANGED), ==, 4);
+  g_assert_cmpint (count_events (G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT), ==, 0);
+
+  /* and the changes are assumed to be done after two seconds */
+  wait_for_event (G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT, "limited");
+  g_assert_cmpint (count_events (G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT), ==, 2);
+
+  g_object_unref (file);
+  g_free (path);
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static gboolean
+set_flag (gpointer data)
+{
+  *(gboolean *) data = TRUE;
+  return FALSE;
+}
+
+static void
+test_rate_limit_wakeups (void)
+{
+  GFileMonitor *monitor;
+  GFile *file;
+  gboolean timed_out;
+  guint timeout_id;
+  char *path;
+  int n_wakeups;
+
+  monitor = monitor_directory (test_dir);
+  path = g_build_filename (test_dir, "sleepy", NULL);
+  file = g_file_new_for_path (path);
+
+  /* a single change should not keep the main loop busy while
+   * the limiter waits to send the virtual changes done hint
+   */
+  g_file_monitor_emit_event (monitor, file, NULL, G_FILE_MONITOR_EVENT_CHANGED);
+
+  timed_out = FALSE;
+  timeout_id = g_timeout_add ((guint) (EVENT_TIMEOUT * 1000), set_flag, &timed_out);
+  n_wakeups = 0;
+  while (!has_event (G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT, "sleepy") && !timed_out)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      n_wakeups++;
+    }
+  if (!timed_out)
+    g_source_remove (timeout_id);
+
+  g_assert (has_event (G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT, "sleepy"));
+  g_assert_cmpint (n_wakeups, <, 10);
+
+  g_object_unref (file);
+  g_free (path);
+  clear_events ();
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  int res;
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  test_dir = g_build_filename (g_get_tmp_dir (), "file-monitor-XXXXXX", NULL);
+  g_assert (mkdtemp (test_dir) != NULL);
+
+  g_test_add_func ("/file-monitor/create", test_create);
+  g_test_add_func ("/file-monitor/rename", test_rename);
+  g_test_add_func ("/file-monitor/move-out", test_move_out);
+  g_test_add_func ("/file-monitor/recursive", test_recursive);
+  g_test_add_func ("/file-monitor/recursive-root-removed", test_recursive_root_removed);
+  g_test_add_func ("/file-monitor/batch", test_batch);
+  g_test_add_func ("/file-monitor/rate-limit", test_rate_limit);
+  g_test_add_func ("/file-monitor/rate-limit-wakeups", test_rate_limit_wakeups);
+  g_test_add_func ("/file-monitor/recursive-performance", test_recursive_performance);
+
+  res = g_test_run ();
+
+  g_rmdir (test_dir);
+  g_free (test_dir);
+
+  return res;
+}
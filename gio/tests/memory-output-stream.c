@@ -85,6 +85,70 @@ test_data_size (void)
   g_object_unref (mo);
 }
 
+static void
+writev_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  GError *error = NULL;
+  gssize res;
+
+  res = g_output_stream_writev_finish (G_OUTPUT_STREAM (source), result, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, 14);
+
+  g_main_loop_quit (user_data);
+}
+
+static void
+test_writev (void)
+{
+  GOutputVector vectors[3] = {
+    { "header:", 7 },
+    { "", 0 },
+    { "payload", 7 }
+  };
+  GOutputStream *mo;
+  GMainLoop *loop;
+  GError *error = NULL;
+  char buffer[10];
+  gssize res;
+
+  /* memory streams get the default implementation, one write per buffer */
+  mo = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  res = g_output_stream_writev (mo, vectors, G_N_ELEMENTS (vectors), NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, 14);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_output_stream_writev_async (mo, vectors, G_N_ELEMENTS (vectors),
+                                G_PRIORITY_DEFAULT, NULL, writev_done, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 28);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo)),
+                    "header:payloadheader:payload", 28) == 0);
+  g_object_unref (mo);
+
+  /* running out of space part way is a short write, not an error */
+  mo = g_memory_output_stream_new (buffer, sizeof (buffer), NULL, NULL);
+  res = g_output_stream_writev (mo, vectors, G_N_ELEMENTS (vectors), NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, sizeof (buffer));
+  g_assert (memcmp (buffer, "header:pay", sizeof (buffer)) == 0);
+
+  res = g_output_stream_writev (mo, vectors + 2, 1, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_assert_cmpint (res, ==, -1);
+  g_clear_error (&error);
+
+  res = g_output_stream_writev (mo, vectors + 1, 1, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, 0);
+  g_object_unref (mo);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -95,6 +159,7 @@ main (int   argc,
 
   g_test_add_func ("/memory-output-stream/truncate", test_truncate);
   g_test_add_func ("/memory-output-stream/get-data-size", test_data_size);
+  g_test_add_func ("/memory-output-stream/writev", test_writev);
 
   return g_test_run();
 }
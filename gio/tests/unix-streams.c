@@ -23,6 +23,8 @@
 #include <gio/gio.h>
 #include <gio/gunixinputstream.h>
 #include <gio/gunixoutputstream.h>
+#include <glib/gstdio.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -242,6 +244,166 @@ test_pipe_io (void)
   g_object_unref (out);
 }
 
+#define SPLICE_DATA_SIZE (1024 * 1024 + 17)
+
+static gpointer
+splice_writer_thread (gpointer data)
+{
+  GOutputStream *out;
+  gsize bytes_written;
+  GError *error = NULL;
+
+  out = g_unix_output_stream_new (writer_pipe[1], TRUE);
+  g_output_stream_write_all (out, data, SPLICE_DATA_SIZE, &bytes_written,
+			     NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (bytes_written, ==, SPLICE_DATA_SIZE);
+  g_object_unref (out);
+
+  return NULL;
+}
+
+static void
+check_file_contents (const char *filename,
+		     const char *data)
+{
+  char *contents;
+  gsize length;
+  GError *error = NULL;
+
+  g_file_get_contents (filename, &contents, &length, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (length, ==, SPLICE_DATA_SIZE);
+  g_assert (memcmp (contents, data, length) == 0);
+  g_free (contents);
+}
+
+static void
+test_splice (void)
+{
+  GThread *writer;
+  GInputStream *in;
+  GOutputStream *out;
+  GCancellable *cancellable;
+  GError *error = NULL;
+  char *data, *pipe_copy, *file_copy;
+  gssize spliced;
+  int fd, i;
+
+  data = g_malloc (SPLICE_DATA_SIZE);
+  for (i = 0; i < SPLICE_DATA_SIZE; i++)
+    data[i] = DATA[i % (sizeof (DATA) - 1)];
+
+  /* pipe to file */
+  g_assert (pipe (writer_pipe) == 0);
+  writer = g_thread_create (splice_writer_thread, data, TRUE, NULL);
+
+  fd = g_file_open_tmp ("unix-streams-XXXXXX", &pipe_copy, &error);
+  g_assert_no_error (error);
+
+  in = g_unix_input_stream_new (writer_pipe[0], TRUE);
+  out = g_unix_output_stream_new (fd, TRUE);
+  spliced = g_output_stream_splice (out, in,
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				    NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (spliced, ==, SPLICE_DATA_SIZE);
+  g_object_unref (in);
+  g_object_unref (out);
+  g_thread_join (writer);
+
+  check_file_contents (pipe_copy, data);
+
+  /* file to file, with a cancellable */
+  cancellable = g_cancellable_new ();
+  fd = g_file_open_tmp ("unix-streams-XXXXXX", &file_copy, &error);
+  g_assert_no_error (error);
+
+  in = g_unix_input_stream_new (g_open (pipe_copy, O_RDONLY, 0), TRUE);
+  out = g_unix_output_stream_new (fd, TRUE);
+  spliced = g_output_stream_splice (out, in,
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				    cancellable, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (spliced, ==, SPLICE_DATA_SIZE);
+  g_object_unref (in);
+  g_object_unref (out);
+
+  check_file_contents (file_copy, data);
+
+  /* cancelled before it starts */
+  g_cancellable_cancel (cancellable);
+  in = g_unix_input_stream_new (g_open (pipe_copy, O_RDONLY, 0), TRUE);
+  out = g_unix_output_stream_new (g_open (file_copy, O_WRONLY, 0), TRUE);
+  spliced = g_output_stream_splice (out, in, 0, cancellable, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_cmpint (spliced, ==, -1);
+  g_clear_error (&error);
+  g_object_unref (in);
+  g_object_unref (out);
+  g_object_unref (cancellable);
+
+  g_unlink (pipe_copy);
+  g_unlink (file_copy);
+  g_free (pipe_copy);
+  g_free (file_copy);
+  g_free (data);
+}
+
+static void
+writev_done (GObject      *source,
+	     GAsyncResult *res,
+	     gpointer      user_data)
+{
+  gssize *written = user_data;
+  GError *error = NULL;
+
+  *written = g_output_stream_writev_finish (G_OUTPUT_STREAM (source), res, &error);
+  g_assert_no_error (error);
+
+  g_main_loop_quit (loop);
+}
+
+static void
+test_writev (void)
+{
+  GOutputVector vectors[3] = {
+    { "abc", 3 },
+    { DATA, sizeof (DATA) - 1 },
+    { "xyz", 3 }
+  };
+  GOutputStream *out;
+  GError *error = NULL;
+  char buf[2 * sizeof (DATA)];
+  gssize written;
+  int fds[2];
+
+  g_assert (pipe (fds) == 0);
+  out = g_unix_output_stream_new (fds[1], TRUE);
+
+  written = g_output_stream_writev (out, vectors, G_N_ELEMENTS (vectors),
+				    NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (written, ==, sizeof (DATA) + 5);
+  g_assert_cmpint (read (fds[0], buf, sizeof (buf)), ==, written);
+  g_assert (memcmp (buf, "abc" DATA "xyz", written) == 0);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_output_stream_writev_async (out, vectors + 1, 2, G_PRIORITY_DEFAULT,
+				NULL, writev_done, &written);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+
+  g_assert_cmpint (written, ==, sizeof (DATA) + 2);
+  g_assert_cmpint (read (fds[0], buf, sizeof (buf)), ==, written);
+  g_assert (memcmp (buf, DATA "xyz", written) == 0);
+
+  g_object_unref (out);
+  close (fds[0]);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -251,6 +413,8 @@ main (int   argc,
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/unix-streams/pipe-io-test", test_pipe_io);
+  g_test_add_func ("/unix-streams/splice", test_splice);
+  g_test_add_func ("/unix-streams/writev", test_writev);
 
   return g_test_run();
 }
@@ -49,6 +49,7 @@ typedef struct XdgDirTimeList XdgDirTimeList;
 typedef struct XdgCallbackList XdgCallbackList;
 
 static int need_reread = TRUE;
+static int auto_reload = TRUE;
 static time_t last_stat_time = 0;
 
 static XdgGlobHash *global_hash = NULL;
@@ -73,9 +74,21 @@ enum
   XDG_CHECKED_INVALID
 };
 
+/* Nanoseconds of the mtime, so that a change in the same second as
+ * the last load is noticed too
+ */
+#if defined (HAVE_STRUCT_STAT_ST_MTIMENSEC)
+#define XDG_MTIME_NSEC(st) ((st)->st_mtimensec)
+#elif defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+#define XDG_MTIME_NSEC(st) ((st)->st_mtim.tv_nsec)
+#else
+#define XDG_MTIME_NSEC(st) 0
+#endif
+
 struct XdgDirTimeList
 {
   time_t mtime;
+  long mtime_nsec;
   char *directory_name;
   int checked;
   XdgDirTimeList *next;
@@ -97,8 +110,8 @@ typedef int (*XdgDirectoryFunc) (const char *directory,
 				 void       *user_data);
 
 static void
-xdg_dir_time_list_add (char   *file_name, 
-		       time_t  mtime)
+xdg_dir_time_list_add (char        *file_name, 
+		       struct stat *st)
 {
   XdgDirTimeList *list;
 
@@ -114,7 +127,8 @@ xdg_dir_time_list_add (char   *file_name,
   list = calloc (1, sizeof (XdgDirTimeList));
   list->checked = XDG_CHECKED_UNCHECKED;
   list->directory_name = file_name;
-  list->mtime = mtime;
+  list->mtime = st->st_mtime;
+  list->mtime_nsec = XDG_MTIME_NSEC (st);
   list->next = dir_time_list;
   dir_time_list = list;
 }
@@ -149,7 +163,7 @@ xdg_mime_init_from_directory (const char *directory)
 
       if (cache != NULL)
 	{
-	  xdg_dir_time_list_add (file_name, st.st_mtime);
+	  xdg_dir_time_list_add (file_name, &st);
 
 	  _caches = realloc (_caches, sizeof (XdgMimeCache *) * (n_caches + 2));
 	  _caches[n_caches] = cache;
@@ -166,7 +180,7 @@ xdg_mime_init_from_directory (const char *directory)
   if (stat (file_name, &st) == 0)
     {
       _xdg_mime_glob_read_from_file (global_hash, file_name);
-      xdg_dir_time_list_add (file_name, st.st_mtime);
+      xdg_dir_time_list_add (file_name, &st);
     }
   else
     {
@@ -176,7 +190,7 @@ xdg_mime_init_from_directory (const char *directory)
       if (stat (file_name, &st) == 0)
         {
           _xdg_mime_glob_read_from_file (global_hash, file_name);
-          xdg_dir_time_list_add (file_name, st.st_mtime);
+          xdg_dir_time_list_add (file_name, &st);
         }
       else
         {
@@ -189,7 +203,7 @@ xdg_mime_init_from_directory (const char *directory)
   if (stat (file_name, &st) == 0)
     {
       _xdg_mime_magic_read_from_file (global_magic, file_name);
-      xdg_dir_time_list_add (file_name, st.st_mtime);
+      xdg_dir_time_list_add (file_name, &st);
     }
   else
     {
@@ -319,7 +333,8 @@ xdg_check_file (const char *file_path,
 	{
 	  if (! strcmp (list->directory_name, file_path))
 	    {
-	      if (st.st_mtime == list->mtime)
+	      if (st.st_mtime == list->mtime &&
+		  XDG_MTIME_NSEC (&st) == list->mtime_nsec)
 		list->checked = XDG_CHECKED_VALID;
 	      else 
 		list->checked = XDG_CHECKED_INVALID;
@@ -439,7 +454,7 @@ xdg_check_time_and_dirs (void)
 static void
 xdg_mime_init (void)
 {
-  if (xdg_check_time_and_dirs ())
+  if (auto_reload && xdg_check_time_and_dirs ())
     {
       xdg_mime_shutdown ();
     }
@@ -455,11 +470,45 @@ xdg_mime_init (void)
 
       xdg_run_command_on_dirs ((XdgDirectoryFunc) xdg_mime_init_from_directory,
 			       NULL);
+      _xdg_glob_hash_compile (global_hash);
 
       need_reread = FALSE;
     }
 }
 
+/* With auto_reload turned off, the public functions never modify
+ * the loaded data, so they can be called from several threads at
+ * once as long as xdg_mime_update() and xdg_mime_shutdown() are not
+ * running.
+ */
+void
+xdg_mime_set_auto_reload (int enabled)
+{
+  auto_reload = enabled;
+}
+
+/* Returns TRUE if any of the files changed since they were loaded.
+ * This only touches the bookkeeping of the checks, not the loaded
+ * data, so it may run while lookups are in progress.
+ */
+int
+xdg_mime_needs_update (void)
+{
+  return xdg_check_dirs ();
+}
+
+/* Loads the data if that hasn't happened yet. Rereads it if
+ * force_reread is set, or if any of the files changed otherwise.
+ */
+void
+xdg_mime_update (int force_reread)
+{
+  if (force_reread || xdg_check_dirs ())
+    xdg_mime_shutdown ();
+
+  xdg_mime_init ();
+}
+
 const char *
 xdg_mime_get_mime_type_for_data (const void *data,
 				 size_t      len,
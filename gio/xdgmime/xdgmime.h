@@ -64,6 +64,9 @@ typedef void (*XdgMimeDestroy)  (void *user_data);
 #define xdg_mime_unalias_mime_type            XDG_ENTRY(unalias_mime_type)
 #define xdg_mime_get_max_buffer_extents       XDG_ENTRY(get_max_buffer_extents)
 #define xdg_mime_shutdown                     XDG_ENTRY(shutdown)
+#define xdg_mime_set_auto_reload              XDG_ENTRY(set_auto_reload)
+#define xdg_mime_needs_update                 XDG_ENTRY(needs_update)
+#define xdg_mime_update                       XDG_ENTRY(update)
 #define xdg_mime_dump                         XDG_ENTRY(dump)
 #define xdg_mime_register_reload_callback     XDG_ENTRY(register_reload_callback)
 #define xdg_mime_remove_callback              XDG_ENTRY(remove_callback)
@@ -107,6 +110,9 @@ const char  *xdg_mime_get_icon                     (const char *mime);
 const char  *xdg_mime_get_generic_icon             (const char *mime);
 int          xdg_mime_get_max_buffer_extents       (void);
 void         xdg_mime_shutdown                     (void);
+void         xdg_mime_set_auto_reload              (int         enabled);
+int          xdg_mime_needs_update                 (void);
+void         xdg_mime_update                       (int         force_reread);
 void         xdg_mime_dump                         (void);
 int          xdg_mime_register_reload_callback     (XdgMimeCallback  callback,
 						    void            *data,
@@ -48,6 +48,7 @@
 
 typedef struct XdgGlobHashNode XdgGlobHashNode;
 typedef struct XdgGlobList XdgGlobList;
+typedef struct XdgGlobMatcher XdgGlobMatcher;
 
 struct XdgGlobHashNode
 {
@@ -70,6 +71,7 @@ struct XdgGlobHash
   XdgGlobList *literal_list;
   XdgGlobHashNode *simple_node;
   XdgGlobList *full_list;
+  XdgGlobMatcher *matcher;
 };
 
 
@@ -365,6 +367,816 @@ static int compare_mime_weight (const void *a, const void *b)
   return aa->weight - bb->weight;
 }
 
+/* XdgGlobMatcher
+ *
+ * _xdg_glob_hash_compile() turns the globs into a matcher that classifies
+ * a file name in time linear in the length of the name, however many globs
+ * there are:
+ *
+ *  - the literals are put in an open addressed hash table
+ *  - the suffix tree is flattened into an array, with the children of each
+ *    node stored next to each other in order, so they can be binary searched
+ *  - the full globs are combined into a single DFA by subset construction
+ *    over the positions in the globs. The DFA only has columns for ASCII;
+ *    after any other character the position sets are stepped directly.
+ *
+ * Globs with syntax the compiler doesn't handle, like character classes,
+ * are still matched with fnmatch().
+ */
+
+#define MAX_DFA_STATES 1024
+
+#define POSITION_IS_SET(set, p) (((set)[(p) >> 5] & (1u << ((p) & 31))) != 0)
+
+typedef struct XdgGlobSuffixNode XdgGlobSuffixNode;
+typedef struct XdgGlobAtom XdgGlobAtom;
+
+struct XdgGlobSuffixNode
+{
+  xdg_unichar_t character;
+  int first_child;
+  int n_children;
+  int first_mime;
+  int n_mimes;
+};
+
+typedef enum
+{
+  XDG_GLOB_ATOM_CHAR,
+  XDG_GLOB_ATOM_ANY,
+  XDG_GLOB_ATOM_STAR,
+  XDG_GLOB_ATOM_SET,
+  XDG_GLOB_ATOM_END
+} XdgGlobAtomType;
+
+struct XdgGlobAtom
+{
+  XdgGlobAtomType type;
+  xdg_unichar_t character;
+  /* first, last pairs for XDG_GLOB_ATOM_SET */
+  xdg_unichar_t *ranges;
+  int n_ranges;
+  int negated;
+  /* The glob ending at an XDG_GLOB_ATOM_END */
+  XdgGlobList *glob;
+};
+
+struct XdgGlobMatcher
+{
+  XdgGlobList **literals;
+  unsigned int literals_mask;
+
+  XdgGlobSuffixNode *suffix_nodes;
+  MimeWeight *suffix_mimes;
+
+  XdgGlobAtom *atoms;
+  int n_atoms;
+  int n_words;
+  unsigned int *start_set;
+
+  /* State 0 is the dead state, state 1 the start state. n_states is 0
+   * if the DFA got too large, and the position sets are stepped instead.
+   */
+  int n_states;
+  int n_classes;
+  unsigned char classes[128];
+  unsigned int *state_sets;
+  int *transitions;
+  int *first_accept;
+  XdgGlobList **accepts;
+
+  /* NULL terminated */
+  XdgGlobList **fallback;
+};
+
+static unsigned int
+_xdg_glob_hash_string (const char *str)
+{
+  unsigned int h = 0;
+
+  while (*str)
+    h = h * 31 + (unsigned char) *str++;
+
+  return h;
+}
+
+static void
+_xdg_glob_matcher_compile_literals (XdgGlobMatcher *matcher,
+				    XdgGlobList    *literal_list)
+{
+  XdgGlobList *list;
+  unsigned int size, i;
+  int n;
+
+  n = 0;
+  for (list = literal_list; list; list = list->next)
+    n++;
+
+  size = 2;
+  while (size < 2 * n)
+    size *= 2;
+
+  matcher->literals = calloc (size, sizeof (XdgGlobList *));
+  matcher->literals_mask = size - 1;
+
+  /* The first of several globs for the same name wins */
+  for (list = literal_list; list; list = list->next)
+    {
+      i = _xdg_glob_hash_string (list->data) & matcher->literals_mask;
+      while (matcher->literals[i] != NULL &&
+	     strcmp (matcher->literals[i]->data, list->data) != 0)
+	i = (i + 1) & matcher->literals_mask;
+
+      if (matcher->literals[i] == NULL)
+	matcher->literals[i] = list;
+    }
+}
+
+static void
+_xdg_glob_suffix_count (XdgGlobHashNode *node,
+			int             *n_nodes)
+{
+  for (; node; node = node->next)
+    {
+      if (node->character == 0)
+	continue;
+
+      (*n_nodes)++;
+      _xdg_glob_suffix_count (node->child, n_nodes);
+    }
+}
+
+static void
+_xdg_glob_matcher_compile_suffixes (XdgGlobMatcher  *matcher,
+				    XdgGlobHashNode *simple_node)
+{
+  XdgGlobHashNode **sources;
+  XdgGlobHashNode *node;
+  XdgGlobSuffixNode *suffix;
+  int n_nodes;
+  int i, n, m;
+
+  n_nodes = 1;
+  _xdg_glob_suffix_count (simple_node, &n_nodes);
+
+  sources = calloc (n_nodes, sizeof (XdgGlobHashNode *));
+  matcher->suffix_nodes = calloc (n_nodes, sizeof (XdgGlobSuffixNode));
+
+  /* Lay the tree out breadth first, node 0 being the root */
+  n = 1;
+  m = 0;
+  for (i = 0; i < n; i++)
+    {
+      suffix = &matcher->suffix_nodes[i];
+      suffix->first_child = n;
+      suffix->first_mime = m;
+
+      if (i == 0)
+	node = simple_node;
+      else
+	{
+	  suffix->character = sources[i]->character;
+	  if (sources[i]->mime_type)
+	    {
+	      m++;
+	      for (node = sources[i]->child; node && node->character == 0; node = node->next)
+		m++;
+	    }
+	  node = sources[i]->child;
+	}
+
+      for (; node; node = node->next)
+	{
+	  if (node->character != 0)
+	    sources[n++] = node;
+	}
+
+      suffix->n_children = n - suffix->first_child;
+      suffix->n_mimes = m - suffix->first_mime;
+    }
+
+  matcher->suffix_mimes = calloc (m > 0 ? m : 1, sizeof (MimeWeight));
+  for (i = 1; i < n; i++)
+    {
+      suffix = &matcher->suffix_nodes[i];
+      m = suffix->first_mime;
+      if (sources[i]->mime_type == NULL)
+	continue;
+
+      matcher->suffix_mimes[m].mime = sources[i]->mime_type;
+      matcher->suffix_mimes[m].weight = sources[i]->weight;
+      m++;
+      for (node = sources[i]->child; node && node->character == 0; node = node->next)
+	{
+	  matcher->suffix_mimes[m].mime = node->mime_type;
+	  matcher->suffix_mimes[m].weight = node->weight;
+	  m++;
+	}
+    }
+
+  free (sources);
+}
+
+static XdgGlobAtom *
+_xdg_glob_matcher_add_atom (XdgGlobMatcher  *matcher,
+			    XdgGlobAtomType  type,
+			    int             *n_allocated)
+{
+  XdgGlobAtom *atom;
+
+  if (matcher->n_atoms == *n_allocated)
+    {
+      *n_allocated = *n_allocated ? 2 * *n_allocated : 64;
+      matcher->atoms = realloc (matcher->atoms, *n_allocated * sizeof (XdgGlobAtom));
+    }
+
+  atom = &matcher->atoms[matcher->n_atoms++];
+  memset (atom, 0, sizeof (XdgGlobAtom));
+  atom->type = type;
+
+  return atom;
+}
+
+/* Parses a bracket expression, p pointing past the '['. Returns a pointer
+ * past the closing ']', or NULL if it can't be compiled.
+ */
+static const char *
+_xdg_glob_parse_set (const char  *p,
+		     XdgGlobAtom *atom)
+{
+  xdg_unichar_t first, last;
+  int first_in_set = TRUE;
+
+  if (*p == '!' || *p == '^')
+    {
+      atom->negated = TRUE;
+      p++;
+    }
+
+  while (TRUE)
+    {
+      if (*p == '\0')
+	return NULL;
+      if (*p == ']' && !first_in_set)
+	return p + 1;
+      if (*p == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.'))
+	return NULL;
+
+      if (*p == '\\' && *++p == '\0')
+	return NULL;
+      first = _xdg_utf8_to_ucs4 (p);
+      p = _xdg_utf8_next_char (p);
+
+      last = first;
+      if (*p == '-' && p[1] != ']' && p[1] != '\0')
+	{
+	  p++;
+	  if (*p == '\\' && *++p == '\0')
+	    return NULL;
+	  last = _xdg_utf8_to_ucs4 (p);
+	  p = _xdg_utf8_next_char (p);
+	}
+
+      atom->ranges = realloc (atom->ranges, (atom->n_ranges + 1) * 2 * sizeof (xdg_unichar_t));
+      atom->ranges[2 * atom->n_ranges] = first;
+      atom->ranges[2 * atom->n_ranges + 1] = last;
+      atom->n_ranges++;
+
+      first_in_set = FALSE;
+    }
+}
+
+static void
+_xdg_glob_matcher_remove_atoms (XdgGlobMatcher *matcher,
+				int             n_atoms)
+{
+  while (matcher->n_atoms > n_atoms)
+    free (matcher->atoms[--matcher->n_atoms].ranges);
+}
+
+/* Appends the atoms for glob, or returns FALSE if it can't be compiled */
+static int
+_xdg_glob_matcher_parse (XdgGlobMatcher *matcher,
+			 XdgGlobList    *glob,
+			 int            *n_allocated)
+{
+  XdgGlobAtom *atom;
+  const char *p;
+  int n_atoms;
+
+  n_atoms = matcher->n_atoms;
+  p = glob->data;
+
+  while (*p)
+    {
+      switch (*p)
+	{
+	case '*':
+	  if (matcher->n_atoms == n_atoms ||
+	      matcher->atoms[matcher->n_atoms - 1].type != XDG_GLOB_ATOM_STAR)
+	    _xdg_glob_matcher_add_atom (matcher, XDG_GLOB_ATOM_STAR, n_allocated);
+	  p++;
+	  break;
+	case '?':
+	  _xdg_glob_matcher_add_atom (matcher, XDG_GLOB_ATOM_ANY, n_allocated);
+	  p++;
+	  break;
+	case '[':
+	  atom = _xdg_glob_matcher_add_atom (matcher, XDG_GLOB_ATOM_SET, n_allocated);
+	  p = _xdg_glob_parse_set (p + 1, atom);
+	  if (p == NULL)
+	    {
+	      _xdg_glob_matcher_remove_atoms (matcher, n_atoms);
+	      return FALSE;
+	    }
+	  break;
+	case '\\':
+	  if (p[1] == '\0')
+	    {
+	      _xdg_glob_matcher_remove_atoms (matcher, n_atoms);
+	      return FALSE;
+	    }
+	  p++;
+	  /* fall through */
+	default:
+	  atom = _xdg_glob_matcher_add_atom (matcher, XDG_GLOB_ATOM_CHAR, n_allocated);
+	  atom->character = _xdg_utf8_to_ucs4 (p);
+	  p = _xdg_utf8_next_char (p);
+	  break;
+	}
+    }
+
+  atom = _xdg_glob_matcher_add_atom (matcher, XDG_GLOB_ATOM_END, n_allocated);
+  atom->glob = glob;
+
+  return TRUE;
+}
+
+static int
+_xdg_glob_atom_matches (XdgGlobAtom   *atom,
+			xdg_unichar_t  c)
+{
+  int i;
+
+  switch (atom->type)
+    {
+    case XDG_GLOB_ATOM_CHAR:
+      return c == atom->character;
+    case XDG_GLOB_ATOM_ANY:
+    case XDG_GLOB_ATOM_STAR:
+      return TRUE;
+    case XDG_GLOB_ATOM_SET:
+      for (i = 0; i < atom->n_ranges; i++)
+	{
+	  if (c >= atom->ranges[2 * i] && c <= atom->ranges[2 * i + 1])
+	    return !atom->negated;
+	}
+      return atom->negated;
+    case XDG_GLOB_ATOM_END:
+      break;
+    }
+
+  return FALSE;
+}
+
+static void
+_xdg_glob_matcher_add_position (XdgGlobMatcher *matcher,
+				unsigned int   *set,
+				int             p)
+{
+  /* A star may match nothing, so the position after it is active too */
+  while (TRUE)
+    {
+      set[p >> 5] |= 1u << (p & 31);
+      if (matcher->atoms[p].type != XDG_GLOB_ATOM_STAR)
+	break;
+      p++;
+    }
+}
+
+static void
+_xdg_glob_matcher_step (XdgGlobMatcher *matcher,
+			unsigned int   *set,
+			xdg_unichar_t   c,
+			unsigned int   *next_set)
+{
+  int p;
+
+  memset (next_set, 0, matcher->n_words * sizeof (unsigned int));
+
+  for (p = 0; p < matcher->n_atoms; p++)
+    {
+      if (!POSITION_IS_SET (set, p) ||
+	  !_xdg_glob_atom_matches (&matcher->atoms[p], c))
+	continue;
+
+      if (matcher->atoms[p].type == XDG_GLOB_ATOM_STAR)
+	_xdg_glob_matcher_add_position (matcher, next_set, p);
+      else
+	_xdg_glob_matcher_add_position (matcher, next_set, p + 1);
+    }
+}
+
+static void
+_xdg_glob_matcher_compute_classes (XdgGlobMatcher *matcher,
+				   xdg_unichar_t   representatives[])
+{
+  xdg_unichar_t c;
+  int k, p;
+
+  /* Characters that every atom treats the same share a column */
+  matcher->n_classes = 0;
+  for (c = 0; c < 128; c++)
+    {
+      for (k = 0; k < matcher->n_classes; k++)
+	{
+	  for (p = 0; p < matcher->n_atoms; p++)
+	    {
+	      if (_xdg_glob_atom_matches (&matcher->atoms[p], c) !=
+		  _xdg_glob_atom_matches (&matcher->atoms[p], representatives[k]))
+		break;
+	    }
+	  if (p == matcher->n_atoms)
+	    break;
+	}
+
+      if (k == matcher->n_classes)
+	representatives[matcher->n_classes++] = c;
+      matcher->classes[c] = k;
+    }
+}
+
+static int
+_xdg_glob_matcher_find_state (XdgGlobMatcher *matcher,
+			      unsigned int   *set)
+{
+  int s;
+
+  /* Only done at load time, and there are few states in practice */
+  for (s = 0; s < matcher->n_states; s++)
+    {
+      if (memcmp (&matcher->state_sets[s * matcher->n_words], set,
+		  matcher->n_words * sizeof (unsigned int)) == 0)
+	return s;
+    }
+
+  if (matcher->n_states == MAX_DFA_STATES)
+    return -1;
+
+  memcpy (&matcher->state_sets[s * matcher->n_words], set,
+	  matcher->n_words * sizeof (unsigned int));
+  matcher->n_states++;
+
+  return s;
+}
+
+static void
+_xdg_glob_matcher_build_dfa (XdgGlobMatcher *matcher)
+{
+  xdg_unichar_t representatives[128];
+  unsigned int *set;
+  int s, k, p, t, n;
+
+  if (matcher->n_atoms == 0)
+    return;
+
+  _xdg_glob_matcher_compute_classes (matcher, representatives);
+
+  matcher->state_sets = calloc (MAX_DFA_STATES * matcher->n_words, sizeof (unsigned int));
+  matcher->transitions = malloc (MAX_DFA_STATES * matcher->n_classes * sizeof (int));
+  set = malloc (matcher->n_words * sizeof (unsigned int));
+
+  /* The dead state and the start state */
+  matcher->n_states = 1;
+  _xdg_glob_matcher_find_state (matcher, matcher->start_set);
+
+  for (s = 0; s < matcher->n_states; s++)
+    {
+      for (k = 0; k < matcher->n_classes; k++)
+	{
+	  _xdg_glob_matcher_step (matcher, &matcher->state_sets[s * matcher->n_words],
+				  representatives[k], set);
+	  t = _xdg_glob_matcher_find_state (matcher, set);
+	  if (t < 0)
+	    {
+	      free (set);
+	      free (matcher->state_sets);
+	      free (matcher->transitions);
+	      matcher->state_sets = NULL;
+	      matcher->transitions = NULL;
+	      matcher->n_states = 0;
+	      return;
+	    }
+	  matcher->transitions[s * matcher->n_classes + k] = t;
+	}
+    }
+
+  free (set);
+
+  matcher->state_sets = realloc (matcher->state_sets,
+				 matcher->n_states * matcher->n_words * sizeof (unsigned int));
+  matcher->transitions = realloc (matcher->transitions,
+				  matcher->n_states * matcher->n_classes * sizeof (int));
+
+  /* Collect the globs matching in each state */
+  matcher->first_accept = malloc ((matcher->n_states + 1) * sizeof (int));
+  n = 0;
+  for (s = 0; s < matcher->n_states; s++)
+    for (p = 0; p < matcher->n_atoms; p++)
+      if (matcher->atoms[p].type == XDG_GLOB_ATOM_END &&
+	  POSITION_IS_SET (&matcher->state_sets[s * matcher->n_words], p))
+	n++;
+
+  matcher->accepts = malloc ((n > 0 ? n : 1) * sizeof (XdgGlobList *));
+  n = 0;
+  for (s = 0; s < matcher->n_states; s++)
+    {
+      matcher->first_accept[s] = n;
+      for (p = 0; p < matcher->n_atoms; p++)
+	if (matcher->atoms[p].type == XDG_GLOB_ATOM_END &&
+	    POSITION_IS_SET (&matcher->state_sets[s * matcher->n_words], p))
+	  matcher->accepts[n++] = matcher->atoms[p].glob;
+    }
+  matcher->first_accept[s] = n;
+}
+
+static void
+_xdg_glob_matcher_compile_full (XdgGlobMatcher *matcher,
+				XdgGlobList    *full_list)
+{
+  XdgGlobList *list;
+  int n_allocated = 0;
+  int n_fallback = 0;
+  int p;
+
+  for (list = full_list; list; list = list->next)
+    n_fallback++;
+  matcher->fallback = calloc (n_fallback + 1, sizeof (XdgGlobList *));
+
+  n_fallback = 0;
+  for (list = full_list; list; list = list->next)
+    {
+      if (!_xdg_glob_matcher_parse (matcher, list, &n_allocated))
+	matcher->fallback[n_fallback++] = list;
+    }
+
+  matcher->n_words = (matcher->n_atoms + 31) / 32;
+  if (matcher->n_words == 0)
+    matcher->n_words = 1;
+
+  matcher->start_set = calloc (matcher->n_words, sizeof (unsigned int));
+  for (p = 0; p < matcher->n_atoms; p++)
+    {
+      if (p == 0 || matcher->atoms[p - 1].type == XDG_GLOB_ATOM_END)
+	_xdg_glob_matcher_add_position (matcher, matcher->start_set, p);
+    }
+
+  _xdg_glob_matcher_build_dfa (matcher);
+}
+
+static void
+_xdg_glob_matcher_free (XdgGlobMatcher *matcher)
+{
+  if (matcher == NULL)
+    return;
+
+  _xdg_glob_matcher_remove_atoms (matcher, 0);
+  free (matcher->literals);
+  free (matcher->suffix_nodes);
+  free (matcher->suffix_mimes);
+  free (matcher->atoms);
+  free (matcher->start_set);
+  free (matcher->state_sets);
+  free (matcher->transitions);
+  free (matcher->first_accept);
+  free (matcher->accepts);
+  free (matcher->fallback);
+  free (matcher);
+}
+
+static XdgGlobList *
+_xdg_glob_matcher_lookup_literal (XdgGlobMatcher *matcher,
+				  const char     *file_name)
+{
+  unsigned int i;
+
+  i = _xdg_glob_hash_string (file_name) & matcher->literals_mask;
+  while (matcher->literals[i] != NULL)
+    {
+      if (strcmp (matcher->literals[i]->data, file_name) == 0)
+	return matcher->literals[i];
+      i = (i + 1) & matcher->literals_mask;
+    }
+
+  return NULL;
+}
+
+static int
+_xdg_glob_matcher_lookup_suffix (XdgGlobMatcher *matcher,
+				 const char     *file_name,
+				 int             len,
+				 int             ignore_case,
+				 MimeWeight      mime_types[],
+				 int             n_mime_types)
+{
+  XdgGlobSuffixNode *nodes, *node, *match;
+  const char *p, *q;
+  xdg_unichar_t character;
+  int lo, hi, mid;
+  int n;
+
+  nodes = matcher->suffix_nodes;
+  node = &nodes[0];
+  match = NULL;
+
+  /* Walk down the tree from the end of the name, and use the
+   * longest suffix that has mime types.
+   */
+  p = file_name + len;
+  while (p > file_name && node->n_children > 0)
+    {
+      q = p - 1;
+      while (q > file_name && (*q & 0xc0) == 0x80)
+	q--;
+
+      character = _xdg_utf8_to_ucs4 (q);
+      if (ignore_case)
+	character = _xdg_ucs4_to_lower (character);
+
+      lo = node->first_child;
+      hi = lo + node->n_children;
+      while (lo < hi)
+	{
+	  mid = (lo + hi) / 2;
+	  if (nodes[mid].character < character)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+
+      if (lo == node->first_child + node->n_children ||
+	  nodes[lo].character != character)
+	break;
+
+      node = &nodes[lo];
+      if (node->n_mimes > 0)
+	match = node;
+      p = q;
+    }
+
+  if (match == NULL)
+    return 0;
+
+  for (n = 0; n < match->n_mimes && n < n_mime_types; n++)
+    mime_types[n] = matcher->suffix_mimes[match->first_mime + n];
+
+  return n;
+}
+
+static int
+_xdg_glob_matcher_lookup_full (XdgGlobMatcher *matcher,
+			       const char     *file_name,
+			       MimeWeight      mime_types[],
+			       int             n_mime_types)
+{
+  unsigned int *set, *next_set, *tmp;
+  const char *p;
+  xdg_unichar_t character;
+  int state;
+  int i, n;
+
+  n = 0;
+  p = file_name;
+  state = 0;
+
+  if (matcher->n_atoms == 0)
+    goto fallback;
+
+  if (matcher->n_states > 0)
+    {
+      state = 1;
+      while (*p && state != 0)
+	{
+	  character = _xdg_utf8_to_ucs4 (p);
+	  if (character >= 128)
+	    break;
+	  state = matcher->transitions[state * matcher->n_classes + matcher->classes[character]];
+	  p = _xdg_utf8_next_char (p);
+	}
+
+      if (*p == '\0' || state == 0)
+	{
+	  for (i = matcher->first_accept[state];
+	       i < matcher->first_accept[state + 1] && n < n_mime_types;
+	       i++)
+	    {
+	      mime_types[n].mime = matcher->accepts[i]->mime_type;
+	      mime_types[n].weight = matcher->accepts[i]->weight;
+	      n++;
+	    }
+	  goto fallback;
+	}
+    }
+
+  /* Continue on the position sets from where the DFA stopped */
+  set = malloc (matcher->n_words * sizeof (unsigned int));
+  next_set = malloc (matcher->n_words * sizeof (unsigned int));
+
+  if (matcher->n_states > 0)
+    memcpy (set, &matcher->state_sets[state * matcher->n_words],
+	    matcher->n_words * sizeof (unsigned int));
+  else
+    memcpy (set, matcher->start_set, matcher->n_words * sizeof (unsigned int));
+
+  for (; *p; p = _xdg_utf8_next_char (p))
+    {
+      _xdg_glob_matcher_step (matcher, set, _xdg_utf8_to_ucs4 (p), next_set);
+      tmp = set;
+      set = next_set;
+      next_set = tmp;
+    }
+
+  for (i = 0; i < matcher->n_atoms && n < n_mime_types; i++)
+    {
+      if (matcher->atoms[i].type == XDG_GLOB_ATOM_END && POSITION_IS_SET (set, i))
+	{
+	  mime_types[n].mime = matcher->atoms[i].glob->mime_type;
+	  mime_types[n].weight = matcher->atoms[i].glob->weight;
+	  n++;
+	}
+    }
+
+  free (set);
+  free (next_set);
+
+ fallback:
+  for (i = 0; matcher->fallback[i] != NULL && n < n_mime_types; i++)
+    {
+      if (fnmatch (matcher->fallback[i]->data, file_name, 0) == 0)
+	{
+	  mime_types[n].mime = matcher->fallback[i]->mime_type;
+	  mime_types[n].weight = matcher->fallback[i]->weight;
+	  n++;
+	}
+    }
+
+  return n;
+}
+
+/* The matcher decodes the name one character at a time, which runs
+ * past the end of names that aren't well formed UTF-8.
+ */
+static int
+_xdg_glob_name_is_utf8 (const char *file_name)
+{
+  const unsigned char *p;
+  int i, len;
+
+  for (p = (const unsigned char *) file_name; *p; p += len)
+    {
+      len = _xdg_utf8_char_size (p);
+      if ((*p & 0xc0) == 0x80 || *p >= 0xfe)
+	return FALSE;
+      for (i = 1; i < len; i++)
+	if ((p[i] & 0xc0) != 0x80)
+	  return FALSE;
+    }
+
+  return TRUE;
+}
+
+static int
+_xdg_glob_matcher_lookup_file_name (XdgGlobMatcher *matcher,
+				    const char     *file_name,
+				    MimeWeight      mime_types[],
+				    int             n_mime_types)
+{
+  XdgGlobList *literal;
+  int len;
+  int n;
+
+  literal = _xdg_glob_matcher_lookup_literal (matcher, file_name);
+  if (literal != NULL)
+    {
+      mime_types[0].mime = literal->mime_type;
+      mime_types[0].weight = literal->weight;
+      return 1;
+    }
+
+  len = strlen (file_name);
+  n = _xdg_glob_matcher_lookup_suffix (matcher, file_name, len, FALSE,
+				       mime_types, n_mime_types);
+  if (n == 0)
+    n = _xdg_glob_matcher_lookup_suffix (matcher, file_name, len, TRUE,
+					 mime_types, n_mime_types);
+  if (n == 0)
+    n = _xdg_glob_matcher_lookup_full (matcher, file_name,
+				       mime_types, n_mime_types);
+
+  return n;
+}
+
+
 int
 _xdg_glob_hash_lookup_file_name (XdgGlobHash *glob_hash,
 				 const char  *file_name,
@@ -378,10 +1190,18 @@ _xdg_glob_hash_lookup_file_name (XdgGlobHash *glob_hash,
   xdg_unichar_t *ucs4;
   int len;
 
-  /* First, check the literals */
-
   assert (file_name != NULL && n_mime_types > 0);
 
+  /* Names that aren't UTF-8 are matched byte by byte on the lists */
+  if (glob_hash->matcher != NULL && _xdg_glob_name_is_utf8 (file_name))
+    {
+      n = _xdg_glob_matcher_lookup_file_name (glob_hash->matcher, file_name,
+					      mimes, n_mimes);
+      goto done;
+    }
+
+  /* First, check the literals */
+
   n = 0;
 
   for (list = glob_hash->literal_list; list; list = list->next)
@@ -413,6 +1233,7 @@ _xdg_glob_hash_lookup_file_name (XdgGlobHash *glob_hash,
         }
     }
 
+ done:
   qsort (mimes, n, sizeof (MimeWeight), compare_mime_weight);
 
   if (n_mime_types < n)
@@ -458,12 +1279,32 @@ _xdg_glob_hash_free_nodes (XdgGlobHashNode *node)
 void
 _xdg_glob_hash_free (XdgGlobHash *glob_hash)
 {
+  _xdg_glob_matcher_free (glob_hash->matcher);
   _xdg_glob_list_free (glob_hash->literal_list);
   _xdg_glob_list_free (glob_hash->full_list);
   _xdg_glob_hash_free_nodes (glob_hash->simple_node);
   free (glob_hash);
 }
 
+/* Builds the matcher used by _xdg_glob_hash_lookup_file_name(). Must be
+ * called again after appending globs, until then the lookups fall back
+ * to walking the lists.
+ */
+void
+_xdg_glob_hash_compile (XdgGlobHash *glob_hash)
+{
+  XdgGlobMatcher *matcher;
+
+  _xdg_glob_matcher_free (glob_hash->matcher);
+
+  matcher = calloc (1, sizeof (XdgGlobMatcher));
+  _xdg_glob_matcher_compile_literals (matcher, glob_hash->literal_list);
+  _xdg_glob_matcher_compile_suffixes (matcher, glob_hash->simple_node);
+  _xdg_glob_matcher_compile_full (matcher, glob_hash->full_list);
+
+  glob_hash->matcher = matcher;
+}
+
 XdgGlobType
 _xdg_glob_determine_type (const char *glob)
 {
@@ -503,6 +1344,9 @@ _xdg_glob_hash_append_glob (XdgGlobHash *glob_hash,
 
   type = _xdg_glob_determine_type (glob);
 
+  _xdg_glob_matcher_free (glob_hash->matcher);
+  glob_hash->matcher = NULL;
+
   switch (type)
     {
     case XDG_GLOB_LITERAL:
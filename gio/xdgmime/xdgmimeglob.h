@@ -46,6 +46,7 @@ typedef enum
 #define _xdg_glob_hash_free                   XDG_RESERVED_ENTRY(hash_free)
 #define _xdg_glob_hash_lookup_file_name       XDG_RESERVED_ENTRY(hash_lookup_file_name)
 #define _xdg_glob_hash_append_glob            XDG_RESERVED_ENTRY(hash_append_glob)
+#define _xdg_glob_hash_compile                XDG_RESERVED_ENTRY(hash_compile)
 #define _xdg_glob_determine_type              XDG_RESERVED_ENTRY(determine_type)
 #define _xdg_glob_hash_dump                   XDG_RESERVED_ENTRY(hash_dump)
 #endif
@@ -62,6 +63,7 @@ void         _xdg_glob_hash_append_glob      (XdgGlobHash *glob_hash,
 					      const char  *glob,
 					      const char  *mime_type,
 					      int          weight);
+void         _xdg_glob_hash_compile          (XdgGlobHash *glob_hash);
 XdgGlobType  _xdg_glob_determine_type        (const char  *glob);
 void         _xdg_glob_hash_dump             (XdgGlobHash *glob_hash);
 
@@ -53,6 +53,7 @@
 
 typedef struct XdgMimeMagicMatch XdgMimeMagicMatch;
 typedef struct XdgMimeMagicMatchlet XdgMimeMagicMatchlet;
+typedef struct XdgMimeMagicIndexEntry XdgMimeMagicIndexEntry;
 
 typedef enum
 {
@@ -84,10 +85,33 @@ struct XdgMimeMagicMatchlet
 };
 
 
+/* Top level matchlets that compare their first byte unmasked, over a
+ * short range of offsets, are entered in an index by offset and first
+ * byte. Only the matches found in the index for a buffer, and the ones
+ * that couldn't be indexed, need to be compared against it.
+ */
+#define MAX_INDEXED_RANGE 32
+
+struct XdgMimeMagicIndexEntry
+{
+  int offset;
+  int match;
+  unsigned char byte;
+};
+
 struct XdgMimeMagic
 {
   XdgMimeMagicMatch *match_list;
   int max_extent;
+
+  /* The index, see _xdg_mime_magic_build_index() */
+  XdgMimeMagicMatch **matches;
+  int n_matches;
+  unsigned char *unindexed;
+  XdgMimeMagicIndexEntry *entries;
+  int *slot_offsets;
+  int *slot_starts;
+  int n_slots;
 };
 
 static XdgMimeMagicMatch *
@@ -521,7 +545,34 @@ _xdg_mime_magic_matchlet_compare_to_data (XdgMimeMagicMatchlet *matchlet,
 					  const void           *data,
 					  size_t                len)
 {
+  const unsigned char *bytes = data;
+  const unsigned char *p, *end;
   int i, j;
+
+  if (matchlet->mask == NULL && matchlet->value_length > 0)
+    {
+      /* Let memchr() and memcmp() do the comparing, they look at
+       * several bytes at a time.
+       */
+      if (matchlet->offset + matchlet->value_length > len)
+	return FALSE;
+
+      p = bytes + matchlet->offset;
+      end = p + matchlet->range_length;
+      if (end > bytes + len - matchlet->value_length + 1)
+	end = bytes + len - matchlet->value_length + 1;
+
+      while (p < end &&
+	     (p = memchr (p, matchlet->value[0], end - p)) != NULL)
+	{
+	  if (memcmp (p + 1, matchlet->value + 1, matchlet->value_length - 1) == 0)
+	    return TRUE;
+	  p++;
+	}
+
+      return FALSE;
+    }
+
   for (i = matchlet->offset; i < matchlet->offset + matchlet->range_length; i++)
     {
       int valid_matchlet = TRUE;
@@ -637,10 +688,28 @@ _xdg_mime_magic_new (void)
   return calloc (1, sizeof (XdgMimeMagic));
 }
 
+static void
+_xdg_mime_magic_free_index (XdgMimeMagic *mime_magic)
+{
+  free (mime_magic->matches);
+  free (mime_magic->unindexed);
+  free (mime_magic->entries);
+  free (mime_magic->slot_offsets);
+  free (mime_magic->slot_starts);
+  mime_magic->matches = NULL;
+  mime_magic->n_matches = 0;
+  mime_magic->unindexed = NULL;
+  mime_magic->entries = NULL;
+  mime_magic->slot_offsets = NULL;
+  mime_magic->slot_starts = NULL;
+  mime_magic->n_slots = 0;
+}
+
 void
 _xdg_mime_magic_free (XdgMimeMagic *mime_magic)
 {
   if (mime_magic) {
+    _xdg_mime_magic_free_index (mime_magic);
     _xdg_mime_magic_match_free (mime_magic->match_list);
     free (mime_magic);
   }
@@ -652,6 +721,46 @@ _xdg_mime_magic_get_buffer_extents (XdgMimeMagic *mime_magic)
   return mime_magic->max_extent;
 }
 
+/* Marks the matches that can match data */
+static void
+_xdg_mime_magic_find_candidates (XdgMimeMagic  *mime_magic,
+				 const void    *data,
+				 size_t         len,
+				 unsigned char *candidates)
+{
+  XdgMimeMagicIndexEntry *entries;
+  unsigned char byte;
+  int s, lo, hi, mid;
+
+  if (mime_magic->n_matches == 0)
+    return;
+
+  memcpy (candidates, mime_magic->unindexed, mime_magic->n_matches);
+
+  entries = mime_magic->entries;
+  for (s = 0; s < mime_magic->n_slots; s++)
+    {
+      if (mime_magic->slot_offsets[s] >= len)
+	break;
+
+      byte = ((const unsigned char *) data)[mime_magic->slot_offsets[s]];
+
+      lo = mime_magic->slot_starts[s];
+      hi = mime_magic->slot_starts[s + 1];
+      while (lo < hi)
+	{
+	  mid = (lo + hi) / 2;
+	  if (entries[mid].byte < byte)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+
+      for (; lo < mime_magic->slot_starts[s + 1] && entries[lo].byte == byte; lo++)
+	candidates[entries[lo].match] = TRUE;
+    }
+}
+
 const char *
 _xdg_mime_magic_lookup_data (XdgMimeMagic *mime_magic,
 			     const void   *data,
@@ -662,27 +771,38 @@ _xdg_mime_magic_lookup_data (XdgMimeMagic *mime_magic,
 {
   XdgMimeMagicMatch *match;
   const char *mime_type;
-  int n;
+  unsigned char *candidates;
+  int i, j, n;
   int prio;
 
+  candidates = malloc (mime_magic->n_matches + 1);
+  _xdg_mime_magic_find_candidates (mime_magic, data, len, candidates);
+
   prio = 0;
   mime_type = NULL;
-  for (match = mime_magic->match_list; match; match = match->next)
+  for (i = 0; i < mime_magic->n_matches; i++)
     {
-      if (_xdg_mime_magic_match_compare_to_data (match, data, len))
+      match = mime_magic->matches[i];
+      if (candidates[i] &&
+	  _xdg_mime_magic_match_compare_to_data (match, data, len))
 	{
 	  prio = match->priority;
 	  mime_type = match->mime_type;
 	  break;
 	}
-      else 
+    }
+
+  free (candidates);
+
+  /* Every match before i failed */
+  for (j = 0; j < i && n_mime_types > 0; j++)
+    {
+      match = mime_magic->matches[j];
+      for (n = 0; n < n_mime_types; n++)
 	{
-	  for (n = 0; n < n_mime_types; n++)
-	    {
-	      if (mime_types[n] && 
-		  _xdg_mime_mime_type_equal (mime_types[n], match->mime_type))
-		mime_types[n] = NULL;
-	    }
+	  if (mime_types[n] && 
+	      _xdg_mime_mime_type_equal (mime_types[n], match->mime_type))
+	    mime_types[n] = NULL;
 	}
     }
 
@@ -724,6 +844,106 @@ _xdg_mime_update_mime_magic_extents (XdgMimeMagic *mime_magic)
   mime_magic->max_extent = max_extent;
 }
 
+static int
+_xdg_mime_magic_matchlet_is_indexable (XdgMimeMagicMatchlet *matchlet)
+{
+  return matchlet->value_length > 0 &&
+	 (matchlet->mask == NULL || matchlet->mask[0] == 0xff) &&
+	 matchlet->range_length <= MAX_INDEXED_RANGE;
+}
+
+static int
+_xdg_mime_magic_compare_index_entries (const void *a,
+				       const void *b)
+{
+  const XdgMimeMagicIndexEntry *aa = a;
+  const XdgMimeMagicIndexEntry *bb = b;
+
+  if (aa->offset != bb->offset)
+    return aa->offset - bb->offset;
+  if (aa->byte != bb->byte)
+    return aa->byte - bb->byte;
+  return aa->match - bb->match;
+}
+
+static void
+_xdg_mime_magic_build_index (XdgMimeMagic *mime_magic)
+{
+  XdgMimeMagicMatch *match;
+  XdgMimeMagicMatchlet *matchlet;
+  XdgMimeMagicIndexEntry *entry;
+  int n_entries;
+  int i, e, s;
+  unsigned int j;
+
+  _xdg_mime_magic_free_index (mime_magic);
+
+  for (match = mime_magic->match_list; match; match = match->next)
+    mime_magic->n_matches++;
+
+  mime_magic->matches = malloc ((mime_magic->n_matches + 1) * sizeof (XdgMimeMagicMatch *));
+  mime_magic->unindexed = calloc (mime_magic->n_matches + 1, 1);
+
+  /* A match can only succeed if one of its top level matchlets does,
+   * so it is a candidate if any of their first bytes is found.
+   */
+  n_entries = 0;
+  for (i = 0, match = mime_magic->match_list; match; i++, match = match->next)
+    {
+      mime_magic->matches[i] = match;
+      for (matchlet = match->matchlet; matchlet; matchlet = matchlet->next)
+	{
+	  if (matchlet->indent != 0)
+	    continue;
+	  if (_xdg_mime_magic_matchlet_is_indexable (matchlet))
+	    n_entries += matchlet->range_length;
+	  else
+	    mime_magic->unindexed[i] = TRUE;
+	}
+    }
+
+  mime_magic->entries = malloc ((n_entries + 1) * sizeof (XdgMimeMagicIndexEntry));
+  e = 0;
+  for (i = 0; i < mime_magic->n_matches; i++)
+    {
+      if (mime_magic->unindexed[i])
+	continue;
+
+      for (matchlet = mime_magic->matches[i]->matchlet; matchlet; matchlet = matchlet->next)
+	{
+	  if (matchlet->indent != 0)
+	    continue;
+	  for (j = 0; j < matchlet->range_length; j++)
+	    {
+	      entry = &mime_magic->entries[e++];
+	      entry->offset = matchlet->offset + j;
+	      entry->byte = matchlet->value[0];
+	      entry->match = i;
+	    }
+	}
+    }
+  n_entries = e;
+
+  qsort (mime_magic->entries, n_entries, sizeof (XdgMimeMagicIndexEntry),
+	 _xdg_mime_magic_compare_index_entries);
+
+  /* One slot for each offset, with its entries sorted by byte */
+  mime_magic->slot_offsets = malloc ((n_entries + 1) * sizeof (int));
+  mime_magic->slot_starts = malloc ((n_entries + 1) * sizeof (int));
+  s = 0;
+  for (e = 0; e < n_entries; e++)
+    {
+      if (e == 0 || mime_magic->entries[e].offset != mime_magic->entries[e - 1].offset)
+	{
+	  mime_magic->slot_offsets[s] = mime_magic->entries[e].offset;
+	  mime_magic->slot_starts[s] = e;
+	  s++;
+	}
+    }
+  mime_magic->slot_starts[s] = n_entries;
+  mime_magic->n_slots = s;
+}
+
 static XdgMimeMagicMatchlet *
 _xdg_mime_magic_matchlet_mirror (XdgMimeMagicMatchlet *matchlets)
 {
@@ -789,6 +1009,7 @@ _xdg_mime_magic_read_magic_file (XdgMimeMagic *mime_magic,
 	}
     }
   _xdg_mime_update_mime_magic_extents (mime_magic);
+  _xdg_mime_magic_build_index (mime_magic);
 }
 
 void
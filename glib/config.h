@@ -144,6 +144,9 @@
 /* Have nl_langinfo (CODESET) */
 #define HAVE_CODESET 1
 
+/* Define to 1 if you have the `copy_file_range' function. */
+/* #undef HAVE_COPY_FILE_RANGE */
+
 /* Define to 1 if you have the <crt_externs.h> header file. */
 /* #undef HAVE_CRT_EXTERNS_H */
 
@@ -153,6 +156,9 @@
 /* Define to 1 if you have the <dirent.h> header file. */
 #define HAVE_DIRENT_H 1
 
+/* Define to 1 if you have the `dirfd' function. */
+#define HAVE_DIRFD 1
+
 /* Define to 1 if you have the <dlfcn.h> header file. */
 #define HAVE_DLFCN_H 1
 
@@ -189,6 +195,9 @@
 /* Define to 1 if you have the <fstab.h> header file. */
 #define HAVE_FSTAB_H 1
 
+/* Define to 1 if you have the `fstatat' function. */
+#define HAVE_FSTATAT 1
+
 /* Define to 1 if you have the `getcwd' function. */
 #define HAVE_GETCWD 1
 
@@ -250,6 +259,12 @@
 /* Define to 1 if you have the `link' function. */
 #define HAVE_LINK 1
 
+/* Define to 1 if you have the <linux/fs.h> header file. */
+/* #undef HAVE_LINUX_FS_H */
+
+/* Define to 1 if you have the <linux/io_uring.h> header file. */
+/* #undef HAVE_LINUX_IO_URING_H */
+
 /* Define to 1 if you have the `localtime_r' function. */
 #define HAVE_LOCALTIME_R 1
 
@@ -328,6 +343,9 @@
 /* Define to 1 if you have the <selinux/selinux.h> header file. */
 /* #undef HAVE_SELINUX_SELINUX_H */
 
+/* Define to 1 if you have the `sendfile' function. */
+/* #undef HAVE_SENDFILE */
+
 /* Define to 1 if you have the `setenv' function. */
 #define HAVE_SETENV 1
 
@@ -340,6 +358,9 @@
 /* Define to 1 if you have the `snprintf' function. */
 #define HAVE_SNPRINTF 1
 
+/* Define to 1 if you have the `splice' function. */
+/* #undef HAVE_SPLICE */
+
 /* Define to 1 if you have the `statfs' function. */
 #define HAVE_STATFS 1
 
@@ -380,6 +401,9 @@
 /* Define to 1 if you have the `strsignal' function. */
 #define HAVE_STRSIGNAL 1
 
+/* Define to 1 if `d_type' is member of `struct dirent'. */
+#define HAVE_STRUCT_DIRENT_D_TYPE 1
+
 /* Define to 1 if `f_bavail' is member of `struct statfs'. */
 #define HAVE_STRUCT_STATFS_F_BAVAIL 1
 
@@ -440,6 +464,9 @@
 /* found fd_set in sys/select.h */
 #define HAVE_SYS_SELECT_H 1
 
+/* Define to 1 if you have the <sys/sendfile.h> header file. */
+/* #undef HAVE_SYS_SENDFILE_H */
+
 /* Define to 1 if you have the <sys/statfs.h> header file. */
 #define HAVE_SYS_STATFS_H 1
 
@@ -42,26 +42,42 @@
 /* --- defines --- */
 #define	G_QUARK_BLOCK_SIZE			(512)
 
+/* the bit above the public flags is used as a per datalist spinlock, so
+ * that accesses to the qdata of unrelated objects don't contend on a
+ * global lock. GData arrays are malloc()ed and thus aligned well enough
+ * to leave the lower three bits of the pointer free.
+ */
+#define G_DATALIST_LOCK_FLAG			(0x4)
+#define G_DATALIST_FLAGS_MASK_INTERNAL		(G_DATALIST_FLAGS_MASK | G_DATALIST_LOCK_FLAG)
+
+/* spins on a held datalist lock before yielding the processor */
+#define G_DATALIST_LOCK_SPINS			(100)
+
 /* datalist pointer accesses have to be carried out atomically */
 #define G_DATALIST_GET_POINTER(datalist)						\
-  ((GData*) ((gsize) g_atomic_pointer_get (datalist) & ~(gsize) G_DATALIST_FLAGS_MASK))
+  ((GData*) ((gsize) g_atomic_pointer_get (datalist) & ~(gsize) G_DATALIST_FLAGS_MASK_INTERNAL))
 
 #define G_DATALIST_SET_POINTER(datalist, pointer)       G_STMT_START {                  \
   gpointer _oldv, _newv;                                                                \
   do {                                                                                  \
     _oldv = g_atomic_pointer_get (datalist);                                            \
-    _newv = (gpointer) (((gsize) _oldv & G_DATALIST_FLAGS_MASK) | (gsize) pointer);     \
+    _newv = (gpointer) (((gsize) _oldv & G_DATALIST_FLAGS_MASK_INTERNAL) | (gsize) pointer); \
   } while (!g_atomic_pointer_compare_and_exchange ((void**) datalist, _oldv, _newv));   \
 } G_STMT_END
 
 /* --- structures --- */
+typedef struct {
+  GQuark          key;
+  gpointer        data;
+  GDestroyNotify  destroy;
+} GDataElt;
+
 typedef struct _GDataset GDataset;
 struct _GData
 {
-  GData *next;
-  GQuark id;
-  gpointer data;
-  GDestroyNotify destroy_func;
+  guint32  len;     /* number of elements */
+  guint32  alloc;   /* number of allocated elements */
+  GDataElt data[1]; /* flexible array */
 };
 
 struct _GDataset
@@ -73,7 +89,8 @@ struct _GDataset
 
 /* --- prototypes --- */
 static inline GDataset*	g_dataset_lookup		(gconstpointer	  dataset_location);
-static inline void	g_datalist_clear_i		(GData		**datalist);
+static inline void	g_datalist_clear_i		(GData		**datalist,
+							 gboolean	  global_locked);
 static void		g_dataset_destroy_internal	(GDataset	 *dataset);
 static inline gpointer	g_data_set_internal		(GData     	**datalist,
 							 GQuark   	  key_id,
@@ -96,47 +113,80 @@ static GQuark        g_quark_seq_id = 0;
 
 /* --- functions --- */
 
-/* HOLDS: g_dataset_global_lock */
-static inline void
-g_datalist_clear_i (GData **datalist)
+/* lock order: g_dataset_global_lock, then the datalist lock */
+static void
+g_datalist_lock (GData **datalist)
 {
-  register GData *list;
-  
-  /* unlink *all* items before walking their destructors
-   */
-  list = G_DATALIST_GET_POINTER (datalist);
-  G_DATALIST_SET_POINTER (datalist, NULL);
-  
-  while (list)
+  guint spins = 0;
+
+  while (TRUE)
     {
-      register GData *prev;
-      
-      prev = list;
-      list = prev->next;
-      
-      if (prev->destroy_func)
+      gpointer oldval = g_atomic_pointer_get (datalist);
+
+      if (!((gsize) oldval & G_DATALIST_LOCK_FLAG))
 	{
-	  G_UNLOCK (g_dataset_global);
-	  prev->destroy_func (prev->data);
-	  G_LOCK (g_dataset_global);
+	  if (g_atomic_pointer_compare_and_exchange ((void**) datalist, oldval,
+						     (gpointer) ((gsize) oldval | G_DATALIST_LOCK_FLAG)))
+	    return;
 	}
-      
-      g_slice_free (GData, prev);
+      else if (++spins >= G_DATALIST_LOCK_SPINS)
+	{
+	  spins = 0;
+	  g_thread_yield ();
+	}
+    }
+}
+
+static void
+g_datalist_unlock (GData **datalist)
+{
+  gpointer oldval;
+
+  /* the public flags may change under us, so this needs to be a loop */
+  do
+    {
+      oldval = g_atomic_pointer_get (datalist);
     }
+  while (!g_atomic_pointer_compare_and_exchange ((void**) datalist, oldval,
+						 (gpointer) ((gsize) oldval & ~(gsize) G_DATALIST_LOCK_FLAG)));
+}
+
+/* HOLDS: g_dataset_global_lock if global_locked */
+static inline void
+g_datalist_clear_i (GData    **datalist,
+		    gboolean   global_locked)
+{
+  GData *data;
+  guint i;
+
+  /* unlink *all* items before walking their destructors
+   */
+  g_datalist_lock (datalist);
+  data = G_DATALIST_GET_POINTER (datalist);
+  G_DATALIST_SET_POINTER (datalist, NULL);
+  g_datalist_unlock (datalist);
+
+  if (!data)
+    return;
+
+  if (global_locked)
+    G_UNLOCK (g_dataset_global);
+  for (i = 0; i < data->len; i++)
+    if (data->data[i].destroy)
+      data->data[i].destroy (data->data[i].data);
+  if (global_locked)
+    G_LOCK (g_dataset_global);
+
+  g_free (data);
 }
 
 void
 g_datalist_clear (GData **datalist)
 {
   g_return_if_fail (datalist != NULL);
-  
-  G_LOCK (g_dataset_global);
-  if (!g_dataset_location_ht)
-    g_data_initialize ();
 
   while (G_DATALIST_GET_POINTER (datalist))
-    g_datalist_clear_i (datalist);
-  G_UNLOCK (g_dataset_global);
+    g_datalist_clear_i (datalist, FALSE);
 }
 
 /* HOLDS: g_dataset_global_lock */
@@ -164,7 +214,7 @@ g_dataset_destroy_internal (GDataset *dataset)
   dataset_location = dataset->location;
   while (dataset)
     {
-      if (!dataset->datalist)
+      if (!G_DATALIST_GET_POINTER (&dataset->datalist))
 	{
 	  if (dataset == g_dataset_cached)
 	    g_dataset_cached = NULL;
@@ -173,7 +223,7 @@ g_dataset_destroy_internal (GDataset *dataset)
 	  break;
 	}
       
-      g_datalist_clear_i (&dataset->datalist);
+      g_datalist_clear_i (&dataset->datalist, TRUE);
       dataset = g_dataset_lookup (dataset_location);
     }
 }
@@ -195,108 +245,135 @@ g_dataset_destroy (gconstpointer  dataset_location)
   G_UNLOCK (g_dataset_global);
 }
 
-/* HOLDS: g_dataset_global_lock */
+/* HOLDS: the datalist lock, which is released before returning;
+ * HOLDS: g_dataset_global_lock if dataset != NULL
+ */
 static inline gpointer
 g_data_set_internal (GData	  **datalist,
 		     GQuark         key_id,
-		     gpointer       data,
-		     GDestroyNotify destroy_func,
+		     gpointer       new_data,
+		     GDestroyNotify new_destroy_func,
 		     GDataset	   *dataset)
 {
-  register GData *list;
-  
-  list = G_DATALIST_GET_POINTER (datalist);
-  if (!data)
+  GData *d;
+  GDataElt old, *data, *data_last, *data_end;
+
+  d = G_DATALIST_GET_POINTER (datalist);
+
+  if (!new_data)
     {
-      register GData *prev;
-      
-      prev = NULL;
-      while (list)
+      if (d)
 	{
-	  if (list->id == key_id)
+	  data = d->data;
+	  data_last = data + d->len - 1;
+	  while (data <= data_last)
 	    {
-	      gpointer ret_data = NULL;
-
-	      if (prev)
-		prev->next = list->next;
-	      else
+	      if (data->key == key_id)
 		{
-		  G_DATALIST_SET_POINTER (datalist, list->next);
-		  
-		  /* the dataset destruction *must* be done
-		   * prior to invocation of the data destroy function
+		  old = *data;
+		  if (data != data_last)
+		    *data = *data_last;
+		  d->len--;
+
+		  /* we don't bother to shrink, but if all data are now
+		   * gone we at least free the memory
 		   */
-		  if (!list->next && dataset)
-		    g_dataset_destroy_internal (dataset);
-		}
-	      
-	      /* the GData struct *must* already be unlinked
-	       * when invoking the destroy function.
-	       * we use (data==NULL && destroy_func!=NULL) as
-	       * a special hint combination to "steal"
-	       * data without destroy notification
-	       */
-	      if (list->destroy_func && !destroy_func)
-		{
-		  G_UNLOCK (g_dataset_global);
-		  list->destroy_func (list->data);
-		  G_LOCK (g_dataset_global);
+		  if (d->len == 0)
+		    {
+		      G_DATALIST_SET_POINTER (datalist, NULL);
+		      g_free (d);
+		      g_datalist_unlock (datalist);
+
+		      /* the dataset destruction *must* be done
+		       * prior to invocation of the data destroy function
+		       */
+		      if (dataset)
+			g_dataset_destroy_internal (dataset);
+		    }
+		  else
+		    g_datalist_unlock (datalist);
+
+		  /* the GData struct *must* already be unlinked
+		   * when invoking the destroy function.
+		   * we use (new_data==NULL && new_destroy_func!=NULL) as
+		   * a special hint combination to "steal"
+		   * data without destroy notification
+		   */
+		  if (old.destroy && !new_destroy_func)
+		    {
+		      if (dataset)
+			G_UNLOCK (g_dataset_global);
+		      old.destroy (old.data);
+		      if (dataset)
+			G_LOCK (g_dataset_global);
+		      old.data = NULL;
+		    }
+
+		  return old.data;
 		}
-	      else
-		ret_data = list->data;
-	      
-              g_slice_free (GData, list);
-	      
-	      return ret_data;
+	      data++;
 	    }
-	  
-	  prev = list;
-	  list = list->next;
 	}
     }
   else
     {
-      while (list)
+      if (d)
 	{
-	  if (list->id == key_id)
+	  data = d->data;
+	  data_end = data + d->len;
+	  while (data < data_end)
 	    {
-	      if (!list->destroy_func)
-		{
-		  list->data = data;
-		  list->destroy_func = destroy_func;
-		}
-	      else
+	      if (data->key == key_id)
 		{
-		  register GDestroyNotify dfunc;
-		  register gpointer ddata;
-		  
-		  dfunc = list->destroy_func;
-		  ddata = list->data;
-		  list->data = data;
-		  list->destroy_func = destroy_func;
-		  
+		  old = *data;
+		  data->data = new_data;
+		  data->destroy = new_destroy_func;
+		  g_datalist_unlock (datalist);
+
 		  /* we need to have updated all structures prior to
 		   * invocation of the destroy function
 		   */
-		  G_UNLOCK (g_dataset_global);
-		  dfunc (ddata);
-		  G_LOCK (g_dataset_global);
+		  if (old.destroy)
+		    {
+		      if (dataset)
+			G_UNLOCK (g_dataset_global);
+		      old.destroy (old.data);
+		      if (dataset)
+			G_LOCK (g_dataset_global);
+		    }
+
+		  return NULL;
 		}
-	      
-	      return NULL;
+	      data++;
 	    }
-	  
-	  list = list->next;
 	}
-      
-      list = g_slice_new (GData);
-      list->next = G_DATALIST_GET_POINTER (datalist);
-      list->id = key_id;
-      list->data = data;
-      list->destroy_func = destroy_func;
-      G_DATALIST_SET_POINTER (datalist, list);
+
+      /* the key was not found, insert it */
+      if (!d)
+	{
+	  d = g_malloc (sizeof (GData));
+	  d->len = 0;
+	  d->alloc = 1;
+	  G_DATALIST_SET_POINTER (datalist, d);
+	}
+      else if (d->len == d->alloc)
+	{
+	  GData *old_d = d;
+
+	  d->alloc = d->alloc * 2;
+	  d = g_realloc (d, sizeof (GData) + (d->alloc - 1) * sizeof (GDataElt));
+	  if (d != old_d)
+	    G_DATALIST_SET_POINTER (datalist, d);
+	}
+
+      d->data[d->len].key = key_id;
+      d->data[d->len].data = new_data;
+      d->data[d->len].destroy = new_destroy_func;
+      d->len++;
     }
 
+  g_datalist_unlock (datalist);
+
   return NULL;
 }
 
@@ -334,6 +411,7 @@ g_dataset_id_set_data_full (gconstpointer  dataset_location,
 			   dataset);
     }
   
+  g_datalist_lock (&dataset->datalist);
   g_data_set_internal (&dataset->datalist, key_id, data, destroy_func, dataset);
   G_UNLOCK (g_dataset_global);
 }
@@ -355,12 +433,8 @@ g_datalist_id_set_data_full (GData	  **datalist,
 	return;
     }
 
-  G_LOCK (g_dataset_global);
-  if (!g_dataset_location_ht)
-    g_data_initialize ();
-  
+  g_datalist_lock (datalist);
   g_data_set_internal (datalist, key_id, data, destroy_func, NULL);
-  G_UNLOCK (g_dataset_global);
 }
 
 gpointer
@@ -378,7 +452,10 @@ g_dataset_id_remove_no_notify (gconstpointer  dataset_location,
   
       dataset = g_dataset_lookup (dataset_location);
       if (dataset)
-	ret_data = g_data_set_internal (&dataset->datalist, key_id, NULL, (GDestroyNotify) 42, dataset);
+	{
+	  g_datalist_lock (&dataset->datalist);
+	  ret_data = g_data_set_internal (&dataset->datalist, key_id, NULL, (GDestroyNotify) 42, dataset);
+	}
     } 
   G_UNLOCK (g_dataset_global);
 
@@ -393,10 +470,11 @@ g_datalist_id_remove_no_notify (GData	**datalist,
 
   g_return_val_if_fail (datalist != NULL, NULL);
 
-  G_LOCK (g_dataset_global);
-  if (key_id && g_dataset_location_ht)
-    ret_data = g_data_set_internal (datalist, key_id, NULL, (GDestroyNotify) 42, NULL);
-  G_UNLOCK (g_dataset_global);
+  if (key_id)
+    {
+      g_datalist_lock (datalist);
+      ret_data = g_data_set_internal (datalist, key_id, NULL, (GDestroyNotify) 42, NULL);
+    }
 
   return ret_data;
 }
@@ -405,6 +483,8 @@ gpointer
 g_dataset_id_get_data (gconstpointer  dataset_location,
 		       GQuark         key_id)
 {
+  gpointer retval = NULL;
+
   g_return_val_if_fail (dataset_location != NULL, NULL);
   
   G_LOCK (g_dataset_global);
@@ -414,20 +494,11 @@ g_dataset_id_get_data (gconstpointer  dataset_location,
       
       dataset = g_dataset_lookup (dataset_location);
       if (dataset)
-	{
-	  register GData *list;
-	  
-	  for (list = dataset->datalist; list; list = list->next)
-	    if (list->id == key_id)
-	      {
-		G_UNLOCK (g_dataset_global);
-		return list->data;
-	      }
-	}
+	retval = g_datalist_id_get_data (&dataset->datalist, key_id);
     }
   G_UNLOCK (g_dataset_global);
  
-  return NULL;
+  return retval;
 }
 
 gpointer
@@ -438,15 +509,22 @@ g_datalist_id_get_data (GData	 **datalist,
   g_return_val_if_fail (datalist != NULL, NULL);
   if (key_id)
     {
-      register GData *list;
-      G_LOCK (g_dataset_global);
-      for (list = G_DATALIST_GET_POINTER (datalist); list; list = list->next)
-	if (list->id == key_id)
-	  {
-            data = list->data;
-            break;
-          }
-      G_UNLOCK (g_dataset_global);
+      GData *d;
+
+      g_datalist_lock (datalist);
+      d = G_DATALIST_GET_POINTER (datalist);
+      if (d)
+	{
+	  GDataElt *elt = d->data, *elt_end = d->data + d->len;
+
+	  for (; elt < elt_end; elt++)
+	    if (elt->key == key_id)
+	      {
+		data = elt->data;
+		break;
+	      }
+	}
+      g_datalist_unlock (datalist);
     }
   return data;
 }
@@ -467,15 +545,7 @@ g_dataset_foreach (gconstpointer    dataset_location,
       dataset = g_dataset_lookup (dataset_location);
       G_UNLOCK (g_dataset_global);
       if (dataset)
-	{
-	  register GData *list, *next;
-	  
-	  for (list = dataset->datalist; list; list = next)
-	    {
-	      next = list->next;
-	      func (list->id, list->data, user_data);
-	    }
-	}
+	g_datalist_foreach (&dataset->datalist, func, user_data);
     }
   else
     {
@@ -488,16 +558,43 @@ g_datalist_foreach (GData	   **datalist,
 		    GDataForeachFunc func,
 		    gpointer         user_data)
 {
-  register GData *list, *next;
+  GData *d;
+  GQuark *keys;
+  guint i, j, len;
 
   g_return_if_fail (datalist != NULL);
   g_return_if_fail (func != NULL);
-  
-  for (list = G_DATALIST_GET_POINTER (datalist); list; list = next)
+
+  d = G_DATALIST_GET_POINTER (datalist);
+  if (!d)
+    return;
+
+  /* we make a copy of the keys so that we can handle it changing
+   * in the callback
+   */
+  len = d->len;
+  keys = g_new (GQuark, len);
+  for (i = 0; i < len; i++)
+    keys[i] = d->data[i].key;
+
+  for (i = 0; i < len; i++)
     {
-      next = list->next;
-      func (list->id, list->data, user_data);
+      /* a previous callback might have removed a later item, so
+       * look it up again
+       */
+      d = G_DATALIST_GET_POINTER (datalist);
+      if (!d)
+	break;
+      for (j = 0; j < d->len; j++)
+	{
+	  if (d->data[j].key == keys[i])
+	    {
+	      func (d->data[j].key, d->data[j].data, user_data);
+	      break;
+	    }
+	}
     }
+  g_free (keys);
 }
 
 void
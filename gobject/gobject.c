@@ -113,6 +113,19 @@
     ((G_DATALIST_GET_FLAGS (&(object)->qdata) & OBJECT_HAS_TOGGLE_REF_FLAG) != 0)
 #define OBJECT_FLOATING_FLAG 0x2
 
+#define CLASS_HAS_PROPS_FLAG 0x1
+#define CLASS_HAS_PROPS(class) \
+    ((class)->flags & CLASS_HAS_PROPS_FLAG)
+#define CLASS_HAS_CUSTOM_CONSTRUCTOR(class) \
+    ((class)->constructor != g_object_constructor)
+
+/* property lookups by name are cached per class in a small direct-mapped
+ * table, indexed by the address of the name string. callers mostly pass
+ * string literals, so repeated lookups skip the pspec pool lock and hash.
+ */
+#define PSPEC_CACHE_SIZE		32	/* power of 2 */
+#define PSPEC_CACHE_SLOT(name)		((GPOINTER_TO_SIZE (name) ^ (GPOINTER_TO_SIZE (name) >> 5)) & (PSPEC_CACHE_SIZE - 1))
+
 
 /* --- signals --- */
 enum {
@@ -131,7 +144,8 @@ enum {
 static void	g_object_base_class_init		(GObjectClass	*class);
 static void	g_object_base_class_finalize		(GObjectClass	*class);
 static void	g_object_do_class_init			(GObjectClass	*class);
-static void	g_object_init				(GObject	*object);
+static void	g_object_init				(GObject	*object,
+							 GObjectClass	*class);
 static GObject*	g_object_constructor			(GType                  type,
 							 guint                  n_construct_properties,
 							 GObjectConstructParam *construct_params);
@@ -279,6 +293,7 @@ g_object_base_class_init (GObjectClass *class)
 
   /* reset instance specific fields and methods that don't get inherited */
   class->construct_properties = pclass ? g_slist_copy (pclass->construct_properties) : NULL;
+  class->pspec_cache = NULL;
   class->get_property = NULL;
   class->set_property = NULL;
 }
@@ -292,6 +307,8 @@ g_object_base_class_finalize (GObjectClass *class)
 
   g_slist_free (class->construct_properties);
   class->construct_properties = NULL;
+  g_free (class->pspec_cache);
+  class->pspec_cache = NULL;
   list = g_param_spec_pool_list_owned (pspec_pool, G_OBJECT_CLASS_TYPE (class));
   for (node = list; node; node = node->next)
     {
@@ -390,6 +407,56 @@ install_property_internal (GType       g_type,
   g_param_spec_pool_insert (pspec_pool, pspec, g_type);
 }
 
+static inline GParamSpec*
+class_find_pspec (GObjectClass *class,
+		  const gchar  *property_name)
+{
+  GParamSpec **cache = g_atomic_pointer_get (&class->pspec_cache);
+  guint slot = PSPEC_CACHE_SLOT (property_name);
+  GParamSpec *pspec;
+
+  /* a slot may hold the pspec of a different name that hashes alike,
+   * the name comparison guards against that and against canonicalization
+   */
+  if (cache)
+    {
+      pspec = g_atomic_pointer_get (&cache[slot]);
+      if (pspec && strcmp (pspec->name, property_name) == 0)
+	return pspec;
+    }
+
+  pspec = g_param_spec_pool_lookup (pspec_pool,
+				    property_name,
+				    G_OBJECT_CLASS_TYPE (class),
+				    TRUE);
+  if (pspec && strcmp (pspec->name, property_name) == 0)
+    {
+      if (!cache)
+	{
+	  cache = g_new0 (GParamSpec*, PSPEC_CACHE_SIZE);
+	  if (!g_atomic_pointer_compare_and_exchange ((gpointer*) &class->pspec_cache, NULL, cache))
+	    {
+	      g_free (cache);
+	      cache = g_atomic_pointer_get (&class->pspec_cache);
+	    }
+	}
+      g_atomic_pointer_set (&cache[slot], pspec);
+    }
+
+  return pspec;
+}
+
+static void
+class_clear_pspec_cache (GObjectClass *class)
+{
+  GParamSpec **cache = g_atomic_pointer_get (&class->pspec_cache);
+  guint i;
+
+  if (cache)
+    for (i = 0; i < PSPEC_CACHE_SIZE; i++)
+      g_atomic_pointer_set (&cache[i], NULL);
+}
+
 /**
  * g_object_class_install_property:
  * @oclass: a #GObjectClass
@@ -421,6 +488,9 @@ g_object_class_install_property (GObjectClass *class,
     g_return_if_fail (pspec->flags & G_PARAM_WRITABLE);
 
   install_property_internal (G_OBJECT_CLASS_TYPE (class), property_id, pspec);
+  /* the new pspec may shadow an inherited one that is cached already */
+  class_clear_pspec_cache (class);
+  class->flags |= CLASS_HAS_PROPS_FLAG;
 
   if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
     class->construct_properties = g_slist_prepend (class->construct_properties, pspec);
@@ -490,10 +560,7 @@ g_object_class_find_property (GObjectClass *class,
   g_return_val_if_fail (G_IS_OBJECT_CLASS (class), NULL);
   g_return_val_if_fail (property_name != NULL, NULL);
   
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_CLASS_TYPE (class),
-				    TRUE);
+  pspec = class_find_pspec (class, property_name);
   if (pspec)
     {
       redirect = g_param_spec_get_redirect_target (pspec);
@@ -682,17 +749,29 @@ g_object_interface_list_properties (gpointer      g_iface,
 }
 
 static void
-g_object_init (GObject *object)
+g_object_init (GObject		*object,
+	       GObjectClass	*class)
 {
   object->ref_count = 1;
   g_datalist_init (&object->qdata);
-  
-  /* freeze object's notification queue, g_object_newv() preserves pairedness */
-  g_object_notify_queue_freeze (object, &property_notify_context);
-  /* enter construction list for notify_queue_thaw() and to allow construct-only properties */
-  G_LOCK (construction_mutex);
-  construction_objects = g_slist_prepend (construction_objects, object);
-  G_UNLOCK (construction_mutex);
+
+  /* objects without properties never notify, so skip the queue */
+  if (CLASS_HAS_PROPS (class))
+    {
+      /* freeze object's notification queue, g_object_newv() preserves pairedness */
+      g_object_notify_queue_freeze (object, &property_notify_context);
+    }
+
+  /* g_object_constructor() always returns a new instance and sets construct
+   * properties itself, only custom constructors need the construction list
+   */
+  if (CLASS_HAS_CUSTOM_CONSTRUCTOR (class))
+    {
+      /* enter construction list for notify_queue_thaw() and to allow construct-only properties */
+      G_LOCK (construction_mutex);
+      construction_objects = g_slist_prepend (construction_objects, object);
+      G_UNLOCK (construction_mutex);
+    }
 
 #ifdef	G_ENABLE_DEBUG
   IF_DEBUG (OBJECTS)
@@ -838,10 +917,7 @@ g_object_notify (GObject     *object,
    * (by, e.g. calling g_object_class_find_property())
    * because g_object_notify_queue_add() does that
    */
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_TYPE (object),
-				    TRUE);
+  pspec = class_find_pspec (G_OBJECT_GET_CLASS (object), property_name);
 
   if (!pspec)
     g_warning ("%s: object class `%s' has no property named `%s'",
@@ -1141,10 +1217,7 @@ g_object_newv (GType       object_type,
   for (i = 0; i < n_parameters; i++)
     {
       GValue *value = &parameters[i].value;
-      GParamSpec *pspec = g_param_spec_pool_lookup (pspec_pool,
-						    parameters[i].name,
-						    object_type,
-						    TRUE);
+      GParamSpec *pspec = class_find_pspec (class, parameters[i].name);
       if (!pspec)
 	{
 	  g_warning ("%s: object class `%s' has no property named `%s'",
@@ -1220,13 +1293,22 @@ g_object_newv (GType       object_type,
   g_free (cvalues);
 
   /* adjust freeze_count according to g_object_init() and remaining properties */
-  G_LOCK (construction_mutex);
-  newly_constructed = slist_maybe_remove (&construction_objects, object);
-  G_UNLOCK (construction_mutex);
-  if (newly_constructed || n_oparams)
-    nqueue = g_object_notify_queue_freeze (object, &property_notify_context);
-  if (newly_constructed)
-    g_object_notify_queue_thaw (object, nqueue);
+  if (CLASS_HAS_CUSTOM_CONSTRUCTOR (class))
+    {
+      G_LOCK (construction_mutex);
+      newly_constructed = slist_maybe_remove (&construction_objects, object);
+      G_UNLOCK (construction_mutex);
+    }
+  else
+    newly_constructed = TRUE;
+
+  if (CLASS_HAS_PROPS (class))
+    {
+      if (newly_constructed || n_oparams)
+	nqueue = g_object_notify_queue_freeze (object, &property_notify_context);
+      if (newly_constructed)
+	g_object_notify_queue_thaw (object, nqueue);
+    }
 
   /* run 'constructed' handler if there is one */
   if (newly_constructed && class->constructed)
@@ -1238,7 +1320,7 @@ g_object_newv (GType       object_type,
   g_free (oparams);
 
   /* release our own freeze count and handle notifications */
-  if (newly_constructed || n_oparams)
+  if (CLASS_HAS_PROPS (class) && (newly_constructed || n_oparams))
     g_object_notify_queue_thaw (object, nqueue);
 
   if (unref_class)
@@ -1284,10 +1366,7 @@ g_object_new_valist (GType	  object_type,
   while (name)
     {
       gchar *error = NULL;
-      GParamSpec *pspec = g_param_spec_pool_lookup (pspec_pool,
-						    name,
-						    object_type,
-						    TRUE);
+      GParamSpec *pspec = class_find_pspec (class, name);
       if (!pspec)
 	{
 	  g_warning ("%s: object class `%s' has no property named `%s'",
@@ -1390,10 +1469,7 @@ g_object_set_valist (GObject	 *object,
       GParamSpec *pspec;
       gchar *error = NULL;
       
-      pspec = g_param_spec_pool_lookup (pspec_pool,
-					name,
-					G_OBJECT_TYPE (object),
-					TRUE);
+      pspec = class_find_pspec (G_OBJECT_GET_CLASS (object), name);
       if (!pspec)
 	{
 	  g_warning ("%s: object class `%s' has no property named `%s'",
@@ -1472,10 +1548,7 @@ g_object_get_valist (GObject	 *object,
       GParamSpec *pspec;
       gchar *error;
       
-      pspec = g_param_spec_pool_lookup (pspec_pool,
-					name,
-					G_OBJECT_TYPE (object),
-					TRUE);
+      pspec = class_find_pspec (G_OBJECT_GET_CLASS (object), name);
       if (!pspec)
 	{
 	  g_warning ("%s: object class `%s' has no property named `%s'",
@@ -1612,10 +1685,7 @@ g_object_set_property (GObject	    *object,
   g_object_ref (object);
   nqueue = g_object_notify_queue_freeze (object, &property_notify_context);
   
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_TYPE (object),
-				    TRUE);
+  pspec = class_find_pspec (G_OBJECT_GET_CLASS (object), property_name);
   if (!pspec)
     g_warning ("%s: object class `%s' has no property named `%s'",
 	       G_STRFUNC,
@@ -1663,10 +1733,7 @@ g_object_get_property (GObject	   *object,
   
   g_object_ref (object);
   
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_TYPE (object),
-				    TRUE);
+  pspec = class_find_pspec (G_OBJECT_GET_CLASS (object), property_name);
   if (!pspec)
     g_warning ("%s: object class `%s' has no property named `%s'",
 	       G_STRFUNC,
@@ -344,8 +344,10 @@ struct  _GObjectClass
   void	     (*constructed)		(GObject	*object);
 
   /*< private >*/
+  GParamSpec  **pspec_cache;
+  gsize		flags;
   /* padding */
-  gpointer	pdummy[7];
+  gpointer	pdummy[5];
 };
 /**
  * GObjectConstructParam:
@@ -20,13 +20,15 @@
 #ifndef __G_OBJECT_NOTIFY_QUEUE_H__
 #define __G_OBJECT_NOTIFY_QUEUE_H__
 
-#include <string.h> /* memset */
+#include <string.h> /* memcpy */
 
 #include <glib-object.h>
 
 G_BEGIN_DECLS
 
 
+#define G_OBJECT_NOTIFY_QUEUE_PREALLOC 8
+
 /* --- typedefs --- */
 typedef struct _GObjectNotifyContext          GObjectNotifyContext;
 typedef struct _GObjectNotifyQueue            GObjectNotifyQueue;
@@ -45,12 +47,16 @@ struct _GObjectNotifyContext
 struct _GObjectNotifyQueue
 {
   GObjectNotifyContext *context;
-  GSList               *pspecs;
+  GParamSpec          **pspecs;
   guint16               n_pspecs;
   guint16               freeze_count;
-  /* currently, this structure abuses the GList allocation chain and thus
-   * must be <= sizeof (GList)
+  guint16               n_alloced;
+  /* bitset of the (folded) param ids of the queued pspecs; a clear bit
+   * means the pspec is certainly not queued yet, so the common case of
+   * distinct properties is added without scanning the queue.
    */
+  guint32               id_mask;
+  GParamSpec           *pspecs_mem[G_OBJECT_NOTIFY_QUEUE_PREALLOC];
 };
 
 
@@ -60,8 +66,9 @@ g_object_notify_queue_free (gpointer data)
 {
   GObjectNotifyQueue *nqueue = data;
 
-  g_slist_free (nqueue->pspecs);
-  g_list_free_1 ((void*) nqueue);
+  if (nqueue->pspecs != nqueue->pspecs_mem)
+    g_free (nqueue->pspecs);
+  g_slice_free (GObjectNotifyQueue, nqueue);
 }
 
 static inline GObjectNotifyQueue*
@@ -73,9 +80,10 @@ g_object_notify_queue_freeze (GObject		   *object,
   nqueue = g_datalist_id_get_data (&object->qdata, context->quark_notify_queue);
   if (!nqueue)
     {
-      nqueue = (void*) g_list_alloc ();
-      memset (nqueue, 0, sizeof (*nqueue));
+      nqueue = g_slice_new0 (GObjectNotifyQueue);
       nqueue->context = context;
+      nqueue->pspecs = nqueue->pspecs_mem;
+      nqueue->n_alloced = G_OBJECT_NOTIFY_QUEUE_PREALLOC;
       g_datalist_id_set_data_full (&object->qdata, context->quark_notify_queue,
 				   nqueue, g_object_notify_queue_free);
     }
@@ -92,8 +100,7 @@ g_object_notify_queue_thaw (GObject            *object,
 {
   GObjectNotifyContext *context = nqueue->context;
   GParamSpec *pspecs_mem[16], **pspecs, **free_me = NULL;
-  GSList *slist;
-  guint n_pspecs = 0;
+  guint n_pspecs;
 
   g_return_if_fail (nqueue->freeze_count > 0);
 
@@ -102,23 +109,13 @@ g_object_notify_queue_thaw (GObject            *object,
     return;
   g_return_if_fail (object->ref_count > 0);
 
-  pspecs = nqueue->n_pspecs > 16 ? free_me = g_new (GParamSpec*, nqueue->n_pspecs) : pspecs_mem;
-  /* set first entry to NULL since it's checked unconditionally */
-  pspecs[0] = NULL;
-  for (slist = nqueue->pspecs; slist; slist = slist->next)
-    {
-      GParamSpec *pspec = slist->data;
-      guint i = 0;
-
-      /* dedup, make pspecs in the list unique */
-    redo_dedup_check:
-      if (pspecs[i] == pspec)
-	continue;
-      if (++i < n_pspecs)
-	goto redo_dedup_check;
-
-      pspecs[n_pspecs++] = pspec;
-    }
+  /* the queue is unique already (see _add), so we only need to take
+   * a private copy before the queue is destroyed
+   */
+  n_pspecs = nqueue->n_pspecs;
+  pspecs = n_pspecs > 16 ? free_me = g_new (GParamSpec*, n_pspecs) : pspecs_mem;
+  if (n_pspecs)
+    memcpy (pspecs, nqueue->pspecs, n_pspecs * sizeof (GParamSpec*));
   g_datalist_id_set_data (&object->qdata, context->quark_notify_queue, NULL);
 
   if (n_pspecs)
@@ -132,9 +129,8 @@ g_object_notify_queue_clear (GObject            *object,
 {
   g_return_if_fail (nqueue->freeze_count > 0);
 
-  g_slist_free (nqueue->pspecs);
-  nqueue->pspecs = NULL;
   nqueue->n_pspecs = 0;
+  nqueue->id_mask = 0;
 }
 
 static inline void
@@ -145,16 +141,42 @@ g_object_notify_queue_add (GObject            *object,
   if (pspec->flags & G_PARAM_READABLE)
     {
       GParamSpec *redirect;
+      guint32 id_bit;
 
       g_return_if_fail (nqueue->n_pspecs < 65535);
 
       redirect = g_param_spec_get_redirect_target (pspec);
       if (redirect)
 	pspec = redirect;
-	    
-      /* we do the deduping in _thaw */
-      nqueue->pspecs = g_slist_prepend (nqueue->pspecs, pspec);
-      nqueue->n_pspecs++;
+
+      /* dedup, keep pspecs in the queue unique. param ids are only unique
+       * per owner class, so a set bit may still be a false positive.
+       */
+      id_bit = 1 << (pspec->param_id & 31);
+      if (nqueue->id_mask & id_bit)
+	{
+	  guint i;
+
+	  for (i = 0; i < nqueue->n_pspecs; i++)
+	    if (nqueue->pspecs[i] == pspec)
+	      return;
+	}
+
+      if (nqueue->n_pspecs == nqueue->n_alloced)
+	{
+	  guint n_alloced = MIN (nqueue->n_alloced * 2, 65535);
+
+	  if (nqueue->pspecs == nqueue->pspecs_mem)
+	    {
+	      nqueue->pspecs = g_new (GParamSpec*, n_alloced);
+	      memcpy (nqueue->pspecs, nqueue->pspecs_mem, sizeof (nqueue->pspecs_mem));
+	    }
+	  else
+	    nqueue->pspecs = g_renew (GParamSpec*, nqueue->pspecs, n_alloced);
+	  nqueue->n_alloced = n_alloced;
+	}
+      nqueue->pspecs[nqueue->n_pspecs++] = pspec;
+      nqueue->id_mask |= id_bit;
     }
 }
 
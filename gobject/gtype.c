@@ -4050,6 +4050,11 @@ g_type_init_with_debug_flags (GTypeDebugFlags debug_flags)
    */
   g_enum_types_init ();
   
+  /* Value Transformations, registered ahead of the G_TYPE_PARAM and
+   * G_TYPE_OBJECT transforms to keep the transform table append-only
+   */
+  g_value_transforms_init ();
+  
   /* G_TYPE_BOXED
    */
   g_boxed_type_init ();
@@ -4066,10 +4071,6 @@ g_type_init_with_debug_flags (GTypeDebugFlags debug_flags)
    */
   g_param_spec_types_init ();
   
-  /* Value Transformations
-   */
-  g_value_transforms_init ();
-  
   /* Signal system
    */
   g_signal_init ();
@@ -134,7 +134,7 @@ static GBSearchArray *transform_array = NULL;
 static GBSearchConfig transform_bconfig = {
   sizeof (TransformEntry),
   transform_entries_cmp,
-  0,
+  G_BSEARCH_ARRAY_ALIGN_POWER2,
 };
 
 
@@ -441,6 +441,7 @@ g_value_register_transform_func (GType           src_type,
 				 GValueTransform transform_func)
 {
   TransformEntry entry;
+  guint n_nodes;
 
   /* these checks won't pass for dynamic types.
    * g_return_if_fail (G_TYPE_HAS_VALUE_TABLE (src_type));
@@ -460,7 +461,20 @@ g_value_register_transform_func (GType           src_type,
 #endif
 
   entry.func = transform_func;
-  transform_array = g_bsearch_array_replace (transform_array, &transform_bconfig, &entry);
+
+  /* the builtin transforms (and most others) are registered in
+   * ascending type order, so catch appends before searching the
+   * array for the insertion point.
+   */
+  n_nodes = g_bsearch_array_get_n_nodes (transform_array);
+  if (n_nodes == 0 ||
+      transform_entries_cmp (g_bsearch_array_get_nth (transform_array, &transform_bconfig, n_nodes - 1), &entry) < 0)
+    {
+      transform_array = g_bsearch_array_grow (transform_array, &transform_bconfig, n_nodes);
+      memcpy (g_bsearch_array_get_nth (transform_array, &transform_bconfig, n_nodes), &entry, sizeof (entry));
+    }
+  else
+    transform_array = g_bsearch_array_replace (transform_array, &transform_bconfig, &entry);
 }
 
 /**
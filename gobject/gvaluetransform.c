@@ -241,7 +241,8 @@ value_transform_flags_string (const GValue *src_value,
 }
 
 
-/* registration
+/* registration, ordered by source and destination type id so
+ * that each g_value_register_transform_func() call is an append
  */
 void
 g_value_transforms_init (void)
@@ -0,0 +1,325 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#define N_KEYS 8
+#define N_THREADS 8
+#define N_ITERATIONS 20000
+
+static int destroy_count;
+
+static void
+count_destroy (gpointer data)
+{
+  destroy_count++;
+}
+
+static void
+test_datalist_basic (void)
+{
+  GData *list;
+  GQuark one, two;
+  gpointer data;
+
+  one = g_quark_from_static_string ("dataset-one");
+  two = g_quark_from_static_string ("dataset-two");
+
+  g_datalist_init (&list);
+  g_assert (g_datalist_id_get_data (&list, one) == NULL);
+
+  destroy_count = 0;
+  g_datalist_id_set_data_full (&list, one, "a", count_destroy);
+  g_datalist_id_set_data (&list, two, "b");
+  g_assert_cmpstr (g_datalist_id_get_data (&list, one), ==, "a");
+  g_assert_cmpstr (g_datalist_id_get_data (&list, two), ==, "b");
+
+  /* replacing notifies about the old data */
+  g_datalist_id_set_data_full (&list, one, "c", count_destroy);
+  g_assert_cmpint (destroy_count, ==, 1);
+  g_assert_cmpstr (g_datalist_id_get_data (&list, one), ==, "c");
+
+  /* stealing doesn't */
+  data = g_datalist_id_remove_no_notify (&list, one);
+  g_assert_cmpstr (data, ==, "c");
+  g_assert_cmpint (destroy_count, ==, 1);
+  g_assert (g_datalist_id_get_data (&list, one) == NULL);
+
+  g_datalist_id_set_data_full (&list, one, "d", count_destroy);
+  g_datalist_id_remove_data (&list, one);
+  g_assert_cmpint (destroy_count, ==, 2);
+
+  g_datalist_id_set_data_full (&list, one, "e", count_destroy);
+  g_datalist_clear (&list);
+  g_assert_cmpint (destroy_count, ==, 3);
+  g_assert (g_datalist_id_get_data (&list, two) == NULL);
+}
+
+static void
+collect_keys (GQuark   key_id,
+	      gpointer data,
+	      gpointer user_data)
+{
+  GString *keys = user_data;
+
+  g_assert_cmpint (GPOINTER_TO_INT (data), ==, key_id);
+  g_string_append_c (keys, g_quark_to_string (key_id)[strlen ("dataset-key-")]);
+}
+
+static void
+test_datalist_remove (void)
+{
+  GQuark keys[N_KEYS];
+  GString *seen;
+  GData *list;
+  char name[32];
+  int i;
+
+  for (i = 0; i < N_KEYS; i++)
+    {
+      g_snprintf (name, sizeof (name), "dataset-key-%d", i);
+      keys[i] = g_quark_from_string (name);
+    }
+
+  g_datalist_init (&list);
+  for (i = 0; i < N_KEYS; i++)
+    g_datalist_id_set_data (&list, keys[i], GINT_TO_POINTER (keys[i]));
+
+  /* removal from the middle moves the last element, removal of the
+   * first and last elements must work too; every other key stays
+   * reachable and is visited exactly once
+   */
+  g_datalist_id_remove_data (&list, keys[2]);
+  g_datalist_id_remove_data (&list, keys[0]);
+  g_datalist_id_remove_data (&list, keys[N_KEYS - 1]);
+
+  for (i = 0; i < N_KEYS; i++)
+    {
+      if (i == 0 || i == 2 || i == N_KEYS - 1)
+	g_assert (g_datalist_id_get_data (&list, keys[i]) == NULL);
+      else
+	g_assert_cmpint (GPOINTER_TO_INT (g_datalist_id_get_data (&list, keys[i])), ==, keys[i]);
+    }
+
+  seen = g_string_new (NULL);
+  g_datalist_foreach (&list, collect_keys, seen);
+  g_assert_cmpint (seen->len, ==, N_KEYS - 3);
+  for (i = 1; i < N_KEYS - 1; i++)
+    if (i != 2)
+      g_assert (strchr (seen->str, '0' + i) != NULL);
+  g_string_free (seen, TRUE);
+
+  /* removing everything frees the list */
+  for (i = 0; i < N_KEYS; i++)
+    g_datalist_id_remove_data (&list, keys[i]);
+  g_assert (list == NULL);
+}
+
+static GData *reentrant_list;
+static GQuark reentrant_key;
+static GQuark reentrant_other_key;
+
+static void
+reentrant_destroy (gpointer data)
+{
+  /* the list is unlocked while notifiers run, so they may use it */
+  g_assert (g_datalist_id_get_data (&reentrant_list, reentrant_key) != data);
+  g_datalist_id_set_data (&reentrant_list, reentrant_other_key, data);
+  destroy_count++;
+}
+
+static void
+clear_destroy (gpointer data)
+{
+  /* adding data while the list is cleared gets cleared too */
+  if (destroy_count++ == 0)
+    g_datalist_id_set_data_full (&reentrant_list, reentrant_key,
+				 "again", clear_destroy);
+}
+
+static void
+test_datalist_reentrant (void)
+{
+  reentrant_key = g_quark_from_static_string ("dataset-reentrant");
+  reentrant_other_key = g_quark_from_static_string ("dataset-reentrant-other");
+
+  g_datalist_init (&reentrant_list);
+  destroy_count = 0;
+
+  /* from a replace */
+  g_datalist_id_set_data_full (&reentrant_list, reentrant_key, "a", reentrant_destroy);
+  g_datalist_id_set_data_full (&reentrant_list, reentrant_key, "b", reentrant_destroy);
+  g_assert_cmpint (destroy_count, ==, 1);
+  g_assert_cmpstr (g_datalist_id_get_data (&reentrant_list, reentrant_other_key), ==, "a");
+  g_assert_cmpstr (g_datalist_id_get_data (&reentrant_list, reentrant_key), ==, "b");
+
+  /* from a remove */
+  g_datalist_id_remove_data (&reentrant_list, reentrant_key);
+  g_assert_cmpint (destroy_count, ==, 2);
+  g_assert (g_datalist_id_get_data (&reentrant_list, reentrant_key) == NULL);
+  g_assert_cmpstr (g_datalist_id_get_data (&reentrant_list, reentrant_other_key), ==, "b");
+
+  /* from a clear */
+  g_datalist_clear (&reentrant_list);
+  destroy_count = 0;
+  g_datalist_id_set_data_full (&reentrant_list, reentrant_key, "a", clear_destroy);
+  g_datalist_clear (&reentrant_list);
+  g_assert_cmpint (destroy_count, ==, 2);
+  g_assert (reentrant_list == NULL);
+}
+
+static int dataset_location;
+
+static void
+dataset_destroy (gpointer data)
+{
+  /* g_dataset_global is not held while notifiers run */
+  g_assert (g_dataset_get_data (&dataset_location, "dataset-a") != data);
+  g_dataset_set_data (&dataset_location, "dataset-b", data);
+  destroy_count++;
+}
+
+static void
+collect_dataset (GQuark   key_id,
+		 gpointer data,
+		 gpointer user_data)
+{
+  (*(int *) user_data)++;
+}
+
+static void
+test_dataset (void)
+{
+  int n;
+
+  destroy_count = 0;
+  g_dataset_set_data_full (&dataset_location, "dataset-a", "a", dataset_destroy);
+  g_dataset_set_data_full (&dataset_location, "dataset-a", "b", dataset_destroy);
+  g_assert_cmpint (destroy_count, ==, 1);
+  g_assert_cmpstr (g_dataset_get_data (&dataset_location, "dataset-a"), ==, "b");
+  g_assert_cmpstr (g_dataset_get_data (&dataset_location, "dataset-b"), ==, "a");
+
+  n = 0;
+  g_dataset_foreach (&dataset_location, collect_dataset, &n);
+  g_assert_cmpint (n, ==, 2);
+
+  g_assert_cmpstr (g_dataset_remove_no_notify (&dataset_location, "dataset-b"), ==, "a");
+  g_dataset_remove_data (&dataset_location, "dataset-a");
+  g_assert_cmpint (destroy_count, ==, 2);
+  g_assert_cmpstr (g_dataset_get_data (&dataset_location, "dataset-b"), ==, "b");
+
+  g_dataset_set_data_full (&dataset_location, "dataset-a", "c", dataset_destroy);
+  g_dataset_destroy (&dataset_location);
+  g_assert_cmpint (destroy_count, ==, 3);
+  g_assert (g_dataset_get_data (&dataset_location, "dataset-a") == NULL);
+  g_assert (g_dataset_get_data (&dataset_location, "dataset-b") == NULL);
+}
+
+static GData *shared_list;
+static GQuark shared_keys[N_THREADS];
+static GQuark shared_key;
+static volatile gint shared_destroy_count;
+
+static void
+shared_destroy (gpointer data)
+{
+  g_atomic_int_inc (&shared_destroy_count);
+}
+
+static gpointer
+datalist_thread (gpointer data)
+{
+  int n = GPOINTER_TO_INT (data);
+  GQuark key = shared_keys[n];
+  int i;
+
+  for (i = 0; i < N_ITERATIONS; i++)
+    {
+      g_datalist_id_set_data_full (&shared_list, key, GINT_TO_POINTER (i + 1), shared_destroy);
+      g_assert_cmpint (GPOINTER_TO_INT (g_datalist_id_get_data (&shared_list, key)), ==, i + 1);
+
+      /* contend on one key as well */
+      g_datalist_id_set_data_full (&shared_list, shared_key, GINT_TO_POINTER (n + 1), shared_destroy);
+      g_datalist_id_get_data (&shared_list, shared_key);
+
+      if (i % 2)
+	g_datalist_id_remove_data (&shared_list, key);
+
+      /* the flags live in the same pointer as the lock */
+      if (n == 0)
+	g_datalist_set_flags (&shared_list, 1);
+    }
+
+  return NULL;
+}
+
+static void
+test_datalist_threads (void)
+{
+  GThread *threads[N_THREADS];
+  char name[32];
+  int i;
+
+  for (i = 0; i < N_THREADS; i++)
+    {
+      g_snprintf (name, sizeof (name), "dataset-thread-%d", i);
+      shared_keys[i] = g_quark_from_string (name);
+    }
+  shared_key = g_quark_from_static_string ("dataset-shared");
+
+  g_datalist_init (&shared_list);
+  shared_destroy_count = 0;
+
+  for (i = 0; i < N_THREADS; i++)
+    threads[i] = g_thread_create (datalist_thread, GINT_TO_POINTER (i), TRUE, NULL);
+  for (i = 0; i < N_THREADS; i++)
+    g_thread_join (threads[i]);
+
+  /* every key ended with a remove, every set was notified except the
+   * single remaining value of the shared key
+   */
+  for (i = 0; i < N_THREADS; i++)
+    g_assert (g_datalist_id_get_data (&shared_list, shared_keys[i]) == NULL);
+  g_assert (g_datalist_id_get_data (&shared_list, shared_key) != NULL);
+  g_assert_cmpint (shared_destroy_count, ==, N_THREADS * N_ITERATIONS * 2 - 1);
+  g_assert_cmpint (g_datalist_get_flags (&shared_list), ==, 1);
+
+  g_datalist_unset_flags (&shared_list, 1);
+  g_datalist_clear (&shared_list);
+  g_assert (shared_list == NULL);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_thread_init (NULL);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/dataset/datalist-basic", test_datalist_basic);
+  g_test_add_func ("/dataset/datalist-remove", test_datalist_remove);
+  g_test_add_func ("/dataset/datalist-reentrant", test_datalist_reentrant);
+  g_test_add_func ("/dataset/dataset", test_dataset);
+  g_test_add_func ("/dataset/datalist-threads", test_datalist_threads);
+
+  return g_test_run ();
+}
@@ -0,0 +1,489 @@
+/* GObject - GLib Type, Object, Parameter and Signal Library
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#undef	G_LOG_DOMAIN
+#define	G_LOG_DOMAIN "TestPerformance"
+
+#undef G_DISABLE_ASSERT
+#undef G_DISABLE_CHECKS
+#undef G_DISABLE_CAST_CHECKS
+
+#include <string.h>
+#include <glib-object.h>
+
+/* This is a benchmark, not a regression test: it times common GObject
+ * operations and prints the rate at which they run, after reporting how
+ * long type system startup took. Pass test names on the command line to
+ * run only those.
+ */
+
+#define TARGET_ROUND_TIME 0.008
+#define DEFAULT_TEST_TIME 2 /* seconds */
+
+static gdouble test_length = DEFAULT_TEST_TIME;
+static gboolean verbose = FALSE;
+
+static GOptionEntry cmd_entries[] = {
+  {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+   "Print extra information", NULL},
+  {"seconds", 's', 0, G_OPTION_ARG_DOUBLE, &test_length,
+   "Time to run each test in seconds", NULL},
+  {NULL}
+};
+
+typedef struct _PerformanceTest PerformanceTest;
+struct _PerformanceTest
+{
+  const char *name;
+  gpointer (*setup)    (PerformanceTest *test);
+  void     (*run)      (PerformanceTest *test,
+                        gpointer         data,
+                        guint            n_iterations);
+  void     (*teardown) (PerformanceTest *test,
+                        gpointer         data);
+  const char *unit;
+};
+
+/*
+ * Simple objects, without properties
+ */
+#define SIMPLE_TYPE_OBJECT        (simple_object_get_type ())
+typedef struct _SimpleObject      SimpleObject;
+typedef struct _SimpleObjectClass SimpleObjectClass;
+
+struct _SimpleObject
+{
+  GObject parent_instance;
+  int val;
+};
+
+struct _SimpleObjectClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (SimpleObject, simple_object, G_TYPE_OBJECT);
+
+static void
+simple_object_class_init (SimpleObjectClass *class)
+{
+}
+
+static void
+simple_object_init (SimpleObject *simple_object)
+{
+  simple_object->val = 42;
+}
+
+/*
+ * Objects with properties
+ */
+#define COMPLEX_TYPE_OBJECT          (complex_object_get_type ())
+#define COMPLEX_OBJECT(object)       (G_TYPE_CHECK_INSTANCE_CAST ((object), COMPLEX_TYPE_OBJECT, ComplexObject))
+typedef struct _ComplexObject        ComplexObject;
+typedef struct _ComplexObjectClass   ComplexObjectClass;
+
+struct _ComplexObject
+{
+  GObject parent_instance;
+  int val1;
+  int val2;
+  int val3;
+  char *str1;
+  gboolean flag1;
+};
+
+struct _ComplexObjectClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (ComplexObject, complex_object, G_TYPE_OBJECT);
+
+enum {
+  PROP_0,
+  PROP_VAL1,
+  PROP_VAL2,
+  PROP_VAL3,
+  PROP_STR1,
+  PROP_FLAG1
+};
+
+static void
+complex_object_finalize (GObject *object)
+{
+  ComplexObject *c = COMPLEX_OBJECT (object);
+
+  g_free (c->str1);
+
+  G_OBJECT_CLASS (complex_object_parent_class)->finalize (object);
+}
+
+static void
+complex_object_set_property (GObject         *object,
+                             guint            prop_id,
+                             const GValue    *value,
+                             GParamSpec      *pspec)
+{
+  ComplexObject *complex = COMPLEX_OBJECT (object);
+
+  switch (prop_id)
+    {
+    case PROP_VAL1:
+      complex->val1 = g_value_get_int (value);
+      break;
+    case PROP_VAL2:
+      complex->val2 = g_value_get_int (value);
+      break;
+    case PROP_VAL3:
+      complex->val3 = g_value_get_int (value);
+      break;
+    case PROP_STR1:
+      g_free (complex->str1);
+      complex->str1 = g_value_dup_string (value);
+      break;
+    case PROP_FLAG1:
+      complex->flag1 = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+complex_object_get_property (GObject         *object,
+                             guint            prop_id,
+                             GValue          *value,
+                             GParamSpec      *pspec)
+{
+  ComplexObject *complex = COMPLEX_OBJECT (object);
+
+  switch (prop_id)
+    {
+    case PROP_VAL1:
+      g_value_set_int (value, complex->val1);
+      break;
+    case PROP_VAL2:
+      g_value_set_int (value, complex->val2);
+      break;
+    case PROP_VAL3:
+      g_value_set_int (value, complex->val3);
+      break;
+    case PROP_STR1:
+      g_value_set_string (value, complex->str1);
+      break;
+    case PROP_FLAG1:
+      g_value_set_boolean (value, complex->flag1);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+complex_object_class_init (ComplexObjectClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->finalize = complex_object_finalize;
+  object_class->set_property = complex_object_set_property;
+  object_class->get_property = complex_object_get_property;
+
+  g_object_class_install_property (object_class,
+				   PROP_VAL1,
+				   g_param_spec_int ("val1",
+						     "val1",
+						     "val1",
+						     0,
+						     G_MAXINT,
+						     42,
+						     G_PARAM_READWRITE));
+  g_object_class_install_property (object_class,
+				   PROP_VAL2,
+				   g_param_spec_int ("val2",
+						     "val2",
+						     "val2",
+						     0,
+						     G_MAXINT,
+						     43,
+						     G_PARAM_READWRITE));
+  g_object_class_install_property (object_class,
+				   PROP_VAL3,
+				   g_param_spec_int ("val3",
+						     "val3",
+						     "val3",
+						     0,
+						     G_MAXINT,
+						     44,
+						     G_PARAM_READWRITE));
+  g_object_class_install_property (object_class,
+				   PROP_STR1,
+				   g_param_spec_string ("str1",
+							"str1",
+							"str1",
+							"Default",
+							G_PARAM_READWRITE));
+  g_object_class_install_property (object_class,
+				   PROP_FLAG1,
+				   g_param_spec_boolean ("flag1",
+							 "flag1",
+							 "flag1",
+							 FALSE,
+							 G_PARAM_READWRITE));
+}
+
+static void
+complex_object_init (ComplexObject *complex_object)
+{
+  complex_object->val1 = 42;
+  complex_object->val2 = 43;
+  complex_object->val3 = 44;
+}
+
+/*
+ * Test property set/get
+ */
+static gpointer
+test_set_properties_setup (PerformanceTest *test)
+{
+  return g_object_new (COMPLEX_TYPE_OBJECT, NULL);
+}
+
+static void
+test_set_properties_run (PerformanceTest *test,
+                         gpointer         data,
+                         guint            n_iterations)
+{
+  GObject *object = data;
+  guint i;
+
+  for (i = 0; i < n_iterations; i++)
+    g_object_set (object,
+                  "val1", i,
+                  "val2", i + 1,
+                  "val3", i + 2,
+                  "str1", "Hello",
+                  "flag1", (i & 1),
+                  NULL);
+}
+
+static void
+test_get_properties_run (PerformanceTest *test,
+                         gpointer         data,
+                         guint            n_iterations)
+{
+  GObject *object = data;
+  int val1, val2, val3;
+  gboolean flag1;
+  guint i;
+
+  for (i = 0; i < n_iterations; i++)
+    g_object_get (object,
+                  "val1", &val1,
+                  "val2", &val2,
+                  "val3", &val3,
+                  "flag1", &flag1,
+                  NULL);
+}
+
+static void
+test_object_teardown (PerformanceTest *test,
+                      gpointer         data)
+{
+  g_object_unref (data);
+}
+
+/*
+ * Test object construction
+ */
+static gpointer
+test_construction_setup (PerformanceTest *test)
+{
+  GType *type = g_new (GType, 1);
+
+  if (strcmp (test->name, "simple-construction") == 0)
+    *type = SIMPLE_TYPE_OBJECT;
+  else
+    *type = COMPLEX_TYPE_OBJECT;
+
+  /* make sure the class is initialized outside of the timed loop */
+  g_type_class_ref (*type);
+
+  return type;
+}
+
+static void
+test_construction_run (PerformanceTest *test,
+                       gpointer         data,
+                       guint            n_iterations)
+{
+  GType type = *(GType *) data;
+  guint i;
+
+  for (i = 0; i < n_iterations; i++)
+    g_object_unref (g_object_new (type, NULL));
+}
+
+static void
+test_construction_teardown (PerformanceTest *test,
+                            gpointer         data)
+{
+  GType *type = data;
+
+  g_type_class_unref (g_type_class_peek (*type));
+  g_free (type);
+}
+
+static PerformanceTest tests[] = {
+  {
+    "set-properties",
+    test_set_properties_setup,
+    test_set_properties_run,
+    test_object_teardown,
+    "g_object_set of 5 properties"
+  },
+  {
+    "get-properties",
+    test_set_properties_setup,
+    test_get_properties_run,
+    test_object_teardown,
+    "g_object_get of 4 properties"
+  },
+  {
+    "simple-construction",
+    test_construction_setup,
+    test_construction_run,
+    test_construction_teardown,
+    "objects created and destroyed"
+  },
+  {
+    "complex-construction",
+    test_construction_setup,
+    test_construction_run,
+    test_construction_teardown,
+    "objects created and destroyed"
+  }
+};
+
+static PerformanceTest *
+find_test (const char *name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (tests); i++)
+    if (strcmp (tests[i].name, name) == 0)
+      return &tests[i];
+
+  return NULL;
+}
+
+static void
+run_test (PerformanceTest *test)
+{
+  gpointer data;
+  GTimer *timer;
+  guint n_iterations = 1;
+  guint64 total_iterations = 0;
+  gdouble elapsed, total_elapsed = 0;
+
+  g_print ("Running test %s\n", test->name);
+
+  data = test->setup (test);
+  timer = g_timer_new ();
+
+  /* find a round size that takes about TARGET_ROUND_TIME */
+  while (TRUE)
+    {
+      g_timer_start (timer);
+      test->run (test, data, n_iterations);
+      elapsed = g_timer_elapsed (timer, NULL);
+      if (elapsed >= TARGET_ROUND_TIME || n_iterations >= G_MAXUINT / 2)
+        break;
+      n_iterations *= 2;
+    }
+
+  while (total_elapsed < test_length)
+    {
+      g_timer_start (timer);
+      test->run (test, data, n_iterations);
+      elapsed = g_timer_elapsed (timer, NULL);
+      total_elapsed += elapsed;
+      total_iterations += n_iterations;
+
+      if (verbose)
+        g_print ("  %u iterations in %.4f seconds\n", n_iterations, elapsed);
+    }
+
+  g_timer_destroy (timer);
+  test->teardown (test, data);
+
+  g_print ("%.0f %s per second\n",
+           total_iterations / total_elapsed, test->unit);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  PerformanceTest *test;
+  GOptionContext *context;
+  GError *error = NULL;
+  GTimer *timer;
+  gdouble type_init_time;
+  int i;
+
+  /* g_type_init() only does work once per process, so it can't be run
+   * in a loop like the other tests; time the single call instead.
+   */
+  timer = g_timer_new ();
+  g_type_init ();
+  type_init_time = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  context = g_option_context_new ("GObject performance tests");
+  g_option_context_add_main_entries (context, cmd_entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s: %s\n", argv[0], error->message);
+      return 1;
+    }
+
+  g_print ("g_type_init() took %.1f usec\n", type_init_time * 1000000);
+
+  if (argc > 1)
+    {
+      for (i = 1; i < argc; i++)
+	{
+	  test = find_test (argv[i]);
+	  if (test)
+	    run_test (test);
+	  else
+	    g_printerr ("%s: unknown test %s\n", argv[0], argv[i]);
+	}
+    }
+  else
+    {
+      for (i = 0; i < G_N_ELEMENTS (tests); i++)
+	run_test (&tests[i]);
+    }
+
+  return 0;
+}